@@ -0,0 +1,404 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Benchmarks for the 2D programme.
+
+Times dft(), dft_single(), the construct_*() generators and
+write_datafile() over a sweep of grid sizes, and dft() over inputs
+of different density:
+a slit, random points at several fill fractions, which go through
+the direct sum when there are only a few of them and the row-column
+FFT otherwise, and dense real and real, even points, which take the
+real and the cosine transforms.  Results are printed as comma separated
+values (timing.c), one line per kernel, input and size, with a
+comment line giving the error of dft_single() against dft().
+
+The programme's own sources are linked in with -DDFT_NO_MAIN, so the
+code timed is exactly the code that runs:
+
+gcc -O2 -DDFT_NO_MAIN -o bench2d bench.c fourier.c io.c ../fft.c ../realfft.c
+		../twiddle.c ../threads.c ../simd.c ../datafile.c ../arena.c ../tune.c ../timing.c ../render.c
+		-lm -lpthread
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "header.h"
+#include "../timing.h"
+
+// Shortest time each measurement is taken over, in seconds
+#define BENCH_MIN_SECONDS 0.2
+// Most sizes or densities that can be given
+#define BENCH_MAX_LIST 32
+
+/* The arguments of the call being timed */
+struct bench_args {
+	double complex *input;
+	double complex *output;
+	dft_context *ctx;
+	// for dft_single_call(): a context of single precision
+	dft_context *single;
+	// for write_call(): precision of the data file
+	int precision;
+};
+
+static void dft_call(void *arg) {
+	struct bench_args *args = arg;
+
+	if (dft(args->ctx, args->input, args->output) != 0) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+}
+
+static void dft_single_call(void *arg) {
+	struct bench_args *args = arg;
+
+	if (dft_single(args->single, args->single->real_single, args->single->freq_single) != 0) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+}
+
+static void single_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_single(args->ctx, args->output, 0, 0, 1.0);
+}
+
+static void squares_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_squares(args->ctx, args->output, 0, 0, 3, 3, 1.0);
+}
+
+static void slit_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_slit(args->ctx, args->output, 0, 0, 3, 20, 1.0);
+}
+
+static void doubleslit_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_doubleslit(args->ctx, args->output, 0, 0, 3, 30, 10, 1.0);
+}
+
+static void write_call(void *arg) {
+	struct bench_args *args = arg;
+
+	args->ctx->output_precision = args->precision;
+	if (write_datafile(args->ctx, args->input, "bench") != 0) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+}
+
+/* Fill the 2N x 2M points with random values at a random fraction of them
+	 and zero elsewhere.  The generator is seeded afresh each time,
+	 so every run sees the same input. */
+static void fill_random(double complex *output, double fraction) {
+	// index variable
+	int i;
+	// state of the generator
+	unsigned long long state = 88172645463325252ULL;
+	// uniform deviates in [0, 1)
+	double r[3];
+	int k;
+	const int N = plan->N, M = plan->M;
+
+	for (i = 0; i < 4*N*M; i++) {
+		for (k = 0; k < 3; k++) {
+			// xorshift64
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			r[k] = (double)(state >> 11) / 9007199254740992.0;
+		}
+		*(output + i) = (r[0] < fraction) ? CMPLX(r[1] - 0.5, r[2] - 0.5) : 0.0;
+	}
+}
+
+/* Drop the imaginary parts of the 2N x 2M points, and if even is
+	 set make them even in x and y too, so that dft() takes its real
+	 or its cosine transform path. */
+static void make_real(double complex *output, int even) {
+	// index variables
+	int i, j;
+	const int N = plan->N, M = plan->M;
+
+	for (i = -N; i < N; i++) {
+		for (j = -M; j < M; j++) {
+			*(output + indexof(i, j)) = creal(*(output + indexof(i, j)));
+		}
+	}
+	if (even) {
+		for (i = -N; i < N; i++) {
+			for (j = 1; j < M; j++) {
+				*(output + indexof(i, -j)) = *(output + indexof(i, j));
+			}
+		}
+		for (i = 1; i < N; i++) {
+			for (j = -M; j < M; j++) {
+				*(output + indexof(-i, j)) = *(output + indexof(i, j));
+			}
+		}
+	}
+}
+
+/* The largest difference between the single precision F(u,v) and
+	 the double precision one, over the largest |F(u,v)| */
+static double single_error(double complex *reference, float complex *single) {
+	// index variable
+	int i;
+	// the largest difference and the largest point
+	double worst = 0.0, largest = 0.0;
+	const int N = plan->N, M = plan->M;
+
+	for (i = 0; i < 4*N*M; i++) {
+		if (cabs(*(reference + i) - *(single + i)) > worst) {
+			worst = cabs(*(reference + i) - *(single + i));
+		}
+		if (cabs(*(reference + i)) > largest) {
+			largest = cabs(*(reference + i));
+		}
+	}
+	return (largest > 0.0) ? worst / largest : 0.0;
+}
+
+/* Read a comma separated list of numbers into values.
+
+	 arg[]: the list
+	 *values: where to store the numbers
+
+	 Returns how many there were, or 0 if arg is not such a list.
+	 */
+static int parse_list(char arg[], double *values) {
+	// number read so far
+	int n = 0;
+	// character after the number
+	char *end;
+
+	for (;;) {
+		if (n == BENCH_MAX_LIST) {
+			return 0;
+		}
+		*(values + n) = strtod(arg, &end);
+		if (end == arg || *(values + n) <= 0.0) {
+			return 0;
+		}
+		n++;
+		if (*end == '\0') {
+			return n;
+		}
+		if (*end != ',') {
+			return 0;
+		}
+		arg = end + 1;
+	}
+}
+
+/* Time and report the data file writes for one size.  Each file is
+	 removed again once its size is known. */
+static void bench_write(struct bench_args *args, int layout) {
+	// index variable
+	int i;
+	// the formats, their names and the extensions of their files
+	const int precisions[3] = {DATAFILE_FLOAT64, DATAFILE_FLOAT32, DATAFILE_TEXT};
+	const char *names[3] = {"write_datafile_f64", "write_datafile_f32", "write_datafile_text"};
+	const char *extensions[3] = {"bin", "bin", "dat"};
+	// name and size of the file written
+	char filename[80] = { };
+	struct stat info;
+	// time of one write
+	double seconds;
+	const int N = plan->N, M = plan->M;
+
+	for (i = 0; i < 3; i++) {
+		args->precision = precisions[i];
+		seconds = time_call(write_call, args, BENCH_MIN_SECONDS);
+		snprintf(filename, sizeof(filename), "data/data_bench_m0_N%d_M%d.%s", N, M, extensions[i]);
+		if (stat(filename, &info) != 0) {
+			printf("Unable to open file to write data\n");
+			_exit(4);
+		}
+		report(names[i], "random1", N, M, layout, seconds, 4.0*N*M, 0.0, (double)info.st_size);
+		remove(filename);
+	}
+}
+
+/* Time every kernel at one size.
+
+	 N, M: x runs from -N to N-1, y from -M to M-1
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+	 *densities, ndensities: fill fractions of the random inputs
+	 */
+static void bench_size(int N, int M, int layout, int pages, double *densities, int ndensities) {
+	// index variable
+	int i;
+	// the context the kernels run in, as in the programme, and the
+	// arrays of it they work on, and one of single precision
+	dft_context *ctx, *single;
+	double complex *a, *c;
+	// arguments of the call being timed
+	struct bench_args args;
+	// description of the input, and time of one call
+	char input[32] = { };
+	double seconds;
+	// points in the grid, and bytes in one array
+	double points = 4.0*N*M;
+	double bytes = points * sizeof(double complex);
+
+	if ( (plan = dft_plan_create(N, M, layout)) == NULL
+		|| (ctx = dft_context_create(plan, DATAFILE_FLOAT64, pages)) == NULL
+		|| (single = dft_context_create(plan, DATAFILE_FLOAT32, pages)) == NULL ) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+	a = ctx->real_space;
+	c = ctx->freq_space;
+	args.input = a;
+	args.output = c;
+	args.ctx = ctx;
+	args.single = single;
+
+	// The generators
+	report("construct_single", "none", N, M, layout,
+				 time_call(single_call, &args, BENCH_MIN_SECONDS), points, 0.0, bytes);
+	report("construct_squares", "none", N, M, layout,
+				 time_call(squares_call, &args, BENCH_MIN_SECONDS), points, 0.0, bytes);
+	report("construct_slit", "none", N, M, layout,
+				 time_call(slit_call, &args, BENCH_MIN_SECONDS), points, 0.0, bytes);
+	report("construct_doubleslit", "none", N, M, layout,
+				 time_call(doubleslit_call, &args, BENCH_MIN_SECONDS), points, 0.0, bytes);
+
+	// dft() on a slit, then on random input of each density.  The
+	// flop count is that of the 2N x 2M FFT.
+	construct_slit(ctx, a, 0, 0, 3, 20, 1.0);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "slit", N, M, layout, seconds, points, fft_flops(points), 2.0*bytes);
+	for (i = 0; i < ndensities; i++) {
+		fill_random(a, *(densities + i));
+		snprintf(input, sizeof(input), "random%g", *(densities + i));
+		seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+		report("dft", input, N, M, layout, seconds, points, fft_flops(points), 2.0*bytes);
+	}
+	// Dense real input, then real and even, with the flop count still
+	// that of the complex FFT so that the rates compare directly
+	fill_random(a, 1.0);
+	make_real(a, 0);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "real1", N, M, layout, seconds, points, fft_flops(points), 2.0*bytes);
+	make_real(a, 1);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "even1", N, M, layout, seconds, points, fft_flops(points), 2.0*bytes);
+
+	// dft_single() always takes the row-column FFT, so dense random
+	// input shows it against dft() on the same work, with its error
+	fill_random(a, 1.0);
+	for (i = 0; i < 4*N*M; i++) {
+		*(single->real_single + i) = *(a + i);
+	}
+	seconds = time_call(dft_single_call, &args, BENCH_MIN_SECONDS);
+	report("dft_single", "random1", N, M, layout, seconds, points, fft_flops(points), bytes);
+	dft(ctx, a, c);
+	report_error("dft_single", "random1", N, M, single_error(c, single->freq_single));
+
+	fill_random(a, 1.0);
+	bench_write(&args, layout);
+
+	dft_context_destroy(single);
+	dft_context_destroy(ctx);
+	dft_plan_destroy(plan);
+	plan = NULL;
+}
+
+/* Display the options */
+static void bench_help(void) {
+	printf("Options:\n\n"
+				 "-N list             Sizes to sweep, comma separated, with\n"
+				 "                    M = N (default 50,100,200,500,1000)\n"
+				 "-d list             Fill fractions of the random inputs\n"
+				 "                    (default 0.0001,0.01,1)\n"
+				 "-t int              Number of threads (default one per\n"
+				 "                    processor)\n"
+				 "-split              Use the split layout\n"
+				 "-simd int           Highest instruction set to use: 0 scalar,\n"
+				 "                    1 SSE2, 2 AVX2, 3 AVX-512\n"
+				 "-huge off|thp|tlb   Pages for the arrays (default thp)\n\n"
+				 "Data files are written to, and removed from, data/ in the\n"
+				 "current directory.\n");
+}
+
+int main(int argc, char *argv[]) {
+	// index variable
+	int i;
+	// the sweep
+	double sizes[BENCH_MAX_LIST] = {50, 100, 200, 500, 1000};
+	double densities[BENCH_MAX_LIST] = {0.0001, 0.01, 1};
+	int nsizes = 5, ndensities = 3;
+	// Number of threads, 0 for one per processor
+	int threads = 0;
+	// How the transforms hold the data
+	int layout = LAYOUT_INTERLEAVED;
+	// Pages for the arrays
+	int pages = ARENA_THP;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-N") == 0 && i+1 < argc) {
+			if ((nsizes = parse_list(argv[++i], sizes)) == 0) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-d") == 0 && i+1 < argc) {
+			if ((ndensities = parse_list(argv[++i], densities)) == 0) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+			if ((threads = atoi(argv[++i])) < 1) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-split") == 0) {
+			layout = LAYOUT_SPLIT;
+		} else if (strcmp(argv[i], "-simd") == 0 && i+1 < argc) {
+			simd_select(atoi(argv[++i]));
+		} else if (strcmp(argv[i], "-huge") == 0 && i+1 < argc) {
+			i++;
+			if (strcmp(argv[i], "off") == 0) {
+				pages = ARENA_SMALL;
+			} else if (strcmp(argv[i], "thp") == 0) {
+				pages = ARENA_THP;
+			} else if (strcmp(argv[i], "tlb") == 0) {
+				pages = ARENA_HUGETLB;
+			} else {
+				bench_help();
+				return 2;
+			}
+		} else {
+			bench_help();
+			return 2;
+		}
+	}
+
+	// write_datafile() needs somewhere to write
+	mkdir("data", 0755);
+	threads_init(threads);
+
+	report_header();
+	for (i = 0; i < nsizes; i++) {
+		bench_size((int)sizes[i], (int)sizes[i], layout, pages, densities, ndensities);
+	}
+
+	threads_shutdown();
+	return 0;
+}
@@ -0,0 +1,432 @@
+/*
+2D DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Convolution and correlation of grids.
+
+As in 1D, convolving two grids is multiplying their transforms.
+Both are padded with zeros to a grid at least half as big again
+along each side, so that the circular convolution the FFT gives
+does not wrap around onto the points kept, and the padded grids go
+through dft() itself on a plan of that size.  dft() works with the
+origin at the middle of the grid, which the convolution theorem
+does not mind, and its inverse is its conjugate, so one plan does
+both ways.
+
+Most point spread functions are small and separable, a function of
+x times a function of y, like a Gaussian.  Those are better summed
+directly, a row pass then a column pass, at a cost per point of the
+kernel's width plus its height.  convolve() and correlate() spot
+such kernels and take that path themselves.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#include <limits.h>
+#include "header.h"
+
+/* Arguments for the loops below, which parallel_for() shares out
+	 among the threads a range of rows at a time. */
+struct conv_args {
+	// the grid half-sizes of the input and output, and of the padded
+	// grids
+	int N;
+	int M;
+	int padded_N;
+	int padded_M;
+	double complex *input;
+	double complex *output;
+	// for product_body(): the second spectrum, whether to conjugate
+	// the first, and the scale
+	double complex *spectrum;
+	int correlate;
+	double scale;
+	// for the separable passes: the kernel's factors along x and y,
+	// their lengths and the offset of their first points
+	double complex *kernel_x;
+	double complex *kernel_y;
+	int nx;
+	int ny;
+	int x_first;
+	int y_first;
+};
+
+/* Rows first to last-1 of the grid into the middle of the padded
+	 grid, and the rows of the padded grid beyond it zeroed */
+static void pad_body(void *arg, int chunk, int first, int last) {
+	struct conv_args *args = arg;
+	// index variable, and the row in the grid
+	int i, row;
+	double complex *padded;
+	const int N = args->N, M = args->M, padded_M = args->padded_M;
+
+	for (i = first; i < last; i++) {
+		padded = args->output + (size_t)i*2*padded_M;
+		row = i - args->padded_N + N;
+		if (row < 0 || row >= 2*N) {
+			memset(padded, 0, 2*(size_t)padded_M * sizeof(double complex));
+			continue;
+		}
+		memset(padded, 0, (size_t)(padded_M - M) * sizeof(double complex));
+		memcpy(padded + padded_M - M, args->input + (size_t)row*2*M, 2*(size_t)M * sizeof(double complex));
+		memset(padded + padded_M + M, 0, (size_t)(padded_M - M) * sizeof(double complex));
+	}
+}
+
+/* output = conj(input times spectrum) times scale, with input
+	 conjugated first for a correlation, for padded rows first to
+	 last-1 */
+static void product_body(void *arg, int chunk, int first, int last) {
+	struct conv_args *args = arg;
+	// index variable, and the points of the rows
+	size_t k;
+	double complex a;
+	const size_t start = (size_t)first*2*args->padded_M, end = (size_t)last*2*args->padded_M;
+
+	for (k = start; k < end; k++) {
+		a = args->correlate ? conj(*(args->input + k)) : *(args->input + k);
+		*(args->output + k) = conj(cmul(a, *(args->spectrum + k))) * args->scale;
+	}
+}
+
+/* Rows first to last-1 of the grid from the middle of the padded
+	 grid, conjugated and times scale */
+static void unpad_body(void *arg, int chunk, int first, int last) {
+	struct conv_args *args = arg;
+	// index variables
+	int i, j;
+	double complex *padded;
+	const int N = args->N, M = args->M, padded_M = args->padded_M;
+
+	for (i = first; i < last; i++) {
+		padded = args->input + (size_t)(i - N + args->padded_N)*2*padded_M + padded_M - M;
+		for (j = 0; j < 2*M; j++) {
+			*(args->output + (size_t)i*2*M + j) = conj(*(padded + j)) * args->scale;
+		}
+	}
+}
+
+/* Convolution or correlation of two grids through the 2D transform,
+	 on grids padded to 2P x 2Q points with P >= 3N/2 and Q >= 3M/2.
+	 The circular convolution adds point X+2P onto point X, and for X
+	 on the grid and f and g nonzero only on it, those points are
+	 more than 3N away, off the end of g.  Returns 0, or -1 if memory
+	 could not be allocated. */
+static int convolve_fft(dft_context *ctx, double complex *output, double complex *input1,
+												double complex *input2, int correlate) {
+	// plan and context of the padded transforms, and the second
+	// spectrum
+	dft_plan *padded_plan;
+	dft_context *padded;
+	double complex *spectrum = NULL;
+	struct conv_args args;
+	int status = 0;
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	args.N = N;
+	args.M = M;
+	args.padded_N = fft_good_size((3*N + 1) / 2);
+	args.padded_M = fft_good_size((3*M + 1) / 2);
+	if ((padded_plan = dft_plan_create(args.padded_N, args.padded_M, ctx->plan->layout)) == NULL) {
+		return -1;
+	}
+	if ((padded = dft_context_create(padded_plan, DATAFILE_FLOAT64, ARENA_THP)) == NULL) {
+		dft_plan_destroy(padded_plan);
+		return -1;
+	}
+	// A grid with itself needs only the one transform
+	if (input2 != input1
+		&& (spectrum = malloc(4*(size_t)args.padded_N*args.padded_M * sizeof(double complex))) == NULL) {
+		status = -1;
+	}
+
+	// The transforms of f and g.  dft() divides by the number of
+	// points, so the spectrum of the convolution is 4PQ times their
+	// product.
+	if (status == 0) {
+		args.input = input1;
+		args.output = padded->real_space;
+		parallel_for(2*args.padded_N, PARALLEL_GRAIN / (2*args.padded_M) + 1, pad_body, &args);
+		status = dft(padded, padded->real_space, padded->freq_space);
+	}
+	if (status == 0 && input2 != input1) {
+		args.input = input2;
+		parallel_for(2*args.padded_N, PARALLEL_GRAIN / (2*args.padded_M) + 1, pad_body, &args);
+		status = dft(padded, padded->real_space, spectrum);
+	}
+
+	// The inverse transform is the conjugate of the forward one of
+	// the conjugate, times 4PQ for dft()'s division
+	if (status == 0) {
+		args.input = padded->freq_space;
+		args.output = padded->real_space;
+		args.spectrum = (input2 != input1) ? spectrum : padded->freq_space;
+		args.correlate = correlate;
+		args.scale = 4.0 * args.padded_N * args.padded_M;
+		parallel_for(2*args.padded_N, PARALLEL_GRAIN / (2*args.padded_M) + 1, product_body, &args);
+		status = dft(padded, padded->real_space, padded->freq_space);
+	}
+	if (status == 0) {
+		args.input = padded->freq_space;
+		args.output = output;
+		parallel_for(2*N, PARALLEL_GRAIN / (2*M) + 1, unpad_body, &args);
+	}
+
+	free(spectrum);
+	dft_context_destroy(padded);
+	dft_plan_destroy(padded_plan);
+	return status;
+}
+
+/* Rows first to last-1 of the input convolved along y with the
+	 kernel's y factor */
+static void rows_body(void *arg, int chunk, int first, int last) {
+	struct conv_args *args = arg;
+	// index variables, the shift of the kernel point and the points
+	// of the output it reaches
+	int i, j, b, shift, j_low, j_high;
+	double complex *row, *out;
+	const int M = args->M;
+
+	for (i = first; i < last; i++) {
+		row = args->input + (size_t)i*2*M;
+		out = args->output + (size_t)i*2*M;
+		memset(out, 0, 2*(size_t)M * sizeof(double complex));
+		for (b = 0; b < args->ny; b++) {
+			// out(y) += k(b) f(y - shift)
+			shift = b + args->y_first;
+			j_low = (shift > 0) ? shift : 0;
+			j_high = (shift < 0) ? 2*M + shift : 2*M;
+			for (j = j_low; j < j_high; j++) {
+				*(out + j) += cmul(*(args->kernel_y + b), *(row + j - shift));
+			}
+		}
+	}
+}
+
+/* Rows first to last-1 of the output: the rows of the input around
+	 them convolved along x with the kernel's x factor */
+static void columns_body(void *arg, int chunk, int first, int last) {
+	struct conv_args *args = arg;
+	// index variables, and the row the kernel point falls on
+	int i, j, a, from;
+	double complex *row, *out;
+	const int N = args->N, M = args->M;
+
+	for (i = first; i < last; i++) {
+		out = args->output + (size_t)i*2*M;
+		memset(out, 0, 2*(size_t)M * sizeof(double complex));
+		for (a = 0; a < args->nx; a++) {
+			from = i - a - args->x_first;
+			if (from < 0 || from >= 2*N) {
+				continue;
+			}
+			row = args->input + (size_t)from*2*M;
+			for (j = 0; j < 2*M; j++) {
+				*(out + j) += cmul(*(args->kernel_x + a), *(row + j));
+			}
+		}
+	}
+}
+
+/* Convolution of the grid with a separable kernel, summed directly:
+	 kernel_x(a) kernel_y(b) at x = x_first+a, y = y_first+b.  Returns
+	 0, or -1 if memory could not be allocated. */
+static int convolve_direct(dft_context *ctx, double complex *output, double complex *input,
+													 double complex *kernel_x, int nx, int x_first,
+													 double complex *kernel_y, int ny, int y_first) {
+	// the grid convolved along y
+	double complex *rows;
+	struct conv_args args;
+	const int N = ctx->plan->N, M = ctx->plan->M;
+	// rows each thread should have at the least
+	const int grain = PARALLEL_GRAIN / (2*M) + 1;
+
+	if ((rows = malloc(4*(size_t)N*M * sizeof(double complex))) == NULL) {
+		return -1;
+	}
+	args.N = N;
+	args.M = M;
+	args.kernel_x = kernel_x;
+	args.kernel_y = kernel_y;
+	args.nx = nx;
+	args.ny = ny;
+	args.x_first = x_first;
+	args.y_first = y_first;
+
+	args.input = input;
+	args.output = rows;
+	parallel_for(2*N, grain, rows_body, &args);
+	args.input = rows;
+	args.output = output;
+	parallel_for(2*N, grain, columns_body, &args);
+	free(rows);
+	return 0;
+}
+
+/* Whether a grid is a small separable kernel: nonzero only within a
+	 box of at most CONVOLVE_DIRECT_SIZE points a side, and there a
+	 function of x times a function of y.  If it is, its factors are
+	 stored, reversed and conjugated for a correlation, with the
+	 offsets of their first points.
+
+	 *ctx: context whose plan gives N and M
+	 *input: the grid
+	 reverse: nonzero to give the factors of conj(f(-x,-y))
+	 *kernel_x, *kernel_y: room for CONVOLVE_DIRECT_SIZE points each
+	 *nx, *x_first, *ny, *y_first: the factors' lengths and offsets
+
+	 Returns 1 if it is, or 0.
+	 */
+static int separable_kernel(dft_context *ctx, double complex *input, int reverse,
+														double complex *kernel_x, int *nx, int *x_first,
+														double complex *kernel_y, int *ny, int *y_first) {
+	// index variables
+	int i, j, a, b;
+	// the box the nonzero points lie in, and the largest point
+	int i_low = INT_MAX, i_high = INT_MIN, j_low = INT_MAX, j_high = INT_MIN;
+	int i_peak = 0, j_peak = 0;
+	double largest = 0.0;
+	double complex point;
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	for (i = -N; i < N; i++) {
+		for (j = -M; j < M; j++) {
+			point = *(input + indexof(i, j));
+			if (point == 0.0) {
+				continue;
+			}
+			i_low = (i < i_low) ? i : i_low;
+			i_high = (i > i_high) ? i : i_high;
+			j_low = (j < j_low) ? j : j_low;
+			j_high = (j > j_high) ? j : j_high;
+			if (cabs(point) > largest) {
+				largest = cabs(point);
+				i_peak = i;
+				j_peak = j;
+			}
+			// Give up as soon as the box is too big
+			if (i_high - i_low >= CONVOLVE_DIRECT_SIZE || j_high - j_low >= CONVOLVE_DIRECT_SIZE) {
+				return 0;
+			}
+		}
+	}
+	if (largest == 0.0) {
+		return 0;
+	}
+
+	// f(x,y) = f(x,q) f(p,y) / f(p,q) for a separable f, with (p,q)
+	// the largest point
+	*nx = i_high - i_low + 1;
+	*ny = j_high - j_low + 1;
+	for (a = 0; a < *nx; a++) {
+		*(kernel_x + a) = *(input + indexof(i_low + a, j_peak)) / *(input + indexof(i_peak, j_peak));
+	}
+	for (b = 0; b < *ny; b++) {
+		*(kernel_y + b) = *(input + indexof(i_peak, j_low + b));
+	}
+	for (a = 0; a < *nx; a++) {
+		for (b = 0; b < *ny; b++) {
+			if (cabs(*(input + indexof(i_low + a, j_low + b)) - *(kernel_x + a) * *(kernel_y + b))
+					> CONVOLVE_TOLERANCE * largest) {
+				return 0;
+			}
+		}
+	}
+
+	*x_first = i_low;
+	*y_first = j_low;
+	// conj(f(-x,-y)) runs the other way from -i_high and -j_high
+	if (reverse) {
+		for (a = 0; a < *nx / 2; a++) {
+			point = *(kernel_x + a);
+			*(kernel_x + a) = *(kernel_x + *nx - 1 - a);
+			*(kernel_x + *nx - 1 - a) = point;
+		}
+		for (b = 0; b < *ny / 2; b++) {
+			point = *(kernel_y + b);
+			*(kernel_y + b) = *(kernel_y + *ny - 1 - b);
+			*(kernel_y + *ny - 1 - b) = point;
+		}
+		for (a = 0; a < *nx; a++) {
+			*(kernel_x + a) = conj(*(kernel_x + a));
+		}
+		for (b = 0; b < *ny; b++) {
+			*(kernel_y + b) = conj(*(kernel_y + b));
+		}
+		*x_first = -i_high;
+		*y_first = -j_high;
+	}
+	return 1;
+}
+
+/* Produce the convolution of the grids input1 and input2,
+	 h(X,Y) = sum over (x,y) of f(x,y) g(X-x,Y-y), for X and Y on the
+	 grid.  A g that is a small separable kernel is summed directly,
+	 and anything else goes through the 2D transform.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the convolution
+	 					is to be stored, which may be either input
+	 *input1, *input2: pointers to starts of the grids f and g
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int convolve(dft_context *ctx, double complex *output, double complex *input1, double complex *input2) {
+	// factors of a separable g
+	double complex kernel_x[CONVOLVE_DIRECT_SIZE], kernel_y[CONVOLVE_DIRECT_SIZE];
+	int nx, ny, x_first, y_first;
+
+	if (separable_kernel(ctx, input2, 0, kernel_x, &nx, &x_first, kernel_y, &ny, &y_first)) {
+		return convolve_direct(ctx, output, input1, kernel_x, nx, x_first, kernel_y, ny, y_first);
+	}
+	return convolve_fft(ctx, output, input1, input2, 0);
+}
+
+/* Produce the correlation of the grids input1 and input2,
+	 c(X,Y) = sum over (x,y) of conj(f(x,y)) g(x+X,y+Y), for X and Y
+	 on the grid: with input1 the same as input2, the autocorrelation.
+	 An f that is a small separable kernel is summed directly, and
+	 anything else goes through the 2D transform.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the correlation
+	 					is to be stored, which may be either input
+	 *input1, *input2: pointers to starts of the grids f and g
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int correlate(dft_context *ctx, double complex *output, double complex *input1, double complex *input2) {
+	// factors of a separable f, reversed and conjugated
+	double complex kernel_x[CONVOLVE_DIRECT_SIZE], kernel_y[CONVOLVE_DIRECT_SIZE];
+	int nx, ny, x_first, y_first;
+
+	if (separable_kernel(ctx, input1, 1, kernel_x, &nx, &x_first, kernel_y, &ny, &y_first)) {
+		return convolve_direct(ctx, output, input2, kernel_x, nx, x_first, kernel_y, ny, y_first);
+	}
+	return convolve_fft(ctx, output, input1, input2, 1);
+}
+
+/* Convolve a grid with a separable kernel given by its factors,
+	 summed directly: h(X,Y) = sum over a and b of kernel_x(a)
+	 kernel_y(b) f(X-a,Y-b), with a running from -(nx/2) to
+	 nx-1-nx/2 and b likewise, so that odd length factors are centred.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the convolution
+	 					is to be stored, which may be input
+	 *input: pointer to start of the grid f
+	 *kernel_x, *kernel_y: the factors along x and y
+	 nx, ny: their lengths
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int convolve_separable(dft_context *ctx, double complex *output, double complex *input,
+											 double complex *kernel_x, int nx, double complex *kernel_y, int ny) {
+	return convolve_direct(ctx, output, input, kernel_x, nx, -(nx/2), kernel_y, ny, -(ny/2));
+}
@@ -20,64 +20,418 @@ programme executes.
 #include <complex.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 #include "header.h"
 
 
 /* Global variable definitions */
-// Execution mode number
-int mode;
-// Defines f(x,y)
-double complex *real_space;
-// Holds fourier transform, F(u,v)
-double complex *freq_space;
+// The context the mode runs in
+dft_context context;
+// The mapping its arrays are cut from
+arena *buffer_arena;
+// Transform size and FFT plans
+dft_plan *plan;
+// The -input file, mapped as f(x,y) for LOAD_MODE
+char *input_file;
+datafile_header input_header;
+// Buffers for OOC_MODE
+size_t ooc_memory;
 
 
+// The benchmarks (bench.c) bring their own main()
+#ifndef DFT_NO_MAIN
+/* Write out array, of the context's precision, as the data file
+	 name with the plot for it: the images, or the gnuplot script and
+	 the matrices it reads.  Quit with an error message if they
+	 cannot be written. */
+static void output(void *array, char name[]) {
+	if (write_datafile(&context, array, name) != 0) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+	if (context.render != RENDER_NONE) {
+		if (plot_image(&context, array, name) != 0) {
+			printf("Unable to open file for plotting\n");
+			_exit(3);
+		}
+		return;
+	}
+	if (write_plotdata(&context, array, name) != 0) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+	if (plot(&context, name) != 0) {
+		printf("Unable to open file for plotting\n");
+		_exit(3);
+	}
+}
+
+/* Blur f(x,y) with a Gaussian point spread function, as a detector
+	 would, and find its autocorrelation, and write each out with the
+	 plot for it.  The point spread function is separable and small,
+	 so convolve() sums it directly; the autocorrelation goes through
+	 the 2D transform.
+
+	 *real: f(x,y)
+	 *work: a grid to work in
+	 */
+static void convolution(double complex *real, double complex *work) {
+	// index variables
+	int i, j;
+	// the point spread function along one side, and its sum
+	double psf[2*PSF_RADIUS + 1], sum = 0.0;
+	const int N = context.plan->N, M = context.plan->M;
+
+	for (i = 0; i <= 2*PSF_RADIUS; i++) {
+		psf[i] = exp(-(i - PSF_RADIUS)*(i - PSF_RADIUS) / (2.0 * PSF_SIGMA * PSF_SIGMA));
+		sum += psf[i];
+	}
+	memset(work, 0, 4*(size_t)N*M * sizeof(double complex));
+	for (i = -PSF_RADIUS; i <= PSF_RADIUS && i < N; i++) {
+		for (j = -PSF_RADIUS; j <= PSF_RADIUS && j < M; j++) {
+			if (i >= -N && j >= -M) {
+				*(work + indexof(i, j)) = psf[i + PSF_RADIUS] * psf[j + PSF_RADIUS] / (sum * sum);
+			}
+		}
+	}
+
+	if (convolve(&context, work, real, work) != 0) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+	output(work, "blur");
+	if (correlate(&context, work, real, real) != 0) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+	output(work, "corr");
+}
+
 int main(int argc, char *argv[]) {
+	// f(x,y) and F(u,v)
+	void *real, *freq;
+	// 0, or -1 if the mode's aperture does not fit in the grid
+	int status = 0;
+	// error of F(u,v) with -single, relative to its largest point
+	double error;
 
 	set_params(argc, argv);
 
+	// The grid never comes into memory, so it has a path of its own
+	if (context.mode == OOC_MODE) {
+		// The header was read in set_params(), so a failure here is
+		// in the scratch or output files, or memory
+		if (dft_outofcore(&context, &input_header, input_file, ooc_memory) != 0) {
+			printf("Unable to transform input file out of core\n");
+			_exit(4);
+		}
+		if (context.render != RENDER_NONE) {
+			if (plot_image_file(&context, "freq") != 0) {
+				printf("Unable to open file for plotting\n");
+				_exit(3);
+			}
+		} else {
+			if (write_plotdata_file(&context, "freq") != 0) {
+				printf("Unable to open file to write data\n");
+				_exit(4);
+			}
+			if (plot(&context, "freq") != 0) {
+				printf("Unable to open file for plotting\n");
+				_exit(3);
+			}
+		}
+		printf("Successfully executed!\n");
+		_exit(0);
+	}
+
+	// The arrays of the precision the transform works in
+	if (context.precision == DATAFILE_FLOAT32) {
+		real = context.real_single;
+		freq = context.freq_single;
+	} else {
+		real = context.real_space;
+		freq = context.freq_space;
+	}
+
 	/* Set f(x,y) according to the execution mode */
-	switch (mode) {
+	switch (context.mode) {
 		case 0:
-			construct_single(real_space, 0, 0, 1.0);	
+			status = construct_single(&context, real, 0, 0, 1.0);	
 			break;
 		case 1:
-			construct_squares(real_space, 0, 0, 3, 3, 1.0);
+			status = construct_squares(&context, real, 0, 0, 3, 3, 1.0);
 			break;
 		case 2:
-			construct_slit(real_space, 0, 0, 3, 20, 1.0);
+			status = construct_slit(&context, real, 0, 0, 3, 20, 1.0);
 			break;
 		case 3:
-			construct_doubleslit(real_space, 0, 0, 3, 30, 10, 1.0);
+			status = construct_doubleslit(&context, real, 0, 0, 3, 30, 10, 1.0);
+			break;
+		case CONV_MODE:
+			// The double slit of mode 3, blurred and correlated with
+			// itself in the space F(u,v) will take
+			if ((status = construct_doubleslit(&context, real, 0, 0, 3, 30, 10, 1.0)) == 0) {
+				convolution(real, freq);
+			}
+			break;
+		case LOAD_MODE:
+			// Already in place, mapped or rounded from the file
 			break;
 	}	
+	if (status != 0) {
+		printf("The aperture of mode %d does not fit in N = %d, M = %d\n",
+					 context.mode, context.plan->N, context.plan->M);
+		_exit(2);
+	}
 
-	dft(real_space, freq_space);
+	if (context.precision == DATAFILE_FLOAT32) {
+		if (dft_single(&context, real, freq) != 0) {
+			printf("Unable to allocate memory for data storage");
+			_exit(1);
+		}
+		// Show what single precision cost
+		if ((error = dft_single_error(&context, real, freq)) < 0.0) {
+			printf("Unable to allocate memory for data storage");
+			_exit(1);
+		}
+		printf("Single precision error: %.1e of the largest |F(u,v)|, over its row and column\n",
+					 error);
+	} else if (dft(&context, real, freq) != 0) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
 
-	write_datafile(real_space, "real");
-	write_datafile(freq_space, "freq");
-	plot("freq");
-	plot("real");
+	output(real, "real");
+	output(freq, "freq");
 
 	printf("Successfully executed!\n");
 	_exit(0);
 }
+#endif
 
-/* This function finds the FT of the discrete function
-	 defined in the input array, and stores it in the output
-	 array. 
-	 
-	 *input: pointer to the start of the array containing the 
-	 				 function to be transformed.
-	 *output: pointer to the start of the array where the FT
-	 					will be stored.
+/* Build the plan for transforms of 2N x 2M points.
+
+	 N, M: x runs from -N to N-1, y from -M to M-1
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to do the 1D FFTs on
+	 				 separate real and imaginary arrays with SIMD kernels
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_plan *dft_plan_create(int N, int M, int layout) {
+	// plan under construction
+	dft_plan *plan;
+
+	if ((plan = calloc(1, sizeof(dft_plan))) == NULL) {
+		return NULL;
+	}
+	plan->N = N;
+	plan->M = M;
+	plan->layout = layout;
+	plan->sparse_limit = SPARSE_LIMIT;
+	if ((plan->x_fft = fft_plan_create(2*N, -1)) == NULL
+		|| (plan->y_fft = fft_plan_create(2*M, -1)) == NULL
+		|| (plan->y_rfft = fft_real_plan_create(2*M, -1)) == NULL
+		|| (N%2 == 0 && M%2 == 0
+				&& ((plan->x_dct = fft_real_plan_create(N, -1)) == NULL
+						|| (plan->y_dct = fft_real_plan_create(M, -1)) == NULL))) {
+		dft_plan_destroy(plan);
+		return NULL;
+	}
+	return plan;
+}
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void dft_plan_destroy(dft_plan *plan) {
+	if (plan == NULL) {
+		return;
+	}
+	fft_plan_destroy(plan->x_fft);
+	fft_plan_destroy(plan->y_fft);
+	fft_real_plan_destroy(plan->y_rfft);
+	fft_real_plan_destroy(plan->x_dct);
+	fft_real_plan_destroy(plan->y_dct);
+	free(plan);
+}
+
+/* Fill in a context on a plan with the defaults: mode 0, double
+	 precision throughout and no data arrays yet.
+
+	 *ctx: the context
+	 *plan: plan it works to
+	 */
+void dft_context_init(dft_context *ctx, dft_plan *plan) {
+	memset(ctx, 0, sizeof(dft_context));
+	ctx->plan = plan;
+	ctx->output_precision = DATAFILE_FLOAT64;
+	ctx->precision = DATAFILE_FLOAT64;
+}
+
+/* Take a buffer from the arena, or before there is one, only count
+	 the bytes it will need.
+
+	 *a: the arena, or NULL to count
+	 bytes: size of the buffer
+	 *total: bytes taken so far, added to
+
+	 Returns the buffer, or NULL when counting.
+	 */
+static void *take(arena *a, size_t bytes, size_t *total) {
+	*total += arena_round(bytes);
+	return (a == NULL) ? NULL : arena_alloc(a, bytes);
+}
+
+/* Cut a context's data arrays and scratch space from an arena, or
+	 with no arena only count the bytes they need, so that they can
+	 share an arena with other buffers.  The arrays are those of the
+	 context's precision, which must be set first.  A real_space or
+	 real_single set beforehand, such as a mapped file, is kept and
+	 takes no room.
+
+	 *ctx: context from dft_context_init()
+	 *a: the arena, or NULL to count
+
+	 Returns the bytes the arrays take up.
+	 */
+size_t dft_context_alloc(dft_context *ctx, arena *a) {
+	// bytes taken
+	size_t total = 0;
+	// points in one array
+	size_t points = 4*(size_t)ctx->plan->N*ctx->plan->M;
+
+	if (ctx->precision == DATAFILE_FLOAT32) {
+		if (ctx->real_single == NULL) {
+			ctx->real_single = take(a, points * sizeof(float complex), &total);
+		}
+		ctx->freq_single = take(a, points * sizeof(float complex), &total);
+		ctx->dft_work = take(a, dft_work_size(ctx->plan) * sizeof(float complex), &total);
+		return total;
+	}
+	if (ctx->real_space == NULL) {
+		ctx->real_space = take(a, points * sizeof(double complex), &total);
+	}
+	ctx->freq_space = take(a, points * sizeof(double complex), &total);
+	ctx->dft_work = take(a, dft_work_size(ctx->plan) * sizeof(double complex), &total);
+	return total;
+}
+
+/* Create a context on a plan, with its data arrays in an arena of
+	 its own.  The defaults are those of dft_context_init().  The
+	 threads must already have been started by threads_init().
+
+	 *plan: plan it works to, which must outlive the context
+	 precision: DATAFILE_FLOAT64, or DATAFILE_FLOAT32 for dft_single()
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_context *dft_context_create(dft_plan *plan, int precision, int pages) {
+	// context under construction
+	dft_context *ctx;
+
+	if ((ctx = malloc(sizeof(dft_context))) == NULL) {
+		return NULL;
+	}
+	dft_context_init(ctx, plan);
+	ctx->precision = precision;
+	if ((ctx->space = arena_create(dft_context_alloc(ctx, NULL), pages)) == NULL) {
+		free(ctx);
+		return NULL;
+	}
+	dft_context_alloc(ctx, ctx->space);
+	return ctx;
+}
+
+/* Free a context from dft_context_create() and its arena, but not
+	 its plan.  NULL is ignored.
+
+	 *ctx: context to be freed
+	 */
+void dft_context_destroy(dft_context *ctx) {
+	if (ctx == NULL) {
+		return;
+	}
+	arena_destroy(ctx->space);
+	free(ctx);
+}
+
+/* Arguments for the loops below, which parallel_for() shares out
+	 among the threads a range of rows (or lines) at a time. */
+struct loop_args {
+	// the plan the loop works to
+	dft_plan *plan;
+	double complex *input;
+	double complex *output;
+	// for sign_body(): added to i+j before taking the parity
+	int parity;
+	double scale;
+	// for lines_body(): point k of line l is at
+	// output + l*line_step + k*point_step
+	fft_plan *fft;
+	size_t line_step;
+	size_t point_step;
+	// scratch space for each thread, and the size of each one's share
+	double complex *scratch;
+	size_t scratch_size;
+	// for transpose_body(): rows and columns of the input
+	int rows;
+	int cols;
+	// for the real and cosine transforms: the plan, and the half of
+	// F(u,v) with v >= 0 or the quarter with u, v >= 0 they work in
+	fft_real_plan *rfft;
+	double complex *half;
+	double *quarter;
+	// the rest of the work space after the threads' scratch: the
+	// transposed grid, the half or the quarter
+	double complex *area;
+	// for the single precision loops: their input and output, and
+	// the threads' scratch space as above
+	float complex *input_single;
+	float complex *output_single;
+	float complex *scratch_single;
+	// for the check of dft_single(): the row and column of F(u,v) it
+	// sums again, as array indices, and f(x,y) summed along x for the
+	// row and along y for the column
+	int check_u;
+	int check_v;
+	double complex *row_sums;
+	double complex *column_sums;
+};
+
+/* Points of scratch space each thread needs for one line of the
+	 longer dimension, and for the FFT it runs on it.  The same space
+	 holds a line in split form and the split FFT's scratch.  The real
+	 and cosine transforms are no longer, so it does for them too.
+	 Rounded up to whole cache lines, so that no two threads share
+	 one and each line starts aligned. */
+static size_t scratch_points(dft_plan *plan) {
+	const int N = plan->N, M = plan->M;
+	const size_t line = ARENA_ALIGN / sizeof(double complex);
+	size_t points = 2*(N > M ? N : M)
+									+ (fft_work_size(plan->x_fft) > fft_work_size(plan->y_fft)
+										 ? fft_work_size(plan->x_fft) : fft_work_size(plan->y_fft));
+
+	return (points + line - 1) / line * line;
+}
+
+/* Sum the DFT formula directly over the nonzero points of
+	 f(x,y), for the rows of F at array indices first to last-1.
+	 Only worthwhile when there are very few of them.
 	 */
-void dft(double complex *input, double complex *output) {
+static void direct_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
 	// index variables
 	int u, v, i, j;
+	// indices into the tables of roots of unity
+	int k_x, k_y;
+	// normalised f(x,y), and that times the x phase factor
+	double complex value, row;
+	const int N = args->plan->N, M = args->plan->M;
 
 	// Initialize to 0.  Memset is fast
-	memset(output, 0, 4*N*M*sizeof(double complex));
+	memset(args->output + (size_t)first*2*M, 0, (size_t)(last - first)*2*M*sizeof(double complex));
 
 	// Loop through all values of input array
 	for (i = -N; i < N; i++) {
@@ -86,79 +440,980 @@ void dft(double complex *input, double complex *output) {
 			// If the function value is 0 then  there's no
 			// point in calculating sum.  This optimisation
 			// improves execution speed by orders of magnitude
-			if (*(input+indexof(i,j)) != 0.0) {
-				for (u = -N; u < N; u++) {
-					for (v = -N; v < M; v++) {
+			if (*(args->input+indexof(i,j)) != 0.0) {
+				value = (*(args->input + indexof(i,j))) / ((double)(4.0 * M * N));
+
+				// exp(-i pi i u / N) is entry -i*u mod 2N of the x
+				// table.  Step the index by -i as u goes up by 1.
+				k_x = ((-(long long)i * (first - N)) % (2*N) + 2*N) % (2*N);
+				for (u = first - N; u < last - N; u++) {
+					// The x factor is the same for every v
+					row = cmul(value, *(args->plan->x_fft->table + k_x));
+
+					// Likewise the y factor, entry -j*v mod 2M
+					k_y = (((long long)j * M) % (2*M) + 2*M) % (2*M);
+					for (v = -M; v < M; v++) {
 						
 						// Implement sum
-						*(output + indexof(u,v)) += ((*(input + indexof(i,j))) 
-							* cexp(-M_PI * I * (((double)(i*u))/((double)N) 
-							+ ((double)(j*v))/((double)M))))
-								/ ((double)(4.0 * M * N));
+						*(args->output + indexof(u,v)) += cmul(row, *(args->plan->y_fft->table + k_y));
+
+						k_y -= j;
+						if (k_y >= 2*M) {
+							k_y -= 2*M;
+						} else if (k_y < 0) {
+							k_y += 2*M;
+						}
 					}
+
+					k_x -= i;
+					if (k_x >= 2*N) {
+						k_x -= 2*N;
+					} else if (k_x < 0) {
+						k_x += 2*N;
+					}
+				}
+			}
+		}
+	}
+
+}
+
+/* output = input times scale, negated at odd i+j+parity, for rows
+	 first to last-1 */
+static void sign_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	const int M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		for (j = 0; j < 2*M; j++) {
+			*(args->output + i*2*M + j) = ((i + j + args->parity)%2 ? -args->scale : args->scale)
+																		* *(args->input + i*2*M + j);
+		}
+	}
+}
+
+/* lines_body() for the split layout.  Every line is converted to
+	 split form in scratch, which it shares with the FFT's scratch
+	 space, transformed there and converted back.
+	 */
+static void split_lines(struct loop_args *args, double complex *scratch, int first, int last) {
+	// index variables
+	int l, k;
+	// start of the line
+	double complex *line;
+	int n = args->fft->n;
+	// the line in split form, and the FFT's scratch space
+	double *re = (double *)scratch, *im = re + n, *work = im + n;
+
+	for (l = first; l < last; l++) {
+		line = args->output + l * args->line_step;
+		if (args->point_step == 1) {
+			split_from_interleaved(line, re, im, 0, n, 1.0, 1.0);
+		} else {
+			for (k = 0; k < n; k++) {
+				*(re + k) = creal(*(line + k * args->point_step));
+				*(im + k) = cimag(*(line + k * args->point_step));
+			}
+		}
+		fft_execute_split_work(args->fft, re, im, work);
+		if (args->point_step == 1) {
+			split_to_interleaved(re, im, line, 0, n, 1.0, 1.0);
+		} else {
+			for (k = 0; k < n; k++) {
+				*(line + k * args->point_step) = CMPLX(*(re + k), *(im + k));
+			}
+		}
+	}
+}
+
+/* 1D FFTs of lines first to last-1.  Lines that are not contiguous
+	 are copied out into this thread's scratch space, transformed
+	 and copied back.
+	 */
+static void lines_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int l, k;
+	// start of the line, this thread's copy of it and its scratch space
+	double complex *line, *copy, *work;
+	int n = args->fft->n;
+
+	copy = args->scratch + chunk * args->scratch_size;
+	work = (args->point_step == 1) ? copy : copy + n;
+	if (args->plan->layout == LAYOUT_SPLIT) {
+		split_lines(args, copy, first, last);
+		return;
+	}
+	for (l = first; l < last; l++) {
+		line = args->output + l * args->line_step;
+		if (args->point_step == 1) {
+			fft_execute_work(args->fft, line, line, work);
+		} else {
+			for (k = 0; k < n; k++) {
+				*(copy + k) = *(line + k * args->point_step);
+			}
+			fft_execute_work(args->fft, copy, copy, work);
+			for (k = 0; k < n; k++) {
+				*(line + k * args->point_step) = *(copy + k);
+			}
+		}
+	}
+}
+
+/* Swap the rows and columns of a rows x cols array into output.
+	 Done a square tile at a time so that both the reads and the
+	 writes stay within a few cache lines.  Each iteration is one
+	 band of TRANSPOSE_BLOCK rows of the input.
+	 */
+static void transpose_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j, ii, jj;
+	int rows = args->rows, cols = args->cols;
+
+	for (ii = first*TRANSPOSE_BLOCK; ii < last*TRANSPOSE_BLOCK && ii < rows; ii += TRANSPOSE_BLOCK) {
+		for (jj = 0; jj < cols; jj += TRANSPOSE_BLOCK) {
+			for (i = ii; i < ii + TRANSPOSE_BLOCK && i < rows; i++) {
+				for (j = jj; j < jj + TRANSPOSE_BLOCK && j < cols; j++) {
+					*(args->output + (size_t)j*rows + i) = *(args->input + (size_t)i*cols + j);
 				}
 			}
 		}
 	}
+}
+
+/* Transpose src, rows x cols, into dst, sharing the bands of rows
+	 out among the threads. */
+static void transpose(double complex *src, double complex *dst, int rows, int cols) {
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+
+	args.input = src;
+	args.output = dst;
+	args.rows = rows;
+	args.cols = cols;
+	parallel_for((rows + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK, 1, transpose_body, &args);
+}
+
+/* Real transforms of rows first to last-1 of f(x,y), which must be
+	 real, into the same rows of the half array: M+1 points each, for
+	 v = 0 to M */
+static void real_rows_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+	double complex *work = args->scratch + chunk * args->scratch_size;
+	const int M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		fft_execute_r2c_work(args->rfft, (double *)(args->input + (size_t)i*2*M), 2,
+												 args->half + (size_t)i*(M+1), work);
+	}
+}
+
+/* Rows first to last-1 of F(u,v) from the half array: scale times
+	 X(u,v) for v >= 0 and conj(X(-u,-v)) for v < 0, negated at odd
+	 i+j+parity, where X is the half array's row for u mod 2N */
+static void expand_half_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// rows of the half array for u and -u
+	double complex *row, *mirror;
+	const int N = args->plan->N, M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		row = args->half + (size_t)((i + N) % (2*N))*(M+1);
+		mirror = args->half + (size_t)((3*N - i) % (2*N))*(M+1);
+		for (j = 0; j < M; j++) {
+			*(args->output + (size_t)i*2*M + j) = ((i + j + args->parity)%2 ? -args->scale : args->scale)
+																						* conj(*(mirror + M - j));
+		}
+		for (j = M; j < 2*M; j++) {
+			*(args->output + (size_t)i*2*M + j) = ((i + j + args->parity)%2 ? -args->scale : args->scale)
+																						* *(row + j - M);
+		}
+	}
+}
+
+/* Rows first to last-1 of the quarter array from f(x,y): row j
+	 holds f(x,y) for x = j, y = 0 to M, with x = N and y = M
+	 standing for -N and -M */
+static void quarter_in_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	const int N = args->plan->N, M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		for (j = 0; j < M; j++) {
+			*(args->quarter + (size_t)i*(M+1) + j) = creal(*(args->input + indexof(i == N ? -N : i, j)));
+		}
+		*(args->quarter + (size_t)i*(M+1) + M) = creal(*(args->input + indexof(i == N ? -N : i, -M)));
+	}
+}
+
+/* Cosine transforms of lines first to last-1 of the quarter array.
+	 Point k of line l is at quarter + l*line_step + k*point_step.
+	 Lines that are not contiguous are copied out into this thread's
+	 scratch space, transformed and copied back.
+	 */
+static void cosine_lines_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int l, k;
+	// start of the line, this thread's copy of it, and the transform's
+	// scratch space
+	double *line, *copy;
+	double complex *spectrum, *work;
+	int n = args->rfft->n;
+
+	copy = (double *)(args->scratch + chunk * args->scratch_size);
+	spectrum = args->scratch + chunk * args->scratch_size + n/2 + 1;
+	work = spectrum + n/2 + 1;
+	for (l = first; l < last; l++) {
+		line = args->quarter + l * args->line_step;
+		if (args->point_step == 1) {
+			fft_execute_dct1_work(args->rfft, line, spectrum, work);
+		} else {
+			for (k = 0; k <= n; k++) {
+				*(copy + k) = *(line + k * args->point_step);
+			}
+			fft_execute_dct1_work(args->rfft, copy, spectrum, work);
+			for (k = 0; k <= n; k++) {
+				*(line + k * args->point_step) = *(copy + k);
+			}
+		}
+	}
+}
+
+/* Rows first to last-1 of F(u,v) from the quarter array:
+	 scale times C(|u|,|v|) */
+static void expand_quarter_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// row of the quarter array for |u|
+	double *row;
+	const int N = args->plan->N, M = args->plan->M;
 
+	for (i = first; i < last; i++) {
+		row = args->quarter + (size_t)abs(i - N)*(M+1);
+		for (j = 0; j < 2*M; j++) {
+			*(args->output + (size_t)i*2*M + j) = args->scale * *(row + abs(j - M));
+		}
+	}
+}
+
+/* Returns 1 if f(x,y) is real, and 0 if not */
+static int is_real(dft_plan *plan, double complex *input) {
+	// index variable
+	size_t i;
+	const int N = plan->N, M = plan->M;
+
+	for (i = 0; i < 4*(size_t)N*M; i++) {
+		if (cimag(*(input + i)) != 0.0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Returns 1 if f(-x,y) = f(x,y) and f(x,-y) = f(x,y) for all x and
+	 y that have both, and 0 if not */
+static int is_even(dft_plan *plan, double complex *input) {
+	// index variables
+	int i, j;
+	const int N = plan->N, M = plan->M;
+
+	for (i = -N; i < N; i++) {
+		for (j = 1; j < M; j++) {
+			if (*(input + indexof(i, j)) != *(input + indexof(i, -j))) {
+				return 0;
+			}
+		}
+	}
+	for (i = 1; i < N; i++) {
+		for (j = -M; j < M; j++) {
+			if (*(input + indexof(i, j)) != *(input + indexof(-i, j))) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* dft() for real f(x,y).  F is Hermitian, F(-u,-v) = conj(F(u,v)),
+	 so only v = 0 to M need transforming.  Each row goes through a
+	 real transform into a half array of 2N rows of M+1 points, only
+	 those M+1 columns are transformed along x, and F is filled in
+	 from them.
+
+	 *args: the input and output, and the threads' scratch space
+	 */
+static void dft_real(struct loop_args *args) {
+	// F(u,v) for v = 0 to M
+	double complex *half = args->area;
+	// the output array, which holds the transposed half for big grids
+	double complex *output = args->output;
+	dft_plan *plan = args->plan;
+	const int N = plan->N, M = plan->M;
+
+	args->half = half;
+	args->rfft = plan->y_rfft;
+	parallel_for(2*N, PARALLEL_GRAIN / (2*M) + 1, real_rows_body, args);
+
+	// Transform along x, as in dft(), with the output array as the
+	// transposed copy for big grids
+	args->fft = plan->x_fft;
+	if (4*(size_t)N*M <= TRANSPOSE_LIMIT) {
+		args->output = half;
+		args->line_step = 1;
+		args->point_step = M+1;
+		parallel_for(M+1, PARALLEL_GRAIN / (2*N) + 1, lines_body, args);
+	} else {
+		transpose(half, output, 2*N, M+1);
+		args->line_step = 2*N;
+		args->point_step = 1;
+		parallel_for(M+1, PARALLEL_GRAIN / (2*N) + 1, lines_body, args);
+		transpose(output, half, M+1, 2*N);
+	}
+
+	// The shift of origin and the normalisation are as in dft()
+	args->output = output;
+	args->parity = N + M;
+	args->scale = 1.0 / ((double)(4.0 * M * N));
+	parallel_for(2*N, PARALLEL_GRAIN / (2*M) + 1, expand_half_body, args);
+}
+
+/* dft() for real f(x,y) that is even in x and y, with N and M even.
+	 Then F(u,v) is real and even too, and 1/NM times the 2D cosine
+	 transform of the quarter of f with x from 0 to N and y from 0 to
+	 M, as in the 1D programme.  That is done by cosine transforms
+	 along each row of the quarter and then along each column.
+
+	 *args: the input and output, and the threads' scratch space
+	 */
+static void dft_even(struct loop_args *args) {
+	// f(x,y) and then C(u,v) for x, y, u, v >= 0
+	double *quarter = (double *)args->area;
+	dft_plan *plan = args->plan;
+	const int N = plan->N, M = plan->M;
+
+	args->quarter = quarter;
+	parallel_for(N+1, PARALLEL_GRAIN / (M+1) + 1, quarter_in_body, args);
+
+	// Along y.  Rows are contiguous.
+	args->rfft = plan->y_dct;
+	args->line_step = M+1;
+	args->point_step = 1;
+	parallel_for(N+1, PARALLEL_GRAIN / (M+1) + 1, cosine_lines_body, args);
+
+	// Along x.  Columns are strided by a whole row.
+	args->rfft = plan->x_dct;
+	args->line_step = 1;
+	args->point_step = M+1;
+	parallel_for(M+1, PARALLEL_GRAIN / (N+1) + 1, cosine_lines_body, args);
+
+	args->scale = 1.0 / ((double)N * M);
+	parallel_for(2*N, PARALLEL_GRAIN / (2*M) + 1, expand_quarter_body, args);
+}
+
+/* Number of points of scratch space dft() needs: a share for each
+	 thread, then room for the transposed grid of a big transform or
+	 the half array of a real one.  The threads must already have been
+	 started.
+
+	 *plan: plan of the transform
+	 */
+size_t dft_work_size(dft_plan *plan) {
+	// the transposed grid, and the half array
+	size_t transposed, half;
+	const int N = plan->N, M = plan->M;
+
+	transposed = (4*(size_t)N*M > TRANSPOSE_LIMIT) ? 4*(size_t)N*M : 0;
+	half = 2*(size_t)N*(M+1);
+	return threads_count() * scratch_points(plan) + (transposed > half ? transposed : half);
+}
+
+/* This function finds the FT of the discrete function
+	 defined in the input array, and stores it in the output
+	 array.  It works in the context's dft_work, or if that is NULL
+	 in space allocated for the call.
+	 
+	 *ctx: context whose plan and scratch space it works with
+	 *input: pointer to the start of the array containing the 
+	 				 function to be transformed.
+	 *output: pointer to the start of the array where the FT
+	 					will be stored.
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int dft(dft_context *ctx, double complex *input, double complex *output) {
+	// index variable
+	size_t i;
+	// number of nonzero points in f(x,y)
+	int nonzero = 0;
+	// work space allocated here, when there is no dft_work
+	double complex *owned = NULL;
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	// rows each thread should have at the least
+	int grain;
+	dft_plan *plan = ctx->plan;
+	const int N = plan->N, M = plan->M;
+
+	for (i = 0; i < 4*(size_t)N*M; i++) {
+		if (*(input + i) != 0.0) {
+			nonzero++;
+		}
+	}
+	// Each row of F costs a full pass over the nonzero points
+	grain = PARALLEL_GRAIN / (2*M) + 1;
+	args.plan = plan;
+	args.input = input;
+	args.output = output;
+	if (nonzero < plan->sparse_limit) {
+		parallel_for(2*N, grain, direct_body, &args);
+		return 0;
+	}
+
+	// The threads' scratch space, then the area for the rest
+	args.scratch = ctx->dft_work;
+	if (args.scratch == NULL
+		&& (args.scratch = owned = malloc(dft_work_size(plan) * sizeof(double complex))) == NULL) {
+		return -1;
+	}
+	args.scratch_size = scratch_points(plan);
+	args.area = args.scratch + threads_count() * args.scratch_size;
+
+	/* A real f(x,y) has a Hermitian F(u,v), so half the work can be
+		 saved, and one that is also even in x and y a real and even
+		 F(u,v), so half as much again. */
+	if (is_real(plan, input)) {
+		if (plan->x_dct != NULL && is_even(plan, input)) {
+			dft_even(&args);
+		} else {
+			dft_real(&args);
+		}
+		free(owned);
+		return 0;
+	}
+
+	/* The 2D transform separates into 1D transforms along each
+		 row followed by 1D transforms along each column.  As in
+		 the 1D programme the FFT works with indices 0 to 2N-1, so
+		 the shift of origin becomes a factor (-1)^(i+j) on f and
+		 (-1)^(u+v+N+M) on F, with u, v, i, j the array indices. */
+	args.parity = 0;
+	args.scale = 1.0;
+	parallel_for(2*N, grain, sign_body, &args);
+
+	// Transform along y.  Rows are contiguous.
+	args.fft = plan->y_fft;
+	args.line_step = 2*M;
+	args.point_step = 1;
+	parallel_for(2*N, grain, lines_body, &args);
+
+	// Transform along x.  Columns are strided by a whole row.
+	args.fft = plan->x_fft;
+	if (4*(size_t)N*M <= TRANSPOSE_LIMIT) {
+		// Small enough that the whole array sits in cache: copy
+		// each column out, transform it and copy it back.
+		args.line_step = 1;
+		args.point_step = 2*M;
+		parallel_for(2*M, PARALLEL_GRAIN / (2*N) + 1, lines_body, &args);
+	} else {
+		// Too big for that.  Transpose so the columns become rows,
+		// transform them, and transpose back.
+		transpose(output, args.area, 2*N, 2*M);
+		args.output = args.area;
+		args.line_step = 2*N;
+		args.point_step = 1;
+		parallel_for(2*M, PARALLEL_GRAIN / (2*N) + 1, lines_body, &args);
+		transpose(args.area, output, 2*M, 2*N);
+		args.output = output;
+	}
+	free(owned);
+
+	args.input = output;
+	args.parity = N + M;
+	args.scale = 1.0 / ((double)(4.0 * M * N));
+	parallel_for(2*N, grain, sign_body, &args);
+	return 0;
+}
+
+/* Rows first to last-1 of f(x,y) into the same rows of F, times
+	 (-1)^(i+j), and their FFTs along y, in single precision */
+static void single_rows_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// start of the row in F, and this thread's scratch space
+	float complex *row, *work = args->scratch_single + chunk * args->scratch_size;
+	const int M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		row = args->output_single + (size_t)i*2*M;
+		for (j = 0; j < 2*M; j++) {
+			*(row + j) = ((i + j)%2 ? -1.0f : 1.0f) * *(args->input_single + (size_t)i*2*M + j);
+		}
+		fft_execute_single_work(args->plan->y_fft, row, row, work);
+	}
+}
+
+/* lines_body() in single precision, for the lines along x */
+static void single_lines_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int l, k;
+	// start of the line, this thread's copy of it and its scratch space
+	float complex *line, *copy, *work;
+	int n = args->fft->n;
+
+	copy = args->scratch_single + chunk * args->scratch_size;
+	work = (args->point_step == 1) ? copy : copy + n;
+	for (l = first; l < last; l++) {
+		line = args->output_single + l * args->line_step;
+		if (args->point_step == 1) {
+			fft_execute_single_work(args->fft, line, line, work);
+		} else {
+			for (k = 0; k < n; k++) {
+				*(copy + k) = *(line + k * args->point_step);
+			}
+			fft_execute_single_work(args->fft, copy, copy, work);
+			for (k = 0; k < n; k++) {
+				*(line + k * args->point_step) = *(copy + k);
+			}
+		}
+	}
+}
+
+/* transpose_body() in single precision */
+static void single_transpose_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j, ii, jj;
+	int rows = args->rows, cols = args->cols;
+
+	for (ii = first*TRANSPOSE_BLOCK; ii < last*TRANSPOSE_BLOCK && ii < rows; ii += TRANSPOSE_BLOCK) {
+		for (jj = 0; jj < cols; jj += TRANSPOSE_BLOCK) {
+			for (i = ii; i < ii + TRANSPOSE_BLOCK && i < rows; i++) {
+				for (j = jj; j < jj + TRANSPOSE_BLOCK && j < cols; j++) {
+					*(args->output_single + (size_t)j*rows + i) = *(args->input_single + (size_t)i*cols + j);
+				}
+			}
+		}
+	}
+}
+
+/* transpose() in single precision */
+static void transpose_single(float complex *src, float complex *dst, int rows, int cols) {
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+
+	args.input_single = src;
+	args.output_single = dst;
+	args.rows = rows;
+	args.cols = cols;
+	parallel_for((rows + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK, 1, single_transpose_body, &args);
+}
+
+/* F times scale, negated at odd u+v+N+M, for rows first to last-1,
+	 in single precision */
+static void single_sign_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// the scale, and the row
+	float scale = args->scale;
+	float complex *row;
+	const int M = args->plan->M;
+
+	for (i = first; i < last; i++) {
+		row = args->output_single + (size_t)i*2*M;
+		for (j = 0; j < 2*M; j++) {
+			*(row + j) *= (i + j + args->parity)%2 ? -scale : scale;
+		}
+	}
+}
+
+/* dft() from a grid of its own into a context's freq_space, for
+	 time_call() */
+struct sparse_call {
+	dft_context *ctx;
+	double complex *input;
+};
+
+static void sparse_call(void *arg) {
+	struct sparse_call *call = arg;
+
+	dft(call->ctx, call->input, call->ctx->freq_space);
+}
+
+/* Time dft() on a few nonzero points of f(x,y), summed directly,
+	 and on a full f(x,y) through the FFTs, to find how many nonzero
+	 points the direct sum is worth it for on this machine.  The
+	 results go in the context's freq_space, so call it before that
+	 holds anything.
+
+	 *ctx: double precision context whose plan and arrays it works with
+
+	 Returns the number of nonzero points at which the FFTs become as
+	 quick, for the plan's sparse_limit, or -1 if memory could not be
+	 allocated.
+	 */
+int dft_measure_sparse(dft_context *ctx) {
+	// index variable, and the points the direct sum is timed on
+	size_t i, points;
+	int trial;
+	// time of the FFTs, and of the direct sum per nonzero point
+	double fft_seconds = -1.0, point_seconds = -1.0, seconds;
+	// index variable, the limit found and the one to put back
+	int round, saved;
+	double limit;
+	// f(x,y) to time on.  The context's real_space may be a mapped
+	// input file.
+	struct sparse_call call;
+	dft_plan *plan = ctx->plan;
+
+	points = 4*(size_t)plan->N*plan->M;
+	if ((call.input = malloc(points * sizeof(double complex))) == NULL) {
+		return -1;
+	}
+	call.ctx = ctx;
+	trial = (points < SPARSE_TRIAL) ? (int)points : SPARSE_TRIAL;
+	saved = plan->sparse_limit;
+	for (round = 0; round < TUNE_ROUNDS; round++) {
+		// Complex, so neither the real nor the even transform
+		for (i = 0; i < points; i++) {
+			*(call.input + i) = CMPLX(1.0, 1.0 + i%2);
+		}
+		plan->sparse_limit = 0;
+		seconds = time_call(sparse_call, &call, TUNE_SECONDS);
+		if (fft_seconds < 0.0 || seconds < fft_seconds) {
+			fft_seconds = seconds;
+		}
+
+		memset(call.input, 0, points * sizeof(double complex));
+		for (i = 0; i < (size_t)trial; i++) {
+			*(call.input + i*(points / trial)) = CMPLX(1.0, 1.0 + i);
+		}
+		plan->sparse_limit = INT_MAX;
+		seconds = time_call(sparse_call, &call, TUNE_SECONDS) / trial;
+		if (point_seconds < 0.0 || seconds < point_seconds) {
+			point_seconds = seconds;
+		}
+	}
+	plan->sparse_limit = saved;
+	free(call.input);
+
+	// The direct sum at the limit costs as much as the FFTs
+	limit = fft_seconds / point_seconds + 1.0;
+	return (limit > (double)INT_MAX) ? INT_MAX : (int)limit;
+}
+
+/* dft() in single precision, for half the memory and traffic.  Every
+	 f(x,y) takes the row-column FFT, with none of dft()'s shortcuts
+	 for sparse, real or even input.  The error is a few times 1e-7
+	 of the largest |F(u,v)|; dft_single_error() measures it.
+
+	 *ctx: context whose plan and scratch space it works with
+	 *input: pointer to the start of the array containing the
+	 				 function to be transformed.
+	 *output: pointer to the start of the array where the FT
+	 					will be stored.
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int dft_single(dft_context *ctx, float complex *input, float complex *output) {
+	// work space allocated here, when there is no dft_work
+	float complex *owned = NULL;
+	// the transposed grid of a big transform
+	float complex *area;
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	// rows each thread should have at the least
+	int grain;
+	dft_plan *plan = ctx->plan;
+	const int N = plan->N, M = plan->M;
+
+	// The same scratch space as dft(), counted in float complex
+	args.scratch_single = (float complex *)ctx->dft_work;
+	if (args.scratch_single == NULL
+		&& (args.scratch_single = owned = malloc(dft_work_size(plan) * sizeof(float complex))) == NULL) {
+		return -1;
+	}
+	args.scratch_size = scratch_points(plan);
+	area = args.scratch_single + threads_count() * args.scratch_size;
+	grain = PARALLEL_GRAIN / (2*M) + 1;
+	args.plan = plan;
+	args.input_single = input;
+	args.output_single = output;
+
+	// As in dft(): (-1)^(i+j) on the way in, then the rows, then
+	// the columns, then (-1)^(u+v+N+M) and the scale
+	parallel_for(2*N, grain, single_rows_body, &args);
+
+	args.fft = plan->x_fft;
+	if (4*(size_t)N*M <= TRANSPOSE_LIMIT) {
+		args.line_step = 1;
+		args.point_step = 2*M;
+		parallel_for(2*M, PARALLEL_GRAIN / (2*N) + 1, single_lines_body, &args);
+	} else {
+		transpose_single(output, area, 2*N, 2*M);
+		args.output_single = area;
+		args.line_step = 2*N;
+		args.point_step = 1;
+		parallel_for(2*M, PARALLEL_GRAIN / (2*N) + 1, single_lines_body, &args);
+		transpose_single(area, output, 2*M, 2*N);
+		args.output_single = output;
+	}
+	free(owned);
+
+	args.parity = N + M;
+	args.scale = 1.0 / ((double)(4.0 * M * N));
+	parallel_for(2*N, grain, single_sign_body, &args);
+	return 0;
+}
+
+/* Sum f(x,y) along x for columns first to last-1, each term turned
+	 by the factor of the row of F(u,v) being checked, with the
+	 (-1)^j that lets an FFT along y finish that row.  The columns
+	 are taken a row of f at a time, so that it is read in order. */
+static void check_row_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// index into the table of roots of unity, and its entry for i
+	int k_x;
+	double complex factor;
+	const int N = args->plan->N, M = args->plan->M;
+	const int u = args->check_u - N;
+
+	for (j = first; j < last; j++) {
+		*(args->row_sums + j) = 0.0;
+	}
+	for (i = -N; i < N; i++) {
+		// exp(-i pi i u / N) is entry -i*u mod 2N of the x table
+		k_x = ((-(long long)i * u) % (2*N) + 2*N) % (2*N);
+		factor = *(args->plan->x_fft->table + k_x);
+		for (j = first; j < last; j++) {
+			*(args->row_sums + j) += cmul(*(args->input_single + indexof(i, j - M)), factor);
+		}
+	}
+	for (j = first; j < last; j++) {
+		if (j % 2) {
+			*(args->row_sums + j) = -*(args->row_sums + j);
+		}
+	}
+}
+
+/* Sum f(x,y) along y for rows first to last-1, each term turned by
+	 the factor of the column of F(u,v) being checked, with the
+	 (-1)^i that lets an FFT along x finish that column. */
+static void check_column_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// index into the table of roots of unity
+	int k_y;
+	// the sum along y for one x
+	double complex row;
+	const int N = args->plan->N, M = args->plan->M;
+	const int v = args->check_v - M;
+
+	for (i = first; i < last; i++) {
+		// exp(-i pi j v / M) is entry -j*v mod 2M of the y table
+		row = 0.0;
+		k_y = (((long long)M * v) % (2*M) + 2*M) % (2*M);
+		for (j = -M; j < M; j++) {
+			row += cmul(*(args->input_single + indexof(i - N, j)), *(args->plan->y_fft->table + k_y));
+			k_y -= v;
+			if (k_y >= 2*M) {
+				k_y -= 2*M;
+			} else if (k_y < 0) {
+				k_y += 2*M;
+			}
+		}
+		*(args->column_sums + i) = (i % 2) ? -row : row;
+	}
+}
+
+/* Measure the error of dft_single(): the row and the column of
+	 F(u,v) through its largest point are found again in double
+	 precision from f(x,y), each by one pass over the grid and a
+	 double precision FFT, and compared with it point by point.
+
+	 *ctx: context whose plan it works with
+	 *input, *output: f(x,y) and F(u,v) as dft_single() left them
+
+	 Returns the largest difference found, over the largest |F(u,v)|,
+	 or -1 if memory could not be allocated.
+	 */
+double dft_single_error(dft_context *ctx, float complex *input, float complex *output) {
+	// index variables
+	size_t i;
+	int u, v;
+	// the largest point, as an array index
+	size_t peak = 0;
+	// F(u,v) along the row and column, in double precision
+	double complex *row = NULL, *column = NULL, *work = NULL;
+	// the largest |F(u,v)|, and the largest error
+	double largest = 0.0, worst = 0.0;
+	// the factor (-1)^(u+v+N+M) and the scale of dft()
+	double scale;
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	dft_plan *plan = ctx->plan;
+	const int N = plan->N, M = plan->M;
+	const size_t points = 4*(size_t)N*M;
+	const int work_size = fft_work_size(plan->x_fft) > fft_work_size(plan->y_fft)
+												? fft_work_size(plan->x_fft) : fft_work_size(plan->y_fft);
+
+	if ( (row = malloc(2*M * sizeof(double complex))) == NULL
+		|| (column = malloc(2*N * sizeof(double complex))) == NULL
+		|| (work = malloc((work_size > 0 ? work_size : 1) * sizeof(double complex))) == NULL ) {
+		free(row);
+		free(column);
+		return -1.0;
+	}
+
+	for (i = 0; i < points; i++) {
+		if (cabsf(*(output + i)) > largest) {
+			largest = cabsf(*(output + i));
+			peak = i;
+		}
+	}
+
+	args.plan = plan;
+	args.input_single = input;
+	args.check_u = peak / (2*M);
+	args.check_v = peak % (2*M);
+	args.row_sums = row;
+	args.column_sums = column;
+	parallel_for(2*M, PARALLEL_GRAIN / (2*N) + 1, check_row_body, &args);
+	parallel_for(2*N, PARALLEL_GRAIN / (2*M) + 1, check_column_body, &args);
+	fft_execute_work(plan->y_fft, row, row, work);
+	fft_execute_work(plan->x_fft, column, column, work);
+
+	// As in dft(): (-1)^(u+v+N+M) and the scale on the way out
+	for (v = 0; v < 2*M; v++) {
+		scale = ((args.check_u + v + N + M) % 2 ? -1.0 : 1.0) / (4.0 * N * M);
+		if (cabs(scale * *(row + v) - *(output + (size_t)args.check_u * 2*M + v)) > worst) {
+			worst = cabs(scale * *(row + v) - *(output + (size_t)args.check_u * 2*M + v));
+		}
+	}
+	for (u = 0; u < 2*N; u++) {
+		scale = ((u + args.check_v + N + M) % 2 ? -1.0 : 1.0) / (4.0 * N * M);
+		if (cabs(scale * *(column + u) - *(output + (size_t)u * 2*M + args.check_v)) > worst) {
+			worst = cabs(scale * *(column + u) - *(output + (size_t)u * 2*M + args.check_v));
+		}
+	}
+	free(row);
+	free(column);
+	free(work);
+	return (largest > 0.0) ? worst / largest : 0.0;
+}
+
+/* Zero a grid of the context's precision */
+static void clear_grid(dft_context *ctx, void *output) {
+	memset(output, 0, 4*(size_t)ctx->plan->M*ctx->plan->N
+										* (ctx->precision == DATAFILE_FLOAT32 ? sizeof(float complex) : sizeof(double complex)));
+}
+
+/* Set point (i, j) of a grid of the context's precision to value */
+static inline void set_point(dft_context *ctx, void *output, int i, int j, double value) {
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	if (ctx->precision == DATAFILE_FLOAT32) {
+		*((float complex *)output + indexof(i, j)) = value;
+	} else {
+		*((double complex *)output + indexof(i, j)) = value;
+	}
+}
+
+/* Whether the box of points from (x0, y0) to (x1, y1) lies in the
+	 grid */
+static int box_fits(dft_context *ctx, int x0, int y0, int x1, int y1) {
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	return x0 >= -N && x1 < N && y0 >= -M && y1 < M;
 }
 
 /* This function populates output with a simulated
 	 single cross light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: The position of the centre of the slit
 	 strength: intensity of light from slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_single(double complex *output, int c_x, int c_y, double strength) {
-	memset(output, 0, 4*M*N*sizeof(double complex));
-	*(output+indexof(c_x  ,c_y  ))   = strength;
-	*(output+indexof(c_x+1,c_y  ))   = strength;
-	*(output+indexof(c_x  ,c_y+1))   = strength;
-	*(output+indexof(c_x-1,c_y  ))   = strength;
-	*(output+indexof(c_x  ,c_y-1))   = strength;
+int construct_single(dft_context *ctx, void *output, int c_x, int c_y, double strength) {
+	if (!box_fits(ctx, c_x-1, c_y-1, c_x+1, c_y+1)) {
+		return -1;
+	}
+	clear_grid(ctx, output);
+	set_point(ctx, output, c_x, c_y, strength);
+	set_point(ctx, output, c_x+1, c_y, strength);
+	set_point(ctx, output, c_x, c_y+1, strength);
+	set_point(ctx, output, c_x-1, c_y, strength);
+	set_point(ctx, output, c_x, c_y-1, strength);
+	return 0;
 }
 
 /* This function populates output with a simulated
 	 single square light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c _x,c _y: The positions of the centres of each of the squares
 	 strength: intensity of light from slit
-	 */
-void construct_squares(double complex *output, int c1_x, int c1_y, 
-												int c2_x, int c2_y, double strength) {
 
-	memset(output, 0, 4*M*N*sizeof(double complex));
-	*(output+indexof(c1_x  , c1_y  )) = strength;
-	*(output+indexof(c1_x+1, c1_y  )) = strength;
-	*(output+indexof(c1_x  , c1_y+1)) = strength;
-	*(output+indexof(c1_x+1, c1_y+1)) = strength;
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
+	 */
+int construct_squares(dft_context *ctx, void *output, int c1_x, int c1_y, 
+											 int c2_x, int c2_y, double strength) {
+	if (!box_fits(ctx, c1_x, c1_y, c1_x+1, c1_y+1) || !box_fits(ctx, c2_x, c2_y, c2_x+1, c2_y+1)) {
+		return -1;
+	}
+	clear_grid(ctx, output);
+	set_point(ctx, output, c1_x, c1_y, strength);
+	set_point(ctx, output, c1_x+1, c1_y, strength);
+	set_point(ctx, output, c1_x, c1_y+1, strength);
+	set_point(ctx, output, c1_x+1, c1_y+1, strength);
 
-	*(output+indexof(c2_x  , c2_y  )) = strength;
-	*(output+indexof(c2_x+1, c2_y  )) = strength;
-	*(output+indexof(c2_x  , c2_y+1)) = strength;
-	*(output+indexof(c2_x+1, c2_y+1)) = strength;
+	set_point(ctx, output, c2_x, c2_y, strength);
+	set_point(ctx, output, c2_x+1, c2_y, strength);
+	set_point(ctx, output, c2_x, c2_y+1, strength);
+	set_point(ctx, output, c2_x+1, c2_y+1, strength);
+	return 0;
 }
 
 /* This function populates output with a simulated
 	 single slit light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: coords of centre of the slit
 	 width: The width of the slit
 	 length: The length of the slit
 	 strength: The intensity of the light from the slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_slit(double complex *output, int c_x, int c_y, 
+int construct_slit(dft_context *ctx, void *output, int c_x, int c_y, 
 										int width, int length, double strength) {
-
-	// Most of the function is 0.  Memset is fast.
-	memset(output, 0, 4*M*N*sizeof(double complex));
-
 	// index variables
 	int i, j;
 	// flag - 1 if width odd
@@ -170,33 +1425,41 @@ void construct_slit(double complex *output, int c_x, int c_y,
 	int half_width = (width_odd = width%2) ? (width-1)/2 : width/2;
 	int half_length = (length_odd = length%2) ? (length-1)/2 : length/2;
 
+	if (!box_fits(ctx, c_x-half_width, c_y-half_length, c_x-half_width+width-1, c_y-half_length+length-1)) {
+		return -1;
+	}
+
+	// Most of the function is 0.  Memset is fast.
+	clear_grid(ctx, output);
+
 	// Set half_width and half_length elements either side of the
 	// respective centres to strength.  If either is odd then we want
 	// 1 element extra on the positive side of centre.
 	for (i = -half_width; i < half_width + width_odd; i++) {
 		for (j = -half_length; j < half_length + length_odd; j++) {
-			*(output+indexof(c_x+i, c_y+j)) = strength;	
+			set_point(ctx, output, c_x+i, c_y+j, strength);	
 		}
 	}
+	return 0;
 }
 
 /* This function populates output with a simulated
 	 double slit light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: coords of centre of the slits
 	 width: The width of the slit
 	 length: The length of the slit
 	 centres: Distance of each slit from centre in x-direction
 	 strength: The intensity of the light from the slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_doubleslit(double complex *output, int c_x, int c_y,
+int construct_doubleslit(dft_context *ctx, void *output, int c_x, int c_y,
 												int width, int length, int centres, double strength) {
-
-	// Most of the function is 0.  Memset is fast
-	memset(output, 0, 4*M*N*sizeof(double complex));
-
 	// index variables
 	int i, j;
 	// flag - 1 if width odd
@@ -208,17 +1471,28 @@ void construct_doubleslit(double complex *output, int c_x, int c_y,
 	int half_width = (width_odd = width%2) ? (width-1)/2 : width/2;
 	int half_length = (length_odd = length%2) ? (length-1)/2 : length/2;
 
+	if (!box_fits(ctx, c_x+centres-half_width, c_y-half_length,
+								c_x+centres-half_width+width-1, c_y-half_length+length-1)
+		|| !box_fits(ctx, c_x-centres-half_width, c_y-half_length,
+								 c_x-centres-half_width+width-1, c_y-half_length+length-1)) {
+		return -1;
+	}
+
+	// Most of the function is 0.  Memset is fast
+	clear_grid(ctx, output);
+
 	// Set half_width and half_length elements either side of the
 	// respective centres to strength.  If either is odd then we want
 	// 1 element extra on the positive side of centre.
 	for (i = -half_width; i < half_width + width_odd; i++) {
 		for (j = -half_length; j < half_length + length_odd; j++) {
-			*(output+indexof(c_x+i+centres, c_y+j)) = strength;	
+			set_point(ctx, output, c_x+i+centres, c_y+j, strength);	
 		}
 	}
 	for (i = -half_width; i < half_width + width_odd; i++) {
 		for (j = -half_length; j < half_length + length_odd; j++) {
-			*(output+indexof(c_x+i-centres, c_y+j)) = strength;	
+			set_point(ctx, output, c_x+i-centres, c_y+j, strength);	
 		}
 	}
+	return 0;
 }
@@ -10,10 +10,126 @@ Function prototypes, macros and external variable declarations
 */
 
 // Some definitions and macros
-// This macro maps cordinates to array index
-#define indexof(i, j) ( ((i)+N)*2*N + ((j)+M) )
-#define N 100 // x dimension
-#define M 100 // y dimension
+// This macro maps cordinates to array index.
+// Each row holds the 2M values of y for one x.  N and M are set
+// at run time and held in the plan; functions take local copies.
+#define indexof(i, j) ( ((i)+N)*2*M + ((j)+M) )
+#define DEFAULT_N 100 // x dimension when not given
+#define DEFAULT_M 100 // y dimension when not given
+// The mode that transforms f(x,y) as read from the -input file,
+// which also sets N and M
+#define LOAD_MODE 4
+// The mode that transforms f(x,y) from the -input file out of core,
+// a band of rows or columns at a time, for grids too big for memory
+#define OOC_MODE 5
+// The mode that blurs a double slit with a Gaussian point spread
+// function, and finds its autocorrelation
+#define CONV_MODE 6
+// Spread of the point spread function, in points, and how far out
+// from its centre it is kept
+#define PSF_SIGMA 1.5
+#define PSF_RADIUS 4
+// Kernels no more than this many points a side, and separable, are
+// convolved directly rather than through the 2D transform
+#define CONVOLVE_DIRECT_SIZE 32
+// How closely a kernel must match the product of its factors, as a
+// fraction of its largest point, to count as separable
+#define CONVOLVE_TOLERANCE 1e-12
+// Megabytes of buffers the out-of-core transform works in, when
+// -mem is not given
+#define DEFAULT_OOC_MEMORY 1024
+// Below this many nonzero points of f(x,y), summing the DFT directly
+// over the nonzero points beats the row-column FFT.  This is the
+// plan's sparse_limit unless -tune has measured it.
+#define SPARSE_LIMIT 12
+// Nonzero points the direct sum is timed on by dft_measure_sparse()
+#define SPARSE_TRIAL 4
+// Grids with more points than this do the x transforms on a
+// transposed copy, rather than pulling each column out in turn.
+#define TRANSPOSE_LIMIT (1024*1024)
+// Side of the square tiles the transpose works through
+#define TRANSPOSE_BLOCK 32
+// Fewest points worth handing a thread of their own in the loops
+// shared out by parallel_for()
+#define PARALLEL_GRAIN 4096
+// Most points along each side of a plot when -plotmax is not given.
+// The plots are 1000 pixels across and the surface less than that,
+// so more points would only slow gnuplot down.
+#define PLOT_POINTS 500
+
+#include "../fft.h"
+#include "../realfft.h"
+#include "../twiddle.h"
+#include "../threads.h"
+#include "../simd.h"
+#include "../arena.h"
+#include "../datafile.h"
+#include "../tune.h"
+#include "../timing.h"
+#include "../render.h"
+
+/* Everything that depends on the size of the transform.
+	 Built once by set_params() from the command line.
+	 */
+typedef struct dft_plan {
+	// x runs from -N to N-1, y from -M to M-1
+	int N;
+	int M;
+	// FFT plans for the length 2N transforms along x and the
+	// length 2M transforms along y
+	fft_plan *x_fft;
+	fft_plan *y_fft;
+	// Real transforms of 2M points along y, for f(x,y) that is real
+	fft_real_plan *y_rfft;
+	// Cosine transforms of N+1 points along x and M+1 along y, for
+	// f(x,y) that is real and even in x and y.  NULL unless N and M
+	// are both even.
+	fft_real_plan *x_dct;
+	fft_real_plan *y_dct;
+	// LAYOUT_INTERLEAVED or LAYOUT_SPLIT: how the 1D FFTs hold
+	// each row or column while they work on it
+	int layout;
+	// dft() sums directly over fewer nonzero points than this
+	int sparse_limit;
+} dft_plan;
+
+/* One transform job: the plan it works to, its own data arrays and
+	 scratch space, and how its results are written.  The transforms
+	 and the functions that write their results read nothing else, so
+	 jobs in different contexts can run on different threads of one
+	 process at once, on the same plan or not.
+	 */
+typedef struct dft_context {
+	// Transform size and FFT plans.  Not freed with the context.
+	dft_plan *plan;
+	// Defines f(x,y)
+	double complex *real_space;
+	// Holds fourier transform, F(u,v)
+	double complex *freq_space;
+	// Precision the transform works in: DATAFILE_FLOAT64, or
+	// DATAFILE_FLOAT32 for dft_single(), whose arrays are these in
+	// place of the two above
+	int precision;
+	float complex *real_single;
+	float complex *freq_single;
+	// dft_work_size() points of scratch space for dft(), or for
+	// dft_single() as many float complex points
+	double complex *dft_work;
+	// The arena they are cut from, if the context has one of its own
+	arena *space;
+	// Execution mode, which names the files written
+	int mode;
+	// DATAFILE_FLOAT64 or DATAFILE_FLOAT32 for binary data files,
+	// DATAFILE_TEXT for text
+	int output_precision;
+	// Most points along each side of the plots, 0 for every point
+	int plot_points;
+	// RENDER_PPM or RENDER_PNG to draw the plots as images, on the
+	// RENDER_LINEAR or RENDER_LOG scale, or RENDER_NONE for gnuplot
+	// scripts
+	int render;
+	int render_scale;
+} dft_context;
 
 // Function prototypes
 // Functions in io.c
@@ -36,95 +152,358 @@ void _exit(int code);
 	 */
 void set_params(int count, char *argvec[]);
 
-/* Writes data in array to a file for plotting purposes
-	 Space delimited file:
-	 0 index real_part imag_part magnitude
-
-	 The 0 column is to facilitate a vector plot, though this
-	 is not done from this programme
+/* Writes data in array to a file for plotting purposes.
+	 By default this is a binary file (datafile.c): a header, then
+	 the real and imaginary parts of each point.  With -text it is
+	 the old space delimited file:
+	 x y real_part imag_part magnitude
 
-	 *array: data to be written to the file
+	 *ctx: context the data is for, which sets the mode and format
+	 *array: data to be written to the file, of the context's
+	 				 precision
 	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int write_datafile(dft_context *ctx, void *array, char name[]);
+
+/* Write the data a plot is drawn from: single precision gnuplot
+	 binary matrices of the real part and the magnitude, on the grid
+	 itself, so gnuplot draws them without interpolating them onto a
+	 grid of its own.  Grids with more points along a side than the
+	 context's plot_points are shrunk, each block of points becoming
+	 its extremes.
+
+	 *ctx: context the plot is for, which sets the mode and the most
+				 points
+	 *array: the data, of the context's precision
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the files could not be written or memory
+	 could not be allocated.
 	 */
-void write_datafile(double complex *array, char name[]);
+int write_plotdata(dft_context *ctx, void *array, char name[]);
+
+/* As write_plotdata(), from a binary data file of interleaved points
+	 written for the context, read a row at a time so that the grid
+	 need not fit in memory.
+
+	 *ctx: context the plot is for
+	 name[]: string identifier for the data file and the plot
+
+	 Returns 0, or -1 if the data file could not be read, the
+	 matrices could not be written or memory could not be allocated.
+	 */
+int write_plotdata_file(dft_context *ctx, char name[]);
+
+/* Draw a plot as images in place of the gnuplot script: heatmaps of
+	 the real part and the magnitude, u (or x) across and v (or y) up,
+	 in plots/real_<name>_m<mode>_N<N>_M<M> and abs_ likewise.
+
+	 *ctx: context the plot is for, which sets the mode, the image
+				 format and the scale
+	 *array: the data, of the context's precision
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the images could not be written or memory
+	 could not be allocated.
+	 */
+int plot_image(dft_context *ctx, void *array, char name[]);
+
+/* As plot_image(), from a binary data file of interleaved points
+	 written for the context, read a few rows at a time so that the
+	 grid need not fit in memory.
+
+	 *ctx: context the plot is for
+	 name[]: string identifier for the data file and the plot
+
+	 Returns 0, or -1 if the data file could not be read, the images
+	 could not be written or memory could not be allocated.
+	 */
+int plot_image_file(dft_context *ctx, char name[]);
 
 /* Write a gnuplot script to produce the required plot
 	 Plot depends on programme execution mode.
-	 Gnuplot can then be called externally
+	 Gnuplot can then be called externally.  The script reads the
+	 matrices write_plotdata() wrote.
 
+	 *ctx: context the plot is for, which sets the mode
 	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the script could not be written.
 	 */
-void plot(char name[]);
+int plot(dft_context *ctx, char name[]);
 
 
 // Functions in schrodinger.c
+/* Build the plan for transforms of 2N x 2M points.
+
+	 N, M: x runs from -N to N-1, y from -M to M-1
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to do the 1D FFTs on
+	 				 separate real and imaginary arrays with SIMD kernels
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_plan *dft_plan_create(int N, int M, int layout);
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void dft_plan_destroy(dft_plan *plan);
+
+/* Fill in a context on a plan with the defaults: mode 0, double
+	 precision throughout and no data arrays yet.
+
+	 *ctx: the context
+	 *plan: plan it works to
+	 */
+void dft_context_init(dft_context *ctx, dft_plan *plan);
+
+/* Cut a context's data arrays and scratch space from an arena, or
+	 with no arena only count the bytes they need, so that they can
+	 share an arena with other buffers.  The arrays are those of the
+	 context's precision, which must be set first.  A real_space or
+	 real_single set beforehand, such as a mapped file, is kept and
+	 takes no room.
+
+	 *ctx: context from dft_context_init()
+	 *a: the arena, or NULL to count
+
+	 Returns the bytes the arrays take up.
+	 */
+size_t dft_context_alloc(dft_context *ctx, arena *a);
+
+/* Create a context on a plan, with its data arrays in an arena of
+	 its own.  The defaults are those of dft_context_init().  The
+	 threads must already have been started by threads_init().
+
+	 *plan: plan it works to, which must outlive the context
+	 precision: DATAFILE_FLOAT64, or DATAFILE_FLOAT32 for dft_single()
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_context *dft_context_create(dft_plan *plan, int precision, int pages);
+
+/* Free a context from dft_context_create() and its arena, but not
+	 its plan.  NULL is ignored.
+
+	 *ctx: context to be freed
+	 */
+void dft_context_destroy(dft_context *ctx);
+
+/* Number of points of scratch space dft() needs: a share for each
+	 thread, then room for the transposed grid of a big transform or
+	 the half array of a real one.  The threads must already have been
+	 started.
+
+	 *plan: plan of the transform
+	 */
+size_t dft_work_size(dft_plan *plan);
+
 /* This function finds the FT of the discrete function
 	 defined in the input array, and stores it in the output
-	 array. 
+	 array.  It works in the context's dft_work, or if that is NULL
+	 in space allocated for the call.
 	 
+	 *ctx: context whose plan and scratch space it works with
 	 *input: pointer to the start of the array containing the 
 	 				 function to be transformed.
 	 *output: pointer to the start of the array where the FT
 	 					will be stored.
+
+	 Returns 0, or -1 if memory could not be allocated.
 	 */
-void dft(double complex *input, double complex *output);
+int dft(dft_context *ctx, double complex *input, double complex *output);
+
+/* Time dft() on a few nonzero points of f(x,y), summed directly,
+	 and on a full f(x,y) through the FFTs, to find how many nonzero
+	 points the direct sum is worth it for on this machine.  The
+	 results go in the context's freq_space, so call it before that
+	 holds anything.
+
+	 *ctx: double precision context whose plan and arrays it works with
+
+	 Returns the number of nonzero points at which the FFTs become as
+	 quick, for the plan's sparse_limit, or -1 if memory could not be
+	 allocated.
+	 */
+int dft_measure_sparse(dft_context *ctx);
+
+/* dft() in single precision, for half the memory and traffic.  Every
+	 f(x,y) takes the row-column FFT, with none of dft()'s shortcuts
+	 for sparse, real or even input.  The error is a few times 1e-7
+	 of the largest |F(u,v)|; dft_single_error() measures it.
+
+	 *ctx: context whose plan and scratch space it works with
+	 *input: pointer to the start of the array containing the
+	 				 function to be transformed.
+	 *output: pointer to the start of the array where the FT
+	 					will be stored.
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int dft_single(dft_context *ctx, float complex *input, float complex *output);
+
+/* Measure the error of dft_single(): the row and the column of
+	 F(u,v) through its largest point are found again in double
+	 precision from f(x,y), each by one pass over the grid and a
+	 double precision FFT, and compared with it point by point.
+
+	 *ctx: context whose plan it works with
+	 *input, *output: f(x,y) and F(u,v) as dft_single() left them
+
+	 Returns the largest difference found, over the largest |F(u,v)|,
+	 or -1 if memory could not be allocated.
+	 */
+double dft_single_error(dft_context *ctx, float complex *input, float complex *output);
 
 /* This function populates output with a simulated
 	 single cross light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: The position of the centre of the slit
 	 strength: intensity of light from slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_single(double complex *output, int c_x, int c_y, double strength);
+int construct_single(dft_context *ctx, void *output, int c_x, int c_y, double strength);
 
 /* This function populates output with a simulated
 	 single square light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c _x,c _y: The positions of the centres of each of the squares
 	 strength: intensity of light from slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_squares(double complex *output, int c1_x, int c1_y, 
+int construct_squares(dft_context *ctx, void *output, int c1_x, int c1_y, 
 											int c2_x, int c2_y, double strength);
 
 /* This function populates output with a simulated
 	 single slit light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: coords of centre of the slit
 	 width: The width of the slit
 	 length: The length of the slit
 	 strength: The intensity of the light from the slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_slit(double complex *output, int c_x, int c_y, 
+int construct_slit(dft_context *ctx, void *output, int c_x, int c_y, 
 										int width, int height, double strength);
 
 /* This function populates output with a simulated
 	 double slit light source.
 	 
+	 *ctx: context whose plan gives N and M
 	 *output: pointer to start of the array where the
-	 					function is to be stored
+	 					function is to be stored, of the context's precision
 	 c_x,c_y: coords of centre of the slits
 	 width: The width of the slit
 	 length: The length of the slit
 	 centres: Distance of each slit from centre in x-direction
 	 strength: The intensity of the light from the slit
+
+	 Returns 0, or -1 if it does not fit in the grid, when output is
+	 left as it was.
 	 */
-void construct_doubleslit(double complex *output, int c_x, int c_y, 
+int construct_doubleslit(dft_context *ctx, void *output, int c_x, int c_y, 
 										int width, int height, int centres, double strength);
 
 
+// Functions in convolve.c
+/* Produce the convolution of the grids input1 and input2,
+	 h(X,Y) = sum over (x,y) of f(x,y) g(X-x,Y-y), for X and Y on the
+	 grid.  A g that is a small separable kernel is summed directly,
+	 and anything else goes through the 2D transform.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the convolution
+	 					is to be stored, which may be either input
+	 *input1, *input2: pointers to starts of the grids f and g
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int convolve(dft_context *ctx, double complex *output, double complex *input1, double complex *input2);
+
+/* Produce the correlation of the grids input1 and input2,
+	 c(X,Y) = sum over (x,y) of conj(f(x,y)) g(x+X,y+Y), for X and Y
+	 on the grid: with input1 the same as input2, the autocorrelation.
+	 An f that is a small separable kernel is summed directly, and
+	 anything else goes through the 2D transform.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the correlation
+	 					is to be stored, which may be either input
+	 *input1, *input2: pointers to starts of the grids f and g
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int correlate(dft_context *ctx, double complex *output, double complex *input1, double complex *input2);
+
+/* Convolve a grid with a separable kernel given by its factors,
+	 summed directly: h(X,Y) = sum over a and b of kernel_x(a)
+	 kernel_y(b) f(X-a,Y-b), with a running from -(nx/2) to
+	 nx-1-nx/2 and b likewise, so that odd length factors are centred.
+
+	 *ctx: context whose plan it works with, in double precision
+	 *output: pointer to start of the array where the convolution
+	 					is to be stored, which may be input
+	 *input: pointer to start of the grid f
+	 *kernel_x, *kernel_y: the factors along x and y
+	 nx, ny: their lengths
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int convolve_separable(dft_context *ctx, double complex *output, double complex *input,
+											 double complex *kernel_x, int nx, double complex *kernel_y, int ny);
+
+
+// Functions in outofcore.c
+/* Find the FT of f(x,y) in an input data file without holding
+	 either in memory, and write it to the data file for the freq
+	 plot.  Only about memory bytes of buffers are used, however big
+	 the grid.
+
+	 *ctx: context whose plan, mode and format it works to.  It needs
+	 			 no data arrays.
+	 *header: header of the input file, which sets N and M
+	 *path: the input file
+	 memory: bytes of buffers to use
+
+	 Returns 0, or -1 if the input could not be read, the scratch or
+	 output file written, or memory allocated.
+	 */
+int dft_outofcore(dft_context *ctx, datafile_header *header, const char *path, size_t memory);
+
+
 /* Declare global variables */
-// Execution mode number
-extern int mode;
-
-// Data storage arrays
-// The native complex data type is ideal for this application
-// Defines f(x)
-extern double complex *real_space;
-// Holds fourier transform, F(u)
-extern double complex *freq_space;
+// These belong to the programme, which runs the mode from the
+// command line.  set_params() sets them; the other functions above
+// use only the context they are given.
+// The context the mode runs in.  Its data arrays are cut from
+// buffer_arena, but for a loaded f(x,y), which is mapped.
+extern dft_context context;
+extern arena *buffer_arena;
+
+// Transform size and FFT plans, built once in set_params()
+extern dft_plan *plan;
+
+// The -input file for LOAD_MODE and OOC_MODE, and its header
+extern char *input_file;
+extern datafile_header input_header;
+// Bytes of buffers for OOC_MODE
+extern size_t ooc_memory;
@@ -10,30 +10,416 @@ going on here.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <complex.h>
+#include <math.h>
 #include "header.h"
 
 
+/* A plot's data in the making.  The grid is folded into blocks of
+	 block_x by block_y points, one row of blocks at a time, and each
+	 block is written as the extremes of the points in it: the largest
+	 magnitude, and whichever of the least and greatest real part lies
+	 further from zero.  Peaks and sign changes narrower than a block
+	 survive, which averaging or picking every nth point would lose.
+	 Blocks of one point write the grid as it is.
+	 */
+struct plot_matrix {
+	// The matrices of the real part and of the magnitude
+	FILE *real;
+	FILE *abs;
+	// Points to a block along x and y, and blocks along y
+	int block_x;
+	int block_y;
+	int cols;
+	// Rows of the grid folded into the current row of blocks, and
+	// rows before it
+	int filled;
+	int done;
+	// The current row of blocks of each matrix: its x coordinate,
+	// then the extremes so far
+	float *real_row;
+	float *abs_row;
+};
+
+/* Coordinate of the middle of a block of points along one side
+
+	 first: coordinate of the side's first point
+	 length: points along the side
+	 block: points to a block
+	 k: the block
+	 */
+static float block_centre(int first, int length, int block, int k) {
+	int size = (length - k*block < block) ? length - k*block : block;
+
+	return first + k*block + (size - 1) / 2.0;
+}
+
+/* Start a plot's matrices: choose the blocks and write the first
+	 record of each file, the number of blocks along y and their y
+	 coordinates.  Gnuplot reads the files as "binary matrix" (a
+	 nonuniform matrix of floats), so the points need no gridding.
+
+	 *m: the matrices
+	 *ctx: context the plot is for, which sets the mode and the most
+				 points
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the files could not be opened or memory
+	 could not be allocated.
+	 */
+static int matrix_open(struct plot_matrix *m, dft_context *ctx, char name[]) {
+	// index variable
+	int j;
+	// Buffer for file name
+	char filename[80] = { };
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
+	const int points = ctx->plot_points;
+
+	memset(m, 0, sizeof(struct plot_matrix));
+	// As few blocks along each side as will keep to the most points
+	m->block_x = (points > 0 && 2*N > points) ? (2*N + points - 1) / points : 1;
+	m->block_y = (points > 0 && 2*M > points) ? (2*M + points - 1) / points : 1;
+	m->cols = (2*M + m->block_y - 1) / m->block_y;
+
+	if ((m->real_row = malloc((m->cols + 1) * sizeof(float))) == NULL
+		|| (m->abs_row = malloc((m->cols + 1) * sizeof(float))) == NULL) {
+		return -1;
+	}
+	snprintf(filename, sizeof(filename), "data/matrix_%s_m%d_N%d_M%d_re.bin", name, mode, N, M);
+	if ((m->real = fopen(filename, "wb")) == NULL) {
+		return -1;
+	}
+	snprintf(filename, sizeof(filename), "data/matrix_%s_m%d_N%d_M%d_abs.bin", name, mode, N, M);
+	if ((m->abs = fopen(filename, "wb")) == NULL) {
+		return -1;
+	}
+
+	*m->real_row = m->cols;
+	for (j = 0; j < m->cols; j++) {
+		*(m->real_row + j + 1) = block_centre(-M, 2*M, m->block_y, j);
+	}
+	if (fwrite(m->real_row, sizeof(float), m->cols + 1, m->real) != (size_t)(m->cols + 1)
+		|| fwrite(m->real_row, sizeof(float), m->cols + 1, m->abs) != (size_t)(m->cols + 1)) {
+		return -1;
+	}
+	return 0;
+}
+
+/* Fold the next row of the grid into the matrices, writing out the
+	 row of blocks when it is complete.
+
+	 *m: the matrices
+	 *ctx: context the plot is for
+	 *values: the row's 2M points, real and imaginary parts in turn
+
+	 Returns 0, or -1 if the files could not be written.
+	 */
+static int matrix_add_row(struct plot_matrix *m, dft_context *ctx, const double *values) {
+	// index variable
+	int j;
+	// the point being folded in, and the block it falls in
+	double re, im, magnitude;
+	float *real, *abs;
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	if (m->filled == 0) {
+		for (j = 1; j <= m->cols; j++) {
+			*(m->real_row + j) = 0.0f;
+			*(m->abs_row + j) = 0.0f;
+		}
+	}
+	for (j = 0; j < 2*M; j++) {
+		re = *(values + 2*j);
+		im = *(values + 2*j + 1);
+		magnitude = sqrt(re*re + im*im);
+		real = m->real_row + j / m->block_y + 1;
+		abs = m->abs_row + j / m->block_y + 1;
+		if (fabs(re) > fabsf(*real)) {
+			*real = re;
+		}
+		if (magnitude > *abs) {
+			*abs = magnitude;
+		}
+	}
+	m->filled++;
+
+	// The last row of blocks may be short
+	if (m->filled == m->block_x || m->done + m->filled == 2*N) {
+		*m->real_row = block_centre(-N, 2*N, m->block_x, m->done / m->block_x);
+		*m->abs_row = *m->real_row;
+		if (fwrite(m->real_row, sizeof(float), m->cols + 1, m->real) != (size_t)(m->cols + 1)
+			|| fwrite(m->abs_row, sizeof(float), m->cols + 1, m->abs) != (size_t)(m->cols + 1)) {
+			return -1;
+		}
+		m->done += m->filled;
+		m->filled = 0;
+	}
+	return 0;
+}
+
+/* Close a plot's matrices and free their rows.
+
+	 *m: the matrices, opened or not
+
+	 Returns 0, or -1 if the files could not be closed.
+	 */
+static int matrix_close(struct plot_matrix *m) {
+	int status = 0;
+
+	if (m->real != NULL && fclose(m->real) != 0) {
+		status = -1;
+	}
+	if (m->abs != NULL && fclose(m->abs) != 0) {
+		status = -1;
+	}
+	free(m->real_row);
+	free(m->abs_row);
+	return status;
+}
+
+/* Write the data a plot is drawn from: single precision gnuplot
+	 binary matrices of the real part and the magnitude, on the grid
+	 itself, so gnuplot draws them without interpolating them onto a
+	 grid of its own.  Grids with more points along a side than the
+	 context's plot_points are shrunk, each block of points becoming
+	 its extremes.
+
+	 *ctx: context the plot is for, which sets the mode and the most
+				 points
+	 *array: the data, of the context's precision
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the files could not be written or memory
+	 could not be allocated.
+	 */
+int write_plotdata(dft_context *ctx, void *array, char name[]) {
+	// index variables
+	int i, j;
+	// the matrices, and a row of single precision data as doubles
+	struct plot_matrix m;
+	double *row = NULL;
+	int status;
+	const int N = ctx->plan->N, M = ctx->plan->M;
+
+	if ((status = matrix_open(&m, ctx, name)) == 0 && ctx->precision == DATAFILE_FLOAT32
+		&& (row = malloc(4 * (size_t)M * sizeof(double))) == NULL) {
+		status = -1;
+	}
+	for (i = 0; i < 2*N && status == 0; i++) {
+		if (ctx->precision == DATAFILE_FLOAT32) {
+			for (j = 0; j < 2*M; j++) {
+				*(row + 2*j) = crealf(*((float complex *)array + (size_t)i*2*M + j));
+				*(row + 2*j + 1) = cimagf(*((float complex *)array + (size_t)i*2*M + j));
+			}
+			status = matrix_add_row(&m, ctx, row);
+		} else {
+			status = matrix_add_row(&m, ctx, (double *)((double complex *)array + (size_t)i*2*M));
+		}
+	}
+	free(row);
+	return (matrix_close(&m) == 0) ? status : -1;
+}
+
+/* As write_plotdata(), from a binary data file of interleaved points
+	 written for the context, read a row at a time so that the grid
+	 need not fit in memory.
+
+	 *ctx: context the plot is for
+	 name[]: string identifier for the data file and the plot
+
+	 Returns 0, or -1 if the data file could not be read, the
+	 matrices could not be written or memory could not be allocated.
+	 */
+int write_plotdata_file(dft_context *ctx, char name[]) {
+	// index variable
+	int i;
+	// the data file and its header, the matrices, and a row of data
+	FILE *fp;
+	datafile_header header;
+	struct plot_matrix m;
+	double *row = NULL;
+	int status;
+	// Buffer for file name
+	char filename[80] = { };
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
+
+	snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d_M%d.bin", name, mode, N, M);
+	if ((fp = datafile_open(filename, &header)) == NULL) {
+		return -1;
+	}
+	if (header.rows != 2*N || header.cols != 2*M || header.layout != LAYOUT_INTERLEAVED
+		|| header.precision == DATAFILE_TEXT) {
+		fclose(fp);
+		return -1;
+	}
+
+	if ((status = matrix_open(&m, ctx, name)) == 0
+		&& (row = malloc(4 * (size_t)M * sizeof(double))) == NULL) {
+		status = -1;
+	}
+	for (i = 0; i < 2*N && status == 0; i++) {
+		if (datafile_read_values(fp, header.precision, row, 4 * (size_t)M) != 4 * (size_t)M) {
+			status = -1;
+		} else {
+			status = matrix_add_row(&m, ctx, row);
+		}
+	}
+	free(row);
+	fclose(fp);
+	return (matrix_close(&m) == 0) ? status : -1;
+}
+
+/* Draw the heatmaps of a grid, from memory or from a data file,
+	 RENDER_BATCH rows at a time.
+
+	 *ctx: context the plot is for
+	 name[]: string identifier for the plot
+	 *array: the grid, of the context's precision, or NULL to read it
+	 *fp: if array is NULL, the data file at its first point
+	 precision: the precision of the data file
+
+	 Returns 0, or -1 if the images could not be written, the file
+	 could not be read or memory could not be allocated.
+	 */
+static int image_maps(dft_context *ctx, char name[], void *array, FILE *fp, int precision) {
+	// index variables, and the rows in the batch
+	int i, k, rows;
+	// the maps of the real part and the magnitude, and a batch of
+	// rows of each
+	render_map *real = NULL, *abs = NULL;
+	double *values = NULL, *magnitudes = NULL;
+	double complex point;
+	// Buffer for file name
+	char filename[80] = { };
+	int status = 0;
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
+	const size_t points = (size_t)RENDER_BATCH * 2*M;
+
+	if ((real = render_map_create(2*N, 2*M)) == NULL
+		|| (abs = render_map_create(2*N, 2*M)) == NULL
+		|| (values = malloc(2 * points * sizeof(double))) == NULL
+		|| (magnitudes = malloc(points * sizeof(double))) == NULL) {
+		status = -1;
+	}
+
+	for (i = 0; i < 2*N && status == 0; i += rows) {
+		rows = (2*N - i < RENDER_BATCH) ? 2*N - i : RENDER_BATCH;
+		// The real parts overwrite the points they come from
+		if (array == NULL) {
+			if (datafile_read_values(fp, precision, values, 2 * (size_t)rows*2*M) != 2 * (size_t)rows*2*M) {
+				status = -1;
+				break;
+			}
+			for (k = 0; k < rows*2*M; k++) {
+				*(magnitudes + k) = hypot(*(values + 2*k), *(values + 2*k + 1));
+				*(values + k) = *(values + 2*k);
+			}
+		} else {
+			for (k = 0; k < rows*2*M; k++) {
+				point = (ctx->precision == DATAFILE_FLOAT32) ? *((float complex *)array + (size_t)i*2*M + k)
+																										 : *((double complex *)array + (size_t)i*2*M + k);
+				*(values + k) = creal(point);
+				*(magnitudes + k) = cabs(point);
+			}
+		}
+		render_map_rows(real, values, rows);
+		render_map_rows(abs, magnitudes, rows);
+	}
+
+	if (status == 0) {
+		snprintf(filename, sizeof(filename), "plots/real_%s_m%d_N%d_M%d.%s",
+			name, mode, N, M, render_extension(ctx->render));
+		status = render_map_write(real, ctx->render_scale, ctx->render, filename);
+	}
+	if (status == 0) {
+		snprintf(filename, sizeof(filename), "plots/abs_%s_m%d_N%d_M%d.%s",
+			name, mode, N, M, render_extension(ctx->render));
+		status = render_map_write(abs, ctx->render_scale, ctx->render, filename);
+	}
+	render_map_destroy(real);
+	render_map_destroy(abs);
+	free(values);
+	free(magnitudes);
+	return status;
+}
+
+/* Draw a plot as images in place of the gnuplot script: heatmaps of
+	 the real part and the magnitude, u (or x) across and v (or y) up,
+	 in plots/real_<name>_m<mode>_N<N>_M<M> and abs_ likewise.
+
+	 *ctx: context the plot is for, which sets the mode, the image
+				 format and the scale
+	 *array: the data, of the context's precision
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the images could not be written or memory
+	 could not be allocated.
+	 */
+int plot_image(dft_context *ctx, void *array, char name[]) {
+	return image_maps(ctx, name, array, NULL, 0);
+}
+
+/* As plot_image(), from a binary data file of interleaved points
+	 written for the context, read a few rows at a time so that the
+	 grid need not fit in memory.
+
+	 *ctx: context the plot is for
+	 name[]: string identifier for the data file and the plot
+
+	 Returns 0, or -1 if the data file could not be read, the images
+	 could not be written or memory could not be allocated.
+	 */
+int plot_image_file(dft_context *ctx, char name[]) {
+	// the data file and its header
+	FILE *fp;
+	datafile_header header;
+	int status;
+	// Buffer for file name
+	char filename[80] = { };
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
+
+	snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d_M%d.bin", name, mode, N, M);
+	if ((fp = datafile_open(filename, &header)) == NULL) {
+		return -1;
+	}
+	if (header.rows != 2*N || header.cols != 2*M || header.layout != LAYOUT_INTERLEAVED
+		|| header.precision == DATAFILE_TEXT) {
+		fclose(fp);
+		return -1;
+	}
+	status = image_maps(ctx, name, NULL, fp, header.precision);
+	fclose(fp);
+	return status;
+}
+
 /* Write a gnuplot script to produce the required plot
 	 Plot depends on programme execution mode.
-	 Gnuplot can then be called externally
+	 Gnuplot can then be called externally.  The script reads the
+	 matrices write_plotdata() wrote.
 
+	 *ctx: context the plot is for, which sets the mode
 	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the script could not be written.
 	 */
-void plot (char name[]) {
+int plot(dft_context *ctx, char name[]) {
 
 	// File pointer
 	FILE *fp;
 	// Buffer for file name
-	char filename[35] = { };
+	char filename[80] = { };
+	// The matrices as gnuplot is to read them.  Their rows run
+	// along x and columns along y, hence "u 2:1:3".
+	char real_source[200] = { }, abs_source[200] = { };
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
 
-	// Set filename according to identifier, mode number and N
-	sprintf(filename, "plots/plot_%s_m%d_N%d.p", name, mode, N);
-	// Open file for writing if possible, otherwise exit with
-	// error message
+	// Set filename according to identifier, mode number, N and M
+	snprintf(filename, sizeof(filename), "plots/plot_%s_m%d_N%d_M%d.p", name, mode, N, M);
+	// Open file for writing if possible
 	if ((fp = fopen(filename, "w")) == NULL) {
-		printf("Unable to open file for plotting\n");
-		_exit(3);
+		return -1;
 	}
 
 	fprintf(fp,
@@ -49,68 +435,93 @@ void plot (char name[]) {
 		"set key off\n"
 		"set contour\n"
 		"set grid\n"
-		"set dgrid3d %d,%d\n"
-		"set pm3d corners2color mean\n", 2*N, 2*M
 	);
 
-	if (name == "freq") {
+	snprintf(real_source, sizeof(real_source),
+		"\"../data/matrix_%s_m%d_N%d_M%d_re.bin\" binary matrix u 2:1:3", name, mode, N, M);
+	snprintf(abs_source, sizeof(abs_source),
+		"\"../data/matrix_%s_m%d_N%d_M%d_abs.bin\" binary matrix u 2:1:3", name, mode, N, M);
+	fprintf(fp, "set pm3d corners2color mean\n");
+
+	if (strcmp(name, "freq") == 0) {
 		fprintf(fp, "set zlabel \"Re(F(u, v))\"\n");
 		fprintf(fp, "set output \"real_%s_m%d_N%d_M%d.jpg\"\n", name, mode, N, M);
-		fprintf(fp, "splot \"../data/data_%s_m%d_N%d_M%d.dat\" u 1:2:3 with pm3d\n", name, mode, N, M);
+		fprintf(fp, "splot %s with pm3d\n", real_source);
 		fprintf(fp, "set zlabel \"|F(u, v)|\"\n");
 		fprintf(fp, "set output \"abs_%s_m%d_N%d_M%d.jpg\"\n", name, mode, N, M);
-		fprintf(fp, "splot \"../data/data_%s_m%d_N%d_M%d.dat\" u 1:2:5 with pm3d\n", name, mode, N, M);
+		fprintf(fp, "splot %s with pm3d\n", abs_source);
 	} else {
 		fprintf(fp, "set zlabel \"Re(f(x,y))\"\n");
 		fprintf(fp, "set xlabel \"x\"\n");
 		fprintf(fp, "set ylabel \"y\"\n");
 		fprintf(fp, "set output \"real_%s_m%d_N%d_M%d.jpg\"\n", name, mode, N, M);
-		fprintf(fp, "splot \"../data/data_%s_m%d_N%d_M%d.dat\" u 1:2:3 with pm3d\n", name, mode, N, M);
+		fprintf(fp, "splot %s with pm3d\n", real_source);
 		fprintf(fp, "set zlabel \"|f(x, y)|\"\n");
 		fprintf(fp, "set output \"abs_%s_m%d_N%d_M%d.jpg\"\n", name, mode, N, M);
-		fprintf(fp, "splot \"../data/data_%s_m%d_N%d_M%d.dat\" u 1:2:5 with pm3d\n", name, mode, N, M);
+		fprintf(fp, "splot %s with pm3d\n", abs_source);
 	}
 
 	// Close file
-	fclose(fp);
+	return (fclose(fp) == 0) ? 0 : -1;
 }
 
-/* Writes data in array to a file for plotting purposes
-	 Space delimited file:
-	 0 index real_part imag_part magnitude
-
-	 The 0 column is to facilitate a vector plot, though this
-	 is not done from this programme
+/* Writes data in array to a file for plotting purposes.
+	 By default this is a binary file (datafile.c): a header, then
+	 the real and imaginary parts of each point.  With -text it is
+	 the old space delimited file:
+	 x y real_part imag_part magnitude
 
-	 *array: data to be written to the file
+	 *ctx: context the data is for, which sets the mode and format
+	 *array: data to be written to the file, of the context's
+	 				 precision
 	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
 	 */
-void write_datafile(double complex *array, char name[]) {
+int write_datafile(dft_context *ctx, void *array, char name[]) {
 	// File pointer
 	FILE *fp;
 	// index variables
 	int i, j;
+	// the point being written
+	double complex point;
 	// Buffer for file name
-	char filename[50] = { };
+	char filename[80] = { };
+	// header of a binary file
+	datafile_header header;
+	const int N = ctx->plan->N, M = ctx->plan->M, mode = ctx->mode;
+	const int output_precision = ctx->output_precision;
+
+	// A binary file is a single write, or a block by block
+	// conversion for single precision.  Rows run along x.
+	if (output_precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d_M%d.bin", name, mode, N, M);
+		datafile_header_init(&header, output_precision, mode, 2*N, 2*M);
+		header.row0 = -N;
+		header.col0 = -M;
+		if (ctx->precision == DATAFILE_FLOAT32) {
+			return datafile_write_single(filename, &header, array);
+		}
+		return datafile_write(filename, &header, array);
+	}
 
 	// Set filename according to identifier, execution mode, N and M
-	sprintf(filename, "data/data_%s_m%d_N%d_M%d.dat", name, mode, N, M);
-	// Open file for writing if possible, otherwise quit with
-	// error message.
+	snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d_M%d.dat", name, mode, N, M);
+	// Open file for writing if possible
 	if ((fp = fopen(filename, "w")) == NULL) {
-		printf("Unable to open file to write data\n");
-		_exit(4);
+		return -1;
 	}
 
 	// Loop through arrays and write data to file	
 	for (i = 0; i < 2*N; i++) {
 		for (j = 0; j < 2*M; j++) {
-			fprintf(fp, "%d %d %.9g %.9g %.9g\n", i-N, j-M,
-				creal(*(array+i*2*N+j)), cimag(*(array+i*2*N+j)), cabs(*(array+i*2*N+j)));
+			point = (ctx->precision == DATAFILE_FLOAT32) ? *((float complex *)array+i*2*M+j)
+																									 : *((double complex *)array+i*2*M+j);
+			fprintf(fp, "%d %d %.9g %.9g %.9g\n", i-N, j-M, creal(point), cimag(point), cabs(point));
 		}
 	}
 	// Close file
-	fclose(fp);
+	return (fclose(fp) == 0) ? 0 : -1;
 }
 
 /* Get user parameters and set global variables accordingly.
@@ -120,26 +531,47 @@ void write_datafile(double complex *array, char name[]) {
 	 *argvec[]: pointer to string array of the parameters
 	 */
 void set_params(int count, char *argvec[]) {
+	// index variable
+	int i;
+	// Grid half-sizes, from the command line
+	int N = DEFAULT_N, M = DEFAULT_M;
+	// Number of threads, 0 for one per processor
+	int threads = 0;
+	// How the transforms hold the data
+	int layout = LAYOUT_INTERLEAVED;
+	// Execution mode, the precision of the data files and that of
+	// the transform
+	int mode, output_precision = DATAFILE_FLOAT64, precision = DATAFILE_FLOAT64;
+	// Pages for the data arrays, and a point of a loaded f(x,y)
+	int pages = ARENA_THP;
+	size_t point;
+	// The -input file, for its header in OOC_MODE
+	FILE *fp;
+	// Whether to time the plan's choices, and the directory they
+	// are kept in, NULL for the default
+	int tune = 0;
+	char *plans_dir = NULL;
+	// Most points along each side of the plots
+	int plot_points = PLOT_POINTS;
+	// Image format of the plots, RENDER_NONE for gnuplot scripts,
+	// and their scale
+	int render = RENDER_NONE, render_scale = RENDER_LINEAR;
+
 	// If this are not NULL before an _exit() is called, the programme
 	// will attempt to free memory at a garbage pointer.
-	real_space = NULL;
-	freq_space = NULL;
+	dft_context_init(&context, NULL);
+	buffer_arena = NULL;
+	plan = NULL;
+	input_file = NULL;
+	ooc_memory = (size_t)DEFAULT_OOC_MEMORY << 20;
 
 	// Check the number of inputs is correct.
 	// If not, display help and exit cleanly.
-	if (count != 2) {
+	if (count < 2) {
 		help();
 		_exit(2);
 	}
 
-	// Allocate memory for data arrays if possible, otherwise quit
-	// error message
-	if ( (real_space = malloc( 2*N * 2*M * sizeof(double complex) )) == NULL
-		|| (freq_space = malloc( 2*N * 2*M * sizeof(double complex) )) == NULL ) {
-			printf("Unable to allocate memory for data storage");
-			_exit(1);
-		}
-
 	// Assign input parameters.  Display help and exit cleanly if error.
 	// Mode is the only parameter that can sensibly be zero, otherwise
 	// return value 0 indicates error.
@@ -147,6 +579,213 @@ void set_params(int count, char *argvec[]) {
 		help();
 		_exit(2);
 	}
+
+	// Any options follow the mode
+	for (i = 2; i < count; i++) {
+		if (strcmp(*(++argvec), "-N") == 0 && i+1 < count) {
+			i++;
+			if ((N = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-M") == 0 && i+1 < count) {
+			i++;
+			if ((M = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-split") == 0) {
+			layout = LAYOUT_SPLIT;
+		} else if (strcmp(*argvec, "-text") == 0) {
+			output_precision = DATAFILE_TEXT;
+		} else if (strcmp(*argvec, "-float") == 0) {
+			output_precision = DATAFILE_FLOAT32;
+		} else if (strcmp(*argvec, "-single") == 0) {
+			precision = DATAFILE_FLOAT32;
+		} else if (strcmp(*argvec, "-t") == 0 && i+1 < count) {
+			i++;
+			if ((threads = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-huge") == 0 && i+1 < count) {
+			i++;
+			if (strcmp(*(++argvec), "off") == 0) {
+				pages = ARENA_SMALL;
+			} else if (strcmp(*argvec, "thp") == 0) {
+				pages = ARENA_THP;
+			} else if (strcmp(*argvec, "tlb") == 0) {
+				pages = ARENA_HUGETLB;
+			} else {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-tune") == 0) {
+			tune = 1;
+		} else if (strcmp(*argvec, "-plans") == 0 && i+1 < count) {
+			i++;
+			plans_dir = *(++argvec);
+		} else if (strcmp(*argvec, "-render") == 0 && i+1 < count) {
+			i++;
+			if (strcmp(*(++argvec), "ppm") == 0) {
+				render = RENDER_PPM;
+			} else if (strcmp(*argvec, "png") == 0) {
+				render = RENDER_PNG;
+			} else {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-log") == 0) {
+			render_scale = RENDER_LOG;
+		} else if (strcmp(*argvec, "-plotmax") == 0 && i+1 < count) {
+			i++;
+			if ((plot_points = atoi(*(++argvec))) < 0
+				|| (plot_points == 0 && (*argvec)[0] != '0')) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-input") == 0 && i+1 < count) {
+			i++;
+			input_file = *(++argvec);
+		} else if (strcmp(*argvec, "-mem") == 0 && i+1 < count) {
+			i++;
+			if (atoi(*(++argvec)) < 1) {
+				help();
+				_exit(2);
+			}
+			ooc_memory = (size_t)atoi(*argvec) << 20;
+		} else {
+			help();
+			_exit(2);
+		}
+	}
+
+	// The convolutions work in double precision
+	if (mode == CONV_MODE && precision == DATAFILE_FLOAT32) {
+		help();
+		_exit(2);
+	}
+
+	context.mode = mode;
+	context.output_precision = output_precision;
+	context.precision = precision;
+	context.plot_points = plot_points;
+	context.render = render;
+	context.render_scale = render_scale;
+
+	// A loaded f(x,y) is transformed where the file is mapped, and
+	// its grid sets N and M
+	if (mode == LOAD_MODE) {
+		if (input_file == NULL) {
+			help();
+			_exit(2);
+		}
+		if ((context.real_space = datafile_map(input_file, &input_header)) == NULL
+			|| input_header.rows % 2 != 0 || input_header.cols % 2 != 0) {
+			printf("Unable to read input file\n");
+			_exit(5);
+		}
+		N = input_header.rows / 2;
+		M = input_header.cols / 2;
+	}
+
+	// Out of core, only the header is read here.  The grid is read
+	// a band at a time, so it must be a binary file of interleaved
+	// points, and the result is always written as a binary file.
+	if (mode == OOC_MODE) {
+		if (input_file == NULL || output_precision == DATAFILE_TEXT) {
+			help();
+			_exit(2);
+		}
+		if ((fp = datafile_open(input_file, &input_header)) == NULL
+			|| input_header.precision == DATAFILE_TEXT || input_header.layout != LAYOUT_INTERLEAVED
+			|| input_header.rows % 2 != 0 || input_header.cols % 2 != 0) {
+			if (fp != NULL) {
+				fclose(fp);
+			}
+			printf("Unable to read input file\n");
+			_exit(5);
+		}
+		fclose(fp);
+		N = input_header.rows / 2;
+		M = input_header.cols / 2;
+	}
+
+	// Any N and M can be planned up to a limit set by the padding of
+	// Bluestein's algorithm; past it, say so rather than failing to
+	// plan them
+	if (N > INT_MAX / 2 || M > INT_MAX / 2 || !fft_supported(2*N) || !fft_supported(2*M)) {
+		printf("N = %d, M = %d is too large to transform\n", N, M);
+		_exit(2);
+	}
+
+	// A grid in memory is indexed with ints, so it can have at most
+	// INT_MAX points; out of core it is taken a band at a time
+	if (mode != OOC_MODE && 4*(size_t)N*M > INT_MAX) {
+		printf("N = %d, M = %d is too large to transform in memory; use mode %d\n", N, M, OOC_MODE);
+		_exit(2);
+	}
+
+	// Start the threads the transforms are shared out among, which
+	// also fault in the data arrays, and which -tune times the
+	// transforms on
+	threads_init(threads);
+
+	// Order the stages of the FFTs as the plan cache says, or as the
+	// timings say with -tune: the transforms along x and y, and the
+	// half length ones inside the real and cosine transforms
+	if (tune_init(plans_dir, tune) != 0) {
+		printf("Unable to create the plan cache directory\n");
+		_exit(4);
+	}
+	if (tune_fft(2*N, layout) != 0 || tune_fft(2*M, layout) != 0
+		|| tune_fft(M, LAYOUT_INTERLEAVED) != 0
+		|| (N%2 == 0 && M%2 == 0
+				&& (tune_fft(N/2, LAYOUT_INTERLEAVED) != 0 || tune_fft(M/2, LAYOUT_INTERLEAVED) != 0))) {
+		printf("Unable to allocate memory for data storage");
+		_exit(1);
+	}
+
+	// Build the plan used by dft(), and the context on it
+	if ( (plan = dft_plan_create(N, M, layout)) == NULL ) {
+			printf("Unable to allocate memory for data storage");
+			_exit(1);
+		}
+	context.plan = plan;
+
+	// The out-of-core transform brings its own buffers
+	if (mode == OOC_MODE) {
+		return;
+	}
+
+	// Cut the data arrays from one arena if possible, otherwise quit
+	// error message.  A loaded f(x,y) is already mapped.
+	if ( (buffer_arena = arena_create(dft_context_alloc(&context, NULL), pages)) == NULL ) {
+			printf("Unable to allocate memory for data storage");
+			_exit(1);
+		}
+	dft_context_alloc(&context, buffer_arena);
+
+	// How sparse f(x,y) must be for the direct sum, likewise.
+	// dft_single() has no direct sum.
+	if (context.precision == DATAFILE_FLOAT64
+		&& tune_get("sparse2d", N, M, layout, &plan->sparse_limit, 1) != 1 && tune) {
+		if ((plan->sparse_limit = dft_measure_sparse(&context)) < 0
+			|| tune_put("sparse2d", N, M, layout, &plan->sparse_limit, 1) != 0) {
+			printf("Unable to allocate memory for data storage");
+			_exit(1);
+		}
+	}
+
+	// In single precision a loaded f(x,y) is rounded into the arena,
+	// and the mapping is done with
+	if (context.precision == DATAFILE_FLOAT32 && context.real_space != NULL) {
+		for (point = 0; point < 4*(size_t)N*M; point++) {
+			*(context.real_single + point) = *(context.real_space + point);
+		}
+		datafile_unmap(context.real_space, &input_header);
+		context.real_space = NULL;
+	}
 }
 
 /* Exit cleanly, freeing any dynamically allocated memory first.
@@ -155,8 +794,13 @@ void set_params(int count, char *argvec[]) {
 	 code: Exit status
 	 */
 void _exit(int code) {
-	free(real_space);
-	free(freq_space);
+	if (context.mode == LOAD_MODE) {
+		datafile_unmap(context.real_space, &input_header);
+	}
+	arena_destroy(buffer_arena);
+	dft_plan_destroy(plan);
+	threads_shutdown();
+	tune_finish();
 	printf("Exit status: %d\n", code);
 	exit(code);
 }
@@ -164,20 +808,67 @@ void _exit(int code) {
 /* Display parameter list and modes
 	 */
 void help(void) {
-	printf("3 input parameters are required as follows in the following order:\n\n"
-				 "int mode            The mode number\n\n\n");
+	printf("The mode number is required, optionally followed by options:\n\n"
+				 "int mode            The mode number\n\n"
+				 "-N int              x runs from -N to N-1 (default %d)\n"
+				 "-M int              y runs from -M to M-1 (default %d)\n"
+				 "                    Any sizes work; fastest when 2N and 2M\n"
+				 "                    factor into 2s, 3s and 5s\n\n"
+				 "-t int              Number of threads (default one per\n"
+				 "                    processor)\n\n"
+				 "-huge off|thp|tlb   Pages for the data arrays: small, or 2 MB\n"
+				 "                    transparent (default) or hugetlbfs ones\n\n"
+				 "-split              Do the FFTs with real and imaginary parts\n"
+				 "                    in separate arrays, using the widest SIMD\n"
+				 "                    the processor has\n\n"
+				 "-tune               Time the ways the transforms could be\n"
+				 "                    done at this N and M, and keep the\n"
+				 "                    fastest in the plan cache for later runs\n\n"
+				 "-plans dir          Plan cache directory (default %s).  If\n"
+				 "                    it exists, later runs use what is in it,\n"
+				 "                    with or without -tune\n\n"
+				 "-float              Write the data files in single precision\n\n"
+				 "-single             Transform in single precision (modes 0\n"
+				 "                    to 4), in half the memory, and report\n"
+				 "                    the error over a row and column of F\n\n"
+				 "-text               Write the data files as text, one point\n"
+				 "                    per line, rather than binary\n\n"
+				 "-plotmax int        Most points along each side of the\n"
+				 "                    plots (default %d), larger grids being\n"
+				 "                    shrunk to the extremes of blocks of\n"
+				 "                    points; 0 for every point\n\n"
+				 "-render ppm|png     Draw the plots as images in plots/, in\n"
+				 "                    place of the gnuplot scripts\n\n"
+				 "-log                Draw the images on a log scale of the\n"
+				 "                    magnitude, %d decades deep\n\n"
+				 "-input file         f(x,y) for mode 4: a data file, or a text\n"
+				 "                    file as -text writes, of 2N x 2M points;\n"
+				 "                    for mode 5 a binary data file\n\n"
+				 "-mem int            Megabytes of buffers for mode 5 (default\n"
+				 "                    %d)\n\n\n",
+				 DEFAULT_N, DEFAULT_M, TUNE_CACHE_DIR, PLOT_POINTS, RENDER_DECADES, DEFAULT_OOC_MEMORY);
 
 	printf("EXIT STATUSES:\n\n"
 				 "0 -                 Successfully executed\n"
 				 "1 -                 Unable to allocate memory for data arrays\n"
 				 "2 -                 Input error\n"
 				 "3 -                 Unable to open file for plotting\n"
-				 "4 -                 Unable to open file to write data\n\n\n");
+				 "4 -                 Unable to open file to write data\n"
+				 "5 -                 Unable to read input file\n\n\n");
 
 	printf("MODES:\n\n"
 				 "0 -                 Single cross source at 0, strength 1.0\n"
 				 "1 -                 Two square sources, arbitrary position, strength 1.0\n"
 				 "2 -                 Single slit, centre 0, width 3, length 20, strength 1.0\n"
 				 "3 -                 Double slit, centre 0, width 3, length 20,\n"
-				 "                    centre distance 10, centre distance 10\n\n");
+				 "                    centre distance 10, centre distance 10\n"
+				 "4 -                 f(x,y) from the -input file, which sets N\n"
+				 "                    and M\n"
+				 "5 -                 The same, out of core: for grids too big\n"
+				 "                    for memory, only -mem of buffers are used\n"
+				 "                    and only F(u,v) is written\n"
+				 "6 -                 The double slit of mode 3, also written\n"
+				 "                    blurred by a Gaussian point spread\n"
+				 "                    function of sigma %.1f (blur) and as its\n"
+				 "                    autocorrelation (corr)\n\n", PSF_SIGMA);
 }
@@ -0,0 +1,563 @@
+/*
+2D DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Out-of-core transform, for grids too big to hold in memory.
+
+The row-column method only ever needs one set of lines at a time,
+so the grid can stay on disk.  The row pass reads a band of rows of
+f(x,y), transforms them along y and writes them to a scratch file
+cut into tiles: each tile is written transposed, and the tiles are
+ordered by column band, so that a whole band of columns later comes
+back in one long sequential read.  That tiling is the blocked
+on-disk transpose.  The column pass reads each band of columns,
+transforms it along x and writes it into its place in the output
+data file.
+
+A thread of its own does the reads and writes, so that while one
+band is being transformed the next is being read and the last
+written.  With enough memory for a few bands the time is then set
+by the disk rather than by the transforms.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "header.h"
+
+// Jobs the I/O thread can have waiting
+#define IO_QUEUE 64
+
+/* A read or write for the I/O thread: count pieces of bytes each,
+	 buf_stride apart in memory and file_stride apart in the file. */
+struct io_job {
+	int fd;
+	int write;
+	char *buf;
+	size_t bytes;
+	size_t count;
+	size_t buf_stride;
+	off_t offset;
+	off_t file_stride;
+};
+
+/* The I/O thread and its queue of jobs */
+struct io_thread {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	// signalled when a job is queued, and when one is done
+	pthread_cond_t queued;
+	pthread_cond_t done;
+	struct io_job jobs[IO_QUEUE];
+	// jobs taken and queued so far, and finished
+	int head, tail, finished;
+	// set to stop the thread, and by it if a transfer failed
+	int stop;
+	int failed;
+};
+
+/* The bands the grid is cut into, and the buffers they pass
+	 through */
+struct ooc_args {
+	// the plan the bands are transformed to
+	dft_plan *plan;
+	// rows of f to a row band, and columns to a column band
+	int band_rows;
+	int band_cols;
+	// the band being transformed: first row or column, and how many
+	int first;
+	int count;
+	// the buffers bands are read into and their results written from,
+	// each two so that one can be transformed while the other moves
+	double complex *buffer[2];
+	double complex *result[2];
+	// the band as read, lines of it while they are transformed, and
+	// the result as it is written
+	double complex *in;
+	double complex *lines;
+	double complex *out;
+	// FFT scratch space for each thread, and each one's share
+	double complex *scratch;
+	size_t scratch_size;
+};
+
+/* Move all of one job's data.  pread() and pwrite() may do less
+	 than asked, so keep going until it is all done.
+
+	 Returns 0, or -1 if the file ended or could not be written.
+	 */
+static int transfer(struct io_job *job) {
+	// piece, and bytes moved of it
+	size_t k, done;
+	// bytes moved by one call
+	ssize_t moved;
+
+	for (k = 0; k < job->count; k++) {
+		for (done = 0; done < job->bytes; done += moved) {
+			if (job->write) {
+				moved = pwrite(job->fd, job->buf + k*job->buf_stride + done, job->bytes - done,
+											 job->offset + k*job->file_stride + done);
+			} else {
+				moved = pread(job->fd, job->buf + k*job->buf_stride + done, job->bytes - done,
+											job->offset + k*job->file_stride + done);
+			}
+			if (moved <= 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* The I/O thread: do the jobs in the order they were queued */
+static void *io_main(void *arg) {
+	struct io_thread *io = arg;
+	// the job being done
+	struct io_job job;
+	// whether it worked
+	int ok;
+
+	pthread_mutex_lock(&io->lock);
+	for (;;) {
+		while (io->head == io->tail && !io->stop) {
+			pthread_cond_wait(&io->queued, &io->lock);
+		}
+		if (io->head == io->tail) {
+			break;
+		}
+		job = io->jobs[io->head % IO_QUEUE];
+		io->head++;
+		pthread_mutex_unlock(&io->lock);
+
+		ok = (transfer(&job) == 0);
+
+		pthread_mutex_lock(&io->lock);
+		if (!ok) {
+			io->failed = 1;
+		}
+		io->finished++;
+		pthread_cond_broadcast(&io->done);
+	}
+	pthread_mutex_unlock(&io->lock);
+	return NULL;
+}
+
+/* Queue a job, waiting for room if the queue is full.
+
+	 Returns the number of jobs queued so far, this one included.
+	 */
+static int io_submit(struct io_thread *io, struct io_job *job) {
+	// jobs queued so far
+	int queued;
+
+	pthread_mutex_lock(&io->lock);
+	while (io->tail - io->finished >= IO_QUEUE) {
+		pthread_cond_wait(&io->done, &io->lock);
+	}
+	io->jobs[io->tail % IO_QUEUE] = *job;
+	queued = ++io->tail;
+	pthread_cond_signal(&io->queued);
+	pthread_mutex_unlock(&io->lock);
+	return queued;
+}
+
+/* Queue a transfer of count pieces, strided in the file and in
+	 memory, or of one contiguous piece with count 1.
+
+	 Returns the number of jobs queued so far, for io_wait_for().
+	 */
+static int io_queue(struct io_thread *io, int fd, int write, void *buf, size_t bytes,
+										size_t count, size_t buf_stride, off_t offset, off_t file_stride) {
+	struct io_job job = {fd, write, buf, bytes, count, buf_stride, offset, file_stride};
+	// jobs queued so far
+	int queued;
+
+	if (bytes > 0 && count > 0) {
+		return io_submit(io, &job);
+	}
+	pthread_mutex_lock(&io->lock);
+	queued = io->tail;
+	pthread_mutex_unlock(&io->lock);
+	return queued;
+}
+
+/* Wait for the first queued jobs.  The jobs are done in the order
+	 they were queued, so the rest may still be under way.
+
+	 queued: jobs to wait for, as io_queue() returned it
+
+	 Returns 0, or -1 if any job so far has failed.
+	 */
+static int io_wait_for(struct io_thread *io, int queued) {
+	// whether they all worked
+	int failed;
+
+	pthread_mutex_lock(&io->lock);
+	while (io->finished < queued) {
+		pthread_cond_wait(&io->done, &io->lock);
+	}
+	failed = io->failed;
+	pthread_mutex_unlock(&io->lock);
+	return failed ? -1 : 0;
+}
+
+/* Wait for every job queued so far.
+
+	 Returns 0, or -1 if any of them failed.
+	 */
+static int io_wait(struct io_thread *io) {
+	// whether they all worked
+	int failed;
+
+	pthread_mutex_lock(&io->lock);
+	while (io->finished < io->tail) {
+		pthread_cond_wait(&io->done, &io->lock);
+	}
+	failed = io->failed;
+	pthread_mutex_unlock(&io->lock);
+	return failed ? -1 : 0;
+}
+
+/* Start the I/O thread.
+
+	 Returns 0, or -1 if it could not be started.
+	 */
+static int io_start(struct io_thread *io) {
+	memset(io, 0, sizeof(*io));
+	pthread_mutex_init(&io->lock, NULL);
+	pthread_cond_init(&io->queued, NULL);
+	pthread_cond_init(&io->done, NULL);
+	return (pthread_create(&io->thread, NULL, io_main, io) == 0) ? 0 : -1;
+}
+
+/* Finish the jobs queued and stop the I/O thread */
+static void io_stop(struct io_thread *io) {
+	pthread_mutex_lock(&io->lock);
+	io->stop = 1;
+	pthread_cond_signal(&io->queued);
+	pthread_mutex_unlock(&io->lock);
+	pthread_join(io->thread, NULL);
+	pthread_mutex_destroy(&io->lock);
+	pthread_cond_destroy(&io->queued);
+	pthread_cond_destroy(&io->done);
+}
+
+/* Widen count floats at the start of buf to doubles, in place.
+	 Going from the end, no float is overwritten before it is read. */
+static void widen(void *buf, size_t count) {
+	// index variable
+	size_t i;
+	float *single = buf;
+	double *full = buf;
+
+	for (i = count; i > 0; i--) {
+		*(full + i - 1) = *(single + i - 1);
+	}
+}
+
+/* Narrow count doubles at the start of buf to floats, in place */
+static void narrow(void *buf, size_t count) {
+	// index variable
+	size_t i;
+	float *single = buf;
+	double *full = buf;
+
+	for (i = 0; i < count; i++) {
+		*(single + i) = (float)*(full + i);
+	}
+}
+
+/* Transform rows first to last-1 of the band along y, after the
+	 (-1)^(i+j) that moves the origin, and scatter them into the
+	 tiles: tile c holds columns c*band_cols onwards, transposed. */
+static void row_body(void *arg, int chunk, int first, int last) {
+	struct ooc_args *args = arg;
+	// index variables, and the first column and width of a tile
+	int r, j, start, width;
+	// the row, and this thread's FFT scratch space
+	double complex *row;
+	double complex *work = args->scratch + chunk * args->scratch_size;
+	const int M = args->plan->M;
+
+	for (r = first; r < last; r++) {
+		row = args->in + (size_t)r * 2*M;
+		for (j = (args->first + r + 1) % 2; j < 2*M; j += 2) {
+			*(row + j) = -*(row + j);
+		}
+		fft_execute_work(args->plan->y_fft, row, row, work);
+
+		for (start = 0; start < 2*M; start += args->band_cols) {
+			width = (2*M - start < args->band_cols) ? 2*M - start : args->band_cols;
+			for (j = 0; j < width; j++) {
+				*(args->out + (size_t)start * args->count + (size_t)j * args->count + r)
+					= *(row + start + j);
+			}
+		}
+	}
+}
+
+/* Gather columns first to last-1 of the band from the tiles they
+	 were read in, and transform them along x. */
+static void column_body(void *arg, int chunk, int first, int last) {
+	struct ooc_args *args = arg;
+	// index variables, and the first row and height of a tile
+	int c, start, height;
+	// the column, and this thread's FFT scratch space
+	double complex *column;
+	double complex *work = args->scratch + chunk * args->scratch_size;
+	const int N = args->plan->N;
+
+	for (c = first; c < last; c++) {
+		column = args->lines + (size_t)c * 2*N;
+		for (start = 0; start < 2*N; start += args->band_rows) {
+			height = (2*N - start < args->band_rows) ? 2*N - start : args->band_rows;
+			memcpy(column + start,
+						 args->in + (size_t)start * args->count + (size_t)c * height,
+						 height * sizeof(double complex));
+		}
+		fft_execute_work(args->plan->x_fft, column, column, work);
+	}
+}
+
+/* Transpose rows first to last-1 of F for the band out of the
+	 transformed columns, with the (-1)^(u+v+N+M) and normalisation
+	 of dft(). */
+static void output_body(void *arg, int chunk, int first, int last) {
+	struct ooc_args *args = arg;
+	// index variables
+	int u, c;
+	// the factor for the row, alternating in sign along it
+	double scale;
+	const int N = args->plan->N, M = args->plan->M;
+
+	for (u = first; u < last; u++) {
+		scale = ((u + args->first + N + M) % 2 == 0 ? 1.0 : -1.0) / (4.0 * N * M);
+		for (c = 0; c < args->count; c++) {
+			*(args->out + (size_t)u * args->count + c) = scale * *(args->lines + (size_t)c * 2*N + u);
+			scale = -scale;
+		}
+	}
+}
+
+/* Row pass: transform each band of rows of f along y and write it
+	 to the scratch file in tiles.  Band b is read into buffer[b%2]
+	 while band b-1 is transformed, and written from result[b%2]
+	 while band b+1 is.  Each wait is for just the job that must be
+	 done: the read of the band about to be transformed, and the
+	 writes from the result buffer about to be reused.
+
+	 Returns 0, or -1 if the input could not be read or the scratch
+	 file written.
+	 */
+static int row_pass(struct io_thread *io, struct ooc_args *args, int precision, int in, int tmp) {
+	// band number, first row of the next one, and rows or tiles in it
+	int b, next, count;
+	// jobs queued up to the read of the next band, and up to the
+	// writes from each result buffer
+	int read, written[2] = {0, 0};
+	// bytes in a point of the input
+	size_t in_point = 2 * precision;
+	const size_t rows = 2*(size_t)args->plan->N, cols = 2*(size_t)args->plan->M;
+
+	read = io_queue(io, in, 0, args->buffer[0], ((size_t)args->band_rows < rows ? (size_t)args->band_rows : rows) * cols * in_point,
+									1, 0, sizeof(datafile_header), 0);
+	for (b = 0, args->first = 0; args->first < (int)rows; b++, args->first = next) {
+		next = args->first + args->band_rows;
+		args->count = ((int)rows - args->first < args->band_rows) ? (int)rows - args->first : args->band_rows;
+		if (io_wait_for(io, read) != 0 || io_wait_for(io, written[b % 2]) != 0) {
+			return -1;
+		}
+		if (next < (int)rows) {
+			count = ((int)rows - next < args->band_rows) ? (int)rows - next : args->band_rows;
+			read = io_queue(io, in, 0, args->buffer[(b+1) % 2], count * cols * in_point, 1, 0,
+											sizeof(datafile_header) + (off_t)next * cols * in_point, 0);
+		}
+		if (precision == DATAFILE_FLOAT32) {
+			widen(args->buffer[b % 2], 2 * args->count * cols);
+		}
+
+		args->in = args->buffer[b % 2];
+		args->out = args->result[b % 2];
+		parallel_for(args->count, 1, row_body, args);
+
+		// Tile c of this band goes band_rows*band_cols points into
+		// column band c, which is band_cols x 2N points long.  All
+		// but the last are full width, so they go in one job.
+		count = cols / args->band_cols;
+		io_queue(io, tmp, 1, args->out, (size_t)args->band_cols * args->count * sizeof(double complex),
+						 count, (size_t)args->band_cols * args->count * sizeof(double complex),
+						 (off_t)args->first * args->band_cols * sizeof(double complex),
+						 (off_t)args->band_cols * rows * sizeof(double complex));
+		written[b % 2] = io_queue(io, tmp, 1, args->out + (size_t)count * args->band_cols * args->count,
+															(cols - (size_t)count * args->band_cols) * args->count * sizeof(double complex), 1, 0,
+															((off_t)count * args->band_cols * rows + (off_t)args->first * (cols - count * args->band_cols))
+															* sizeof(double complex), 0);
+	}
+	return io_wait(io);
+}
+
+/* Column pass: transform each band of columns along x and write it
+	 into F a row of it at a time.  Each column band is one read, and
+	 as in the row pass the writes from one result buffer go on while
+	 the next band is transformed into the other.
+
+	 Returns 0, or -1 if the scratch file could not be read or the
+	 output written.
+	 */
+static int column_pass(struct io_thread *io, struct ooc_args *args, int precision, int tmp, int out) {
+	// band number, first column of the next one, and columns in it
+	int b, next, count;
+	// jobs queued up to the read of the next band, and up to the
+	// writes from each result buffer
+	int read, written[2] = {0, 0};
+	// bytes in a point of the output
+	size_t out_point = 2 * precision;
+	const size_t rows = 2*(size_t)args->plan->N, cols = 2*(size_t)args->plan->M;
+
+	count = ((size_t)args->band_cols < cols) ? (size_t)args->band_cols : cols;
+	read = io_queue(io, tmp, 0, args->buffer[0], count * rows * sizeof(double complex), 1, 0, 0, 0);
+	for (b = 0, args->first = 0; args->first < (int)cols; b++, args->first = next) {
+		next = args->first + args->band_cols;
+		args->count = ((int)cols - args->first < args->band_cols) ? (int)cols - args->first : args->band_cols;
+		if (io_wait_for(io, read) != 0 || io_wait_for(io, written[b % 2]) != 0) {
+			return -1;
+		}
+		if (next < (int)cols) {
+			count = ((int)cols - next < args->band_cols) ? (int)cols - next : args->band_cols;
+			read = io_queue(io, tmp, 0, args->buffer[(b+1) % 2], count * rows * sizeof(double complex), 1, 0,
+											(off_t)next * rows * sizeof(double complex), 0);
+		}
+
+		args->in = args->buffer[b % 2];
+		args->out = args->result[b % 2];
+		parallel_for(args->count, 1, column_body, args);
+		parallel_for(rows, PARALLEL_GRAIN / args->count + 1, output_body, args);
+		if (precision == DATAFILE_FLOAT32) {
+			narrow(args->out, 2 * rows * args->count);
+		}
+		written[b % 2] = io_queue(io, out, 1, args->out, args->count * out_point, rows, args->count * out_point,
+															sizeof(datafile_header) + (off_t)args->first * out_point, cols * out_point);
+	}
+	return io_wait(io);
+}
+
+/* Find the FT of f(x,y) in an input data file without holding
+	 either in memory, and write it to the data file for the freq
+	 plot.  Only about memory bytes of buffers are used, however big
+	 the grid.
+
+	 *ctx: context whose plan, mode and format it works to.  It needs
+	 			 no data arrays.
+	 *header: header of the input file, which sets N and M
+	 *path: the input file
+	 memory: bytes of buffers to use
+
+	 Returns 0, or -1 if the input could not be read, the scratch or
+	 output file written, or memory allocated.
+	 */
+int dft_outofcore(dft_context *ctx, datafile_header *header, const char *path, size_t memory) {
+	// the input, scratch and output files
+	int in = -1, tmp = -1, out = -1;
+	// name of the output and scratch files
+	char filename[80] = { };
+	// header of the output
+	datafile_header out_header;
+	// the I/O thread
+	struct io_thread io;
+	// the bands, and the buffers they go through
+	struct ooc_args args = { };
+	// bytes in a band either way
+	size_t band;
+	// 0, or -1 once anything has failed
+	int status = 0;
+	dft_plan *plan = ctx->plan;
+	const int N = plan->N, M = plan->M, mode = ctx->mode;
+	const size_t rows = 2*(size_t)N, cols = 2*(size_t)M;
+
+	if (header->layout != LAYOUT_INTERLEAVED || (in = open(path, O_RDONLY)) < 0) {
+		status = -1;
+	}
+
+	/* The row pass holds two bands being read or transformed and two
+		 being written, all band_rows x 2M points; the column pass the
+		 same of band_cols x 2N, and the lines being transformed. */
+	args.plan = plan;
+	args.band_rows = memory / (4 * cols * sizeof(double complex));
+	args.band_cols = memory / (5 * rows * sizeof(double complex));
+	args.band_rows = (args.band_rows < 1) ? 1 : (args.band_rows > (int)rows) ? (int)rows : args.band_rows;
+	args.band_cols = (args.band_cols < 1) ? 1 : (args.band_cols > (int)cols) ? (int)cols : args.band_cols;
+	args.scratch_size = fft_work_size(plan->x_fft) > fft_work_size(plan->y_fft)
+											? fft_work_size(plan->x_fft) : fft_work_size(plan->y_fft);
+	band = (size_t)args.band_rows * cols > (size_t)args.band_cols * rows
+				 ? (size_t)args.band_rows * cols : (size_t)args.band_cols * rows;
+	if (status == 0
+		&& ( (args.buffer[0] = malloc(band * sizeof(double complex))) == NULL
+			|| (args.buffer[1] = malloc(band * sizeof(double complex))) == NULL
+			|| (args.result[0] = malloc(band * sizeof(double complex))) == NULL
+			|| (args.result[1] = malloc(band * sizeof(double complex))) == NULL
+			|| (args.lines = malloc((size_t)args.band_cols * rows * sizeof(double complex))) == NULL
+			|| (args.scratch = malloc(threads_count() * args.scratch_size * sizeof(double complex))) == NULL )) {
+		status = -1;
+	}
+
+	// The scratch file goes as soon as it is closed, however the
+	// programme ends
+	if (status == 0) {
+		snprintf(filename, sizeof(filename), "data/outofcore_m%d_N%d_M%d.tmp", mode, N, M);
+		if ((tmp = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+			status = -1;
+		} else {
+			unlink(filename);
+		}
+	}
+
+	// The output is an ordinary data file, so its header goes first
+	if (status == 0) {
+		snprintf(filename, sizeof(filename), "data/data_freq_m%d_N%d_M%d.bin", mode, N, M);
+		datafile_header_init(&out_header, ctx->output_precision, mode, rows, cols);
+		out_header.row0 = -N;
+		out_header.col0 = -M;
+		if ((out = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0
+			|| pwrite(out, &out_header, sizeof(out_header), 0) != sizeof(out_header)) {
+			status = -1;
+		}
+	}
+
+	// Jobs still queued when a pass fails are finished before the
+	// I/O thread stops, so the buffers are free to go after it
+	if (status == 0) {
+		if (io_start(&io) != 0) {
+			status = -1;
+		} else {
+			if (row_pass(&io, &args, header->precision, in, tmp) != 0
+				|| column_pass(&io, &args, ctx->output_precision, tmp, out) != 0) {
+				status = -1;
+			}
+			io_stop(&io);
+		}
+	}
+
+	if (out >= 0 && close(out) != 0) {
+		status = -1;
+	}
+	if (tmp >= 0) {
+		close(tmp);
+	}
+	if (in >= 0) {
+		close(in);
+	}
+	free(args.buffer[0]);
+	free(args.buffer[1]);
+	free(args.result[0]);
+	free(args.result[1]);
+	free(args.lines);
+	free(args.scratch);
+	return status;
+}
@@ -0,0 +1,184 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Working buffer arena.
+
+The data arrays used to be separate malloc()s, each aligned however
+the allocator pleased and each on 4 kB pages.  A big 2D grid then
+takes thousands of TLB entries to sweep, and the SIMD kernels have
+to cope with buffers that start part way into a cache line.  Instead
+all of them are cut, cache line aligned, from one anonymous mapping.
+That mapping can be backed by 2 MB pages, transparent ones by
+default or explicit hugetlbfs ones when asked for, and its pages are
+faulted in by all the threads at once rather than one at a time by
+whichever loop happens to write to them first.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "arena.h"
+#include "threads.h"
+
+// Small pages faulted in by a thread at a time
+#define ARENA_TOUCH_GRAIN 256
+
+/* The arguments of touch_body() */
+struct touch_args {
+	arena *a;
+	size_t step;
+};
+
+/* Fault in pages first to last-1 of the arena by writing to each */
+static void touch_body(void *arg, int chunk, int first, int last) {
+	struct touch_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(volatile char *)(args->a->base + (size_t)i * args->step) = 0;
+	}
+}
+
+/* Map length bytes of transparent huge pages, aligned to a huge
+	 page so that every one of them can be backed by one.
+
+	 Returns the mapping, or MAP_FAILED.
+	 */
+static char *map_thp(size_t length, int *pages) {
+	// the mapping with room to align it, and the aligned start
+	char *raw, *base;
+	// slack before and after the aligned part
+	size_t head, tail;
+
+	raw = mmap(NULL, length + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return MAP_FAILED;
+	}
+	base = (char *)(((uintptr_t)raw + ARENA_HUGE_PAGE - 1) & ~(uintptr_t)(ARENA_HUGE_PAGE - 1));
+	head = base - raw;
+	tail = ARENA_HUGE_PAGE - head;
+	if (head > 0) {
+		munmap(raw, head);
+	}
+	if (tail > 0) {
+		munmap(base + length, tail);
+	}
+
+	*pages = ARENA_SMALL;
+#ifdef MADV_HUGEPAGE
+	if (madvise(base, length, MADV_HUGEPAGE) == 0) {
+		*pages = ARENA_THP;
+	}
+#endif
+	return base;
+}
+
+/* Bytes a buffer takes up in an arena, rounded up to ARENA_ALIGN.
+	 Add these up to size an arena.
+
+	 bytes: size of the buffer
+	 */
+size_t arena_round(size_t bytes) {
+	return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/* Map an arena and fault its pages in, shared out among the
+	 threads so that each page lands near the thread that first
+	 touches it.  The threads must already have been started by
+	 threads_init().  Explicit huge pages that cannot be had fall back
+	 to transparent ones.
+
+	 size: bytes needed, the sum of arena_round() over the buffers
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+arena *arena_create(size_t size, int pages) {
+	// arena under construction
+	arena *a;
+	// size of the pages, and the mapping rounded up to them
+	size_t page = sysconf(_SC_PAGESIZE), length;
+	// arguments for faulting the pages in
+	struct touch_args args;
+
+	if ((a = calloc(1, sizeof(arena))) == NULL) {
+		return NULL;
+	}
+	a->base = MAP_FAILED;
+	if (size == 0) {
+		size = ARENA_ALIGN;
+	}
+
+	// Huge pages are only worth having for at least one of them
+	if (size < ARENA_HUGE_PAGE) {
+		pages = ARENA_SMALL;
+	}
+	length = (pages == ARENA_SMALL) ? (size + page - 1) / page * page
+					 : (size + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+
+#ifdef MAP_HUGETLB
+	if (pages == ARENA_HUGETLB) {
+		a->base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+									 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		a->pages = ARENA_HUGETLB;
+	}
+#endif
+	if (a->base == MAP_FAILED && pages != ARENA_SMALL) {
+		a->base = map_thp(length, &a->pages);
+	}
+	if (a->base == MAP_FAILED) {
+		a->base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		a->pages = ARENA_SMALL;
+	}
+	if (a->base == MAP_FAILED) {
+		free(a);
+		return NULL;
+	}
+	a->size = length;
+
+	// One write to each page, small or huge, faults it in
+	args.a = a;
+	args.step = (a->pages == ARENA_SMALL) ? page : ARENA_HUGE_PAGE;
+	parallel_for(length / args.step,
+							 (a->pages == ARENA_SMALL) ? ARENA_TOUCH_GRAIN : 1, touch_body, &args);
+	return a;
+}
+
+/* Hand out a buffer from an arena, aligned to ARENA_ALIGN and
+	 zeroed.
+
+	 *a: arena from arena_create()
+	 bytes: size of the buffer
+
+	 Returns NULL if the arena has too little left.
+	 */
+void *arena_alloc(arena *a, size_t bytes) {
+	// the buffer
+	void *buffer;
+
+	bytes = arena_round(bytes);
+	if (bytes > a->size - a->used) {
+		return NULL;
+	}
+	buffer = a->base + a->used;
+	a->used += bytes;
+	return buffer;
+}
+
+/* Unmap an arena and every buffer in it.  NULL is ignored.
+
+	 *a: arena to be freed
+	 */
+void arena_destroy(arena *a) {
+	if (a == NULL) {
+		return;
+	}
+	munmap(a->base, a->size);
+	free(a);
+}
@@ -0,0 +1,79 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the working buffer arena.
+Arena structure and function prototypes.
+
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Every buffer handed out starts on a cache line, so the widest
+// SIMD loads never split one
+#define ARENA_ALIGN 64
+// Size of a transparent or explicit huge page
+#define ARENA_HUGE_PAGE (2*1024*1024)
+
+// Pages the arena asks for
+#define ARENA_SMALL 0
+#define ARENA_THP 1
+#define ARENA_HUGETLB 2
+
+/* One mapping that all the working buffers are carved from.  It is
+	 sized up front from the plan, so nothing is allocated once the
+	 transforms start, and it is freed in one go.
+	 */
+typedef struct arena {
+	// The mapping, and its length
+	char *base;
+	size_t size;
+	// Bytes handed out so far
+	size_t used;
+	// ARENA_SMALL, ARENA_THP or ARENA_HUGETLB: the pages actually
+	// got, which may be smaller than those asked for
+	int pages;
+} arena;
+
+/* Bytes a buffer takes up in an arena, rounded up to ARENA_ALIGN.
+	 Add these up to size an arena.
+
+	 bytes: size of the buffer
+	 */
+size_t arena_round(size_t bytes);
+
+/* Map an arena and fault its pages in, shared out among the
+	 threads so that each page lands near the thread that first
+	 touches it.  The threads must already have been started by
+	 threads_init().  Explicit huge pages that cannot be had fall back
+	 to transparent ones.
+
+	 size: bytes needed, the sum of arena_round() over the buffers
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+arena *arena_create(size_t size, int pages);
+
+/* Hand out a buffer from an arena, aligned to ARENA_ALIGN and
+	 zeroed.
+
+	 *a: arena from arena_create()
+	 bytes: size of the buffer
+
+	 Returns NULL if the arena has too little left.
+	 */
+void *arena_alloc(arena *a, size_t bytes);
+
+/* Unmap an arena and every buffer in it.  NULL is ignored.
+
+	 *a: arena to be freed
+	 */
+void arena_destroy(arena *a);
+
+#endif
@@ -0,0 +1,485 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Benchmarks for the 1D programme.
+
+Times dft(), dft_band() on a narrow band, convolve() in double and
+single precision, the overlap-add conv_stream_*(), multiply(), the
+construct_*() generators and write_datafile() over a sweep of sizes,
+and dft() over inputs of
+different density: a slit, which takes the closed form sums,
+random points at several fill fractions, which go through the
+direct sum when there are only a few of them and the FFT otherwise,
+and dense real and real, even points, which take the real and the
+cosine transforms.
+Results are printed as comma separated values (timing.c), one line
+per kernel, input and size, with comment lines giving the error of
+the narrow band against the same bins of dft(), of the single
+precision convolution, and of the streamed one against
+fast_convolve().
+
+The programme's own sources are linked in with -DDFT_NO_MAIN, so the
+code timed is exactly the code that runs:
+
+gcc -O2 -DDFT_NO_MAIN -o bench bench.c fourier.c io.c fft.c realfft.c
+		twiddle.c convolve.c threads.c simd.c datafile.c stft.c arena.c tune.c timing.c render.c
+		-lm -lpthread
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "header.h"
+#include "timing.h"
+
+// Shortest time each measurement is taken over, in seconds
+#define BENCH_MIN_SECONDS 0.2
+// Most sizes or densities that can be given
+#define BENCH_MAX_LIST 32
+// Kernel length and block of the streamed convolution, and the
+// samples fed to it at a time, which need not match the block
+#define BENCH_STREAM_KERNEL 63
+#define BENCH_STREAM_BLOCK 1024
+#define BENCH_STREAM_CHUNK 1000
+// Frequencies in the band dft_band() finds about u = 0, few enough
+// for Goertzel's recurrence
+#define BENCH_BAND 16
+
+/* The arguments of the call being timed */
+struct bench_args {
+	double complex *input;
+	double complex *input2;
+	double complex *output;
+	dft_context *ctx;
+	// for write_call(): precision of the data file
+	int precision;
+	// for stream_call(): the stream, and the points to feed it
+	conv_stream *stream;
+	int count;
+};
+
+static void dft_call(void *arg) {
+	struct bench_args *args = arg;
+
+	dft(args->ctx, args->input, args->output);
+}
+
+static void band_call(void *arg) {
+	struct bench_args *args = arg;
+
+	if (dft_band(args->ctx, args->input, args->input2, -BENCH_BAND/2, 1.0, BENCH_BAND) != 0) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+}
+
+static void convolve_call(void *arg) {
+	struct bench_args *args = arg;
+
+	if (convolve(args->ctx, args->output, args->input, args->input) != 0) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+}
+
+/* convolve() in single precision, into input2 so that the double
+	 precision result in output is kept for comparison */
+static void convolve_single_call(void *arg) {
+	struct bench_args *args = arg;
+
+	args->ctx->precision = DATAFILE_FLOAT32;
+	if (convolve(args->ctx, args->input2, args->input, args->input) != 0) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+	args->ctx->precision = DATAFILE_FLOAT64;
+}
+
+/* Feed count points of input through the stream a chunk at a time,
+	 and flush it, leaving count + BENCH_STREAM_KERNEL - 1 points of
+	 the convolution in output */
+static void stream_call(void *arg) {
+	struct bench_args *args = arg;
+	// points fed and written so far, and points in this chunk
+	int fed, written = 0, take;
+
+	for (fed = 0; fed < args->count; fed += take) {
+		take = (args->count - fed < BENCH_STREAM_CHUNK) ? args->count - fed : BENCH_STREAM_CHUNK;
+		written += conv_stream_process(args->stream, args->input + fed, take, args->output + written);
+	}
+	conv_stream_flush(args->stream, args->output + written);
+}
+
+static void multiply_call(void *arg) {
+	struct bench_args *args = arg;
+
+	multiply(args->ctx, args->output, args->input, args->input2);
+}
+
+static void slit_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_slit(args->ctx, args->output, 20, 1.0, 0);
+}
+
+static void double_slit_call(void *arg) {
+	struct bench_args *args = arg;
+
+	construct_double_slit(args->ctx, args->output, 20, 1.0, 25);
+}
+
+static void write_call(void *arg) {
+	struct bench_args *args = arg;
+
+	args->ctx->output_precision = args->precision;
+	if (write_datafile(args->ctx, args->input, "bench") != 0) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+}
+
+/* Fill 2N points with random values at a random fraction of them
+	 and zero elsewhere.  The generator is seeded afresh each time,
+	 so every run sees the same input. */
+static void fill_random(double complex *output, double fraction) {
+	// index variable
+	int i;
+	// state of the generator
+	unsigned long long state = 88172645463325252ULL;
+	// uniform deviates in [0, 1)
+	double r[3];
+	int k;
+	const int N = plan->N;
+
+	for (i = 0; i < 2*N; i++) {
+		for (k = 0; k < 3; k++) {
+			// xorshift64
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			r[k] = (double)(state >> 11) / 9007199254740992.0;
+		}
+		*(output + i) = (r[0] < fraction) ? CMPLX(r[1] - 0.5, r[2] - 0.5) : 0.0;
+	}
+}
+
+/* Drop the imaginary parts of 2N points, and if even is set make
+	 them even too, f(-x) = f(x), so that dft() takes its real or its
+	 cosine transform path. */
+static void make_real(double complex *output, int even) {
+	// index variable
+	int x;
+	const int N = plan->N;
+
+	for (x = -N; x < N; x++) {
+		*(output + indexof(x)) = creal(*(output + indexof(x)));
+	}
+	if (even) {
+		for (x = 1; x < N; x++) {
+			*(output + indexof(-x)) = *(output + indexof(x));
+		}
+	}
+}
+
+/* Largest difference between count points and a reference,
+	 relative to the largest reference point */
+static double relative_error(double complex *reference, double complex *result, int count) {
+	// index variable
+	int i;
+	// the largest difference and the largest point
+	double worst = 0.0, largest = 0.0;
+
+	for (i = 0; i < count; i++) {
+		if (cabs(*(reference + i) - *(result + i)) > worst) {
+			worst = cabs(*(reference + i) - *(result + i));
+		}
+		if (cabs(*(reference + i)) > largest) {
+			largest = cabs(*(reference + i));
+		}
+	}
+	return (largest > 0.0) ? worst / largest : 0.0;
+}
+
+/* Read a comma separated list of numbers into values.
+
+	 arg[]: the list
+	 *values: where to store the numbers
+
+	 Returns how many there were, or 0 if arg is not such a list.
+	 */
+static int parse_list(char arg[], double *values) {
+	// number read so far
+	int n = 0;
+	// character after the number
+	char *end;
+
+	for (;;) {
+		if (n == BENCH_MAX_LIST) {
+			return 0;
+		}
+		*(values + n) = strtod(arg, &end);
+		if (end == arg || *(values + n) <= 0.0) {
+			return 0;
+		}
+		n++;
+		if (*end == '\0') {
+			return n;
+		}
+		if (*end != ',') {
+			return 0;
+		}
+		arg = end + 1;
+	}
+}
+
+/* Time and report the data file writes for one size.  Each file is
+	 removed again once its size is known. */
+static void bench_write(struct bench_args *args, int layout) {
+	// index variable
+	int i;
+	// the formats, their names and the extensions of their files
+	const int precisions[3] = {DATAFILE_FLOAT64, DATAFILE_FLOAT32, DATAFILE_TEXT};
+	const char *names[3] = {"write_datafile_f64", "write_datafile_f32", "write_datafile_text"};
+	const char *extensions[3] = {"bin", "bin", "dat"};
+	// name and size of the file written
+	char filename[80] = { };
+	struct stat info;
+	// time of one write
+	double seconds;
+	const int N = plan->N;
+
+	for (i = 0; i < 3; i++) {
+		args->precision = precisions[i];
+		seconds = time_call(write_call, args, BENCH_MIN_SECONDS);
+		snprintf(filename, sizeof(filename), "data/data_bench_m0_N%d.%s", N, extensions[i]);
+		if (stat(filename, &info) != 0) {
+			printf("Unable to open file to write data\n");
+			_exit(4);
+		}
+		report(names[i], "random1", N, 0, layout, seconds, 2.0*N, 0.0, (double)info.st_size);
+		remove(filename);
+	}
+}
+
+/* Time and report the streamed convolution of the 2N points of
+	 args->input with the first BENCH_STREAM_KERNEL of args->input2,
+	 and check it against fast_convolve(). */
+static void bench_stream(struct bench_args *args, int layout) {
+	// the streamed result and fast_convolve()'s, and where the other
+	// kernels write theirs
+	double complex *streamed, *reference, *output = args->output;
+	// time of one run, blocks in it and the padded length of each
+	double seconds, blocks, length;
+	const int N = plan->N, count = 2*N + BENCH_STREAM_KERNEL - 1;
+
+	if ((streamed = malloc(count * sizeof(double complex))) == NULL
+		|| (reference = malloc(count * sizeof(double complex))) == NULL
+		|| (args->stream = conv_stream_create(args->input2, BENCH_STREAM_KERNEL,
+																					BENCH_STREAM_BLOCK)) == NULL
+		|| fast_convolve(args->input, 2*N, args->input2, BENCH_STREAM_KERNEL,
+										 reference, 0, count, LAYOUT_INTERLEAVED) != 0) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+	args->count = 2*N;
+	args->output = streamed;
+
+	// Each block is two FFTs of the padded length and a product
+	seconds = time_call(stream_call, args, BENCH_MIN_SECONDS);
+	blocks = (2*N + BENCH_STREAM_BLOCK - 1) / BENCH_STREAM_BLOCK;
+	length = fft_good_size(BENCH_STREAM_BLOCK + BENCH_STREAM_KERNEL - 1);
+	report("conv_stream", "random1", N, 0, layout, seconds, count,
+				 blocks * (2.0*fft_flops(length) + 6.0*length), 2.0 * count * sizeof(double complex));
+	report_error("conv_stream", "random1", N, 0, relative_error(reference, streamed, count));
+
+	conv_stream_destroy(args->stream);
+	args->stream = NULL;
+	args->output = output;
+	free(reference);
+	free(streamed);
+}
+
+/* Time every kernel at one size.
+
+	 N: x runs from -N to N-1
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 *densities, ndensities: fill fractions of the random inputs
+	 */
+static void bench_size(int N, int layout, int pages, double *densities, int ndensities) {
+	// index variable
+	int i;
+	// the context the kernels run in, as in the programme, and the
+	// arrays of it they work on
+	dft_context *ctx;
+	double complex *a, *b, *c;
+	// arguments of the call being timed
+	struct bench_args args;
+	// description of the input, and time of one call
+	char input[32] = { };
+	double seconds;
+	// bytes in one array, and the length convolve() pads to
+	double bytes = 2.0*N * sizeof(double complex);
+	double length;
+
+	if ( (plan = dft_plan_create(N, layout)) == NULL
+		|| (ctx = dft_context_create(plan, 0, 0, pages)) == NULL ) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+	a = ctx->work.real_space;
+	b = ctx->work.convolved;
+	c = ctx->work.freq_space;
+	args.input = a;
+	args.input2 = b;
+	args.output = c;
+	args.ctx = ctx;
+
+	// The generators
+	report("construct_slit", "none", N, 0, layout,
+				 time_call(slit_call, &args, BENCH_MIN_SECONDS), 2.0*N, 0.0, bytes);
+	report("construct_double_slit", "none", N, 0, layout,
+				 time_call(double_slit_call, &args, BENCH_MIN_SECONDS), 2.0*N, 0.0, bytes);
+
+	// dft() on a slit, then on random input of each density
+	construct_slit(ctx, a, 20, 1.0, 0);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "slit", N, 0, layout, seconds, 2.0*N, fft_flops(2.0*N), 2.0*bytes);
+	for (i = 0; i < ndensities; i++) {
+		fill_random(a, *(densities + i));
+		snprintf(input, sizeof(input), "random%g", *(densities + i));
+		seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+		report("dft", input, N, 0, layout, seconds, 2.0*N, fft_flops(2.0*N), 2.0*bytes);
+	}
+	// Dense real input, then real and even.  The nominal operations
+	// are still those of the complex transform, so that the rates
+	// compare directly.
+	fill_random(a, 1.0);
+	make_real(a, 0);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "real1", N, 0, layout, seconds, 2.0*N, fft_flops(2.0*N), 2.0*bytes);
+	make_real(a, 1);
+	seconds = time_call(dft_call, &args, BENCH_MIN_SECONDS);
+	report("dft", "even1", N, 0, layout, seconds, 2.0*N, fft_flops(2.0*N), 2.0*bytes);
+
+	// A narrow band about u = 0, into b, against the same bins of
+	// dft().  Goertzel's recurrence costs about 8 flops a point for
+	// each frequency.
+	fill_random(a, 1.0);
+	dft(ctx, a, c);
+	seconds = time_call(band_call, &args, BENCH_MIN_SECONDS);
+	report("dft_band", "random1", N, 0, layout, seconds, BENCH_BAND,
+				 8.0 * 2.0*N * BENCH_BAND, bytes);
+	report_error("dft_band", "random1", N, 0, relative_error(c + N - BENCH_BAND/2, b, BENCH_BAND));
+
+	// The rest do the same work whatever the input, so dense random
+	// input will do.  convolve() does two FFTs of the padded length
+	// and a pointwise product.
+	fill_random(a, 1.0);
+	fill_random(b, 1.0);
+	length = fft_good_size(3*N);
+	seconds = time_call(convolve_call, &args, BENCH_MIN_SECONDS);
+	report("convolve", "random1", N, 0, layout, seconds, 2.0*N,
+				 2.0*fft_flops(length) + 6.0*length, 2.0*bytes);
+	// The same in single precision, and how far it strays from the
+	// double precision result
+	seconds = time_call(convolve_single_call, &args, BENCH_MIN_SECONDS);
+	report("convolve_single", "random1", N, 0, layout, seconds, 2.0*N,
+				 2.0*fft_flops(length) + 6.0*length, 2.0*bytes);
+	report_error("convolve_single", "random1", N, 0, relative_error(c, b, 2*N));
+	bench_stream(&args, layout);
+	seconds = time_call(multiply_call, &args, BENCH_MIN_SECONDS);
+	report("multiply", "random1", N, 0, layout, seconds, 2.0*N, 6.0*2.0*N, 3.0*bytes);
+
+	bench_write(&args, layout);
+
+	dft_context_destroy(ctx);
+	dft_plan_destroy(plan);
+	plan = NULL;
+}
+
+/* Display the options */
+static void bench_help(void) {
+	printf("Options:\n\n"
+				 "-N list             Sizes to sweep, comma separated\n"
+				 "                    (default 500,5000,50000,500000)\n"
+				 "-d list             Fill fractions of the random inputs\n"
+				 "                    (default 0.001,0.01,0.1,1)\n"
+				 "-t int              Number of threads (default one per\n"
+				 "                    processor)\n"
+				 "-split              Use the split layout\n"
+				 "-simd int           Highest instruction set to use: 0 scalar,\n"
+				 "                    1 SSE2, 2 AVX2, 3 AVX-512\n"
+				 "-huge off|thp|tlb   Pages for the arrays (default thp)\n\n"
+				 "Data files are written to, and removed from, data/ in the\n"
+				 "current directory.\n");
+}
+
+int main(int argc, char *argv[]) {
+	// index variable
+	int i;
+	// the sweep
+	double sizes[BENCH_MAX_LIST] = {500, 5000, 50000, 500000};
+	double densities[BENCH_MAX_LIST] = {0.001, 0.01, 0.1, 1};
+	int nsizes = 4, ndensities = 4;
+	// Number of threads, 0 for one per processor
+	int threads = 0;
+	// How the transforms hold the data, and the pages they are on
+	int layout = LAYOUT_INTERLEAVED;
+	int pages = ARENA_THP;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-N") == 0 && i+1 < argc) {
+			if ((nsizes = parse_list(argv[++i], sizes)) == 0) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-d") == 0 && i+1 < argc) {
+			if ((ndensities = parse_list(argv[++i], densities)) == 0) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+			if ((threads = atoi(argv[++i])) < 1) {
+				bench_help();
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-split") == 0) {
+			layout = LAYOUT_SPLIT;
+		} else if (strcmp(argv[i], "-simd") == 0 && i+1 < argc) {
+			simd_select(atoi(argv[++i]));
+		} else if (strcmp(argv[i], "-huge") == 0 && i+1 < argc) {
+			i++;
+			if (strcmp(argv[i], "off") == 0) {
+				pages = ARENA_SMALL;
+			} else if (strcmp(argv[i], "thp") == 0) {
+				pages = ARENA_THP;
+			} else if (strcmp(argv[i], "tlb") == 0) {
+				pages = ARENA_HUGETLB;
+			} else {
+				bench_help();
+				return 2;
+			}
+		} else {
+			bench_help();
+			return 2;
+		}
+	}
+
+	// write_datafile() needs somewhere to write
+	mkdir("data", 0755);
+	threads_init(threads);
+
+	report_header();
+	for (i = 0; i < nsizes; i++) {
+		bench_size((int)sizes[i], layout, pages, densities, ndensities);
+	}
+
+	threads_shutdown();
+	return 0;
+}
@@ -0,0 +1,425 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+FFT-based convolution.
+
+By the convolution theorem, convolving two functions is the same
+as multiplying their Fourier transforms.  Padding both with zeros
+first turns the circular convolution the FFT gives into the linear
+one we want, at a cost of O(N log N) rather than O(N^2).
+
+Overlap-add extends this to input of any length: it is cut into
+blocks, each block is convolved on its own, and the overlapping
+ends of the results are added together.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include "fft.h"
+#include "convolve.h"
+#include "threads.h"
+#include "simd.h"
+
+// Fewest points of a pointwise product worth a thread of their own
+#define PRODUCT_GRAIN 4096
+
+/* Arguments for product_body() and split_product_body() */
+struct product_args {
+	double complex *a;
+	double complex *b;
+	double divisor;
+	// split arrays: length real parts, then length imaginary parts
+	double *split_a;
+	double *split_b;
+	int length;
+};
+
+/* a = a times b over divisor, for indices first to last-1 */
+static void product_body(void *arg, int chunk, int first, int last) {
+	struct product_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->a + i) = cmul(*(args->a + i), *(args->b + i)) / args->divisor;
+	}
+}
+
+/* The same for split arrays */
+static void split_product_body(void *arg, int chunk, int first, int last) {
+	struct product_args *args = arg;
+
+	split_multiply(args->split_a, args->split_a + args->length,
+								 args->split_a, args->split_a + args->length,
+								 args->split_b, args->split_b + args->length,
+								 first, last, args->divisor);
+}
+
+/* fast_convolve() with the padded copies held as split real and
+	 imaginary arrays.  Returns 0 on success, -1 if memory could not
+	 be allocated. */
+static int convolve_split(double complex *a, int na, double complex *b, int nb,
+													double complex *output, int first, int count,
+													fft_plan *forward, fft_plan *inverse) {
+	int length = forward->n;
+	// padded copies of a and b
+	double *pad_a, *pad_b;
+	// arguments for the pointwise product
+	struct product_args product;
+
+	pad_a = calloc(2*(size_t)length, sizeof(double));
+	pad_b = (b == a && nb == na) ? pad_a : calloc(2*(size_t)length, sizeof(double));
+	if (pad_a == NULL || pad_b == NULL) {
+		if (pad_b != pad_a) {
+			free(pad_b);
+		}
+		free(pad_a);
+		return -1;
+	}
+
+	split_from_interleaved(a, pad_a, pad_a + length, 0, na, 1.0, 1.0);
+	fft_execute_split(forward, pad_a, pad_a + length);
+	if (pad_b != pad_a) {
+		split_from_interleaved(b, pad_b, pad_b + length, 0, nb, 1.0, 1.0);
+		fft_execute_split(forward, pad_b, pad_b + length);
+	}
+
+	product.split_a = pad_a;
+	product.split_b = pad_b;
+	product.length = length;
+	product.divisor = (double)length;
+	parallel_for(length, PRODUCT_GRAIN, split_product_body, &product);
+	fft_execute_split(inverse, pad_a, pad_a + length);
+
+	split_to_interleaved(pad_a + first, pad_a + length + first, output, 0, count, 1.0, 1.0);
+
+	if (pad_b != pad_a) {
+		free(pad_b);
+	}
+	free(pad_a);
+	return 0;
+}
+
+/* Linear convolution of a and b through the FFT.
+	 Only count points of the full result are kept, starting at
+	 index first, so this also covers truncated convolutions.
+	 The padded length is chosen so that none of the points kept
+	 are affected by the wrap-around of the circular convolution.
+
+	 *a, *b: pointers to the starts of the arrays to be convolved
+	 na, nb: their lengths
+	 *output: pointer to the start of the array where the count
+	 					points of the result are to be stored
+	 first: index into the full result of the first point kept
+	 count: number of points kept
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to transform and
+	 				 multiply the padded copies as split real and imaginary
+	 				 arrays with the SIMD kernels
+
+	 Returns 0 on success, -1 if memory could not be allocated.
+	 */
+int fast_convolve(double complex *a, int na, double complex *b, int nb,
+									double complex *output, int first, int count, int layout) {
+	// result of the split version
+	int status;
+	// padded length
+	int length;
+	// forward and inverse plans
+	fft_plan *forward, *inverse;
+	// arguments for the pointwise product
+	struct product_args product;
+	// padded copies of a and b
+	double complex *pad_a, *pad_b;
+
+	/* The full result runs from 0 to na+nb-2.  Circular convolution
+		 of length P adds point p+P onto point p, so the points kept
+		 are exact as long as P > na+nb-2 - first, and P > first+count-1
+		 so that they do not themselves wrap. */
+	length = na + nb - 1 - first;
+	if (length < first + count) {
+		length = first + count;
+	}
+	length = fft_good_size(length);
+
+	forward = fft_plan_create(length, -1);
+	inverse = fft_plan_create(length, 1);
+	if (layout == LAYOUT_SPLIT && forward != NULL && inverse != NULL) {
+		status = convolve_split(a, na, b, nb, output, first, count, forward, inverse);
+		fft_plan_destroy(forward);
+		fft_plan_destroy(inverse);
+		return status;
+	}
+	pad_a = calloc(length, sizeof(double complex));
+	// Convolving something with itself needs only one transform
+	pad_b = (b == a && nb == na) ? pad_a : calloc(length, sizeof(double complex));
+	if (forward == NULL || inverse == NULL || pad_a == NULL || pad_b == NULL) {
+		fft_plan_destroy(forward);
+		fft_plan_destroy(inverse);
+		if (pad_b != pad_a) {
+			free(pad_b);
+		}
+		free(pad_a);
+		return -1;
+	}
+
+	memcpy(pad_a, a, na * sizeof(double complex));
+	fft_execute(forward, pad_a, pad_a);
+	if (pad_b != pad_a) {
+		memcpy(pad_b, b, nb * sizeof(double complex));
+		fft_execute(forward, pad_b, pad_b);
+	}
+
+	product.a = pad_a;
+	product.b = pad_b;
+	product.divisor = (double)length;
+	parallel_for(length, PRODUCT_GRAIN, product_body, &product);
+	fft_execute(inverse, pad_a, pad_a);
+
+	memcpy(output, pad_a + first, count * sizeof(double complex));
+
+	fft_plan_destroy(forward);
+	fft_plan_destroy(inverse);
+	if (pad_b != pad_a) {
+		free(pad_b);
+	}
+	free(pad_a);
+	return 0;
+}
+
+/* fast_convolve() in single precision.  The inputs are rounded to
+	 float as they are padded, and the transforms and product are done
+	 in float, which halves the memory and traffic of the padded
+	 copies; the result is widened again as it is stored.  Expect a
+	 relative error of a few times 1e-7 of the largest point of the
+	 result, against about 1e-16 for fast_convolve().  The transforms
+	 run on the calling thread.
+
+	 *a, *b: pointers to the starts of the arrays to be convolved
+	 na, nb: their lengths
+	 *output: pointer to the start of the array where the count
+	 					points of the result are to be stored
+	 first: index into the full result of the first point kept
+	 count: number of points kept
+
+	 Returns 0 on success, -1 if memory could not be allocated.
+	 */
+int fast_convolve_single(double complex *a, int na, double complex *b, int nb,
+												 double complex *output, int first, int count) {
+	// index variable
+	int i;
+	// padded length, as in fast_convolve()
+	int length;
+	// forward and inverse plans
+	fft_plan *forward, *inverse;
+	// padded copies of a and b, and the FFTs' scratch space
+	float complex *pad_a, *pad_b, *work;
+	// the product is divided by the length on the way
+	float scale;
+
+	length = na + nb - 1 - first;
+	if (length < first + count) {
+		length = first + count;
+	}
+	length = fft_good_size(length);
+
+	forward = fft_plan_create(length, -1);
+	inverse = fft_plan_create(length, 1);
+	pad_a = calloc(length, sizeof(float complex));
+	pad_b = (b == a && nb == na) ? pad_a : calloc(length, sizeof(float complex));
+	work = (forward == NULL) ? NULL : malloc(fft_work_size(forward) * sizeof(float complex));
+	if (forward == NULL || inverse == NULL || pad_a == NULL || pad_b == NULL || work == NULL) {
+		fft_plan_destroy(forward);
+		fft_plan_destroy(inverse);
+		if (pad_b != pad_a) {
+			free(pad_b);
+		}
+		free(pad_a);
+		free(work);
+		return -1;
+	}
+
+	for (i = 0; i < na; i++) {
+		*(pad_a + i) = CMPLXF(creal(*(a + i)), cimag(*(a + i)));
+	}
+	fft_execute_single_work(forward, pad_a, pad_a, work);
+	if (pad_b != pad_a) {
+		for (i = 0; i < nb; i++) {
+			*(pad_b + i) = CMPLXF(creal(*(b + i)), cimag(*(b + i)));
+		}
+		fft_execute_single_work(forward, pad_b, pad_b, work);
+	}
+
+	scale = 1.0f / length;
+	for (i = 0; i < length; i++) {
+		*(pad_a + i) = scale * cmulf(*(pad_a + i), *(pad_b + i));
+	}
+	fft_execute_single_work(inverse, pad_a, pad_a, work);
+
+	for (i = 0; i < count; i++) {
+		*(output + i) = CMPLX(crealf(*(pad_a + first + i)), cimagf(*(pad_a + first + i)));
+	}
+
+	fft_plan_destroy(forward);
+	fft_plan_destroy(inverse);
+	if (pad_b != pad_a) {
+		free(pad_b);
+	}
+	free(pad_a);
+	free(work);
+	return 0;
+}
+
+/* Set up overlap-add convolution with a fixed kernel.
+
+	 *kernel: pointer to the start of the kernel
+	 klen: kernel length
+	 block: input samples to gather before each FFT.  A block a few
+	 			 times longer than the kernel keeps the cost per point low.
+
+	 Returns NULL if memory could not be allocated.
+	 */
+conv_stream *conv_stream_create(double complex *kernel, int klen, int block) {
+	// stream under construction
+	conv_stream *stream;
+	// index variable
+	int i;
+	// padded length
+	int length;
+
+	if (klen < 1 || block < 1 || (stream = calloc(1, sizeof(conv_stream))) == NULL) {
+		return NULL;
+	}
+	stream->klen = klen;
+	stream->block = block;
+
+	// Each block's result is block+klen-1 long and must not wrap
+	length = fft_good_size(block + klen - 1);
+
+	if ((stream->forward = fft_plan_create(length, -1)) == NULL
+		|| (stream->inverse = fft_plan_create(length, 1)) == NULL
+		|| (stream->kernel = calloc(length, sizeof(double complex))) == NULL
+		|| (stream->buffer = calloc(length, sizeof(double complex))) == NULL
+		|| (stream->tail = calloc(klen, sizeof(double complex))) == NULL) {
+		conv_stream_destroy(stream);
+		return NULL;
+	}
+
+	memcpy(stream->kernel, kernel, klen * sizeof(double complex));
+	fft_execute(stream->forward, stream->kernel, stream->kernel);
+	for (i = 0; i < length; i++) {
+		*(stream->kernel + i) /= (double)length;
+	}
+
+	return stream;
+}
+
+/* Convolve the gathered block with the kernel and add on the
+	 tail of the previous block.  The result is left in the buffer.
+	 */
+static void run_block(conv_stream *stream) {
+	// index variable
+	int i;
+	int length = stream->forward->n;
+	// arguments for the pointwise product
+	struct product_args product;
+
+	memset(stream->buffer + stream->filled, 0,
+				 (length - stream->filled) * sizeof(double complex));
+	fft_execute(stream->forward, stream->buffer, stream->buffer);
+	product.a = stream->buffer;
+	product.b = stream->kernel;
+	product.divisor = 1.0;
+	parallel_for(length, PRODUCT_GRAIN, product_body, &product);
+	fft_execute(stream->inverse, stream->buffer, stream->buffer);
+
+	for (i = 0; i < stream->klen - 1; i++) {
+		*(stream->buffer + i) += *(stream->tail + i);
+	}
+	stream->filled = 0;
+}
+
+/* Feed more input through the stream.  Results come out a whole
+	 block at a time, so this writes as many points as there are
+	 complete blocks: never more than count + block - 1.
+
+	 *stream: stream from conv_stream_create()
+	 *input: pointer to the start of the new input samples
+	 count: number of new input samples
+	 *output: pointer to where the results are to be written
+
+	 Returns the number of points written to output.
+	 */
+int conv_stream_process(conv_stream *stream, double complex *input, int count,
+												double complex *output) {
+	// points written so far, and points to copy into the block
+	int written = 0, take;
+
+	while (count > 0) {
+		take = stream->block - stream->filled;
+		if (take > count) {
+			take = count;
+		}
+		memcpy(stream->buffer + stream->filled, input, take * sizeof(double complex));
+		stream->filled += take;
+		input += take;
+		count -= take;
+
+		// A full block comes straight out, and what spills past
+		// its end is kept for the next one.
+		if (stream->filled == stream->block) {
+			run_block(stream);
+			memcpy(output + written, stream->buffer, stream->block * sizeof(double complex));
+			memcpy(stream->tail, stream->buffer + stream->block,
+						 (stream->klen - 1) * sizeof(double complex));
+			written += stream->block;
+		}
+	}
+
+	return written;
+}
+
+/* Finish the stream: convolve any partly gathered block and write
+	 out everything still pending, ending with the tail of the
+	 kernel.  Writes at most block + klen - 1 points.  The stream
+	 is left empty, ready for new input.
+
+	 *stream: stream from conv_stream_create()
+	 *output: pointer to where the results are to be written
+
+	 Returns the number of points written to output.
+	 */
+int conv_stream_flush(conv_stream *stream, double complex *output) {
+	// points written
+	int written = stream->filled + stream->klen - 1;
+
+	if (stream->filled > 0) {
+		// The pending points and the final tail come out together
+		run_block(stream);
+		memcpy(output, stream->buffer, written * sizeof(double complex));
+	} else {
+		memcpy(output, stream->tail, written * sizeof(double complex));
+	}
+	memset(stream->tail, 0, stream->klen * sizeof(double complex));
+
+	return written;
+}
+
+/* Free a stream and everything it holds.  NULL is ignored.
+
+	 *stream: stream to be freed
+	 */
+void conv_stream_destroy(conv_stream *stream) {
+	if (stream == NULL) {
+		return;
+	}
+	fft_plan_destroy(stream->forward);
+	fft_plan_destroy(stream->inverse);
+	free(stream->kernel);
+	free(stream->buffer);
+	free(stream->tail);
+	free(stream);
+}
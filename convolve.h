@@ -0,0 +1,127 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for FFT-based convolution.
+Stream structure and function prototypes.
+
+*/
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+#include <complex.h>
+#include "fft.h"
+
+/* State for convolving a stream of input of any length with a
+	 fixed kernel, by overlap-add.  Input is gathered into blocks;
+	 each full block is convolved with the kernel through the FFT
+	 and the part of the result that spills past the end of the
+	 block is carried over and added to the next one.  Memory use
+	 depends only on the block and kernel lengths.
+	 */
+typedef struct conv_stream {
+	// Kernel length, and input samples per block
+	int klen;
+	int block;
+	// Forward and inverse plans of the padded length
+	fft_plan *forward;
+	fft_plan *inverse;
+	// FT of the zero padded kernel, with the 1/length
+	// normalisation of the inverse transform folded in
+	double complex *kernel;
+	// Block being gathered, then transformed in place
+	double complex *buffer;
+	// klen-1 points carried over from the previous block
+	double complex *tail;
+	// Samples gathered so far in the current block
+	int filled;
+} conv_stream;
+
+/* Linear convolution of a and b through the FFT.
+	 Only count points of the full result are kept, starting at
+	 index first, so this also covers truncated convolutions.
+	 The padded length is chosen so that none of the points kept
+	 are affected by the wrap-around of the circular convolution.
+
+	 *a, *b: pointers to the starts of the arrays to be convolved
+	 na, nb: their lengths
+	 *output: pointer to the start of the array where the count
+	 					points of the result are to be stored
+	 first: index into the full result of the first point kept
+	 count: number of points kept
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to transform and
+	 				 multiply the padded copies as split real and imaginary
+	 				 arrays with the SIMD kernels
+
+	 Returns 0 on success, -1 if memory could not be allocated.
+	 */
+int fast_convolve(double complex *a, int na, double complex *b, int nb,
+									double complex *output, int first, int count, int layout);
+
+/* fast_convolve() in single precision.  The inputs are rounded to
+	 float as they are padded, and the transforms and product are done
+	 in float, which halves the memory and traffic of the padded
+	 copies; the result is widened again as it is stored.  Expect a
+	 relative error of a few times 1e-7 of the largest point of the
+	 result, against about 1e-16 for fast_convolve().  The transforms
+	 run on the calling thread.
+
+	 *a, *b: pointers to the starts of the arrays to be convolved
+	 na, nb: their lengths
+	 *output: pointer to the start of the array where the count
+	 					points of the result are to be stored
+	 first: index into the full result of the first point kept
+	 count: number of points kept
+
+	 Returns 0 on success, -1 if memory could not be allocated.
+	 */
+int fast_convolve_single(double complex *a, int na, double complex *b, int nb,
+												 double complex *output, int first, int count);
+
+/* Set up overlap-add convolution with a fixed kernel.
+
+	 *kernel: pointer to the start of the kernel
+	 klen: kernel length
+	 block: input samples to gather before each FFT.  A block a few
+	 			 times longer than the kernel keeps the cost per point low.
+
+	 Returns NULL if memory could not be allocated.
+	 */
+conv_stream *conv_stream_create(double complex *kernel, int klen, int block);
+
+/* Feed more input through the stream.  Results come out a whole
+	 block at a time, so this writes as many points as there are
+	 complete blocks: never more than count + block - 1.
+
+	 *stream: stream from conv_stream_create()
+	 *input: pointer to the start of the new input samples
+	 count: number of new input samples
+	 *output: pointer to where the results are to be written
+
+	 Returns the number of points written to output.
+	 */
+int conv_stream_process(conv_stream *stream, double complex *input, int count,
+												double complex *output);
+
+/* Finish the stream: convolve any partly gathered block and write
+	 out everything still pending, ending with the tail of the
+	 kernel.  Writes at most block + klen - 1 points.  The stream
+	 is left empty, ready for new input.
+
+	 *stream: stream from conv_stream_create()
+	 *output: pointer to where the results are to be written
+
+	 Returns the number of points written to output.
+	 */
+int conv_stream_flush(conv_stream *stream, double complex *output);
+
+/* Free a stream and everything it holds.  NULL is ignored.
+
+	 *stream: stream to be freed
+	 */
+void conv_stream_destroy(conv_stream *stream);
+
+#endif
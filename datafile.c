@@ -0,0 +1,644 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Binary data files.
+
+Writing a line of text per point with three %.9g conversions
+costs far more than the transform itself once the grid is of any
+size.  Instead a file is a short header giving the sizes, mode and
+layout, followed by the raw numbers.  Double precision is written
+straight from the array; single precision halves the file at the
+cost of a conversion.  Gnuplot reads these files directly with its
+binary keywords.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "datafile.h"
+#include "simd.h"
+
+// Points converted to or from single precision at a time
+#define DATAFILE_BLOCK 4096
+// Longest number in a text file
+#define DATAFILE_NUMBER 64
+
+// Fault a mapping in with one long read where the system can
+#ifdef MAP_POPULATE
+#define DATAFILE_MAP_FLAGS (MAP_PRIVATE | MAP_POPULATE)
+#else
+#define DATAFILE_MAP_FLAGS MAP_PRIVATE
+#endif
+
+/* Fill in a header for a file of rows x cols points, in the
+	 interleaved layout, with rows and columns at the integers from 0.
+
+	 *header: header to fill in
+	 precision: DATAFILE_FLOAT32 or DATAFILE_FLOAT64
+	 mode: execution mode
+	 rows, cols: size of the grid; rows is 1 for 1D data
+	 */
+void datafile_header_init(datafile_header *header, int precision, int mode, int rows, int cols) {
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, DATAFILE_MAGIC, sizeof(DATAFILE_MAGIC));
+	header->version = DATAFILE_VERSION;
+	header->precision = precision;
+	header->layout = LAYOUT_INTERLEAVED;
+	header->mode = mode;
+	header->dims = (rows > 1) ? 2 : 1;
+	header->rows = rows;
+	header->cols = cols;
+	header->row_step = 1.0;
+	header->col_step = 1.0;
+}
+
+/* Create a file and write its header, ready for the points to be
+	 appended a block at a time.  The header is written again by
+	 datafile_close(), so the number of rows need not be known yet.
+
+	 filename[]: file to create
+	 *header: header of the file
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *datafile_create(const char filename[], datafile_header *header) {
+	// File pointer
+	FILE *fp;
+
+	if ((fp = fopen(filename, "wb")) == NULL) {
+		return NULL;
+	}
+	if (fwrite(header, sizeof(*header), 1, fp) != 1) {
+		fclose(fp);
+		return NULL;
+	}
+	return fp;
+}
+
+/* Append points to a file from datafile_create(), in the precision
+	 its header gives.  Double precision goes straight from the array
+	 in one write; single precision is converted a block at a time on
+	 the way.
+
+	 *fp: file from datafile_create()
+	 *header: header of the file
+	 *array: the points, interleaved
+	 n: number of points
+
+	 Returns 0, or -1 if they could not be written.
+	 */
+int datafile_append(FILE *fp, datafile_header *header, double complex *array, size_t n) {
+	// index variables, and the end of a block
+	size_t i, k, end;
+	// A block in single precision, real and imaginary parts side by side
+	float block[2*DATAFILE_BLOCK];
+
+	if (header->precision == DATAFILE_FLOAT64) {
+		return (fwrite(array, sizeof(double complex), n, fp) == n) ? 0 : -1;
+	}
+	for (i = 0; i < n; i += DATAFILE_BLOCK) {
+		end = (n - i < DATAFILE_BLOCK) ? n - i : DATAFILE_BLOCK;
+		for (k = 0; k < end; k++) {
+			block[2*k] = (float)creal(*(array+i+k));
+			block[2*k+1] = (float)cimag(*(array+i+k));
+		}
+		if (fwrite(block, 2*sizeof(float), end, fp) != end) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* datafile_append() for points in single precision.  Single
+	 precision goes straight from the array in one write; double
+	 precision is widened a block at a time on the way.
+
+	 *fp: file from datafile_create()
+	 *header: header of the file
+	 *array: the points, interleaved
+	 n: number of points
+
+	 Returns 0, or -1 if they could not be written.
+	 */
+int datafile_append_single(FILE *fp, datafile_header *header, float complex *array, size_t n) {
+	// index variables, and the end of a block
+	size_t i, k, end;
+	// A block in double precision, real and imaginary parts side by side
+	double block[2*DATAFILE_BLOCK];
+
+	if (header->precision == DATAFILE_FLOAT32) {
+		return (fwrite(array, sizeof(float complex), n, fp) == n) ? 0 : -1;
+	}
+	for (i = 0; i < n; i += DATAFILE_BLOCK) {
+		end = (n - i < DATAFILE_BLOCK) ? n - i : DATAFILE_BLOCK;
+		for (k = 0; k < end; k++) {
+			block[2*k] = crealf(*(array+i+k));
+			block[2*k+1] = cimagf(*(array+i+k));
+		}
+		if (fwrite(block, 2*sizeof(double), end, fp) != end) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Write the header of a file from datafile_create() again, now
+	 that everything is known, and close the file.
+
+	 *fp: file from datafile_create()
+	 *header: final header of the file
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_close(FILE *fp, datafile_header *header) {
+	// Whether every write succeeded
+	int ok;
+
+	ok = (fseek(fp, 0, SEEK_SET) == 0 && fwrite(header, sizeof(*header), 1, fp) == 1);
+	// A failed close can lose buffered data too
+	if (fclose(fp) != 0) {
+		ok = 0;
+	}
+	return ok ? 0 : -1;
+}
+
+/* Write a header and the points of array to a file.  Double
+	 precision goes straight from the array in one write; single
+	 precision is converted a block at a time on the way.
+
+	 filename[]: file to create
+	 *header: header describing array
+	 *array: header->rows * header->cols points, interleaved
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_write(const char filename[], datafile_header *header, double complex *array) {
+	// File pointer
+	FILE *fp;
+	// Whether every write succeeded
+	int ok;
+
+	if ((fp = fopen(filename, "wb")) == NULL) {
+		return -1;
+	}
+
+	ok = (fwrite(header, sizeof(*header), 1, fp) == 1)
+		&& (datafile_append(fp, header, array, (size_t)header->rows * header->cols) == 0);
+
+	// A failed close can lose buffered data too
+	if (fclose(fp) != 0) {
+		ok = 0;
+	}
+	return ok ? 0 : -1;
+}
+
+/* datafile_write() for points in single precision, which go
+	 straight from the array to a single precision file.
+
+	 filename[]: file to create
+	 *header: header describing array
+	 *array: header->rows * header->cols points, interleaved
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_write_single(const char filename[], datafile_header *header, float complex *array) {
+	// File pointer
+	FILE *fp;
+	// Whether every write succeeded
+	int ok;
+
+	if ((fp = fopen(filename, "wb")) == NULL) {
+		return -1;
+	}
+
+	ok = (fwrite(header, sizeof(*header), 1, fp) == 1)
+		&& (datafile_append_single(fp, header, array, (size_t)header->rows * header->cols) == 0);
+
+	if (fclose(fp) != 0) {
+		ok = 0;
+	}
+	return ok ? 0 : -1;
+}
+
+/* Read count numbers of the given precision from a file into
+	 doubles, stride apart in the output.
+
+	 Returns 0, or -1 if the file ran out.
+	 */
+static int read_numbers(FILE *fp, int precision, double *out, size_t count, int stride) {
+	// index variables, and the end of a block
+	size_t i, k, end;
+	// A block in either precision
+	float single[DATAFILE_BLOCK];
+	double full[DATAFILE_BLOCK];
+
+	for (i = 0; i < count; i += DATAFILE_BLOCK) {
+		end = (count - i < DATAFILE_BLOCK) ? count - i : DATAFILE_BLOCK;
+		if (precision == DATAFILE_FLOAT64) {
+			if (fread(full, sizeof(double), end, fp) != end) {
+				return -1;
+			}
+			for (k = 0; k < end; k++) {
+				*(out + (i+k)*stride) = full[k];
+			}
+		} else {
+			if (fread(single, sizeof(float), end, fp) != end) {
+				return -1;
+			}
+			for (k = 0; k < end; k++) {
+				*(out + (i+k)*stride) = single[k];
+			}
+		}
+	}
+	return 0;
+}
+
+/* Read up to count numbers of the given precision from a file into
+	 consecutive doubles, stopping early at the end of the file.
+
+	 *fp: the file
+	 precision: DATAFILE_FLOAT32 or DATAFILE_FLOAT64
+	 *out: where to store the numbers
+	 count: most numbers to read
+
+	 Returns how many were read.
+	 */
+size_t datafile_read_values(FILE *fp, int precision, double *out, size_t count) {
+	// index variables, numbers in this block and numbers read of it
+	size_t i, k, end, got;
+	// A block in single precision
+	float single[DATAFILE_BLOCK];
+
+	if (precision == DATAFILE_FLOAT64) {
+		return fread(out, sizeof(double), count, fp);
+	}
+	for (i = 0; i < count; i += got) {
+		end = (count - i < DATAFILE_BLOCK) ? count - i : DATAFILE_BLOCK;
+		got = fread(single, sizeof(float), end, fp);
+		for (k = 0; k < got; k++) {
+			*(out + i + k) = single[k];
+		}
+		if (got < end) {
+			return i + got;
+		}
+	}
+	return count;
+}
+
+/* Whether a header read from a file is one this version understands */
+static int valid_header(datafile_header *header) {
+	return memcmp(header->magic, DATAFILE_MAGIC, sizeof(DATAFILE_MAGIC)) == 0
+		&& header->version == DATAFILE_VERSION
+		&& (header->precision == DATAFILE_FLOAT32 || header->precision == DATAFILE_FLOAT64)
+		&& (header->layout == LAYOUT_INTERLEAVED || header->layout == LAYOUT_SPLIT)
+		&& header->rows >= 1 && header->cols >= 1;
+}
+
+/* Open a data file and read its header, leaving the file at the
+	 first point.
+
+	 filename[]: file to open
+	 *header: filled in from the file
+
+	 Returns the file, or NULL if it could not be read or is not a
+	 data file this version understands.
+	 */
+FILE *datafile_open(const char filename[], datafile_header *header) {
+	// File pointer
+	FILE *fp;
+
+	if ((fp = fopen(filename, "rb")) == NULL) {
+		return NULL;
+	}
+
+	if (fread(header, sizeof(*header), 1, fp) != 1 || !valid_header(header)) {
+		fclose(fp);
+		return NULL;
+	}
+	return fp;
+}
+
+/* Read a file written by datafile_write(), in either precision
+	 or layout, back into an interleaved double complex array.
+
+	 filename[]: file to read
+	 *header: filled in from the file
+
+	 Returns the points, to be freed by the caller, or NULL if the
+	 file could not be read or is not a data file.
+	 */
+double complex *datafile_read(const char filename[], datafile_header *header) {
+	// File pointer
+	FILE *fp;
+	// The points read
+	double complex *array;
+	// Number of points
+	size_t n;
+	// Whether the file was read in full
+	int ok;
+
+	// Check this is a data file this version understands
+	if ((fp = datafile_open(filename, header)) == NULL) {
+		return NULL;
+	}
+
+	n = (size_t)header->rows * header->cols;
+	if ((array = malloc(n * sizeof(double complex))) == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+
+	// Interleaved double precision is the array exactly.  Anything
+	// else is converted on the way in: the real and imaginary parts
+	// of a double complex are its first and second doubles.
+	if (header->precision == DATAFILE_FLOAT64 && header->layout == LAYOUT_INTERLEAVED) {
+		ok = (fread(array, sizeof(double complex), n, fp) == n);
+	} else if (header->layout == LAYOUT_INTERLEAVED) {
+		ok = (datafile_read_values(fp, header->precision, (double *)array, 2*n) == 2*n);
+	} else {
+		ok = (read_numbers(fp, header->precision, (double *)array, n, 2) == 0)
+			&& (read_numbers(fp, header->precision, (double *)array + 1, n, 2) == 0);
+	}
+
+	fclose(fp);
+	if (!ok) {
+		free(array);
+		return NULL;
+	}
+	return array;
+}
+
+/* Bytes of the mapping that holds a header and the points */
+static size_t map_length(datafile_header *header) {
+	return sizeof(datafile_header) + (size_t)header->rows * header->cols * sizeof(double complex);
+}
+
+/* Anonymous memory for the points of a file that has to be
+	 converted, laid out as a mapped file would be, so that
+	 datafile_unmap() frees either the same way.
+
+	 Returns the first point, or NULL if there is no memory.
+	 */
+static double complex *map_points(datafile_header *header) {
+	// the mapping
+	char *base;
+
+	base = mmap(NULL, map_length(header), PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		return NULL;
+	}
+	memcpy(base, header, sizeof(*header));
+	return (double complex *)(base + sizeof(*header));
+}
+
+/* Convert the points of a binary file in another precision or the
+	 split layout, from its mapping into double complex points. */
+static void convert_points(datafile_header *header, const char *file, double complex *points) {
+	// index variable
+	size_t i;
+	// the numbers in each precision
+	const float *single = (const float *)(file + sizeof(*header));
+	const double *full = (const double *)(file + sizeof(*header));
+	double *out = (double *)points;
+	const size_t n = (size_t)header->rows * header->cols;
+
+	if (header->layout == LAYOUT_INTERLEAVED) {
+		// Then it must be single precision
+		for (i = 0; i < 2*n; i++) {
+			*(out + i) = *(single + i);
+		}
+	} else if (header->precision == DATAFILE_FLOAT32) {
+		for (i = 0; i < n; i++) {
+			*(out + 2*i) = *(single + i);
+			*(out + 2*i + 1) = *(single + n + i);
+		}
+	} else {
+		for (i = 0; i < n; i++) {
+			*(out + 2*i) = *(full + i);
+			*(out + 2*i + 1) = *(full + n + i);
+		}
+	}
+}
+
+/* Read the next number on the line from a text file, without
+	 reading beyond end, which need not be followed by a NUL.
+
+	 **p: where to start, moved past the number
+	 *end: end of the file
+	 *value: the number
+
+	 Returns 0, or -1 if there is no number before the end of the line.
+	 */
+static int text_number(const char **p, const char *end, double *value) {
+	// the number, NUL terminated for strtod(), and its length
+	char number[DATAFILE_NUMBER];
+	int length = 0;
+	// end of the number strtod() found
+	char *last;
+
+	while (*p < end && (**p == ' ' || **p == '\t' || **p == '\r')) {
+		(*p)++;
+	}
+	while (*p < end && length < DATAFILE_NUMBER - 1
+				 && **p != ' ' && **p != '\t' && **p != '\r' && **p != '\n') {
+		number[length++] = *((*p)++);
+	}
+	number[length] = '\0';
+	*value = strtod(number, &last);
+	return (length > 0 && *last == '\0') ? 0 : -1;
+}
+
+/* Read the first four numbers of a line of a text file and move to
+	 the start of the next line.
+
+	 **p: start of the line, moved to the start of the next
+	 *end: end of the file
+	 values[]: the numbers
+
+	 Returns the number of numbers read, 0 for a blank line, or -1
+	 if the line starts with something else.
+	 */
+static int text_line(const char **p, const char *end, double values[4]) {
+	// numbers read
+	int count = 0;
+	// start of the line
+	const char *line = *p;
+
+	while (count < 4 && text_number(p, end, values + count) == 0) {
+		count++;
+	}
+	// A line that is not blank must start with numbers
+	if (count < 4 && *p > line) {
+		while (line < *p && (*line == ' ' || *line == '\t' || *line == '\r')) {
+			line++;
+		}
+		if (line < *p) {
+			count = -1;
+		}
+	}
+	while (*p < end && **p != '\n') {
+		(*p)++;
+	}
+	if (*p < end) {
+		(*p)++;
+	}
+	return count;
+}
+
+/* Read the points of a text file as written with -text, from its
+	 mapping.  Columns 3 and 4 of each line are the real and imaginary
+	 parts; columns 1 and 2 give the coordinates, and a new row starts
+	 wherever column 1 changes.  1D files have 0 there, so they come
+	 out as a single row.
+
+	 *file: the mapped file
+	 size: its length
+	 *header: filled in for the points
+
+	 Returns the points, or NULL if the file is not of that form.
+	 */
+static double complex *text_points(const char *file, size_t size, datafile_header *header) {
+	// the line being read, and the end of the file
+	const char *p = file, *end = file + size;
+	// the numbers of a line, and the first column of the one before
+	double values[4], previous = 0.0;
+	// the coordinates of the first point
+	double first_row = 0.0, first_col = 0.0;
+	// points and rows found, and numbers read on a line
+	size_t n = 0, rows = 0;
+	int count;
+	// the points, as doubles
+	double *points;
+
+	// Count the points and rows first, to know the size
+	while (p < end) {
+		if ((count = text_line(&p, end, values)) == 0) {
+			continue;
+		}
+		if (count < 4) {
+			return NULL;
+		}
+		if (n == 0) {
+			first_row = values[0];
+			first_col = values[1];
+		}
+		if (n == 0 || values[0] != previous) {
+			rows++;
+		}
+		previous = values[0];
+		n++;
+	}
+	if (n == 0 || n % rows != 0 || n / rows > INT32_MAX || rows > INT32_MAX) {
+		return NULL;
+	}
+
+	datafile_header_init(header, DATAFILE_FLOAT64, 0, rows, n / rows);
+	header->row0 = first_row;
+	header->col0 = first_col;
+	if ((points = (double *)map_points(header)) == NULL) {
+		return NULL;
+	}
+	for (p = file, n = 0; p < end; ) {
+		if (text_line(&p, end, values) == 4) {
+			*(points + 2*n) = values[2];
+			*(points + 2*n + 1) = values[3];
+			n++;
+		}
+	}
+	return (double complex *)points;
+}
+
+/* Map a data file into memory, for input to be used where it is
+	 rather than read through a buffer.  A binary file in double
+	 precision and the interleaved layout is the array exactly, so
+	 its points are used straight from the page cache.  Other binary
+	 files are converted in one pass from their mapping, and so are
+	 text files in the form -text writes: lines whose third and
+	 fourth columns are the real and imaginary parts.
+
+	 The points are read only: writable private pages would each be
+	 copied as they were faulted in, which is the copy this avoids.
+
+	 filename[]: file to map
+	 *header: filled in from the file, or for a text file made up
+	 					from its rows and columns
+
+	 Returns the rows x cols points, to be freed by datafile_unmap(),
+	 or NULL if the file could not be read or is not of either form.
+	 */
+double complex *datafile_map(const char filename[], datafile_header *header) {
+	// the file, and its size
+	int fd;
+	struct stat st;
+	// the file mapped, and the points
+	char *file;
+	double complex *points = NULL;
+	// bytes of numbers a binary file must hold
+	size_t need;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	if ((size_t)st.st_size >= sizeof(*header)
+		&& pread(fd, header, sizeof(*header), 0) == sizeof(*header)
+		&& memcmp(header->magic, DATAFILE_MAGIC, sizeof(DATAFILE_MAGIC)) == 0) {
+		need = sizeof(*header) + (size_t)header->rows * header->cols * 2 * header->precision;
+		if (!valid_header(header) || (size_t)st.st_size < need) {
+			close(fd);
+			return NULL;
+		}
+
+		// Only as much as the header says, so that datafile_unmap()
+		// knows the length from the header
+		if (header->precision == DATAFILE_FLOAT64 && header->layout == LAYOUT_INTERLEAVED) {
+			file = mmap(NULL, need, PROT_READ, DATAFILE_MAP_FLAGS, fd, 0);
+			close(fd);
+			return (file == MAP_FAILED) ? NULL : (double complex *)(file + sizeof(*header));
+		}
+		file = mmap(NULL, need, PROT_READ, DATAFILE_MAP_FLAGS, fd, 0);
+		close(fd);
+		if (file == MAP_FAILED) {
+			return NULL;
+		}
+		if ((points = map_points(header)) != NULL) {
+			convert_points(header, file, points);
+		}
+		munmap(file, need);
+		return points;
+	}
+
+	file = mmap(NULL, st.st_size, PROT_READ, DATAFILE_MAP_FLAGS, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) {
+		return NULL;
+	}
+	points = text_points(file, st.st_size, header);
+	munmap(file, st.st_size);
+	return points;
+}
+
+/* Free points from datafile_map().  NULL is ignored.
+
+	 *points: the points
+	 *header: the header datafile_map() filled in for them
+	 */
+void datafile_unmap(double complex *points, datafile_header *header) {
+	if (points == NULL) {
+		return;
+	}
+	munmap((char *)points - sizeof(*header), map_length(header));
+}
@@ -0,0 +1,203 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the binary data files.
+File header structure and function prototypes.
+
+*/
+
+#ifndef DATAFILE_H
+#define DATAFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <complex.h>
+
+// First bytes of every data file, NUL included
+#define DATAFILE_MAGIC "DFTDATA"
+// Bumped whenever the header changes
+#define DATAFILE_VERSION 1
+
+// Precision of the numbers in a data file, in bytes.  Text is not a
+// binary format at all; it selects the old space delimited files.
+#define DATAFILE_TEXT 0
+#define DATAFILE_FLOAT32 4
+#define DATAFILE_FLOAT64 8
+
+/* The header at the start of a binary data file.  rows x cols
+	 complex points follow it, row by row, in native byte order.
+	 With LAYOUT_INTERLEAVED each point is its real part then its
+	 imaginary part, as in a double complex array; with LAYOUT_SPLIT
+	 all the real parts come first and then all the imaginary parts.
+
+	 Row r lies at row0 + r*row_step and column c at col0 + c*col_step.
+	 A 1D file has a single row.
+	 */
+typedef struct datafile_header {
+	char magic[8];
+	int32_t version;
+	// DATAFILE_FLOAT32 or DATAFILE_FLOAT64
+	int32_t precision;
+	// LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	int32_t layout;
+	// Execution mode of the programme that wrote the file
+	int32_t mode;
+	// 1 or 2
+	int32_t dims;
+	// Size of the grid
+	int32_t rows;
+	int32_t cols;
+	int32_t reserved;
+	// Coordinates of the first row and column, and their spacings
+	double row0;
+	double row_step;
+	double col0;
+	double col_step;
+} datafile_header;
+
+/* Fill in a header for a file of rows x cols points, in the
+	 interleaved layout, with rows and columns at the integers from 0.
+
+	 *header: header to fill in
+	 precision: DATAFILE_FLOAT32 or DATAFILE_FLOAT64
+	 mode: execution mode
+	 rows, cols: size of the grid; rows is 1 for 1D data
+	 */
+void datafile_header_init(datafile_header *header, int precision, int mode, int rows, int cols);
+
+/* Create a file and write its header, ready for the points to be
+	 appended a block at a time.  The header is written again by
+	 datafile_close(), so the number of rows need not be known yet.
+
+	 filename[]: file to create
+	 *header: header of the file
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *datafile_create(const char filename[], datafile_header *header);
+
+/* Append points to a file from datafile_create(), in the precision
+	 its header gives.  Double precision goes straight from the array
+	 in one write; single precision is converted a block at a time on
+	 the way.
+
+	 *fp: file from datafile_create()
+	 *header: header of the file
+	 *array: the points, interleaved
+	 n: number of points
+
+	 Returns 0, or -1 if they could not be written.
+	 */
+int datafile_append(FILE *fp, datafile_header *header, double complex *array, size_t n);
+
+/* datafile_append() for points in single precision.  Single
+	 precision goes straight from the array in one write; double
+	 precision is widened a block at a time on the way.
+
+	 *fp: file from datafile_create()
+	 *header: header of the file
+	 *array: the points, interleaved
+	 n: number of points
+
+	 Returns 0, or -1 if they could not be written.
+	 */
+int datafile_append_single(FILE *fp, datafile_header *header, float complex *array, size_t n);
+
+/* Write the header of a file from datafile_create() again, now
+	 that everything is known, and close the file.
+
+	 *fp: file from datafile_create()
+	 *header: final header of the file
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_close(FILE *fp, datafile_header *header);
+
+/* Write a header and the points of array to a file.  Double
+	 precision goes straight from the array in one write; single
+	 precision is converted a block at a time on the way.
+
+	 filename[]: file to create
+	 *header: header describing array
+	 *array: header->rows * header->cols points, interleaved
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_write(const char filename[], datafile_header *header, double complex *array);
+
+/* datafile_write() for points in single precision, which go
+	 straight from the array to a single precision file.
+
+	 filename[]: file to create
+	 *header: header describing array
+	 *array: header->rows * header->cols points, interleaved
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int datafile_write_single(const char filename[], datafile_header *header, float complex *array);
+
+/* Read up to count numbers of the given precision from a file into
+	 consecutive doubles, stopping early at the end of the file.
+
+	 *fp: the file
+	 precision: DATAFILE_FLOAT32 or DATAFILE_FLOAT64
+	 *out: where to store the numbers
+	 count: most numbers to read
+
+	 Returns how many were read.
+	 */
+size_t datafile_read_values(FILE *fp, int precision, double *out, size_t count);
+
+/* Open a data file and read its header, leaving the file at the
+	 first point.
+
+	 filename[]: file to open
+	 *header: filled in from the file
+
+	 Returns the file, or NULL if it could not be read or is not a
+	 data file this version understands.
+	 */
+FILE *datafile_open(const char filename[], datafile_header *header);
+
+/* Read a file written by datafile_write(), in either precision
+	 or layout, back into an interleaved double complex array.
+
+	 filename[]: file to read
+	 *header: filled in from the file
+
+	 Returns the points, to be freed by the caller, or NULL if the
+	 file could not be read or is not a data file.
+	 */
+double complex *datafile_read(const char filename[], datafile_header *header);
+
+/* Map a data file into memory, for input to be used where it is
+	 rather than read through a buffer.  A binary file in double
+	 precision and the interleaved layout is the array exactly, so
+	 its points are used straight from the page cache.  Other binary
+	 files are converted in one pass from their mapping, and so are
+	 text files in the form -text writes: lines whose third and
+	 fourth columns are the real and imaginary parts.
+
+	 The points are read only: writable private pages would each be
+	 copied as they were faulted in, which is the copy this avoids.
+
+	 filename[]: file to map
+	 *header: filled in from the file, or for a text file made up
+	 					from its rows and columns
+
+	 Returns the rows x cols points, to be freed by datafile_unmap(),
+	 or NULL if the file could not be read or is not of either form.
+	 */
+double complex *datafile_map(const char filename[], datafile_header *header);
+
+/* Free points from datafile_map().  NULL is ignored.
+
+	 *points: the points
+	 *header: the header datafile_map() filled in for them
+	 */
+void datafile_unmap(double complex *points, datafile_header *header);
+
+#endif
@@ -0,0 +1,821 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Fast Fourier transform engine.
+
+A mixed-radix Cooley-Tukey transform in the self-sorting
+(Stockham) form.  Each stage reads from one buffer and writes to
+another, so no bit-reversal pass is needed and the output comes
+out in natural order.  Radix 2, 3, 4 and 5 stages have dedicated
+butterflies, and radix 8 and 9 ones fully unrolled codelets; other
+small prime factors fall back to a direct sum over that factor.
+All twiddles come from the shared table of roots of unity in
+twiddle.c.
+
+Lengths with a large prime factor would make that direct sum
+quadratic, so they use Bluestein's algorithm: since
+jk = (j^2 + k^2 - (k-j)^2)/2, the transform is a convolution with
+the chirp exp(i pi j^2/n), and the convolution can be done by FFTs
+of any convenient length of at least 2n-1.
+
+The butterflies themselves are in fft_kernels.h, built here in
+double precision and again in single precision for
+fft_execute_single_work().  The codelets are written into
+fft_codelets.h by gen_codelets.c, and their radices are factored out
+first.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <complex.h>
+#include <math.h>
+#include <pthread.h>
+#include "fft.h"
+#include "twiddle.h"
+#include "threads.h"
+#include "simd.h"
+
+/* The butterflies in double precision, under their plain names */
+#define KERNEL(name) name
+#define REAL double
+#define CPLX double complex
+#define MAKE(x, y) CMPLX(x, y)
+#define RE(a) creal(a)
+#define IM(a) cimag(a)
+#define MUL(a, b) cmul(a, b)
+#include "fft_kernels.h"
+#undef KERNEL
+#undef REAL
+#undef CPLX
+#undef MAKE
+#undef RE
+#undef IM
+#undef MUL
+
+/* And in single precision, for fft_execute_single_work() */
+#define KERNEL(name) name##_single
+#define REAL float
+#define CPLX float complex
+#define MAKE(x, y) CMPLXF(x, y)
+#define RE(a) crealf(a)
+#define IM(a) cimagf(a)
+#define MUL(a, b) cmulf(a, b)
+#include "fft_kernels.h"
+#undef KERNEL
+#undef REAL
+#undef CPLX
+#undef MAKE
+#undef RE
+#undef IM
+#undef MUL
+
+// Radices with a codelet, in the order they are factored out
+static const int codelet_radices[] = {FFT_CODELET_RADICES};
+
+/* A factorisation given by fft_prefer_radices(), used in place of
+	 the usual one for plans of its length. */
+struct preferred {
+	int n;
+	int nstages;
+	int radix[FFT_MAX_STAGES];
+};
+
+// The preferred factorisations, first come first served
+static struct preferred preferred[FFT_MAX_PREFERRED];
+static int npreferred = 0;
+// Plans may be built from any thread
+static pthread_mutex_t preferred_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Round n points to single precision, into a new array.
+	 Returns NULL if memory could not be allocated. */
+static float complex *round_single(double complex *input, int n) {
+	// index variable
+	int i;
+	// the rounded points
+	float complex *output;
+
+	if ((output = malloc(n * sizeof(float complex))) == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < n; i++) {
+		*(output + i) = CMPLXF(creal(*(input + i)), cimag(*(input + i)));
+	}
+	return output;
+}
+
+/* Set up Bluestein's algorithm for a plan whose length has a
+	 large prime factor.  Returns 0 on success, -1 if memory could
+	 not be allocated.
+	 */
+static int bluestein_setup(fft_plan *plan) {
+	// index variable
+	int j;
+	int n = plan->n;
+	// padded length
+	int length = fft_good_size(2*n - 1);
+	// table of the 2n roots of unity, for the chirp
+	double complex *roots;
+
+	if ((plan->sub_forward = fft_plan_create(length, -1)) == NULL
+		|| (plan->sub_inverse = fft_plan_create(length, 1)) == NULL
+		|| (plan->chirp = malloc(n * sizeof(double complex))) == NULL
+		|| (plan->filter = calloc(length, sizeof(double complex))) == NULL
+		|| (plan->work = malloc(2*(size_t)length * sizeof(double complex))) == NULL
+		|| (roots = twiddle_acquire(2*n)) == NULL) {
+		return -1;
+	}
+
+	// exp(pi i j^2 / n) is entry j^2 mod 2n of the table
+	for (j = 0; j < n; j++) {
+		*(plan->chirp + j) = root(roots, ((long long)j * j) % (2*n), plan->sign);
+	}
+	twiddle_release(roots);
+
+	// The conjugate chirp is needed at offsets from -(n-1) to n-1;
+	// the negative ones wrap round to the end of the padded array.
+	for (j = 0; j < n; j++) {
+		*(plan->filter + j) = conj(*(plan->chirp + j)) / (double)length;
+		if (j > 0) {
+			*(plan->filter + length - j) = *(plan->filter + j);
+		}
+	}
+	fft_execute(plan->sub_forward, plan->filter, plan->filter);
+
+	if ((plan->chirp_single = round_single(plan->chirp, n)) == NULL
+		|| (plan->filter_single = round_single(plan->filter, length)) == NULL) {
+		return -1;
+	}
+	return 0;
+}
+
+static void execute(fft_plan *plan, double complex *input, double complex *output,
+										double complex *work, int parallel);
+
+/* Execute a Bluestein plan: multiply by the chirp, convolve with
+	 its conjugate, and multiply by the chirp again.  The input is
+	 read in full before the output is written, so in place is fine.
+	 The padded sequence is built in work, and the sub-transforms
+	 use the rest of it as their own scratch space.
+	 */
+static void bluestein(fft_plan *plan, double complex *input, double complex *output,
+											double complex *work, int parallel) {
+	// index variable
+	int j;
+	int n = plan->n, length = plan->sub_forward->n;
+
+	for (j = 0; j < n; j++) {
+		*(work + j) = cmul(*(input + j), *(plan->chirp + j));
+	}
+	memset(work + n, 0, (length - n) * sizeof(double complex));
+
+	execute(plan->sub_forward, work, work, work + length, parallel);
+	for (j = 0; j < length; j++) {
+		*(work + j) = cmul(*(work + j), *(plan->filter + j));
+	}
+	execute(plan->sub_inverse, work, work, work + length, parallel);
+
+	for (j = 0; j < n; j++) {
+		*(output + j) = cmul(*(work + j), *(plan->chirp + j));
+	}
+}
+
+/* Factorise a transform length into the radices of its stages, in
+	 the order the plan built by fft_plan_create() does them: the one
+	 given by fft_prefer_radices(), if any, otherwise the usual one.
+	 A length with a prime factor above FFT_MAX_RADIX ends in a single
+	 stage of that factor and any after it, for Bluestein's algorithm.
+
+	 n: transform length
+	 *radix: FFT_MAX_STAGES places for the radices
+
+	 Returns the number of stages.
+	 */
+int fft_factor(int n, int *radix) {
+	// number of stages so far, and length still to be factored
+	int nstages = 0, left = n;
+	// candidate factor, and index variable
+	int f, i;
+
+	pthread_mutex_lock(&preferred_lock);
+	for (i = 0; i < npreferred; i++) {
+		if ((preferred + i)->n == n) {
+			nstages = (preferred + i)->nstages;
+			memcpy(radix, (preferred + i)->radix, nstages * sizeof(int));
+			pthread_mutex_unlock(&preferred_lock);
+			return nstages;
+		}
+	}
+	pthread_mutex_unlock(&preferred_lock);
+
+	// Take the radices with a codelet first, since a codelet does the
+	// most work per pass for the least overhead, except where that
+	// would leave a lone radix 2 stage (8 x 2 is slower than 4 x 4).
+	// Then 4s, then the other small primes, then whatever is left.
+	for (i = 0; i < (int)(sizeof(codelet_radices) / sizeof(int)); i++) {
+		while (left % codelet_radices[i] == 0
+					 && !(codelet_radices[i] % 2 == 0 && (left / codelet_radices[i]) % 4 == 2)) {
+			*(radix + nstages++) = codelet_radices[i];
+			left /= codelet_radices[i];
+		}
+	}
+	while (left % 4 == 0) {
+		*(radix + nstages++) = 4;
+		left /= 4;
+	}
+	for (f = 2; f <= 5; f++) {
+		while (left % f == 0) {
+			*(radix + nstages++) = f;
+			left /= f;
+		}
+	}
+	for (f = 7; left > 1; f += 2) {
+		// Bluestein's algorithm does the whole length, so whatever is
+		// left from the first factor above FFT_MAX_RADIX on is one last
+		// stage, however many primes it holds
+		if (f > FFT_MAX_RADIX) {
+			*(radix + nstages++) = left;
+			break;
+		}
+		// No factor below sqrt(left) means left is itself prime
+		if (f > left / f) {
+			f = left;
+		}
+		while (left % f == 0) {
+			*(radix + nstages++) = f;
+			left /= f;
+		}
+	}
+	return nstages;
+}
+
+/* Whether a plan of length n can be built at all, memory allowing.
+	 Lengths with a prime factor above FFT_MAX_RADIX need a Bluestein
+	 transform of over twice their length, which must itself fit in
+	 an int.
+
+	 n: transform length
+
+	 Returns 1 if it can, 0 if not.
+	 */
+int fft_supported(int n) {
+	// the radices of the stages
+	int radix[FFT_MAX_STAGES];
+	int nstages;
+
+	if (n < 1) {
+		return 0;
+	}
+	// fft_good_size() is never as much as twice what it is asked for
+	nstages = fft_factor(n, radix);
+	return nstages == 0 || *(radix + nstages - 1) <= FFT_MAX_RADIX || n <= INT_MAX / 4;
+}
+
+/* Have every plan of length n built from now on do its stages in
+	 this order, eg. one found faster by timing.  Plans already built
+	 are unchanged.  A second call for the same length replaces the
+	 first.
+
+	 n: transform length
+	 *radix: the radices of the stages, as for fft_plan_create_radices()
+	 nstages: number of stages
+
+	 Returns 0, or -1 if the radices do not fit n or FFT_MAX_PREFERRED
+	 lengths already have an order.
+	 */
+int fft_prefer_radices(int n, const int *radix, int nstages) {
+	// plan to check the radices with
+	fft_plan *check;
+	// index variable
+	int i;
+
+	// Building the plan is the simplest way to vet the radices, and
+	// leaves the twiddles ready for the plans to come
+	if ((check = fft_plan_create_radices(n, 1, radix, nstages)) == NULL) {
+		return -1;
+	}
+	fft_plan_destroy(check);
+
+	pthread_mutex_lock(&preferred_lock);
+	i = 0;
+	while (i < npreferred && (preferred + i)->n != n) {
+		i++;
+	}
+	if (i == FFT_MAX_PREFERRED) {
+		pthread_mutex_unlock(&preferred_lock);
+		return -1;
+	}
+	if (i == npreferred) {
+		npreferred++;
+	}
+	(preferred + i)->n = n;
+	(preferred + i)->nstages = nstages;
+	memcpy((preferred + i)->radix, radix, nstages * sizeof(int));
+	pthread_mutex_unlock(&preferred_lock);
+	return 0;
+}
+
+/* Build a plan for transforms of length n.
+	 The transform computed is the unnormalised
+	 out[k] = sum_j in[j] exp(sign * 2 pi i j k / n)
+
+	 n: transform length, any positive integer.  Fastest when
+	 	 it factors into 2, 3, 4 and 5.  Lengths with a large prime
+	 	 factor cost a few times more, but are still O(n log n).
+	 sign: sign of the exponent, +1 or -1
+
+	 Returns NULL if n is not supported (see fft_supported()) or
+	 memory could not be allocated.
+	 */
+fft_plan *fft_plan_create(int n, int sign) {
+	// radices of the stages
+	int radix[FFT_MAX_STAGES];
+
+	if (!fft_supported(n)) {
+		return NULL;
+	}
+	return fft_plan_create_radices(n, sign, radix, fft_factor(n, radix));
+}
+
+/* Build a plan for transforms of length n, doing the stages in an
+	 order other than fft_plan_create() would, eg. one found faster by
+	 timing.  A last stage above FFT_MAX_RADIX makes it a Bluestein
+	 plan, as fft_factor() gives for such lengths.
+
+	 n: transform length
+	 sign: sign of the exponent, +1 or -1
+	 *radix: the radices of the stages, whose product must be n
+	 nstages: number of stages
+
+	 Returns NULL if the radices do not fit n, or if memory could not
+	 be allocated.
+	 */
+fft_plan *fft_plan_create_radices(int n, int sign, const int *radix, int nstages) {
+	// plan under construction
+	fft_plan *plan;
+	// index variable, and the product of the radices
+	int i;
+	long long product = 1;
+
+	if (n < 1 || nstages < 0 || nstages > FFT_MAX_STAGES) {
+		return NULL;
+	}
+	for (i = 0; i < nstages; i++) {
+		if (*(radix + i) < 2 || (*(radix + i) > FFT_MAX_RADIX && i < nstages - 1)) {
+			return NULL;
+		}
+		if ((product *= *(radix + i)) > n) {
+			return NULL;
+		}
+	}
+	if (product != n || (plan = calloc(1, sizeof(fft_plan))) == NULL) {
+		return NULL;
+	}
+	plan->n = n;
+	plan->sign = (sign < 0) ? -1 : 1;
+	plan->nstages = nstages;
+	memcpy(plan->radix, radix, nstages * sizeof(int));
+
+	if ((plan->table = twiddle_acquire(n)) == NULL
+		|| (plan->table_single = round_single(plan->table, n)) == NULL) {
+		fft_plan_destroy(plan);
+		return NULL;
+	}
+
+	if (plan->nstages > 0 && plan->radix[plan->nstages - 1] > FFT_MAX_RADIX) {
+		if (bluestein_setup(plan) != 0) {
+			fft_plan_destroy(plan);
+			return NULL;
+		}
+		return plan;
+	}
+
+	if ((plan->work = malloc(n * sizeof(double complex))) == NULL) {
+		fft_plan_destroy(plan);
+		return NULL;
+	}
+
+	return plan;
+}
+
+/* One stage of a transform: radix p, m butterflies of stride s,
+	 reading src and writing dst, or for split data the arrays in
+	 split. */
+struct fft_stage {
+	fft_plan *plan;
+	int p, m, s;
+	double complex *src, *dst;
+	int layout;
+	split_stage split;
+};
+
+/* Do the butterflies of a stage with j from j0 to j1-1 and q from
+	 q0 to q1-1. */
+static void run_stage(struct fft_stage *st, int j0, int j1, int q0, int q1) {
+	fft_plan *plan = st->plan;
+
+	if (st->layout == LAYOUT_SPLIT) {
+		split_butterflies(&st->split, j0, j1, q0, q1);
+		return;
+	}
+
+	switch (st->p) {
+		case 2:
+			radix2(st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s, j0, j1, q0, q1);
+			break;
+		case 3:
+			radix3(st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s, j0, j1, q0, q1);
+			break;
+		case 4:
+			radix4(st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s, j0, j1, q0, q1);
+			break;
+		case 5:
+			radix5(st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s, j0, j1, q0, q1);
+			break;
+		default:
+			if (codelet(st->p, st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s,
+									j0, j1, q0, q1) != 0) {
+				radixg(st->p, st->m, st->s, plan->sign, st->src, st->dst, plan->table, st->s,
+							 j0, j1, q0, q1);
+			}
+			break;
+	}
+}
+
+/* parallel_for() body for one stage.  Early stages have many
+	 butterflies j and a short stride, late ones the reverse, so
+	 split whichever loop is longer. */
+static void stage_body(void *arg, int chunk, int first, int last) {
+	struct fft_stage *st = arg;
+
+	if (st->m >= st->s) {
+		run_stage(st, first, last, 0, st->s);
+	} else {
+		run_stage(st, 0, st->m, first, last);
+	}
+}
+
+/* Execute a plan using the given scratch space.  With parallel set
+	 each stage is shared out among the threads. */
+static void execute(fft_plan *plan, double complex *input, double complex *output,
+										double complex *work, int parallel) {
+	// index variable
+	int stage;
+	// length of current sub-transform
+	int len = plan->n;
+	// the stage being done
+	struct fft_stage st;
+	// loop shared out, and the fewest iterations worth a thread
+	int count, grain;
+
+	if (plan->chirp != NULL) {
+		bluestein(plan, input, output, work, parallel);
+		return;
+	}
+
+	// A length 1 transform is the identity
+	if (plan->nstages == 0) {
+		if (output != input) {
+			*output = *input;
+		}
+		return;
+	}
+
+	st.plan = plan;
+	st.s = 1;
+	st.src = input;
+	st.layout = LAYOUT_INTERLEAVED;
+
+	// Stages alternate between output and the work buffer, and the
+	// last one must land in output.  If that would make the first
+	// stage read and write the same array, read from a copy instead.
+	if (input == output && plan->nstages % 2 == 1) {
+		memcpy(work, input, plan->n * sizeof(double complex));
+		st.src = work;
+	}
+
+	for (stage = 0; stage < plan->nstages; stage++) {
+		st.p = plan->radix[stage];
+		st.m = len / st.p;
+		st.dst = ((plan->nstages - stage) % 2 == 1) ? output : work;
+		if (parallel) {
+			// Each iteration of the longer loop covers n/count points
+			count = (st.m >= st.s) ? st.m : st.s;
+			grain = FFT_PARALLEL_GRAIN / (plan->n / count) + 1;
+			parallel_for(count, grain, stage_body, &st);
+		} else {
+			run_stage(&st, 0, st.m, 0, st.s);
+		}
+		st.src = st.dst;
+		len = st.m;
+		st.s *= st.p;
+	}
+}
+
+static void execute_single(fft_plan *plan, float complex *input, float complex *output,
+													 float complex *work);
+
+/* bluestein() in single precision, on the calling thread */
+static void bluestein_single(fft_plan *plan, float complex *input, float complex *output,
+														 float complex *work) {
+	// index variable
+	int j;
+	int n = plan->n, length = plan->sub_forward->n;
+
+	for (j = 0; j < n; j++) {
+		*(work + j) = cmulf(*(input + j), *(plan->chirp_single + j));
+	}
+	memset(work + n, 0, (length - n) * sizeof(float complex));
+
+	execute_single(plan->sub_forward, work, work, work + length);
+	for (j = 0; j < length; j++) {
+		*(work + j) = cmulf(*(work + j), *(plan->filter_single + j));
+	}
+	execute_single(plan->sub_inverse, work, work, work + length);
+
+	for (j = 0; j < n; j++) {
+		*(output + j) = cmulf(*(work + j), *(plan->chirp_single + j));
+	}
+}
+
+/* execute() in single precision, on the calling thread.  The
+	 stages ping-pong between output and work in the same way. */
+static void execute_single(fft_plan *plan, float complex *input, float complex *output,
+													 float complex *work) {
+	// index variable
+	int stage;
+	// length of current sub-transform, radix, butterflies and stride
+	int len = plan->n, p, m, s = 1;
+	// arrays the stage reads and writes
+	float complex *src = input, *dst;
+
+	if (plan->chirp != NULL) {
+		bluestein_single(plan, input, output, work);
+		return;
+	}
+	if (plan->nstages == 0) {
+		if (output != input) {
+			*output = *input;
+		}
+		return;
+	}
+	if (input == output && plan->nstages % 2 == 1) {
+		memcpy(work, input, plan->n * sizeof(float complex));
+		src = work;
+	}
+
+	for (stage = 0; stage < plan->nstages; stage++) {
+		p = plan->radix[stage];
+		m = len / p;
+		dst = ((plan->nstages - stage) % 2 == 1) ? output : work;
+		switch (p) {
+			case 2:
+				radix2_single(m, s, plan->sign, src, dst, plan->table_single, s, 0, m, 0, s);
+				break;
+			case 3:
+				radix3_single(m, s, plan->sign, src, dst, plan->table_single, s, 0, m, 0, s);
+				break;
+			case 4:
+				radix4_single(m, s, plan->sign, src, dst, plan->table_single, s, 0, m, 0, s);
+				break;
+			case 5:
+				radix5_single(m, s, plan->sign, src, dst, plan->table_single, s, 0, m, 0, s);
+				break;
+			default:
+				if (codelet_single(p, m, s, plan->sign, src, dst, plan->table_single, s,
+													 0, m, 0, s) != 0) {
+					radixg_single(p, m, s, plan->sign, src, dst, plan->table_single, s, 0, m, 0, s);
+				}
+				break;
+		}
+		src = dst;
+		len = m;
+		s *= p;
+	}
+}
+
+static void execute_split(fft_plan *plan, double *re, double *im, double *work, int parallel);
+
+/* Bluestein's algorithm on split data.  As bluestein(), with the
+	 padded sequence split across the first two quarters of work. */
+static void bluestein_split(fft_plan *plan, double *re, double *im, double *work, int parallel) {
+	// index variable
+	int j;
+	int n = plan->n, length = plan->sub_forward->n;
+	double *work_re = work, *work_im = work + length;
+	// one point, times a chirp or the filter
+	double complex z;
+
+	for (j = 0; j < n; j++) {
+		z = cmul(CMPLX(*(re + j), *(im + j)), *(plan->chirp + j));
+		*(work_re + j) = creal(z);
+		*(work_im + j) = cimag(z);
+	}
+	memset(work_re + n, 0, (length - n) * sizeof(double));
+	memset(work_im + n, 0, (length - n) * sizeof(double));
+
+	execute_split(plan->sub_forward, work_re, work_im, work + 2*length, parallel);
+	for (j = 0; j < length; j++) {
+		z = cmul(CMPLX(*(work_re + j), *(work_im + j)), *(plan->filter + j));
+		*(work_re + j) = creal(z);
+		*(work_im + j) = cimag(z);
+	}
+	execute_split(plan->sub_inverse, work_re, work_im, work + 2*length, parallel);
+
+	for (j = 0; j < n; j++) {
+		z = cmul(CMPLX(*(work_re + j), *(work_im + j)), *(plan->chirp + j));
+		*(re + j) = creal(z);
+		*(im + j) = cimag(z);
+	}
+}
+
+/* Execute a plan in place on split data, using the given scratch
+	 space: the real parts in its first n doubles and the imaginary
+	 parts in the next n. */
+static void execute_split(fft_plan *plan, double *re, double *im, double *work, int parallel) {
+	// index variable
+	int stage;
+	// length of current sub-transform
+	int len = plan->n;
+	// the stage being done
+	struct fft_stage st;
+	// loop shared out, and the fewest iterations worth a thread
+	int count, grain;
+
+	if (plan->chirp != NULL) {
+		bluestein_split(plan, re, im, work, parallel);
+		return;
+	}
+	if (plan->nstages == 0) {
+		return;
+	}
+
+	st.plan = plan;
+	st.s = 1;
+	st.layout = LAYOUT_SPLIT;
+	st.split.sign = plan->sign;
+	st.split.table = plan->table;
+	st.split.x_re = re;
+	st.split.x_im = im;
+
+	// As in execute(), the last stage must land in re and im
+	if (plan->nstages % 2 == 1) {
+		memcpy(work, re, plan->n * sizeof(double));
+		memcpy(work + plan->n, im, plan->n * sizeof(double));
+		st.split.x_re = work;
+		st.split.x_im = work + plan->n;
+	}
+
+	for (stage = 0; stage < plan->nstages; stage++) {
+		st.p = st.split.p = plan->radix[stage];
+		st.m = st.split.m = len / st.p;
+		st.split.s = st.s;
+		if ((plan->nstages - stage) % 2 == 1) {
+			st.split.y_re = re;
+			st.split.y_im = im;
+		} else {
+			st.split.y_re = work;
+			st.split.y_im = work + plan->n;
+		}
+		if (parallel) {
+			count = (st.m >= st.s) ? st.m : st.s;
+			grain = FFT_PARALLEL_GRAIN / (plan->n / count) + 1;
+			parallel_for(count, grain, stage_body, &st);
+		} else {
+			run_stage(&st, 0, st.m, 0, st.s);
+		}
+		st.split.x_re = st.split.y_re;
+		st.split.x_im = st.split.y_im;
+		len = st.m;
+		st.s *= st.p;
+	}
+}
+
+/* Execute a plan.  input and output may be the same array,
+	 in which case the transform is done in place.  Long transforms
+	 are shared out among the threads from threads_init(), stage by
+	 stage.  The plan's own scratch space is used, so a plan must
+	 not be executed this way by two threads at once.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 */
+void fft_execute(fft_plan *plan, double complex *input, double complex *output) {
+	execute(plan, input, output, plan->work, 1);
+}
+
+/* Execute a plan on the calling thread alone, with scratch space
+	 supplied by the caller.  Any number of threads can execute the
+	 same plan at once this way, each with its own scratch space.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 *work: scratch space of fft_work_size(plan) points
+	 */
+void fft_execute_work(fft_plan *plan, double complex *input, double complex *output,
+											double complex *work) {
+	execute(plan, input, output, work, 0);
+}
+
+/* Execute a plan in single precision, on the calling thread alone,
+	 with scratch space supplied by the caller.  The twiddles are
+	 rounded from the double precision ones, so the error is that of
+	 the float arithmetic alone: about 6e-8 times log2(n) relative to
+	 the largest output, in the worst case.  input and output may be
+	 the same array.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 *work: scratch space of fft_work_size(plan) points
+	 */
+void fft_execute_single_work(fft_plan *plan, float complex *input, float complex *output,
+														 float complex *work) {
+	execute_single(plan, input, output, work);
+}
+
+/* Execute a plan in place on split data: real parts in one array,
+	 imaginary parts in another.  The butterflies then work on whole
+	 SIMD vectors of points.  Long transforms are shared out among the
+	 threads as by fft_execute(), and the plan's scratch space is used
+	 in the same way.
+
+	 *plan: plan built by fft_plan_create()
+	 *re, *im: the real and imaginary parts of the n points, replaced
+	 					 by those of the transform
+	 */
+void fft_execute_split(fft_plan *plan, double *re, double *im) {
+	execute_split(plan, re, im, (double *)plan->work, 1);
+}
+
+/* Execute a plan in place on split data on the calling thread
+	 alone, with scratch space supplied by the caller.
+
+	 *plan: plan built by fft_plan_create()
+	 *re, *im: the real and imaginary parts of the n points, replaced
+	 					 by those of the transform
+	 *work: scratch space of 2*fft_work_size(plan) doubles
+	 */
+void fft_execute_split_work(fft_plan *plan, double *re, double *im, double *work) {
+	execute_split(plan, re, im, work, 0);
+}
+
+/* Number of points of scratch space fft_execute_work() and
+	 fft_execute_single_work() need.
+
+	 *plan: plan built by fft_plan_create()
+	 */
+int fft_work_size(fft_plan *plan) {
+	// Bluestein pads to the sub-transform length, and that transform
+	// needs as much again for itself
+	return (plan->chirp != NULL) ? 2*plan->sub_forward->n : plan->n;
+}
+
+/* Smallest length of at least n that factors entirely into
+	 2s, 3s and 5s, and so transforms at full speed.
+
+	 n: minimum length required
+	 */
+int fft_good_size(int n) {
+	// candidate length, and what is left of it after dividing out 2, 3, 5
+	int size, left;
+
+	for (size = (n < 1) ? 1 : n; ; size++) {
+		left = size;
+		while (left % 2 == 0) left /= 2;
+		while (left % 3 == 0) left /= 3;
+		while (left % 5 == 0) left /= 5;
+		if (left == 1) {
+			return size;
+		}
+	}
+}
+
+/* Free a plan and everything it holds.  NULL is ignored, so
+	 this is safe to call on a plan that was never built.
+
+	 *plan: plan to be freed
+	 */
+void fft_plan_destroy(fft_plan *plan) {
+	if (plan == NULL) {
+		return;
+	}
+	twiddle_release(plan->table);
+	free(plan->table_single);
+	free(plan->work);
+	fft_plan_destroy(plan->sub_forward);
+	fft_plan_destroy(plan->sub_inverse);
+	free(plan->chirp);
+	free(plan->filter);
+	free(plan->chirp_single);
+	free(plan->filter_single);
+	free(plan);
+}
@@ -0,0 +1,245 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the FFT engine.
+Plan structure and function prototypes.
+
+*/
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex.h>
+
+// CMPLX() only arrived in C11.  Older standards get the GCC builtin.
+#ifndef CMPLX
+#define CMPLX(x, y) __builtin_complex((double)(x), (double)(y))
+#endif
+#ifndef CMPLXF
+#define CMPLXF(x, y) __builtin_complex((float)(x), (float)(y))
+#endif
+
+/* Complex multiply written out in full.  The C99 operator has to
+	 cope with infinities and NaNs and compiles to a library call,
+	 which is far too slow for an innermost loop.
+	 */
+static inline double complex cmul(double complex a, double complex b) {
+	return CMPLX(creal(a)*creal(b) - cimag(a)*cimag(b),
+							 creal(a)*cimag(b) + cimag(a)*creal(b));
+}
+
+/* The same in single precision */
+static inline float complex cmulf(float complex a, float complex b) {
+	return CMPLXF(crealf(a)*crealf(b) - cimagf(a)*cimagf(b),
+								crealf(a)*cimagf(b) + cimagf(a)*crealf(b));
+}
+
+// Largest prime factor done by a direct butterfly.  Lengths with a
+// bigger prime factor go through Bluestein's algorithm instead.
+#define FFT_MAX_RADIX 31
+
+// fft_execute() only shares a transform out among the threads when
+// each thread would get at least this many points of every stage.
+#define FFT_PARALLEL_GRAIN 4096
+
+// Most radix stages a plan can hold.  Every stage divides the
+// length by at least 2, so 64 covers any length we could allocate.
+#define FFT_MAX_STAGES 64
+
+// Most lengths fft_prefer_radices() can hold an order for.  A
+// programme only ever transforms a few lengths.
+#define FFT_MAX_PREFERRED 32
+
+/* A plan holds everything that depends only on the transform
+	 length and direction: the factorisation of the length, the
+	 shared table of roots of unity and a scratch buffer.
+	 Build it once, then execute it as often as required.
+	 */
+typedef struct fft_plan {
+	// Transform length
+	int n;
+	// Sign of the exponent, +1 or -1
+	int sign;
+	// Number of radix stages, and the radix of each
+	int nstages;
+	int radix[FFT_MAX_STAGES];
+	// The n roots of unity exp(2 pi i k / n), shared through
+	// twiddle_acquire().  Every stage takes its twiddles from here.
+	double complex *table;
+	// The same roots rounded to single precision, for
+	// fft_execute_single_work()
+	float complex *table_single;
+	// Scratch buffer used by fft_execute() to ping-pong between
+	// stages.  fft_work_size() points long.
+	double complex *work;
+	// Bluestein's algorithm writes the transform as a convolution
+	// with a chirp, done by FFTs of a longer, well factored length.
+	// These are NULL unless n has a prime factor > FFT_MAX_RADIX.
+	struct fft_plan *sub_forward;
+	struct fft_plan *sub_inverse;
+	// chirp[j] = exp(sign * pi i j^2 / n), j = 0 ... n-1
+	double complex *chirp;
+	// FT of the conjugate chirp, wrapped round the padded length,
+	// with the normalisation of the inverse transform folded in
+	double complex *filter;
+	// chirp and filter rounded to single precision
+	float complex *chirp_single;
+	float complex *filter_single;
+} fft_plan;
+
+/* Build a plan for transforms of length n.
+	 The transform computed is the unnormalised
+	 out[k] = sum_j in[j] exp(sign * 2 pi i j k / n)
+
+	 n: transform length, any positive integer.  Fastest when
+	 	 it factors into 2, 3, 4 and 5.  Lengths with a large prime
+	 	 factor cost a few times more, but are still O(n log n).
+	 sign: sign of the exponent, +1 or -1
+
+	 Returns NULL if n is not supported (see fft_supported()) or
+	 memory could not be allocated.
+	 */
+fft_plan *fft_plan_create(int n, int sign);
+
+/* Factorise a transform length into the radices of its stages, in
+	 the order the plan built by fft_plan_create() does them: the one
+	 given by fft_prefer_radices(), if any, otherwise the usual one.
+	 A length with a prime factor above FFT_MAX_RADIX ends in a single
+	 stage of that factor and any after it, for Bluestein's algorithm.
+
+	 n: transform length
+	 *radix: FFT_MAX_STAGES places for the radices
+
+	 Returns the number of stages.
+	 */
+int fft_factor(int n, int *radix);
+
+/* Whether a plan of length n can be built at all, memory allowing.
+	 Lengths with a prime factor above FFT_MAX_RADIX need a Bluestein
+	 transform of over twice their length, which must itself fit in
+	 an int.
+
+	 n: transform length
+
+	 Returns 1 if it can, 0 if not.
+	 */
+int fft_supported(int n);
+
+/* Build a plan for transforms of length n, doing the stages in an
+	 order other than fft_plan_create() would, eg. one found faster by
+	 timing.  A last stage above FFT_MAX_RADIX makes it a Bluestein
+	 plan, as fft_factor() gives for such lengths.
+
+	 n: transform length
+	 sign: sign of the exponent, +1 or -1
+	 *radix: the radices of the stages, whose product must be n
+	 nstages: number of stages
+
+	 Returns NULL if the radices do not fit n, or if memory could not
+	 be allocated.
+	 */
+fft_plan *fft_plan_create_radices(int n, int sign, const int *radix, int nstages);
+
+/* Have every plan of length n built from now on do its stages in
+	 this order, eg. one found faster by timing.  Plans already built
+	 are unchanged.  A second call for the same length replaces the
+	 first.
+
+	 n: transform length
+	 *radix: the radices of the stages, as for fft_plan_create_radices()
+	 nstages: number of stages
+
+	 Returns 0, or -1 if the radices do not fit n or FFT_MAX_PREFERRED
+	 lengths already have an order.
+	 */
+int fft_prefer_radices(int n, const int *radix, int nstages);
+
+/* Execute a plan.  input and output may be the same array,
+	 in which case the transform is done in place.  Long transforms
+	 are shared out among the threads from threads_init(), stage by
+	 stage.  The plan's own scratch space is used, so a plan must
+	 not be executed this way by two threads at once.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 */
+void fft_execute(fft_plan *plan, double complex *input, double complex *output);
+
+/* Execute a plan on the calling thread alone, with scratch space
+	 supplied by the caller.  Any number of threads can execute the
+	 same plan at once this way, each with its own scratch space.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 *work: scratch space of fft_work_size(plan) points
+	 */
+void fft_execute_work(fft_plan *plan, double complex *input, double complex *output,
+											double complex *work);
+
+/* Execute a plan in single precision, on the calling thread alone,
+	 with scratch space supplied by the caller.  The twiddles are
+	 rounded from the double precision ones, so the error is that of
+	 the float arithmetic alone: about 6e-8 times log2(n) relative to
+	 the largest output, in the worst case.  input and output may be
+	 the same array.
+
+	 *plan: plan built by fft_plan_create()
+	 *input: pointer to the start of the n points to be transformed
+	 *output: pointer to the start of the array where the n
+	 					transformed points will be stored
+	 *work: scratch space of fft_work_size(plan) points
+	 */
+void fft_execute_single_work(fft_plan *plan, float complex *input, float complex *output,
+														 float complex *work);
+
+/* Execute a plan in place on split data: real parts in one array,
+	 imaginary parts in another.  The butterflies then work on whole
+	 SIMD vectors of points.  Long transforms are shared out among the
+	 threads as by fft_execute(), and the plan's scratch space is used
+	 in the same way.
+
+	 *plan: plan built by fft_plan_create()
+	 *re, *im: the real and imaginary parts of the n points, replaced
+	 					 by those of the transform
+	 */
+void fft_execute_split(fft_plan *plan, double *re, double *im);
+
+/* Execute a plan in place on split data on the calling thread
+	 alone, with scratch space supplied by the caller.
+
+	 *plan: plan built by fft_plan_create()
+	 *re, *im: the real and imaginary parts of the n points, replaced
+	 					 by those of the transform
+	 *work: scratch space of 2*fft_work_size(plan) doubles
+	 */
+void fft_execute_split_work(fft_plan *plan, double *re, double *im, double *work);
+
+/* Number of points of scratch space fft_execute_work() and
+	 fft_execute_single_work() need.
+
+	 *plan: plan built by fft_plan_create()
+	 */
+int fft_work_size(fft_plan *plan);
+
+/* Smallest length of at least n that factors entirely into
+	 2s, 3s and 5s, and so transforms at full speed.
+
+	 n: minimum length required
+	 */
+int fft_good_size(int n);
+
+/* Free a plan and everything it holds.  NULL is ignored, so
+	 this is safe to call on a plan that was never built.
+
+	 *plan: plan to be freed
+	 */
+void fft_plan_destroy(fft_plan *plan);
+
+#endif
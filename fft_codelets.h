@@ -0,0 +1,612 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Generated by gen_codelets.c: do not edit.
+
+./gen_codelets fft 8 9
+
+Unrolled butterflies for the interleaved stages, included after
+fft_kernels.h with the same macros.
+*/
+
+#ifndef FFT_CODELET_RADICES
+// Radices with a codelet, in the order fft_plan_create() takes them
+#define FFT_CODELET_RADICES 8, 9
+#endif
+
+/* Radix 8, exponent negative */
+static void KERNEL(radix8_minus)(int m, int s, int sign, CPLX *x, CPLX *y,
+		CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	REAL wr[8], wi[8];
+	const REAL K0 = 0.70710678118654752438;
+	REAL t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	REAL t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	REAL t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	REAL t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	REAL t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	REAL t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+
+	for (j = j0; j < j1; j++) {
+		for (t = 1; t < 8; t++) {
+			wr[t] = RE(KERNEL(root)(table, j*t*ns, sign));
+			wi[t] = IM(KERNEL(root)(table, j*t*ns, sign));
+		}
+		for (q = q0; q < q1; q++) {
+			t0 = RE(*(x + q + s*j));
+			t1 = IM(*(x + q + s*j));
+			t8 = RE(*(x + q + s*(j + 4*m)));
+			t9 = IM(*(x + q + s*(j + 4*m)));
+			t16 = t0 + t8;
+			t17 = t1 + t9;
+			t18 = t0 - t8;
+			t19 = t1 - t9;
+			t4 = RE(*(x + q + s*(j + 2*m)));
+			t5 = IM(*(x + q + s*(j + 2*m)));
+			t12 = RE(*(x + q + s*(j + 6*m)));
+			t13 = IM(*(x + q + s*(j + 6*m)));
+			t20 = t4 + t12;
+			t21 = t5 + t13;
+			t22 = t4 - t12;
+			t23 = t5 - t13;
+			t24 = t16 + t20;
+			t25 = t17 + t21;
+			t26 = t18 + t23;
+			t27 = t19 - t22;
+			t28 = t16 - t20;
+			t29 = t17 - t21;
+			t30 = t18 - t23;
+			t31 = t19 + t22;
+			t2 = RE(*(x + q + s*(j + m)));
+			t3 = IM(*(x + q + s*(j + m)));
+			t10 = RE(*(x + q + s*(j + 5*m)));
+			t11 = IM(*(x + q + s*(j + 5*m)));
+			t32 = t2 + t10;
+			t33 = t3 + t11;
+			t34 = t2 - t10;
+			t35 = t3 - t11;
+			t6 = RE(*(x + q + s*(j + 3*m)));
+			t7 = IM(*(x + q + s*(j + 3*m)));
+			t14 = RE(*(x + q + s*(j + 7*m)));
+			t15 = IM(*(x + q + s*(j + 7*m)));
+			t36 = t6 + t14;
+			t37 = t7 + t15;
+			t38 = t6 - t14;
+			t39 = t7 - t15;
+			t40 = t32 + t36;
+			t41 = t33 + t37;
+			t42 = t34 + t39;
+			t43 = t35 - t38;
+			t44 = t32 - t36;
+			t45 = t33 - t37;
+			t46 = t34 - t39;
+			t47 = t35 + t38;
+			t48 = t42 + t43;
+			t49 = K0 * t48;
+			t50 = t43 - t42;
+			t51 = K0 * t50;
+			t52 = t47 - t46;
+			t53 = K0 * t52;
+			t54 = t46 + t47;
+			t55 = K0 * t54;
+			t56 = t24 + t40;
+			t57 = t25 + t41;
+			t58 = t24 - t40;
+			t59 = t25 - t41;
+			*(y + q + s*(8*j)) = MAKE(t56, t57);
+			*(y + q + s*(8*j + 4)) = MAKE(t58*wr[4] - t59*wi[4], t58*wi[4] + t59*wr[4]);
+			t60 = t26 + t49;
+			t61 = t27 + t51;
+			t62 = t26 - t49;
+			t63 = t27 - t51;
+			*(y + q + s*(8*j + 1)) = MAKE(t60*wr[1] - t61*wi[1], t60*wi[1] + t61*wr[1]);
+			*(y + q + s*(8*j + 5)) = MAKE(t62*wr[5] - t63*wi[5], t62*wi[5] + t63*wr[5]);
+			t64 = t28 + t45;
+			t65 = t29 - t44;
+			t66 = t28 - t45;
+			t67 = t29 + t44;
+			*(y + q + s*(8*j + 2)) = MAKE(t64*wr[2] - t65*wi[2], t64*wi[2] + t65*wr[2]);
+			*(y + q + s*(8*j + 6)) = MAKE(t66*wr[6] - t67*wi[6], t66*wi[6] + t67*wr[6]);
+			t68 = t30 + t53;
+			t69 = t31 - t55;
+			t70 = t30 - t53;
+			t71 = t31 + t55;
+			*(y + q + s*(8*j + 3)) = MAKE(t68*wr[3] - t69*wi[3], t68*wi[3] + t69*wr[3]);
+			*(y + q + s*(8*j + 7)) = MAKE(t70*wr[7] - t71*wi[7], t70*wi[7] + t71*wr[7]);
+		}
+	}
+}
+
+/* Radix 8, exponent positive */
+static void KERNEL(radix8_plus)(int m, int s, int sign, CPLX *x, CPLX *y,
+		CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	REAL wr[8], wi[8];
+	const REAL K0 = 0.70710678118654752438;
+	REAL t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	REAL t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	REAL t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	REAL t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	REAL t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	REAL t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+
+	for (j = j0; j < j1; j++) {
+		for (t = 1; t < 8; t++) {
+			wr[t] = RE(KERNEL(root)(table, j*t*ns, sign));
+			wi[t] = IM(KERNEL(root)(table, j*t*ns, sign));
+		}
+		for (q = q0; q < q1; q++) {
+			t0 = RE(*(x + q + s*j));
+			t1 = IM(*(x + q + s*j));
+			t8 = RE(*(x + q + s*(j + 4*m)));
+			t9 = IM(*(x + q + s*(j + 4*m)));
+			t16 = t0 + t8;
+			t17 = t1 + t9;
+			t18 = t0 - t8;
+			t19 = t1 - t9;
+			t4 = RE(*(x + q + s*(j + 2*m)));
+			t5 = IM(*(x + q + s*(j + 2*m)));
+			t12 = RE(*(x + q + s*(j + 6*m)));
+			t13 = IM(*(x + q + s*(j + 6*m)));
+			t20 = t4 + t12;
+			t21 = t5 + t13;
+			t22 = t4 - t12;
+			t23 = t5 - t13;
+			t24 = t16 + t20;
+			t25 = t17 + t21;
+			t26 = t18 - t23;
+			t27 = t19 + t22;
+			t28 = t16 - t20;
+			t29 = t17 - t21;
+			t30 = t18 + t23;
+			t31 = t19 - t22;
+			t2 = RE(*(x + q + s*(j + m)));
+			t3 = IM(*(x + q + s*(j + m)));
+			t10 = RE(*(x + q + s*(j + 5*m)));
+			t11 = IM(*(x + q + s*(j + 5*m)));
+			t32 = t2 + t10;
+			t33 = t3 + t11;
+			t34 = t2 - t10;
+			t35 = t3 - t11;
+			t6 = RE(*(x + q + s*(j + 3*m)));
+			t7 = IM(*(x + q + s*(j + 3*m)));
+			t14 = RE(*(x + q + s*(j + 7*m)));
+			t15 = IM(*(x + q + s*(j + 7*m)));
+			t36 = t6 + t14;
+			t37 = t7 + t15;
+			t38 = t6 - t14;
+			t39 = t7 - t15;
+			t40 = t32 + t36;
+			t41 = t33 + t37;
+			t42 = t34 - t39;
+			t43 = t35 + t38;
+			t44 = t32 - t36;
+			t45 = t33 - t37;
+			t46 = t34 + t39;
+			t47 = t35 - t38;
+			t48 = t42 - t43;
+			t49 = K0 * t48;
+			t50 = t43 + t42;
+			t51 = K0 * t50;
+			t52 = t47 + t46;
+			t53 = K0 * t52;
+			t54 = t46 - t47;
+			t55 = K0 * t54;
+			t56 = t24 + t40;
+			t57 = t25 + t41;
+			t58 = t24 - t40;
+			t59 = t25 - t41;
+			*(y + q + s*(8*j)) = MAKE(t56, t57);
+			*(y + q + s*(8*j + 4)) = MAKE(t58*wr[4] - t59*wi[4], t58*wi[4] + t59*wr[4]);
+			t60 = t26 + t49;
+			t61 = t27 + t51;
+			t62 = t26 - t49;
+			t63 = t27 - t51;
+			*(y + q + s*(8*j + 1)) = MAKE(t60*wr[1] - t61*wi[1], t60*wi[1] + t61*wr[1]);
+			*(y + q + s*(8*j + 5)) = MAKE(t62*wr[5] - t63*wi[5], t62*wi[5] + t63*wr[5]);
+			t64 = t28 - t45;
+			t65 = t29 + t44;
+			t66 = t28 + t45;
+			t67 = t29 - t44;
+			*(y + q + s*(8*j + 2)) = MAKE(t64*wr[2] - t65*wi[2], t64*wi[2] + t65*wr[2]);
+			*(y + q + s*(8*j + 6)) = MAKE(t66*wr[6] - t67*wi[6], t66*wi[6] + t67*wr[6]);
+			t68 = t30 - t53;
+			t69 = t31 + t55;
+			t70 = t30 + t53;
+			t71 = t31 - t55;
+			*(y + q + s*(8*j + 3)) = MAKE(t68*wr[3] - t69*wi[3], t68*wi[3] + t69*wr[3]);
+			*(y + q + s*(8*j + 7)) = MAKE(t70*wr[7] - t71*wi[7], t70*wi[7] + t71*wr[7]);
+		}
+	}
+}
+
+/* Radix 9, exponent negative */
+static void KERNEL(radix9_minus)(int m, int s, int sign, CPLX *x, CPLX *y,
+		CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	REAL wr[9], wi[9];
+	const REAL K0 = 0.49999999999999999997;
+	const REAL K1 = 0.86602540378443864679;
+	const REAL K2 = 0.64278760968653932633;
+	const REAL K3 = 0.76604444311897803519;
+	const REAL K4 = 0.98480775301220805940;
+	const REAL K5 = 0.17364817766693034880;
+	const REAL K6 = 0.34202014332566873297;
+	const REAL K7 = 0.93969262078590838410;
+	REAL t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	REAL t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	REAL t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	REAL t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	REAL t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	REAL t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+	REAL t72, t73, t74, t75, t76, t77, t78, t79, t80, t81, t82, t83;
+	REAL t84, t85, t86, t87, t88, t89, t90, t91, t92, t93, t94, t95;
+	REAL t96, t97, t98, t99, t100, t101, t102, t103, t104, t105, t106, t107;
+	REAL t108, t109, t110, t111, t112, t113, t114, t115, t116, t117, t118, t119;
+	REAL t120, t121, t122, t123, t124, t125, t126, t127, t128, t129, t130, t131;
+	REAL t132, t133, t134, t135, t136, t137;
+
+	for (j = j0; j < j1; j++) {
+		for (t = 1; t < 9; t++) {
+			wr[t] = RE(KERNEL(root)(table, j*t*ns, sign));
+			wi[t] = IM(KERNEL(root)(table, j*t*ns, sign));
+		}
+		for (q = q0; q < q1; q++) {
+			t6 = RE(*(x + q + s*(j + 3*m)));
+			t7 = IM(*(x + q + s*(j + 3*m)));
+			t12 = RE(*(x + q + s*(j + 6*m)));
+			t13 = IM(*(x + q + s*(j + 6*m)));
+			t18 = t6 + t12;
+			t19 = t7 + t13;
+			t20 = t6 - t12;
+			t21 = t7 - t13;
+			t0 = RE(*(x + q + s*j));
+			t1 = IM(*(x + q + s*j));
+			t22 = t0 + t18;
+			t23 = t1 + t19;
+			t24 = K0 * t18;
+			t25 = K0 * t19;
+			t26 = t0 - t24;
+			t27 = t1 - t25;
+			t28 = K1 * t20;
+			t29 = K1 * t21;
+			t30 = t26 + t29;
+			t31 = t27 - t28;
+			t32 = t26 - t29;
+			t33 = t27 + t28;
+			t8 = RE(*(x + q + s*(j + 4*m)));
+			t9 = IM(*(x + q + s*(j + 4*m)));
+			t14 = RE(*(x + q + s*(j + 7*m)));
+			t15 = IM(*(x + q + s*(j + 7*m)));
+			t34 = t8 + t14;
+			t35 = t9 + t15;
+			t36 = t8 - t14;
+			t37 = t9 - t15;
+			t2 = RE(*(x + q + s*(j + m)));
+			t3 = IM(*(x + q + s*(j + m)));
+			t38 = t2 + t34;
+			t39 = t3 + t35;
+			t40 = K0 * t34;
+			t41 = K0 * t35;
+			t42 = t2 - t40;
+			t43 = t3 - t41;
+			t44 = K1 * t36;
+			t45 = K1 * t37;
+			t46 = t42 + t45;
+			t47 = t43 - t44;
+			t48 = t42 - t45;
+			t49 = t43 + t44;
+			t50 = K2 * t47;
+			t51 = K3 * t46;
+			t52 = t51 + t50;
+			t53 = K2 * t46;
+			t54 = K3 * t47;
+			t55 = t54 - t53;
+			t56 = K4 * t49;
+			t57 = K5 * t48;
+			t58 = t57 + t56;
+			t59 = K4 * t48;
+			t60 = K5 * t49;
+			t61 = t60 - t59;
+			t10 = RE(*(x + q + s*(j + 5*m)));
+			t11 = IM(*(x + q + s*(j + 5*m)));
+			t16 = RE(*(x + q + s*(j + 8*m)));
+			t17 = IM(*(x + q + s*(j + 8*m)));
+			t62 = t10 + t16;
+			t63 = t11 + t17;
+			t64 = t10 - t16;
+			t65 = t11 - t17;
+			t4 = RE(*(x + q + s*(j + 2*m)));
+			t5 = IM(*(x + q + s*(j + 2*m)));
+			t66 = t4 + t62;
+			t67 = t5 + t63;
+			t68 = K0 * t62;
+			t69 = K0 * t63;
+			t70 = t4 - t68;
+			t71 = t5 - t69;
+			t72 = K1 * t64;
+			t73 = K1 * t65;
+			t74 = t70 + t73;
+			t75 = t71 - t72;
+			t76 = t70 - t73;
+			t77 = t71 + t72;
+			t78 = K4 * t75;
+			t79 = K5 * t74;
+			t80 = t79 + t78;
+			t81 = K4 * t74;
+			t82 = K5 * t75;
+			t83 = t82 - t81;
+			t84 = K6 * t77;
+			t85 = K7 * t76;
+			t86 = t84 - t85;
+			t87 = K6 * t76;
+			t88 = K7 * t77;
+			t89 = t88 + t87;
+			t90 = t38 + t66;
+			t91 = t39 + t67;
+			t92 = t38 - t66;
+			t93 = t39 - t67;
+			t94 = t22 + t90;
+			t95 = t23 + t91;
+			t96 = K0 * t90;
+			t97 = K0 * t91;
+			t98 = t22 - t96;
+			t99 = t23 - t97;
+			t100 = K1 * t92;
+			t101 = K1 * t93;
+			t102 = t98 + t101;
+			t103 = t99 - t100;
+			t104 = t98 - t101;
+			t105 = t99 + t100;
+			*(y + q + s*(9*j)) = MAKE(t94, t95);
+			*(y + q + s*(9*j + 3)) = MAKE(t102*wr[3] - t103*wi[3], t102*wi[3] + t103*wr[3]);
+			*(y + q + s*(9*j + 6)) = MAKE(t104*wr[6] - t105*wi[6], t104*wi[6] + t105*wr[6]);
+			t106 = t52 + t80;
+			t107 = t55 + t83;
+			t108 = t52 - t80;
+			t109 = t55 - t83;
+			t110 = t30 + t106;
+			t111 = t31 + t107;
+			t112 = K0 * t106;
+			t113 = K0 * t107;
+			t114 = t30 - t112;
+			t115 = t31 - t113;
+			t116 = K1 * t108;
+			t117 = K1 * t109;
+			t118 = t114 + t117;
+			t119 = t115 - t116;
+			t120 = t114 - t117;
+			t121 = t115 + t116;
+			*(y + q + s*(9*j + 1)) = MAKE(t110*wr[1] - t111*wi[1], t110*wi[1] + t111*wr[1]);
+			*(y + q + s*(9*j + 4)) = MAKE(t118*wr[4] - t119*wi[4], t118*wi[4] + t119*wr[4]);
+			*(y + q + s*(9*j + 7)) = MAKE(t120*wr[7] - t121*wi[7], t120*wi[7] + t121*wr[7]);
+			t122 = t58 + t86;
+			t123 = t61 - t89;
+			t124 = t58 - t86;
+			t125 = t61 + t89;
+			t126 = t32 + t122;
+			t127 = t33 + t123;
+			t128 = K0 * t122;
+			t129 = K0 * t123;
+			t130 = t32 - t128;
+			t131 = t33 - t129;
+			t132 = K1 * t124;
+			t133 = K1 * t125;
+			t134 = t130 + t133;
+			t135 = t131 - t132;
+			t136 = t130 - t133;
+			t137 = t131 + t132;
+			*(y + q + s*(9*j + 2)) = MAKE(t126*wr[2] - t127*wi[2], t126*wi[2] + t127*wr[2]);
+			*(y + q + s*(9*j + 5)) = MAKE(t134*wr[5] - t135*wi[5], t134*wi[5] + t135*wr[5]);
+			*(y + q + s*(9*j + 8)) = MAKE(t136*wr[8] - t137*wi[8], t136*wi[8] + t137*wr[8]);
+		}
+	}
+}
+
+/* Radix 9, exponent positive */
+static void KERNEL(radix9_plus)(int m, int s, int sign, CPLX *x, CPLX *y,
+		CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	REAL wr[9], wi[9];
+	const REAL K0 = 0.49999999999999999997;
+	const REAL K1 = 0.86602540378443864679;
+	const REAL K2 = 0.64278760968653932633;
+	const REAL K3 = 0.76604444311897803519;
+	const REAL K4 = 0.98480775301220805940;
+	const REAL K5 = 0.17364817766693034880;
+	const REAL K6 = 0.34202014332566873297;
+	const REAL K7 = 0.93969262078590838410;
+	REAL t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	REAL t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	REAL t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	REAL t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	REAL t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	REAL t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+	REAL t72, t73, t74, t75, t76, t77, t78, t79, t80, t81, t82, t83;
+	REAL t84, t85, t86, t87, t88, t89, t90, t91, t92, t93, t94, t95;
+	REAL t96, t97, t98, t99, t100, t101, t102, t103, t104, t105, t106, t107;
+	REAL t108, t109, t110, t111, t112, t113, t114, t115, t116, t117, t118, t119;
+	REAL t120, t121, t122, t123, t124, t125, t126, t127, t128, t129, t130, t131;
+	REAL t132, t133, t134, t135, t136, t137;
+
+	for (j = j0; j < j1; j++) {
+		for (t = 1; t < 9; t++) {
+			wr[t] = RE(KERNEL(root)(table, j*t*ns, sign));
+			wi[t] = IM(KERNEL(root)(table, j*t*ns, sign));
+		}
+		for (q = q0; q < q1; q++) {
+			t6 = RE(*(x + q + s*(j + 3*m)));
+			t7 = IM(*(x + q + s*(j + 3*m)));
+			t12 = RE(*(x + q + s*(j + 6*m)));
+			t13 = IM(*(x + q + s*(j + 6*m)));
+			t18 = t6 + t12;
+			t19 = t7 + t13;
+			t20 = t6 - t12;
+			t21 = t7 - t13;
+			t0 = RE(*(x + q + s*j));
+			t1 = IM(*(x + q + s*j));
+			t22 = t0 + t18;
+			t23 = t1 + t19;
+			t24 = K0 * t18;
+			t25 = K0 * t19;
+			t26 = t0 - t24;
+			t27 = t1 - t25;
+			t28 = K1 * t20;
+			t29 = K1 * t21;
+			t30 = t26 - t29;
+			t31 = t27 + t28;
+			t32 = t26 + t29;
+			t33 = t27 - t28;
+			t8 = RE(*(x + q + s*(j + 4*m)));
+			t9 = IM(*(x + q + s*(j + 4*m)));
+			t14 = RE(*(x + q + s*(j + 7*m)));
+			t15 = IM(*(x + q + s*(j + 7*m)));
+			t34 = t8 + t14;
+			t35 = t9 + t15;
+			t36 = t8 - t14;
+			t37 = t9 - t15;
+			t2 = RE(*(x + q + s*(j + m)));
+			t3 = IM(*(x + q + s*(j + m)));
+			t38 = t2 + t34;
+			t39 = t3 + t35;
+			t40 = K0 * t34;
+			t41 = K0 * t35;
+			t42 = t2 - t40;
+			t43 = t3 - t41;
+			t44 = K1 * t36;
+			t45 = K1 * t37;
+			t46 = t42 - t45;
+			t47 = t43 + t44;
+			t48 = t42 + t45;
+			t49 = t43 - t44;
+			t50 = K2 * t47;
+			t51 = K3 * t46;
+			t52 = t51 - t50;
+			t53 = K2 * t46;
+			t54 = K3 * t47;
+			t55 = t54 + t53;
+			t56 = K4 * t49;
+			t57 = K5 * t48;
+			t58 = t57 - t56;
+			t59 = K4 * t48;
+			t60 = K5 * t49;
+			t61 = t60 + t59;
+			t10 = RE(*(x + q + s*(j + 5*m)));
+			t11 = IM(*(x + q + s*(j + 5*m)));
+			t16 = RE(*(x + q + s*(j + 8*m)));
+			t17 = IM(*(x + q + s*(j + 8*m)));
+			t62 = t10 + t16;
+			t63 = t11 + t17;
+			t64 = t10 - t16;
+			t65 = t11 - t17;
+			t4 = RE(*(x + q + s*(j + 2*m)));
+			t5 = IM(*(x + q + s*(j + 2*m)));
+			t66 = t4 + t62;
+			t67 = t5 + t63;
+			t68 = K0 * t62;
+			t69 = K0 * t63;
+			t70 = t4 - t68;
+			t71 = t5 - t69;
+			t72 = K1 * t64;
+			t73 = K1 * t65;
+			t74 = t70 - t73;
+			t75 = t71 + t72;
+			t76 = t70 + t73;
+			t77 = t71 - t72;
+			t78 = K4 * t75;
+			t79 = K5 * t74;
+			t80 = t79 - t78;
+			t81 = K4 * t74;
+			t82 = K5 * t75;
+			t83 = t82 + t81;
+			t84 = K6 * t77;
+			t85 = K7 * t76;
+			t86 = t85 + t84;
+			t87 = K6 * t76;
+			t88 = K7 * t77;
+			t89 = t87 - t88;
+			t90 = t38 + t66;
+			t91 = t39 + t67;
+			t92 = t38 - t66;
+			t93 = t39 - t67;
+			t94 = t22 + t90;
+			t95 = t23 + t91;
+			t96 = K0 * t90;
+			t97 = K0 * t91;
+			t98 = t22 - t96;
+			t99 = t23 - t97;
+			t100 = K1 * t92;
+			t101 = K1 * t93;
+			t102 = t98 - t101;
+			t103 = t99 + t100;
+			t104 = t98 + t101;
+			t105 = t99 - t100;
+			*(y + q + s*(9*j)) = MAKE(t94, t95);
+			*(y + q + s*(9*j + 3)) = MAKE(t102*wr[3] - t103*wi[3], t102*wi[3] + t103*wr[3]);
+			*(y + q + s*(9*j + 6)) = MAKE(t104*wr[6] - t105*wi[6], t104*wi[6] + t105*wr[6]);
+			t106 = t52 + t80;
+			t107 = t55 + t83;
+			t108 = t52 - t80;
+			t109 = t55 - t83;
+			t110 = t30 + t106;
+			t111 = t31 + t107;
+			t112 = K0 * t106;
+			t113 = K0 * t107;
+			t114 = t30 - t112;
+			t115 = t31 - t113;
+			t116 = K1 * t108;
+			t117 = K1 * t109;
+			t118 = t114 - t117;
+			t119 = t115 + t116;
+			t120 = t114 + t117;
+			t121 = t115 - t116;
+			*(y + q + s*(9*j + 1)) = MAKE(t110*wr[1] - t111*wi[1], t110*wi[1] + t111*wr[1]);
+			*(y + q + s*(9*j + 4)) = MAKE(t118*wr[4] - t119*wi[4], t118*wi[4] + t119*wr[4]);
+			*(y + q + s*(9*j + 7)) = MAKE(t120*wr[7] - t121*wi[7], t120*wi[7] + t121*wr[7]);
+			t122 = t58 - t86;
+			t123 = t61 + t89;
+			t124 = t58 + t86;
+			t125 = t61 - t89;
+			t126 = t32 + t122;
+			t127 = t33 + t123;
+			t128 = K0 * t122;
+			t129 = K0 * t123;
+			t130 = t32 - t128;
+			t131 = t33 - t129;
+			t132 = K1 * t124;
+			t133 = K1 * t125;
+			t134 = t130 - t133;
+			t135 = t131 + t132;
+			t136 = t130 + t133;
+			t137 = t131 - t132;
+			*(y + q + s*(9*j + 2)) = MAKE(t126*wr[2] - t127*wi[2], t126*wi[2] + t127*wr[2]);
+			*(y + q + s*(9*j + 5)) = MAKE(t134*wr[5] - t135*wi[5], t134*wi[5] + t135*wr[5]);
+			*(y + q + s*(9*j + 8)) = MAKE(t136*wr[8] - t137*wi[8], t136*wi[8] + t137*wr[8]);
+		}
+	}
+}
+
+/* Do the butterflies of a radix p stage with its codelet, taking
+	 the same arguments as radixg().  Returns 0, or -1 if there is no
+	 codelet for p. */
+static int KERNEL(codelet)(int p, int m, int s, int sign, CPLX *x, CPLX *y,
+		CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	switch (p) {
+		case 8:
+			if (sign < 0) {
+				KERNEL(radix8_minus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);
+			} else {
+				KERNEL(radix8_plus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);
+			}
+			return 0;
+		case 9:
+			if (sign < 0) {
+				KERNEL(radix9_minus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);
+			} else {
+				KERNEL(radix9_plus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);
+			}
+			return 0;
+		default:
+			return -1;
+	}
+}
@@ -0,0 +1,210 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Butterflies of the interleaved FFT, written once for either
+precision.
+
+Like simd_kernels.h this is not a header in the usual sense: fft.c
+includes it once for double complex and once for float complex,
+each time with the macros below defined for that type.
+KERNEL(name) gives each copy its own names.
+
+	REAL                   double or float
+	CPLX                   double complex or float complex
+	MAKE(x, y)             the CPLX x + iy
+	RE(a), IM(a)           real and imaginary parts of a CPLX
+	MUL(a, b)              complex product written out, as cmul()
+
+Every constant is of type REAL, so that the single precision copy
+does no arithmetic in double.
+*/
+
+/* Multiply by sign*i, ie. rotate by a quarter turn */
+static inline CPLX KERNEL(rot90)(CPLX a, int sign) {
+	return (sign > 0) ? MAKE(-IM(a), RE(a)) : MAKE(IM(a), -RE(a));
+}
+
+/* Twiddle w^k where w = exp(sign * 2 pi i / n), taken from the
+	 table of n roots.  0 <= k < n.  The opposite sign is just the
+	 complex conjugate of the tabulated root.
+	 */
+static inline CPLX KERNEL(root)(CPLX *table, int k, int sign) {
+	return MAKE(RE(*(table + k)), sign * IM(*(table + k)));
+}
+
+/* The stages below all follow the same pattern.  The current
+	 sub-transform has length p*m and the data are interleaved with
+	 stride s.  Inputs x[q + s*(j + r*m)], r = 0..p-1, form one
+	 butterfly; its outputs are multiplied by twiddles w^(j*t) and
+	 stored at y[q + s*(p*j + t)], ready for the next stage with
+	 stride s*p.  The sub-transform is n/(p*m) times shorter than the
+	 table, so w^(j*t) is entry j*t*(n/(p*m)) = j*t*ns.
+	 Only butterflies with j from j0 to j1-1 and q from q0 to q1-1
+	 are done, so that a stage can be shared out among threads.
+	 */
+static void KERNEL(radix2)(int m, int s, int sign, CPLX *x, CPLX *y,
+													 CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q;
+	CPLX a, b, w;
+
+	for (j = j0; j < j1; j++) {
+		w = KERNEL(root)(table, j*ns, sign);
+		for (q = q0; q < q1; q++) {
+			a = *(x + q + s*j);
+			b = *(x + q + s*(j + m));
+			*(y + q + s*(2*j)) = a + b;
+			*(y + q + s*(2*j + 1)) = MUL(a - b, w);
+		}
+	}
+}
+
+static void KERNEL(radix3)(int m, int s, int sign, CPLX *x, CPLX *y,
+													 CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q;
+	CPLX a0, a1, a2, t1, t2, t3, w1, w2;
+	// sin(2 pi/3)
+	const REAL s3 = 0.86602540378443864676;
+
+	for (j = j0; j < j1; j++) {
+		w1 = KERNEL(root)(table, j*ns, sign);
+		w2 = KERNEL(root)(table, 2*j*ns, sign);
+		for (q = q0; q < q1; q++) {
+			a0 = *(x + q + s*j);
+			a1 = *(x + q + s*(j + m));
+			a2 = *(x + q + s*(j + 2*m));
+			t1 = a1 + a2;
+			t2 = a0 - (REAL)0.5*t1;
+			t3 = s3 * KERNEL(rot90)(a1 - a2, sign);
+			*(y + q + s*(3*j)) = a0 + t1;
+			*(y + q + s*(3*j + 1)) = MUL(t2 + t3, w1);
+			*(y + q + s*(3*j + 2)) = MUL(t2 - t3, w2);
+		}
+	}
+}
+
+static void KERNEL(radix4)(int m, int s, int sign, CPLX *x, CPLX *y,
+													 CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q;
+	CPLX a0, a1, a2, a3, t0, t1, t2, t3, w1, w2, w3;
+
+	for (j = j0; j < j1; j++) {
+		w1 = KERNEL(root)(table, j*ns, sign);
+		w2 = KERNEL(root)(table, 2*j*ns, sign);
+		w3 = KERNEL(root)(table, 3*j*ns, sign);
+		for (q = q0; q < q1; q++) {
+			a0 = *(x + q + s*j);
+			a1 = *(x + q + s*(j + m));
+			a2 = *(x + q + s*(j + 2*m));
+			a3 = *(x + q + s*(j + 3*m));
+			t0 = a0 + a2;
+			t1 = a0 - a2;
+			t2 = a1 + a3;
+			t3 = KERNEL(rot90)(a1 - a3, sign);
+			*(y + q + s*(4*j)) = t0 + t2;
+			*(y + q + s*(4*j + 1)) = MUL(t1 + t3, w1);
+			*(y + q + s*(4*j + 2)) = MUL(t0 - t2, w2);
+			*(y + q + s*(4*j + 3)) = MUL(t1 - t3, w3);
+		}
+	}
+}
+
+static void KERNEL(radix5)(int m, int s, int sign, CPLX *x, CPLX *y,
+													 CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q;
+	CPLX a0, a1, a2, a3, a4, t1, t2, t3, t4, u1, u2, v1, v2;
+	CPLX w1, w2, w3, w4;
+	// cos and sin of 2 pi/5 and 4 pi/5
+	const REAL c1 = 0.30901699437494742410, c2 = -0.80901699437494742410;
+	const REAL s1 = 0.95105651629515357212, s2 = 0.58778525229247312917;
+
+	for (j = j0; j < j1; j++) {
+		w1 = KERNEL(root)(table, j*ns, sign);
+		w2 = KERNEL(root)(table, 2*j*ns, sign);
+		w3 = KERNEL(root)(table, 3*j*ns, sign);
+		w4 = KERNEL(root)(table, 4*j*ns, sign);
+		for (q = q0; q < q1; q++) {
+			a0 = *(x + q + s*j);
+			a1 = *(x + q + s*(j + m));
+			a2 = *(x + q + s*(j + 2*m));
+			a3 = *(x + q + s*(j + 3*m));
+			a4 = *(x + q + s*(j + 4*m));
+			t1 = a1 + a4;
+			t2 = a2 + a3;
+			t3 = a1 - a4;
+			t4 = a2 - a3;
+			u1 = a0 + c1*t1 + c2*t2;
+			u2 = a0 + c2*t1 + c1*t2;
+			v1 = KERNEL(rot90)(s1*t3 + s2*t4, sign);
+			v2 = KERNEL(rot90)(s2*t3 - s1*t4, sign);
+			*(y + q + s*(5*j)) = a0 + t1 + t2;
+			*(y + q + s*(5*j + 1)) = MUL(u1 + v1, w1);
+			*(y + q + s*(5*j + 2)) = MUL(u2 + v2, w2);
+			*(y + q + s*(5*j + 3)) = MUL(u2 - v2, w3);
+			*(y + q + s*(5*j + 4)) = MUL(u1 - v1, w4);
+		}
+	}
+}
+
+/* Any other radix: the butterfly is a direct length p DFT, so
+	 this stage costs O(p) per point rather than O(1).  Inputs r and
+	 p-r are paired up, since their roots are complex conjugates,
+	 which leaves real cosine and sine sums and halves the work.
+	 The p-th roots of unity are every (n/p)-th entry of the table.
+	 */
+static void KERNEL(radixg)(int p, int m, int s, int sign, CPLX *x, CPLX *y,
+													 CPLX *table, int ns, int j0, int j1, int q0, int q1) {
+	int j, q, r, t;
+	// index of the root for the product r*t, reduced mod p
+	int k;
+	// number of conjugate pairs
+	int h = (p - 1) / 2;
+	// cos and sign*sin of 2 pi k / p
+	REAL c[FFT_MAX_RADIX], sn[FFT_MAX_RADIX];
+	// sums and differences of paired inputs, and the butterfly outputs
+	CPLX a0, sum[FFT_MAX_RADIX], diff[FFT_MAX_RADIX], b[FFT_MAX_RADIX];
+	CPLX re, im;
+
+	for (k = 0; k < p; k++) {
+		c[k] = RE(KERNEL(root)(table, k * ns * m, sign));
+		sn[k] = IM(KERNEL(root)(table, k * ns * m, sign));
+	}
+
+	for (j = j0; j < j1; j++) {
+		for (q = q0; q < q1; q++) {
+			a0 = *(x + q + s*j);
+			*b = a0;
+			for (r = 1; r <= h; r++) {
+				sum[r] = *(x + q + s*(j + r*m)) + *(x + q + s*(j + (p-r)*m));
+				diff[r] = *(x + q + s*(j + r*m)) - *(x + q + s*(j + (p-r)*m));
+				*b += sum[r];
+			}
+			for (t = 1; t <= h; t++) {
+				re = a0;
+				im = 0;
+				k = 0;
+				for (r = 1; r <= h; r++) {
+					k += t;
+					if (k >= p) {
+						k -= p;
+					}
+					re += c[k] * sum[r];
+					im += sn[k] * diff[r];
+				}
+				// im already carries the sign, so only rotate by +i
+				b[t] = re + MAKE(-IM(im), RE(im));
+				b[p-t] = re - MAKE(-IM(im), RE(im));
+			}
+			*(y + q + s*(p*j)) = *b;
+			for (t = 1; t < p; t++) {
+				*(y + q + s*(p*j + t)) = MUL(b[t], KERNEL(root)(table, j*t*ns, sign));
+			}
+		}
+	}
+}
+
+// The unrolled codelets for the larger radices, written by
+// gen_codelets.c with the same macros
+#include "fft_codelets.h"
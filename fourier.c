@@ -16,6 +16,11 @@ a function with itself is found, and then the Fourier
 transform of it is found.  By the convolution theorem,
 this is compared to the square of the fourier transform
 of the original function.
+
+Any number of modes can be run at once.  They share the plan,
+and each thread running them has its own context: its data arrays,
+and how it writes its results.  The transforms use nothing else, so
+they work the same in any other programme that makes its own.
 */
 
 
@@ -24,125 +29,1310 @@ of the original function.
 // C s native support for complex numbers is ideal
 #include <complex.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h> 
 #include "header.h"
 
 /* Global variable definitions */
-// Execution mode number
-int mode;
-// Defines f(x)
-double complex *real_space;
-// Holds fourier transform, F(u)
-double complex *freq_space;
-// Holds convulution of two functions
-double complex *convolved;
+// Execution modes to run, in order
+int *modes;
+int nmodes;
+// A context per thread running modes
+dft_context *contexts;
+int ncontexts;
+// The mapping their data arrays are cut from
+arena *buffer_arena;
+// Transform size and FFT plan
+dft_plan *plan;
+// The -input file
+char *input_file;
+// f(x) mapped from it for LOAD_MODE
+double complex *input_space;
+datafile_header input_header;
+// The signal for STFT_MODE, and how to transform it
+int stft_raw;
+int stft_hop;
+int stft_window;
+// The apertures for SWEEP_MODE
+sweep_range sweep;
+
+/* The aperture each of modes 0 to 8 builds: one slit as
+	 construct_slit() builds it, or two as construct_double_slit(),
+	 with its width, height and centre */
+static const struct {
+	int slits;
+	int width;
+	double height;
+	int centre;
+} apertures[STFT_MODE] = {
+	{1, 10, 1.0, 0}, {1, 10, 1.0, -10}, {1, 20, 1.0, 0}, {1, 20, 0.5, 0},
+	{2, 20, 1.0, 15}, {2, 20, 1.0, 25}, {2, 40, 1.0, 25}, {2, 40, 0.5, 25},
+	{1, 20, 1.0, 0}
+};
 
+// The benchmarks (bench.c) bring their own main()
+#ifndef DFT_NO_MAIN
 int main(int argc, char *argv[]) {
 
 	set_params(argc, argv);
 
-	/* Set f(x) according to the execution mode */
-	switch (mode) {
-		case 0:
-			construct_slit(real_space, 10, 1.0, 0);	
-			break;
-		case 1:
-			construct_slit(real_space, 10, 1.0, -10);
-			break;
-		case 2:
-			construct_slit(real_space, 20, 1.0, 0);
-			break;
-		case 3:
-			construct_slit(real_space, 20, 0.5, 0);
-			break;
-		case 4:
-			construct_double_slit(real_space, 20, 1.0, 15);
-			break;
-		case 5:
-			construct_double_slit(real_space, 20, 1.0, 25);
-			break;
-		case 6:
-			construct_double_slit(real_space, 40, 1.0, 25);
-			break;
-		case 7:
-			construct_double_slit(real_space, 40, 0.5, 25);
-			break;
+	/* Run the modes.  One mode on its own gets every thread for its
+		 transforms.  A list of them is shared out a mode per thread,
+		 each working in its own buffers, and the transforms inside a
+		 mode then run on that thread alone. */
+	parallel_for(nmodes, 1, modes_body, NULL);
+
+	printf("Successfully executed!\n");
+	_exit(0);
+}
+#endif
+
+/* Write the plot for count points of array, the gnuplot script or
+	 with -render the images, or quit with an error message */
+static void output_plot(dft_context *ctx, double complex *array, int count, char name[]) {
+	int status;
+
+	if (ctx->render != RENDER_NONE) {
+		status = plot_image(ctx, array, count, name);
+	} else {
+		status = plot(ctx, name);
+	}
+	if (status != 0) {
+		printf("Unable to open file for plotting\n");
+		_exit(3);
+	}
+}
+
+/* Write out array as the data file name, with the plot for it,
+	 or quit with an error message */
+static void output(dft_context *ctx, double complex *array, char name[]) {
+	if (write_datafile(ctx, array, name) != 0) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+	output_plot(ctx, array, 2*ctx->plan->N, name);
+}
+
+/* Find and write out the FT for the context's execution mode, and
+	 the convolution in mode 8, with the plots for them.
+
+	 *ctx: context to work in, with the mode to run
+	 */
+void run_mode(dft_context *ctx) {
+	// index variable
+	int i;
+	// the context's data arrays
+	dft_buffers *work = &ctx->work;
+	// f(x): built in the buffers, or mapped from the -input file
+	double complex *input = work->real_space;
+
+	/* The spectrogram reads its own input, a batch at a time */
+	if (ctx->mode == STFT_MODE) {
+		spectrogram(ctx);
+		return;
+	}
+
+	/* The sweep builds its own apertures, a batch at a time */
+	if (ctx->mode == SWEEP_MODE) {
+		run_sweep(ctx);
+		return;
+	}
+
+	/* Set f(x) according to the execution mode.  set_params() has
+		 checked that it fits. */
+	if (ctx->mode < STFT_MODE) {
+		if (apertures[ctx->mode].slits == 1) {
+			construct_slit(ctx, work->real_space, apertures[ctx->mode].width,
+										 apertures[ctx->mode].height, apertures[ctx->mode].centre);
+		} else {
+			construct_double_slit(ctx, work->real_space, apertures[ctx->mode].width,
+														apertures[ctx->mode].height, apertures[ctx->mode].centre);
+		}
+	}
+	switch (ctx->mode) {
 		case 8:
 			/* This mode finds the convolution of a single 
 				 slit with itself, FTs and plots it, before 
 				 proceeding as normal. */
-			construct_slit(real_space, 20, 1.0, 0);
-			convolve(convolved, real_space, real_space);
-			write_datafile(convolved, "conv");
-			plot("conv");
-			dft(convolved, freq_space);
-			write_datafile(freq_space, "convfreq");
-			plot("convfreq");
+			if (convolve(ctx, work->convolved, work->real_space, work->real_space) != 0) {
+				printf("Unable to allocate memory for data array(s)");
+				_exit(1);
+			}
+			output(ctx, work->convolved, "conv");
+			dft(ctx, work->convolved, work->freq_space);
+			output(ctx, work->freq_space, "convfreq");
+			break;
+		case LOAD_MODE:
+			// Transformed where it is mapped, without a copy
+			input = input_space;
 			break;
 	}	
 
-	dft(real_space, freq_space);
-	// If in convolution mode, square the FT.
-	if (mode == 8) {
-		multiply(freq_space, freq_space, freq_space);
+	if (ctx->band_count > 0) {
+		// Only the requested band of frequencies
+		if (dft_band(ctx, input, work->band, ctx->band_start, ctx->band_step, ctx->band_count) != 0) {
+			printf("Unable to allocate memory for data array(s)");
+			_exit(1);
+		}
+		// If in convolution mode, square the FT.
+		if (ctx->mode == 8) {
+			for (i = 0; i < ctx->band_count; i++) {
+				*(work->band + i) = cmul(*(work->band + i), *(work->band + i));
+			}
+		}
+
+		if (write_banddata(ctx, work->band, "band") != 0) {
+			printf("Unable to open file to write data\n");
+			_exit(4);
+		}
+		output_plot(ctx, work->band, ctx->band_count, "band");
+	} else {
+		dft(ctx, input, work->freq_space);
+		// If in convolution mode, square the FT.
+		if (ctx->mode == 8) {
+			multiply(ctx, work->freq_space, work->freq_space, work->freq_space);
+		}
+
+		output(ctx, work->freq_space, "freq");
 	}
+}
 
-	write_datafile(freq_space, "freq");
-	plot("freq");
+/* Stream the signal in the -input file through the short-time
+	 Fourier transform, a frame of 2N samples every hop, and write out
+	 its spectrogram with the plot for it.  Memory use depends on the
+	 frame and not on the length of the signal.
 
-	printf("Successfully executed!\n");
-	_exit(0);
+	 *ctx: context to work in, with the mode to run
+	 */
+void spectrogram(dft_context *ctx) {
+	// the input and output files, and the header of each
+	FILE *in, *out;
+	datafile_header in_header, out_header;
+	// the transform, and the frames it gives a batch at a time
+	stft_stream *stream;
+	double complex *frames;
+	// frames to a batch, samples wanted and read, frames found
+	int batch, wanted, got, count;
+	// where the samples go, and doubles per sample
+	double *samples;
+	int width = stft_raw ? 1 : 2;
+	// precision of the samples
+	int precision = stft_raw;
+	// set once a write has failed
+	int failed = 0;
+	const int N = ctx->plan->N;
+
+	/* Raw files are real samples and nothing else.  Data files give
+		 their precision in the header; they are read in order, so the
+		 real and imaginary parts must be interleaved. */
+	if (stft_raw) {
+		in = fopen(input_file, "rb");
+	} else if ((in = datafile_open(input_file, &in_header)) != NULL) {
+		precision = in_header.precision;
+		if (in_header.layout != LAYOUT_INTERLEAVED) {
+			fclose(in);
+			in = NULL;
+		}
+	}
+	if (in == NULL) {
+		printf("Unable to read input file\n");
+		_exit(5);
+	}
+
+	// Enough frames to a batch to keep every thread busy and to make
+	// each read and write a long one
+	batch = STFT_BATCH_POINTS / (2*N) + 1;
+	batch = (batch + threads_count() - 1) / threads_count() * threads_count();
+	if ( (stream = stft_stream_create(2*N, stft_hop, stft_window, stft_raw != 0, batch)) == NULL
+		|| (frames = malloc((size_t)batch * stream->bins * sizeof(double complex))) == NULL ) {
+		printf("Unable to allocate memory for data array(s)");
+		stft_stream_destroy(stream);
+		fclose(in);
+		_exit(1);
+	}
+	if ((out = open_spectrogram(ctx, &out_header, stream)) == NULL) {
+		printf("Unable to open file to write data\n");
+		stft_stream_destroy(stream);
+		free(frames);
+		fclose(in);
+		_exit(4);
+	}
+
+	// Read straight into the stream until the file runs out
+	do {
+		samples = stft_stream_buffer(stream, &wanted);
+		got = datafile_read_values(in, precision, samples, (size_t)wanted * width) / width;
+		if ((count = stft_stream_process(stream, got, frames)) > 0) {
+			failed = (write_spectrogram(ctx, out, &out_header, frames, count) != 0);
+		}
+	} while (got == wanted && !failed);
+	while (!failed && (count = stft_stream_flush(stream, frames)) > 0) {
+		failed = (write_spectrogram(ctx, out, &out_header, frames, count) != 0);
+	}
+
+	fclose(in);
+	free(frames);
+	stft_stream_destroy(stream);
+	if (close_spectrogram(ctx, out, &out_header) != 0 || failed) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+	if (plot_spectrogram(ctx, &out_header) != 0) {
+		printf("Unable to open file for plotting\n");
+		_exit(3);
+	}
+}
+
+/* Transform every aperture of the sweep, a batch at a time shared
+	 out among the threads, and write the results as one file with a
+	 row per aperture, with the plot for it and a list of the
+	 apertures' parameters.
+
+	 *ctx: context to work in, with the mode to run
+	 */
+void run_sweep(dft_context *ctx) {
+	// the output file and its header
+	FILE *out;
+	datafile_header header;
+	// the runs of each aperture of a batch, and their transforms
+	rle_run *runs;
+	int *nruns;
+	double complex *rows;
+	// apertures to a batch, in all, and the first of this batch
+	long long batch, count, first;
+	// index variable, and the parameters of an aperture
+	int i, width, centre;
+	double height;
+	// set once a write has failed
+	int failed = 0;
+	const int N = ctx->plan->N;
+
+	// Enough apertures to a batch to make each write a long one
+	count = sweep_count(&sweep);
+	batch = SWEEP_BATCH_POINTS / (2*N) + 1;
+	if (batch > count) {
+		batch = count;
+	}
+	runs = malloc(batch * SWEEP_MAX_RUNS * sizeof(rle_run));
+	nruns = malloc(batch * sizeof(int));
+	rows = malloc(batch * 2*N * sizeof(double complex));
+	if (runs == NULL || nruns == NULL || rows == NULL) {
+		printf("Unable to allocate memory for data array(s)");
+		free(runs);
+		free(nruns);
+		free(rows);
+		_exit(1);
+	}
+	if (write_sweep_params(ctx, &sweep) != 0 || (out = open_sweep(ctx, &header)) == NULL) {
+		printf("Unable to open file to write data\n");
+		free(runs);
+		free(nruns);
+		free(rows);
+		_exit(4);
+	}
+
+	// Every aperture is a run or two, so its transform is a closed
+	// form; set_params() has checked they all fit
+	for (first = 0; first < count && !failed; first += batch) {
+		if (batch > count - first) {
+			batch = count - first;
+		}
+		for (i = 0; i < batch; i++) {
+			sweep_aperture(&sweep, first + i, &width, &centre, &height);
+			*(nruns + i) = slit_runs(ctx, sweep.slits, width, height, centre, runs + i*SWEEP_MAX_RUNS);
+		}
+		dft_rle_batch(ctx, runs, nruns, SWEEP_MAX_RUNS, batch, rows);
+		failed = (write_spectrogram(ctx, out, &header, rows, batch) != 0);
+	}
+
+	free(runs);
+	free(nruns);
+	free(rows);
+	if (close_spectrogram(ctx, out, &header) != 0 || failed) {
+		printf("Unable to open file to write data\n");
+		_exit(4);
+	}
+	if (plot_sweep(ctx, &header) != 0) {
+		printf("Unable to open file for plotting\n");
+		_exit(3);
+	}
+}
+
+/* Run modes first to last-1 of the list, one after another, in the
+	 context belonging to this chunk.  A parallel_for() body.
+	 */
+void modes_body(void *arg, int chunk, int first, int last) {
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		(contexts + chunk)->mode = *(modes + i);
+		run_mode(contexts + chunk);
+	}
+}
+
+/* Build the plan for transforms of 2N points.
+
+	 N: x and u run from -N to N-1
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to work on the real
+	 				 and imaginary parts in separate arrays with SIMD kernels
+
+	 Returns NULL if memory could not be allocated, or if N is over
+	 INT_MAX/4.
+	 */
+dft_plan *dft_plan_create(int N, int layout) {
+	// plan under construction
+	dft_plan *plan;
+
+	// The table of half-turn roots has 4N entries, counted in an int
+	if (N > INT_MAX / 4 || (plan = malloc(sizeof(dft_plan))) == NULL) {
+		return NULL;
+	}
+	plan->N = N;
+	plan->rfft = NULL;
+	plan->dct = NULL;
+	plan->half_roots = NULL;
+	plan->layout = layout;
+	plan->sparse_limit = SPARSE_LIMIT;
+	if ((plan->fft = fft_plan_create(2*N, 1)) == NULL
+		|| (plan->rfft = fft_real_plan_create(2*N, 1)) == NULL
+		|| (N%2 == 0 && (plan->dct = fft_real_plan_create(N, 1)) == NULL)
+		|| (plan->half_roots = twiddle_acquire(4*N)) == NULL) {
+		dft_plan_destroy(plan);
+		return NULL;
+	}
+	return plan;
+}
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void dft_plan_destroy(dft_plan *plan) {
+	if (plan == NULL) {
+		return;
+	}
+	fft_plan_destroy(plan->fft);
+	fft_real_plan_destroy(plan->rfft);
+	fft_real_plan_destroy(plan->dct);
+	twiddle_release(plan->half_roots);
+	free(plan);
+}
+
+/* Fill in a context on a plan with the defaults: mode 0, double
+	 precision throughout, no band and no data arrays yet.
+
+	 *ctx: the context
+	 *plan: plan it works to
+	 */
+void dft_context_init(dft_context *ctx, dft_plan *plan) {
+	memset(ctx, 0, sizeof(dft_context));
+	ctx->plan = plan;
+	ctx->output_precision = DATAFILE_FLOAT64;
+	ctx->precision = DATAFILE_FLOAT64;
+}
+
+/* Take a buffer from the arena, or before there is one, only count
+	 the bytes it will need.
+
+	 *a: the arena, or NULL to count
+	 bytes: size of the buffer
+	 *total: bytes taken so far, added to
+
+	 Returns the buffer, or NULL when counting.
+	 */
+static void *take(arena *a, size_t bytes, size_t *total) {
+	*total += arena_round(bytes);
+	return (a == NULL) ? NULL : arena_alloc(a, bytes);
+}
+
+/* Cut a context's data arrays and scratch space from an arena, or
+	 with no arena only count the bytes they need, so that one arena
+	 can be sized to hold several contexts.  band_count must be set
+	 first.
+
+	 *ctx: context from dft_context_init()
+	 *a: the arena, or NULL to count
+	 shared: nonzero if other contexts on the same plan may run at
+	 				 the same time.  It then gets FFT scratch space of its
+	 				 own, and its FFTs run on the calling thread alone.
+
+	 Returns the bytes the arrays take up.
+	 */
+size_t dft_context_alloc(dft_context *ctx, arena *a, int shared) {
+	// the arrays
+	dft_buffers *work = &ctx->work;
+	// bytes taken
+	size_t total = 0;
+	const int N = ctx->plan->N;
+
+	work->real_space = take(a, 2*(size_t)N * sizeof(double complex), &total);
+	work->freq_space = take(a, 2*(size_t)N * sizeof(double complex), &total);
+	work->convolved = take(a, 2*(size_t)N * sizeof(double complex), &total);
+	if (ctx->band_count > 0) {
+		work->band = take(a, ctx->band_count * sizeof(double complex), &total);
+	}
+	if (shared) {
+		work->fft_work = take(a, fft_work_size(ctx->plan->fft) * sizeof(double complex), &total);
+	}
+	if (ctx->plan->layout == LAYOUT_SPLIT) {
+		work->split = take(a, 4*(size_t)N * sizeof(double), &total);
+	}
+	return total;
+}
+
+/* Create a context on a plan, with its data arrays in an arena of
+	 its own.  The defaults are those of dft_context_init().  The
+	 threads must already have been started by threads_init().
+
+	 *plan: plan it works to, which must outlive the context
+	 band_count: room for this many points of dft_band(), or 0
+	 shared: as for dft_context_alloc()
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_context *dft_context_create(dft_plan *plan, int band_count, int shared, int pages) {
+	// context under construction
+	dft_context *ctx;
+
+	if ((ctx = malloc(sizeof(dft_context))) == NULL) {
+		return NULL;
+	}
+	dft_context_init(ctx, plan);
+	ctx->band_count = band_count;
+	if ((ctx->space = arena_create(dft_context_alloc(ctx, NULL, shared), pages)) == NULL) {
+		free(ctx);
+		return NULL;
+	}
+	dft_context_alloc(ctx, ctx->space, shared);
+	return ctx;
+}
+
+/* Free a context from dft_context_create() and its arena, but not
+	 its plan.  NULL is ignored.
+
+	 *ctx: context to be freed
+	 */
+void dft_context_destroy(dft_context *ctx) {
+	if (ctx == NULL) {
+		return;
+	}
+	arena_destroy(ctx->space);
+	free(ctx);
+}
+
+/* Arguments for the loops below, which parallel_for() shares out
+	 among the threads a range of array indices at a time. */
+struct loop_args {
+	// the plan the loop works to
+	dft_plan *plan;
+	double complex *input;
+	double complex *output;
+	// second input of multiply()
+	double complex *input2;
+	// for sign_body()
+	int parity;
+	double scale;
+	// for rle_body(), and for rle_batch_body() the runs of each f(x)
+	// and how many f(x) there are
+	rle_run *runs;
+	int nruns;
+	double complex total;
+	int *batch_nruns;
+	int max_runs;
+	int count;
+	// for goertzel_body()
+	double start;
+	double step;
+	// for split_in_body() and split_out_body(): the split buffer,
+	// and factors for even and odd array indices.  real_in_body()
+	// and real_out_body() use the split buffer alone.
+	double *split;
+	double even;
+	double odd;
+};
+
+/* input to the split buffer, times even or odd */
+static void split_in_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+
+	split_from_interleaved(args->input, args->split, args->split + 2*args->plan->N,
+												 first, last, args->even, args->odd);
+}
+
+/* The split buffer to output, times even or odd */
+static void split_out_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+
+	split_to_interleaved(args->split, args->split + 2*args->plan->N, args->output,
+											 first, last, args->even, args->odd);
+}
+
+/* output = input times scale, negated at odd i+parity */
+static void sign_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->output + i) = ((i + args->parity)%2 ? -args->scale : args->scale)
+													* *(args->input + i);
+	}
+}
+
+/* output[-i] = conj(input[i]), to fill in one half of a Hermitian
+	 F(u) from the other */
+static void reflect_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->output - i) = conj(*(args->input + i));
+	}
+}
+
+/* The real parts of input to the split buffer, packed together */
+static void real_in_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->split + i) = creal(*(args->input + i));
+	}
+}
+
+/* output = the split buffer times scale, as real values */
+static void real_out_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->output + i) = args->scale * *(args->split + i);
+	}
+}
+
+/* The DFT formula summed directly over the nonzero points of f(x),
+	 for u at array indices first to last-1 */
+static void direct_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables
+	int i, j;
+	// index into the table of roots of unity
+	int k;
+	// normalised value of f(x)
+	double complex value;
+	const int N = args->plan->N;
+
+	memset(args->output + first, 0, (last - first)*sizeof(double complex));
+
+	/* We loop through all values of the function, and for
+		 each nonzero one add its contribution f(x)*exp(...)
+		 to every point of the FT.  exp(i pi x u / N) is entry
+		 x*u mod 2N of the shared table of roots of unity. */
+	for (j = -N; j < N; j++) {
+		// There is no point in doing the summation if f(x)
+		// is 0.
+		if (*(args->input + indexof(j)) != 0) {
+			// Fold the normalisation into f(x) once
+			value = *(args->input + indexof(j)) / (2.0*((double)N));
+			// Index of exp(i pi j i / N) for the first i.  Each step in
+			// i then moves it on by j, wrapping round mod 2N.
+			k = (((long long)j * (first - N)) % (2*N) + 2*N) % (2*N);
+			for (i = first - N; i < last - N; i++) {
+				// Implement DFT formula
+				*(args->output + indexof(i)) += cmul(value, *(args->plan->fft->table + k));
+				k += j;
+				if (k >= 2*N) {
+					k -= 2*N;
+				} else if (k < 0) {
+					k += 2*N;
+				}
+			}
+		}
+	}
+}
+
+/* Returns 1 if f(x) is real, and 0 if not */
+static int is_real(dft_plan *plan, double complex *input) {
+	// index variable
+	int j;
+	const int N = plan->N;
+
+	for (j = 0; j < 2*N; j++) {
+		if (cimag(*(input + j)) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Returns 1 if f(-x) = f(x) for x = -N+1 to N-1, and 0 if not */
+static int is_even(dft_plan *plan, double complex *input) {
+	// index variable
+	int x;
+	const int N = plan->N;
+
+	for (x = 1; x < N; x++) {
+		if (*(input + indexof(x)) != *(input + indexof(-x))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* dft() for real f(x).  F(u) = (-1)^u/2N X[u mod 2N], where X is
+	 the plain transform of the array, and X[2N-u] = conj(X[u]), so
+	 only X[0] to X[N] are needed.  They are found from a real
+	 transform into the bottom half of output, scaled into the top
+	 half, and then reflected back into the bottom half.
+	 */
+static void dft_real(dft_context *ctx, double complex *input, double complex *output) {
+	// X[N], which the scaling overwrites
+	double complex last;
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	dft_plan *plan = ctx->plan;
+	dft_buffers *work = &ctx->work;
+	const int N = plan->N;
+
+	if (work->fft_work == NULL) {
+		fft_execute_r2c(plan->rfft, (double *)input, 2, output);
+	} else {
+		fft_execute_r2c_work(plan->rfft, (double *)input, 2, output, work->fft_work);
+	}
+	last = *(output + N);
+
+	args.input = output;
+	args.output = output + N;
+	args.parity = 0;
+	args.scale = 1.0 / (2.0*((double)N));
+	parallel_for(N, PARALLEL_GRAIN, sign_body, &args);
+
+	// F(-u) = conj(F(u)) for u = 1 to N-1
+	args.input = output + N + 1;
+	args.output = output + N - 1;
+	parallel_for(N - 1, PARALLEL_GRAIN, reflect_body, &args);
+	*output = ((N%2) ? -args.scale : args.scale) * last;
+}
+
+/* dft() for real f(x) with f(-x) = f(x), and N even.  Then
+	 F(u) = 1/N (f(0)/2 + (-1)^u f(-N)/2 + sum_{x=1}^{N-1} f(x) cos(pi x u/N))
+	 is real and even, the cosine transform of f(0) to f(N) with
+	 f(N) = f(-N).  That is done on the real values packed into the
+	 bottom of output, with the points after them as scratch, then scaled
+	 into the top half and reflected back into the bottom half.
+	 */
+static void dft_even(dft_context *ctx, double complex *input, double complex *output) {
+	// f(0) to f(N), then F(0) to F(N)
+	double *data = (double *)output;
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	dft_plan *plan = ctx->plan;
+	dft_buffers *work = &ctx->work;
+	const int N = plan->N;
+
+	args.input = input + N;
+	args.split = data;
+	parallel_for(N, PARALLEL_GRAIN, real_in_body, &args);
+	*(data + N) = creal(*input);
+
+	if (work->fft_work == NULL) {
+		fft_execute_dct1(plan->dct, data, output + N/2 + 1);
+	} else {
+		fft_execute_dct1_work(plan->dct, data, output + N/2 + 1, work->fft_work);
+	}
+
+	args.output = output + N;
+	args.scale = 1.0 / ((double)N);
+	parallel_for(N, PARALLEL_GRAIN, real_out_body, &args);
+
+	// F(-u) = F(u) for u = 1 to N-1.  F(N) is still in data, which
+	// the reflection overwrites, so F(-N) goes in first.
+	*output = args.scale * *(data + N);
+	args.input = output + N + 1;
+	args.output = output + N - 1;
+	parallel_for(N - 1, PARALLEL_GRAIN, reflect_body, &args);
 }
 
 /* This function finds the FT of the discrete function
 	 defined in the input array, and stores it in the output
 	 array. 
 	 
+	 *ctx: context whose plan and scratch space it works with
 	 *input: pointer to the start of the array containing the 
 	 				 function to be transformed.
 	 *output: pointer to the start of the array where the FT
 	 					will be stored.
 	 */
-void dft(double complex *input, double complex *output) {
+void dft(dft_context *ctx, double complex *input, double complex *output) {
+	// index variable
+	int j;
+	// number of nonzero points in f(x), and of constant runs
+	int nonzero = 0, nruns = 0;
+	// whether f(x) is real, and whether it is also even
+	int real, even;
+	// f(x) as constant runs, if it has few enough to be worth it
+	rle_run runs[SPARSE_LIMIT];
+	// arguments for the loops shared out among the threads
+	struct loop_args args;
+	dft_plan *plan = ctx->plan;
+	dft_buffers *work = &ctx->work;
+	const int N = plan->N;
+
+	args.plan = plan;
+	for (j = 0; j < 2*N; j++) {
+		if (*(input + j) != 0) {
+			nonzero++;
+			// A new run starts wherever the value changes
+			if (j == 0 || *(input + j) != *(input + j - 1)) {
+				nruns++;
+			}
+		}
+	}
+
+	/* If f(x) is a few constant runs, such as a slit, then it is
+		 cheapest to add up the closed form for each run. */
+	if (RUN_COST*nruns < nonzero && RUN_COST*nruns < SPARSE_LIMIT) {
+		dft_rle(ctx, runs, rle_encode(ctx, input, runs, SPARSE_LIMIT), output);
+		return;
+	}
+
+	/* If f(x) is almost entirely 0 then it is cheaper to sum
+		 the DFT formula directly over the nonzero points.  Each
+		 thread does its own range of u. */
+	if (nonzero < plan->sparse_limit) {
+		args.input = input;
+		args.output = output;
+		parallel_for(2*N, PARALLEL_GRAIN, direct_body, &args);
+		return;
+	}
+
+	/* A real f(x) has a Hermitian F(u), so half the work can be
+		 saved, and a real, even one a real and even F(u), so half as
+		 much again.  These do not need the layout. */
+	real = is_real(plan, input);
+	even = real && is_even(plan, input);
+	if (real && even && plan->dct != NULL) {
+		dft_even(ctx, input, output);
+		return;
+	}
+	if (real) {
+		dft_real(ctx, input, output);
+		return;
+	}
+
+	/* Otherwise use the FFT.  It works with indices 0 to 2N-1
+		 rather than -N to N-1.  Shifting both x and u by N gives
+		 exp(i pi x u/N) = exp(2 pi i (x+N)(u+N)/2N) * (-1)^(x+N) * (-1)^(u+N) * (-1)^N
+		 so f(x) is multiplied by (-1)^(x+N) on the way in, and
+		 F(u) by (-1)^(u+2N) along with the normalisation on the way out. */
+	if (plan->layout == LAYOUT_SPLIT) {
+		// The factors go into the conversions to and from split form
+		args.input = input;
+		args.output = output;
+		args.split = work->split;
+		args.even = 1.0;
+		args.odd = -1.0;
+		parallel_for(2*N, PARALLEL_GRAIN, split_in_body, &args);
+
+		if (work->fft_work == NULL) {
+			fft_execute_split(plan->fft, work->split, work->split + 2*N);
+		} else {
+			fft_execute_split_work(plan->fft, work->split, work->split + 2*N,
+														 (double *)work->fft_work);
+		}
+
+		args.even = ((N%2) ? -1.0 : 1.0) / (2.0*((double)N));
+		args.odd = -args.even;
+		parallel_for(2*N, PARALLEL_GRAIN, split_out_body, &args);
+		return;
+	}
+
+	args.input = input;
+	args.output = output;
+	args.parity = 0;
+	args.scale = 1.0;
+	parallel_for(2*N, PARALLEL_GRAIN, sign_body, &args);
+
+	// Without scratch space of its own, the FFT uses the plan's and
+	// is shared out among the threads
+	if (work->fft_work == NULL) {
+		fft_execute(plan->fft, output, output);
+	} else {
+		fft_execute_work(plan->fft, output, output, work->fft_work);
+	}
+
+	args.input = output;
+	args.parity = N;
+	args.scale = 1.0 / (2.0*((double)N));
+	parallel_for(2*N, PARALLEL_GRAIN, sign_body, &args);
+}
+
+/* dft() on a context's real_space, for time_call() */
+static void dft_call(void *arg) {
+	dft_context *ctx = arg;
+
+	dft(ctx, ctx->work.real_space, ctx->work.freq_space);
+}
+
+/* Time dft() on a few nonzero samples of f(x), summed directly, and
+	 on a full f(x) through the FFT, to find how many nonzero samples
+	 the direct sum is worth it for on this machine.  It works in the
+	 context's arrays, so call it before they hold anything.
+
+	 *ctx: context whose plan and arrays it works with
+
+	 Returns the number of nonzero samples at which the FFT
+	 becomes as quick, for the plan's sparse_limit.
+	 */
+int dft_measure_sparse(dft_context *ctx) {
+	// index variable, and the samples the direct sum is timed on
+	int j, trial;
+	// time of the FFT, and of the direct sum per nonzero sample
+	double fft_seconds = -1.0, point_seconds = -1.0, seconds;
+	// index variable, the limit found and the one to put back
+	int round, limit, saved;
+	dft_plan *plan = ctx->plan;
+	double complex *input = ctx->work.real_space;
+	const int N = plan->N;
+
+	// No two neighbours equal, so no runs, and complex, so neither
+	// the real nor the even transform
+	trial = (2*N < SPARSE_TRIAL) ? 2*N : SPARSE_TRIAL;
+	saved = plan->sparse_limit;
+	for (round = 0; round < TUNE_ROUNDS; round++) {
+		for (j = 0; j < 2*N; j++) {
+			*(input + j) = CMPLX(1.0, 1.0 + j%2);
+		}
+		plan->sparse_limit = 0;
+		seconds = time_call(dft_call, ctx, TUNE_SECONDS);
+		if (fft_seconds < 0.0 || seconds < fft_seconds) {
+			fft_seconds = seconds;
+		}
+
+		for (j = 0; j < 2*N; j++) {
+			*(input + j) = 0.0;
+		}
+		for (j = 0; j < trial; j++) {
+			*(input + j*(2*N / trial)) = CMPLX(1.0, 1.0 + j);
+		}
+		plan->sparse_limit = 2*N + 1;
+		seconds = time_call(dft_call, ctx, TUNE_SECONDS) / trial;
+		if (point_seconds < 0.0 || seconds < point_seconds) {
+			point_seconds = seconds;
+		}
+	}
+	plan->sparse_limit = saved;
+
+	// The direct sum at the limit costs as much as the FFT
+	limit = (int)(fft_seconds / point_seconds) + 1;
+	return (limit > 2*N + 1) ? 2*N + 1 : limit;
+}
+
+/* Break f(x) into runs of constant nonzero value.
+
+	 *ctx: context whose plan gives N
+	 *input: pointer to the start of the array holding f(x)
+	 *runs: pointer to the start of the array where the runs
+	 				are to be stored
+	 max_runs: size of the runs array
+
+	 Returns the number of runs, or -1 if there are more than
+	 max_runs of them.
+	 */
+int rle_encode(dft_context *ctx, double complex *input, rle_run *runs, int max_runs) {
+	// index variable
+	int j;
+	// number of runs found
+	int nruns = 0;
+	const int N = ctx->plan->N;
+
+	for (j = 0; j < 2*N; j++) {
+		if (*(input + j) == 0) {
+			continue;
+		}
+		// Extend the current run, or start a new one
+		if (nruns > 0 && (runs + nruns - 1)->value == *(input + j)
+			&& (runs + nruns - 1)->start + (runs + nruns - 1)->length == j - N) {
+			(runs + nruns - 1)->length++;
+		} else {
+			if (nruns == max_runs) {
+				return -1;
+			}
+			(runs + nruns)->start = j - N;
+			(runs + nruns)->length = 1;
+			(runs + nruns)->value = *(input + j);
+			nruns++;
+		}
+	}
+	return nruns;
+}
+
+/* Add the closed form sum over a run to output, for u at array
+	 indices first to last-1.  It is still to be divided by
+	 2N sin(pi u / 2N). */
+static void sum_run(dft_plan *plan, rle_run *run, int first, int last, double complex *output) {
+	// index variable
+	int u;
+	// indices into the table of 4N roots for the centre phase and
+	// for sin(pi u L / 2N), and how far each moves as u goes up by 1
+	int k_c, k_w, step_c, step_w;
+	// the table of 4N roots
+	double complex *roots = plan->half_roots;
+	const int N = plan->N;
+
+	/* Over x = a ... a+L-1 the sum of exp(i pi x u / N) is
+		 exp(i pi u (2a+L-1) / 2N) sin(pi u L / 2N) / sin(pi u / 2N).
+		 Both angles are multiples of pi/2N, so they come from the
+		 table of 4N roots.  The denominator is the same for every
+		 run and is divided out at the end. */
+	step_c = ((2*run->start + run->length - 1) % (4*N) + 4*N) % (4*N);
+	step_w = run->length % (4*N);
+	k_c = (((long long)(first - N) * step_c) % (4*N) + 4*N) % (4*N);
+	k_w = (((long long)(first - N) * step_w) % (4*N) + 4*N) % (4*N);
+	for (u = first - N; u < last - N; u++) {
+		*(output + indexof(u)) += cmul(run->value, *(roots + k_c)) * cimag(*(roots + k_w));
+		if ((k_c += step_c) >= 4*N) {
+			k_c -= 4*N;
+		}
+		if ((k_w += step_w) >= 4*N) {
+			k_w -= 4*N;
+		}
+	}
+}
+
+/* The closed form sums over runs, for u at array indices first
+	 to last-1 */
+static void rle_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
 	// index variables
-	int i, j;
+	int u, r;
+	// the table of 4N roots
+	double complex *roots = args->plan->half_roots;
+	const int N = args->plan->N;
 
-	memset(output, 0, 2*N*sizeof(double complex));
+	memset(args->output + first, 0, (last - first)*sizeof(double complex));
+	for (r = 0; r < args->nruns; r++) {
+		sum_run(args->plan, args->runs + r, first, last, args->output);
+	}
 
-	/* We loop through all points of the FT, and then
-		 sum over the values of the function*exp(...) */
-	for (j = -N; j < N; j++) {
-		// There is no point in doing the summation if f(x)
-		// is 0.  Since f(x) is often largely 0, this offers
-		// huge performance improvements, allowing for much
-		// higher resolution in our plots.
-		if (*(input + indexof(j)) != 0) {
-			for (i = -N; i < N; i++) {
-				// Implement DFT formula
-				*(output + indexof(i)) += (*(input + indexof(j))
-														* cexp(M_PI * I * ((double)j) * ((double)i) 
-														/ (((double)N)))) / (2.0*((double)N));
+	for (u = first - N; u < last - N; u++) {
+		if (u == 0) {
+			*(args->output + indexof(u)) = args->total / (2.0*((double)N));
+		} else {
+			*(args->output + indexof(u)) /= 2.0*((double)N)
+																			* cimag(*(roots + (u + 4*N) % (4*N)));
+		}
+	}
+}
+
+/* The closed form sums over runs for a batch of f(x), for u at
+	 array indices first to last-1, a block of u at a time */
+static void rle_batch_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variables, and the block of u
+	int u, r, i, block, end;
+	// 2N sin(pi u / 2N) for the block
+	double denominator[SWEEP_BLOCK];
+	// the sum of f(x), for u = 0
+	double complex total;
+	// the runs of this f(x), and its row of the output
+	rle_run *runs;
+	double complex *row;
+	// the table of 4N roots
+	double complex *roots = args->plan->half_roots;
+	const int N = args->plan->N;
+
+	for (block = first; block < last; block = end) {
+		end = (block + SWEEP_BLOCK < last) ? block + SWEEP_BLOCK : last;
+		for (u = block - N; u < end - N; u++) {
+			*(denominator + u - block + N) = 2.0*((double)N) * cimag(*(roots + (u + 4*N) % (4*N)));
+		}
+
+		for (i = 0; i < args->count; i++) {
+			runs = args->runs + i*args->max_runs;
+			row = args->output + (size_t)i * 2*N;
+			memset(row + block, 0, (end - block)*sizeof(double complex));
+			total = 0;
+			for (r = 0; r < *(args->batch_nruns + i); r++) {
+				sum_run(args->plan, runs + r, block, end, row);
+				total += (runs + r)->value * (double)(runs + r)->length;
+			}
+			for (u = block - N; u < end - N; u++) {
+				if (u == 0) {
+					*(row + indexof(u)) = total / (2.0*((double)N));
+				} else {
+					*(row + indexof(u)) /= *(denominator + u - block + N);
+				}
+			}
+		}
+	}
+}
+
+/* Find the FT of f(x) given as constant runs.  The sum of
+	 exp(i pi x u / N) over a run is a geometric series, which sums
+	 to a Dirichlet kernel: a phase for the centre of the run times
+	 sin(pi u L / 2N) / sin(pi u / 2N) for a run of length L.  So each
+	 run costs the same whatever its width.
+
+	 *ctx: context whose plan gives N
+	 *runs: pointer to the start of the array of runs
+	 nruns: number of runs
+	 *output: pointer to the start of the array where the FT
+	 					will be stored.
+	 */
+void dft_rle(dft_context *ctx, rle_run *runs, int nruns, double complex *output) {
+	// index variable
+	int r;
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+	const int N = ctx->plan->N;
+
+	args.plan = ctx->plan;
+	// u = 0 is the plain sum of f(x)
+	args.total = 0;
+	for (r = 0; r < nruns; r++) {
+		args.total += (runs + r)->value * (double)(runs + r)->length;
+	}
+	args.runs = runs;
+	args.nruns = nruns;
+	args.output = output;
+	parallel_for(2*N, PARALLEL_GRAIN, rle_body, &args);
+}
+
+/* Find the FTs of a batch of f(x), each given as constant runs,
+	 as dft_rle() does for one.  The work is shared out among the
+	 threads by frequency, and each block of frequencies is summed
+	 for every f(x) of the batch in turn, so that sin(pi u / 2N),
+	 the same for all of them, is looked up once.
+
+	 *ctx: context whose plan gives N
+	 *runs: pointer to the start of the runs; those of f(x) number i
+	 				start at runs + i*max_runs
+	 *nruns: number of runs of each f(x)
+	 max_runs: room for runs each f(x) has
+	 count: number of f(x)
+	 *output: pointer to the start of the array where the FTs will be
+	 					stored, a row of 2N points each
+	 */
+void dft_rle_batch(dft_context *ctx, rle_run *runs, int *nruns, int max_runs, int count,
+									 double complex *output) {
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+	const int N = ctx->plan->N;
+
+	args.plan = ctx->plan;
+	args.runs = runs;
+	args.batch_nruns = nruns;
+	args.max_runs = max_runs;
+	args.count = count;
+	args.output = output;
+	// Each u costs a pass over the whole batch
+	parallel_for(2*N, PARALLEL_GRAIN / count + 1, rle_batch_body, &args);
+}
+
+/* exp(i pi t).  t is reduced to [-2, 2] in long double first,
+	 so that it can be a large multiple of a fractional frequency.
+	 */
+static double complex half_turns(long double t) {
+	double angle = M_PI * (double)fmodl(t, 2.0L);
+
+	return CMPLX(cos(angle), sin(angle));
+}
+
+/* Goertzel's recurrence for a single frequency u.  The sum of
+	 f(x) exp(i theta x) is run as a second order recurrence with
+	 real coefficient 2 cos(theta), then corrected by one phase.
+
+	 The plain recurrence loses accuracy as the square of its length,
+	 and worst of all for theta near 0 or pi, where the central lobe
+	 is.  So it is run in Reinsch's form, on the differences (or sums)
+	 of successive values with the small coefficient -4 sin^2(theta/2)
+	 (or 4 cos^2(theta/2)), and only over GOERTZEL_BLOCK points at a
+	 time.  Each block's sum is then turned to its place by a phase
+	 reduced exactly, as half_turns() does. */
+static double complex goertzel(dft_plan *plan, double complex *input, double u) {
+	// index variables, and the first array index of the block
+	int j, j0, last;
+	// theta / pi, reduced to [-1, 1], and its sine and cosine
+	double t, sine, cosine;
+	// Reinsch's coefficient, and 1 -/+ exp(-i theta)
+	double lambda;
+	double complex edge;
+	// the recurrence: the last value, and the difference from (or sum
+	// with) the one before
+	double complex s, d;
+	// the sum of the block, and the total
+	double complex block, sum = 0;
+	const int N = plan->N;
+
+	t = (double)fmodl((long double)u / N, 2.0L);
+	if (t > 1.0) {
+		t -= 2.0;
+	} else if (t < -1.0) {
+		t += 2.0;
+	}
+	sine = sin(M_PI * t);
+	cosine = cos(M_PI * t);
+
+	for (j0 = 0; j0 < 2*N; j0 += GOERTZEL_BLOCK) {
+		last = (j0 + GOERTZEL_BLOCK < 2*N) ? j0 + GOERTZEL_BLOCK : 2*N;
+		s = 0;
+		d = 0;
+		// The block is fed in backwards, so that s - exp(-i theta) times
+		// the value before it is the sum of f exp(i theta (j-j0))
+		if (cosine >= 0.0) {
+			lambda = -4.0 * sin(M_PI * t / 2.0) * sin(M_PI * t / 2.0);
+			for (j = last - 1; j >= j0; j--) {
+				d += *(input + j) + lambda*s;
+				s += d;
+			}
+			edge = CMPLX(-lambda / 2.0, sine);
+			block = cmul(edge, s) + cmul(CMPLX(cosine, -sine), d);
+		} else {
+			lambda = 4.0 * cos(M_PI * t / 2.0) * cos(M_PI * t / 2.0);
+			for (j = last - 1; j >= j0; j--) {
+				d = *(input + j) + lambda*s - d;
+				s = d - s;
 			}
+			edge = CMPLX(lambda / 2.0, -sine);
+			block = cmul(edge, s) - cmul(CMPLX(cosine, -sine), d);
 		}
+
+		// The block starts at x = j0 - N
+		sum += cmul(half_turns((long double)u * (j0 - N) / N), block);
+	}
+
+	return sum / (2.0*((double)N));
+}
+
+/* Goertzel's recurrence for frequencies first to last-1 of a band */
+static void goertzel_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int k;
+
+	for (k = first; k < last; k++) {
+		*(args->output + k) = goertzel(args->plan, args->input, args->start + k*args->step);
 	}
 }
 
+/* The chirp-z transform.  With u = start + k*step, writing
+	 m*k = (m^2 + k^2 - (k-m)^2)/2 turns the sum over array indices m
+	 into a convolution with the chirp exp(i pi step j^2 / 2N), which
+	 is done by FFT.
+
+	 Returns 0, or -1 if memory could not be allocated. */
+static int chirp_z(dft_plan *plan, double complex *input, double complex *output, double start,
+									 double step, int count) {
+	// index variable
+	int j;
+	// input times the chirp, and the conjugate chirp
+	double complex *weighted, *chirp = NULL;
+	const int N = plan->N;
+
+	if ((weighted = malloc(2*(size_t)N * sizeof(double complex))) == NULL
+		|| (chirp = malloc((2*(size_t)N + count - 1) * sizeof(double complex))) == NULL) {
+		free(weighted);
+		return -1;
+	}
+
+	// f times exp(i pi start m / N) times the chirp at m
+	for (j = 0; j < 2*N; j++) {
+		*(weighted + j) = cmul(*(input + j),
+			half_turns(((long double)start*j + (long double)step*j*j/2.0L) / N));
+	}
+	// The conjugate chirp from offset -(2N-1) up to count-1
+	for (j = -(2*N-1); j < count; j++) {
+		*(chirp + j + 2*N-1) = half_turns(-(long double)step*j*j / (2.0L*N));
+	}
+
+	if (fast_convolve(weighted, 2*N, chirp, 2*N + count - 1, output, 2*N-1, count,
+										plan->layout) != 0) {
+		free(weighted);
+		free(chirp);
+		return -1;
+	}
+
+	// Apply the chirp at k, shift the origin from m = 0 to x = 0,
+	// which is a factor exp(-i pi u), and normalise.
+	for (j = 0; j < count; j++) {
+		*(output + j) = cmul(*(output + j),
+			half_turns((long double)step*j*j / (2.0L*N) - (start + (long double)step*j)))
+			/ (2.0*((double)N));
+	}
+
+	free(weighted);
+	free(chirp);
+	return 0;
+}
+
+/* Find the FT at count evenly spaced frequencies
+	 u = start, start+step, ... start+(count-1)*step
+	 which need not be integers.  This zooms in on part of F(u) at
+	 any resolution without finding the rest of it.  A few
+	 frequencies are done one at a time by Goertzel's recurrence,
+	 and anything more by the chirp-z transform.
+
+	 *ctx: context whose plan it works with
+	 *input: pointer to the start of the array containing the
+	 				 function to be transformed.
+	 *output: pointer to the start of the array where the count
+	 					points of the FT will be stored.
+	 start: first frequency
+	 step: spacing of the frequencies
+	 count: number of frequencies
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int dft_band(dft_context *ctx, double complex *input, double complex *output,
+						 double start, double step, int count) {
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+
+	if (count >= GOERTZEL_LIMIT) {
+		return chirp_z(ctx->plan, input, output, start, step, count);
+	}
+	args.plan = ctx->plan;
+	args.input = input;
+	args.output = output;
+	args.start = start;
+	args.step = step;
+	parallel_for(count, 1, goertzel_body, &args);
+	return 0;
+}
+
 /* This function populates output with a simulated
 	 single slit light source.
 	 
+	 *ctx: context whose plan gives N
 	 *output: pointer to start of the array where the
 	 					function is to be stored
 	 width: The width of the slit
 	 height: The intensity of the light from the slit
 	 centre: The position of the centre of the slit
+
+	 Returns 0, or -1 if the slit does not fit between x = -N and N-1,
+	 when output is left as it was.
 	 */
-void construct_slit(double complex *output, int width, double height, int centre) {
+int construct_slit(dft_context *ctx, double complex *output, int width, double height, int centre) {
+	// the slit as a run, to check it fits
+	rle_run runs[SWEEP_MAX_RUNS];
 	// index variable
 	int i;
 	// flag - 1 for width odd
 	int width_odd;
 	// Set width_odd.  If odd, take half_width to be floor(width/2)
 	int half_width = (width_odd = width%2) ? (width-1)/2 : width/2;
+	const int N = ctx->plan->N;
+
+	if (slit_runs(ctx, 1, width, height, centre, runs) < 0) {
+		return -1;
+	}
 
 	// Most of the array is 0.  Memset is faster tan looping
 	memset(output, 0, 2*N * sizeof(double complex));
@@ -153,25 +1343,38 @@ void construct_slit(double complex *output, int width, double height, int centre
 	for (i = -half_width; i < half_width + width_odd; i++) {
 		*(output + indexof(centre + i)) = height;
 	}
+	return 0;
 }
 
 /* This function populates output with a simulated
 	 double slit light source.
 	 
+	 *ctx: context whose plan gives N
 	 *output: pointer to start of the array where the
 	 					function is to be stored
 	 width: The width of the slits
 	 height: The intensity of the light from the slits
 	 centre_distance: The distance of the centres of 
 	 									the slits from x=0
+
+	 Returns 0, or -1 if the slits do not fit between x = -N and N-1,
+	 when output is left as it was.
 	 */
-void construct_double_slit(double complex *output, int width, double height, int centre_distance) {
+int construct_double_slit(dft_context *ctx, double complex *output, int width, double height,
+													int centre_distance) {
+	// the slits as runs, to check they fit
+	rle_run runs[SWEEP_MAX_RUNS];
 	// index variable
 	int i;
 	// flag - 1 for width odd.
 	int width_odd;
 	// Set width_odd.  If odd, take half_width to be floor(width/2)
 	int half_width = (width_odd = width%2) ? (width-1)/2 : width/2;
+	const int N = ctx->plan->N;
+
+	if (slit_runs(ctx, 2, width, height, centre_distance, runs) < 0) {
+		return -1;
+	}
 
 	// Most of the array is 0.  Memset is faster tan looping
 	memset(output, 0, 2*N * sizeof(double complex));
@@ -185,45 +1388,165 @@ void construct_double_slit(double complex *output, int width, double height, int
 	for (i = -half_width; i < half_width + width_odd; i++) {
 		*(output + indexof(centre_distance+i)) = height;
 	}
+	return 0;
+}
+
+/* Whether the aperture a mode builds fits between x = -N and N-1.
+
+	 *ctx: context whose plan gives N
+	 mode: the execution mode
+
+	 Returns 1 if it does, or the mode builds none, 0 if not.
+	 */
+int mode_fits(dft_context *ctx, int mode) {
+	// the aperture as runs
+	rle_run runs[SWEEP_MAX_RUNS];
+
+	return mode < 0 || mode >= STFT_MODE
+				 || slit_runs(ctx, apertures[mode].slits, apertures[mode].width, apertures[mode].height,
+											apertures[mode].centre, runs) >= 0;
+}
+
+/* The runs of the aperture construct_slit() or
+	 construct_double_slit() builds, without building it.  Double
+	 slits that meet are one run, as they are in the array.
+
+	 *ctx: context whose plan gives N
+	 slits: 1 for construct_slit(), 2 for construct_double_slit()
+	 width, height: as for either
+	 centre: the centre of the slit, or the distance of the centres
+	 				 of the slits from x=0
+	 *runs: room for SWEEP_MAX_RUNS runs
+
+	 Returns the number of runs, or -1 if the aperture does not fit
+	 between x = -N and N-1.
+	 */
+int slit_runs(dft_context *ctx, int slits, int width, double height, int centre, rle_run *runs) {
+	// number of runs, and the first x of the left and right slits
+	int nruns = 1, left, right;
+	const int N = ctx->plan->N;
+
+	// A slit of width w covers centre - floor(w/2) to that + w-1
+	if (slits == 1) {
+		left = right = centre - width/2;
+	} else {
+		centre = (centre < 0) ? -centre : centre;
+		left = -centre - width/2;
+		right = centre - width/2;
+	}
+	if (width < 1 || left < -N || right + width - 1 > N - 1) {
+		return -1;
+	}
+
+	runs->start = left;
+	runs->length = width;
+	runs->value = height;
+	if (right > left + width) {
+		(runs + 1)->start = right;
+		(runs + 1)->length = width;
+		(runs + 1)->value = height;
+		nruns = 2;
+	} else {
+		// The slits overlap or touch
+		runs->length = right + width - left;
+	}
+	return nruns;
+}
+
+/* Number of apertures in a sweep.
+
+	 *range: the sweep
+	 */
+long long sweep_count(sweep_range *range) {
+	return (long long)((range->width[1] - range->width[0]) / range->width[2] + 1)
+				 * ((range->centre[1] - range->centre[0]) / range->centre[2] + 1)
+				 * range->height_count;
+}
+
+/* The parameters of one aperture of a sweep.
+
+	 *range: the sweep
+	 index: the aperture, from 0 to sweep_count()-1
+	 *width, *centre, *height: set to its parameters
+	 */
+void sweep_aperture(sweep_range *range, long long index, int *width, int *centre, double *height) {
+	// number of centres
+	int centres = (range->centre[1] - range->centre[0]) / range->centre[2] + 1;
+
+	*height = range->height_start + (double)(index % range->height_count) * range->height_step;
+	index /= range->height_count;
+	*centre = range->centre[0] + (int)(index % centres) * range->centre[2];
+	*width = range->width[0] + (int)(index / centres) * range->width[2];
 }
 
 /* Produce the convolution of the functions defined in input1
 	 and input2.
 	 
+	 *ctx: context whose plan and precision it works with
 	 *output: pointer to start of the array where convolution is
 	 					to be stored
 	 *input : pointer to start of the arrays to be convolved
+
+	 Returns 0, or -1 if memory could not be allocated.
 	 */
-void convolve(double complex *output, double complex *input1, double complex *input2) {
-	// index variables
-	int X, i;
+int convolve(dft_context *ctx, double complex *output, double complex *input1, double complex *input2) {
+	const int N = ctx->plan->N;
 
-	// Most of the array is 0.  Memset is faster tan looping
-	memset(output, 0, 2*N * sizeof(double complex));
+	/* The integral runs over the i for which both i and X-i lie
+		 between -N and N-1.  In terms of array indices that is point
+		 X+2N of the full linear convolution of the two arrays, so
+		 we keep the 2N points starting from N. */
+	if (ctx->precision == DATAFILE_FLOAT32) {
+		return fast_convolve_single(input1, 2*N, input2, 2*N, output, N, 2*N);
+	}
+	return fast_convolve(input1, 2*N, input2, 2*N, output, N, 2*N, ctx->plan->layout);
+}
 
-	// Loop over X and perform integral for each value of X
-	for (X = -N; X < N; X++) {
-		for (i = -N; i < N; i++) {
-			// Can't access arrays out of bounds
-			if (X-i >= -N && X-i < N) {
-				*(output+indexof(X)) += (*(input1+indexof(i))) * (*(input2 + indexof(X-i))); 	
-			}
-		}
+/* Element-by-element product over array indices first to last-1 */
+static void multiply_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// index variable
+	int i;
+
+	for (i = first; i < last; i++) {
+		*(args->output+i) = (*(args->input+i)) * (*(args->input2+i));
+	}
+}
+
+/* The same with the SIMD kernel.  The arrays are converted to split
+	 form a block at a time, small enough to stay in cache. */
+static void split_multiply_body(void *arg, int chunk, int first, int last) {
+	struct loop_args *args = arg;
+	// start and end of the block
+	int i, end;
+	// the block in split form
+	double a_re[SPLIT_BLOCK], a_im[SPLIT_BLOCK], b_re[SPLIT_BLOCK], b_im[SPLIT_BLOCK];
+
+	for (i = first; i < last; i += SPLIT_BLOCK) {
+		end = (last - i < SPLIT_BLOCK) ? last - i : SPLIT_BLOCK;
+		split_from_interleaved(args->input + i, a_re, a_im, 0, end, 1.0, 1.0);
+		split_from_interleaved(args->input2 + i, b_re, b_im, 0, end, 1.0, 1.0);
+		split_multiply(a_re, a_im, a_re, a_im, b_re, b_im, 0, end, 1.0);
+		split_to_interleaved(a_re, a_im, args->output + i, 0, end, 1.0, 1.0);
 	}
 }
 
 /* Multiply, element-by-element, input1 and input2.
 	 Store the result in output.
 
+	 *ctx: context whose plan it works with
 	 *output: pointer to start of array in which result
 	 					is to be stored.
 	 *input : pointers to starts of arrays to multiplied.
 	 */
-void multiply(double complex *output, double complex *input1, double complex *input2) {
-	// index variable
-	int i;
+void multiply(dft_context *ctx, double complex *output, double complex *input1, double complex *input2) {
+	// arguments for the loop shared out among the threads
+	struct loop_args args;
+	const int N = ctx->plan->N;
 
-	for (i = 0; i < 2*N; i++) {
-		*(output+i) = (*(input1+i)) * (*(input2+i));
-	}
+	args.output = output;
+	args.input = input1;
+	args.input2 = input2;
+	parallel_for(2*N, PARALLEL_GRAIN,
+							 (ctx->plan->layout == LAYOUT_SPLIT) ? split_multiply_body : multiply_body, &args);
 }
@@ -0,0 +1,615 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Codelet generator.
+
+Writes fully unrolled butterflies for the radices given on the
+command line, with every constant inside the butterfly written in
+as a number.  The innermost loop is then straight-line code: no
+loop over the radix, and no twiddles loaded but those of the stage.
+A radix divisible by 4 is built from radix 4 butterflies, any other
+composite radix Cooley-Tukey fashion from its smallest prime factor,
+and a prime one from conjugate pairs as radixg() in fft.c.  Turns by
+multiples of a quarter cost only swaps and changes of sign, which
+are folded into the adds that follow, and odd eighths two multiplies
+rather than four.
+
+Each radix gets a codelet for each sign of the exponent, so that the
+sign is a constant too.  "fft" writes them for the interleaved
+stages, templated in the same way as fft_kernels.h; "simd" writes
+the same operations in the same order for the split stages,
+templated as simd_kernels.h.  The output is kept with the sources,
+so this only needs running again to change the radices:
+
+gcc -O2 -o gen_codelets gen_codelets.c -lm
+./gen_codelets fft 8 9 > fft_codelets.h
+./gen_codelets simd 8 9 > simd_codelets.h
+
+Larger radices can be generated too, but on the machines tried 16
+and 25 lost more to the extra streams of memory at once and to
+register spills than they gained, above a few thousand points.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+// Largest radix, as FFT_MAX_RADIX in fft.h
+#define GEN_MAX_RADIX 31
+// Most radices that can be given
+#define GEN_MAX_CODELETS 16
+// Most distinct constants in one codelet
+#define GEN_MAX_CONSTS 64
+// Room for the body of one codelet
+#define GEN_BODY_SIZE (1 << 20)
+
+// Which template is written
+#define MODE_FFT 0
+#define MODE_SIMD 1
+
+/* A real value in the butterfly: temporary t<var>, or minus it if
+	 neg is set.  Changes of sign are carried along like this and
+	 only turn into a subtraction where the value is next used. */
+struct value {
+	int var;
+	int neg;
+};
+
+/* A complex value */
+struct cvalue {
+	struct value re, im;
+};
+
+// Template being written
+static int mode;
+// Temporaries used so far in this codelet
+static int ntemps;
+// Constants of this codelet, K0, K1, ...
+static long double consts[GEN_MAX_CONSTS];
+static int nconsts;
+// Whether a negation had to be written out in full
+static int zero_used;
+// Radix of the codelet, and which of its inputs have been loaded.
+// Input r is temporaries 2r and 2r+1, loaded where first used so
+// that few values are live at once.
+static int radix;
+static int loaded[GEN_MAX_RADIX];
+// Which outputs have been stored.  A composite butterfly stores each
+// output as soon as its last sub-transform is done.
+static int stored[GEN_MAX_RADIX];
+// The statements of the innermost loop
+static char body[GEN_BODY_SIZE];
+static size_t body_length;
+
+/* Append a line to the body, indented for the innermost loop */
+static void emit(const char *format, ...) {
+	va_list args;
+	int written;
+
+	va_start(args, format);
+	written = vsnprintf(body + body_length, GEN_BODY_SIZE - body_length, format, args);
+	va_end(args);
+	if (written < 0 || body_length + written >= GEN_BODY_SIZE) {
+		fprintf(stderr, "Codelet too long\n");
+		exit(1);
+	}
+	body_length += written;
+}
+
+/* Number of the constant k, which must be positive, adding it to
+	 the codelet's list if it is not already there */
+static int constant(long double k) {
+	// index variable
+	int i;
+
+	for (i = 0; i < nconsts; i++) {
+		if (fabsl(consts[i] - k) < 1e-18L) {
+			return i;
+		}
+	}
+	if (nconsts == GEN_MAX_CONSTS) {
+		fprintf(stderr, "Too many constants\n");
+		exit(1);
+	}
+	consts[nconsts] = k;
+	return nconsts++;
+}
+
+/* Offset of input r of a butterfly, as the hand-written kernels put it */
+static void input_offset(char *text, size_t size, int r) {
+	if (r == 0) {
+		snprintf(text, size, "s*j");
+	} else if (r == 1) {
+		snprintf(text, size, "s*(j + m)");
+	} else {
+		snprintf(text, size, "s*(j + %d*m)", r);
+	}
+}
+
+/* Load the input a belongs to, if that has not been done yet */
+static void fetch(struct value a) {
+	// the input, and its offset
+	int r = a.var / 2;
+	char offset[32];
+
+	if (a.var >= 2*radix || loaded[r]) {
+		return;
+	}
+	loaded[r] = 1;
+	input_offset(offset, sizeof(offset), r);
+	if (mode == MODE_FFT) {
+		emit("\t\t\tt%d = RE(*(x + q + %s));\n", 2*r, offset);
+		emit("\t\t\tt%d = IM(*(x + q + %s));\n", 2*r + 1, offset);
+	} else {
+		emit("\t\t\tt%d = VLOAD(xr + q + %s);\n", 2*r, offset);
+		emit("\t\t\tt%d = VLOAD(xi + q + %s);\n", 2*r + 1, offset);
+	}
+}
+
+static struct value negate(struct value a) {
+	a.neg = !a.neg;
+	return a;
+}
+
+/* a + b, or a - b where b is negated and so on */
+static struct value add(struct value a, struct value b) {
+	struct value t = {ntemps++, 0};
+
+	fetch(a);
+	fetch(b);
+	if (a.neg && b.neg) {
+		t.neg = 1;
+	} else if (a.neg || b.neg) {
+		if (a.neg) {
+			struct value swap = a;
+			a = b;
+			b = swap;
+		}
+		if (mode == MODE_FFT) {
+			emit("\t\t\tt%d = t%d - t%d;\n", t.var, a.var, b.var);
+		} else {
+			emit("\t\t\tt%d = VSUB(t%d, t%d);\n", t.var, a.var, b.var);
+		}
+		return t;
+	}
+	if (mode == MODE_FFT) {
+		emit("\t\t\tt%d = t%d + t%d;\n", t.var, a.var, b.var);
+	} else {
+		emit("\t\t\tt%d = VADD(t%d, t%d);\n", t.var, a.var, b.var);
+	}
+	return t;
+}
+
+static struct value sub(struct value a, struct value b) {
+	return add(a, negate(b));
+}
+
+/* k*a for a constant k */
+static struct value scale(long double k, struct value a) {
+	struct value t;
+	int c;
+
+	if (k < 0) {
+		k = -k;
+		a = negate(a);
+	}
+	if (fabsl(k - 1.0L) < 1e-18L) {
+		return a;
+	}
+	fetch(a);
+	c = constant(k);
+	t.var = ntemps++;
+	t.neg = a.neg;
+	if (mode == MODE_FFT) {
+		emit("\t\t\tt%d = K%d * t%d;\n", t.var, c, a.var);
+	} else {
+		emit("\t\t\tt%d = VMUL(K%d, t%d);\n", t.var, c, a.var);
+	}
+	return t;
+}
+
+/* Write out a pending change of sign, for a value about to be stored */
+static struct value settle(struct value a) {
+	struct value t = {ntemps++, 0};
+
+	fetch(a);
+	if (!a.neg) {
+		ntemps--;
+		return a;
+	}
+	if (mode == MODE_FFT) {
+		emit("\t\t\tt%d = -t%d;\n", t.var, a.var);
+	} else {
+		emit("\t\t\tt%d = VSUB(zero, t%d);\n", t.var, a.var);
+		zero_used = 1;
+	}
+	return t;
+}
+
+static struct cvalue cadd(struct cvalue a, struct cvalue b) {
+	struct cvalue t;
+
+	t.re = add(a.re, b.re);
+	t.im = add(a.im, b.im);
+	return t;
+}
+
+static struct cvalue csub(struct cvalue a, struct cvalue b) {
+	struct cvalue t;
+
+	t.re = sub(a.re, b.re);
+	t.im = sub(a.im, b.im);
+	return t;
+}
+
+static struct cvalue cscale(long double k, struct cvalue a) {
+	struct cvalue t;
+
+	t.re = scale(k, a.re);
+	t.im = scale(k, a.im);
+	return t;
+}
+
+/* Multiply by sign*i: no arithmetic at all */
+static struct cvalue crot(struct cvalue a, int sign) {
+	struct cvalue t;
+
+	if (sign > 0) {
+		t.re = negate(a.im);
+		t.im = a.re;
+	} else {
+		t.re = a.im;
+		t.im = negate(a.re);
+	}
+	return t;
+}
+
+/* Multiply by the constant exp(sign * 2 pi i e / p) */
+static struct cvalue twiddle(struct cvalue a, int e, int p, int sign) {
+	struct cvalue t;
+	// turns of an eighth, and the cosine and sine of the general case
+	int eighths;
+	long double c, s;
+	const long double pi = acosl(-1.0L);
+
+	e %= p;
+	if (e == 0) {
+		return a;
+	}
+	if ((8*e) % p == 0) {
+		// Whole quarter turns first, then what is left is 0 or one
+		// eighth: (x + iy)(1 + sign i)/sqrt(2)
+		for (eighths = 8*e / p; eighths >= 2; eighths -= 2) {
+			a = crot(a, sign);
+		}
+		if (eighths == 0) {
+			return a;
+		}
+		if (sign > 0) {
+			t.re = scale(sqrtl(0.5L), sub(a.re, a.im));
+			t.im = scale(sqrtl(0.5L), add(a.im, a.re));
+		} else {
+			t.re = scale(sqrtl(0.5L), add(a.re, a.im));
+			t.im = scale(sqrtl(0.5L), sub(a.im, a.re));
+		}
+		return t;
+	}
+	c = cosl(2.0L * pi * e / p);
+	s = sign * sinl(2.0L * pi * e / p);
+	t.re = sub(scale(c, a.re), scale(s, a.im));
+	t.im = add(scale(c, a.im), scale(s, a.re));
+	return t;
+}
+
+/* Offset of output t of a butterfly */
+static void output_offset(char *text, size_t size, int p, int t) {
+	if (t == 0) {
+		snprintf(text, size, "s*(%d*j)", p);
+	} else {
+		snprintf(text, size, "s*(%d*j + %d)", p, t);
+	}
+}
+
+/* Store output t of the butterfly, times the stage's twiddle w^(j*t) */
+static void store(int t, struct cvalue a) {
+	char offset[32];
+
+	a.re = settle(a.re);
+	a.im = settle(a.im);
+	stored[t] = 1;
+	output_offset(offset, sizeof(offset), radix, t);
+	if (mode == MODE_FFT && t == 0) {
+		emit("\t\t\t*(y + q + %s) = MAKE(t%d, t%d);\n", offset, a.re.var, a.im.var);
+	} else if (mode == MODE_FFT) {
+		emit("\t\t\t*(y + q + %s) = MAKE(t%d*wr[%d] - t%d*wi[%d], t%d*wi[%d] + t%d*wr[%d]);\n",
+				 offset, a.re.var, t, a.im.var, t, a.re.var, t, a.im.var, t);
+	} else if (t == 0) {
+		emit("\t\t\tVSTORE(yr + q + %s, t%d);\n", offset, a.re.var);
+		emit("\t\t\tVSTORE(yi + q + %s, t%d);\n", offset, a.im.var);
+	} else {
+		emit("\t\t\tVSTORE(yr + q + %s, CMUL_RE(t%d, t%d, wr[%d], wi[%d]));\n",
+				 offset, a.re.var, a.im.var, t, t);
+		emit("\t\t\tVSTORE(yi + q + %s, CMUL_IM(t%d, t%d, wr[%d], wi[%d]));\n",
+				 offset, a.re.var, a.im.var, t, t);
+	}
+}
+
+/* Smallest prime factor of p */
+static int smallest_factor(int p) {
+	// candidate factor
+	int f;
+
+	for (f = 2; f * f <= p; f++) {
+		if (p % f == 0) {
+			return f;
+		}
+	}
+	return p;
+}
+
+/* Write a length p DFT of in[] into out[].  For the whole butterfly,
+	 top is set, and a composite one stores its outputs as it goes. */
+static void dft(struct cvalue *in, int p, int sign, struct cvalue *out, int top) {
+	// index variables
+	int r, t, k, n1, n2;
+	// the two factors of a composite p
+	int p1, p2;
+	// sub-transform inputs and outputs, and for a prime the sums and
+	// differences of conjugate pairs
+	struct cvalue a[GEN_MAX_RADIX], b[GEN_MAX_RADIX], y[GEN_MAX_RADIX][GEN_MAX_RADIX];
+	struct cvalue re, im;
+	const long double pi = acosl(-1.0L);
+
+	if (p == 1) {
+		*out = *in;
+		return;
+	}
+	if (p == 2) {
+		out[0] = cadd(in[0], in[1]);
+		out[1] = csub(in[0], in[1]);
+		return;
+	}
+	if (p == 4) {
+		// as radix4() in fft_kernels.h
+		a[0] = cadd(in[0], in[2]);
+		a[1] = csub(in[0], in[2]);
+		a[2] = cadd(in[1], in[3]);
+		a[3] = crot(csub(in[1], in[3]), sign);
+		out[0] = cadd(a[0], a[2]);
+		out[1] = cadd(a[1], a[3]);
+		out[2] = csub(a[0], a[2]);
+		out[3] = csub(a[1], a[3]);
+		return;
+	}
+
+	p1 = (p % 4 == 0) ? 4 : smallest_factor(p);
+	if (p1 == p) {
+		// Prime: pair inputs r and p-r, whose roots are conjugates
+		out[0] = in[0];
+		for (r = 1; r <= (p - 1) / 2; r++) {
+			a[r] = cadd(in[r], in[p-r]);
+			b[r] = csub(in[r], in[p-r]);
+			out[0] = cadd(out[0], a[r]);
+		}
+		for (t = 1; t <= (p - 1) / 2; t++) {
+			re = in[0];
+			k = 0;
+			for (r = 1; r <= (p - 1) / 2; r++) {
+				k = (k + t) % p;
+				re = cadd(re, cscale(cosl(2.0L * pi * k / p), a[r]));
+				if (r == 1) {
+					im = cscale(sinl(2.0L * pi * k / p), b[r]);
+				} else {
+					im = cadd(im, cscale(sinl(2.0L * pi * k / p), b[r]));
+				}
+			}
+			im = crot(im, sign);
+			out[t] = cadd(re, im);
+			out[p-t] = csub(re, im);
+		}
+		return;
+	}
+
+	// p = p1 p2, input n = p2 n1 + n2 and output k = k1 + p1 k2: a
+	// length p1 DFT for each n2, twiddles exp(sign 2 pi i n2 k1 / p),
+	// then a length p2 DFT for each k1
+	p2 = p / p1;
+	for (n2 = 0; n2 < p2; n2++) {
+		for (n1 = 0; n1 < p1; n1++) {
+			a[n1] = in[p2*n1 + n2];
+		}
+		dft(a, p1, sign, y[n2], 0);
+		for (k = 1; k < p1; k++) {
+			y[n2][k] = twiddle(y[n2][k], n2*k, p, sign);
+		}
+	}
+	for (k = 0; k < p1; k++) {
+		for (n2 = 0; n2 < p2; n2++) {
+			a[n2] = y[n2][k];
+		}
+		dft(a, p2, sign, b, 0);
+		for (t = 0; t < p2; t++) {
+			out[k + p1*t] = b[t];
+			if (top) {
+				store(k + p1*t, b[t]);
+			}
+		}
+	}
+}
+
+/* Write the codelet for radix p and one sign */
+static void codelet(int p, int sign) {
+	// index variables
+	int r, t, i;
+	// the butterfly's inputs and outputs
+	struct cvalue in[GEN_MAX_RADIX], out[GEN_MAX_RADIX];
+	const char *name = (sign < 0) ? "minus" : "plus";
+
+	ntemps = 0;
+	nconsts = 0;
+	zero_used = 0;
+	body_length = 0;
+	*body = '\0';
+
+	radix = p;
+	for (r = 0; r < p; r++) {
+		in[r].re.var = ntemps++;
+		in[r].im.var = ntemps++;
+		in[r].re.neg = in[r].im.neg = 0;
+		loaded[r] = stored[r] = 0;
+	}
+	dft(in, p, sign, out, 1);
+	for (t = 0; t < p; t++) {
+		if (!stored[t]) {
+			store(t, out[t]);
+		}
+	}
+
+	printf("/* Radix %d, exponent %s */\n", p, (sign < 0) ? "negative" : "positive");
+	if (mode == MODE_FFT) {
+		printf("static void KERNEL(radix%d_%s)(int m, int s, int sign, CPLX *x, CPLX *y,\n"
+					 "\t\tCPLX *table, int ns, int j0, int j1, int q0, int q1) {\n"
+					 "\tint j, q, t;\n"
+					 "\tREAL wr[%d], wi[%d];\n", p, name, p, p);
+		for (i = 0; i < nconsts; i++) {
+			printf("\tconst REAL K%d = %.20Lf;\n", i, consts[i]);
+		}
+	} else {
+		printf("SIMD_ATTR static void KERNEL(radix%d_%s)(split_stage *st, int j0, int j1, int q0, int q1) {\n"
+					 "\tint j, q, t;\n"
+					 "\tint qv = q0 + (q1 - q0) / VW * VW;\n"
+					 "\tint m = st->m, s = st->s;\n"
+					 "\tdouble *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;\n"
+					 "\tVEC wr[%d], wi[%d];\n", p, name, p, p);
+		for (i = 0; i < nconsts; i++) {
+			printf("\tconst VEC K%d = VSET1(%.20Lf);\n", i, consts[i]);
+		}
+		if (zero_used) {
+			printf("\tconst VEC zero = VSET1(0.0);\n");
+		}
+	}
+	for (i = 0; i < ntemps; i++) {
+		if (i % 12 == 0) {
+			printf((mode == MODE_FFT) ? "\tREAL " : "\tVEC ");
+		}
+		printf((i % 12 == 11 || i == ntemps - 1) ? "t%d;\n" : "t%d, ", i);
+	}
+
+	if (mode == MODE_FFT) {
+		printf("\n\tfor (j = j0; j < j1; j++) {\n"
+					 "\t\tfor (t = 1; t < %d; t++) {\n"
+					 "\t\t\twr[t] = RE(KERNEL(root)(table, j*t*ns, sign));\n"
+					 "\t\t\twi[t] = IM(KERNEL(root)(table, j*t*ns, sign));\n"
+					 "\t\t}\n"
+					 "\t\tfor (q = q0; q < q1; q++) {\n", p);
+	} else {
+		printf("\n\tfor (j = j0; j < j1 && q0 < qv; j++) {\n"
+					 "\t\tfor (t = 1; t < %d; t++) {\n"
+					 "\t\t\tTWIDDLE(st, j*t*s, wr[t], wi[t]);\n"
+					 "\t\t}\n"
+					 "\t\tfor (q = q0; q < qv; q += VW) {\n", p);
+	}
+	fputs(body, stdout);
+	printf("\t\t}\n\t}\n");
+	if (mode == MODE_SIMD) {
+		printf("#if VW > 1\n"
+					 "\tif (qv < q1) {\n"
+					 "\t\tradix%d_%s_scalar(st, j0, j1, qv, q1);\n"
+					 "\t}\n"
+					 "#endif\n", p, name);
+	}
+	printf("}\n\n");
+}
+
+/* Write the function that picks the codelet for a stage */
+static void dispatch(int *radices, int count) {
+	// index variable
+	int i;
+
+	if (mode == MODE_FFT) {
+		printf("/* Do the butterflies of a radix p stage with its codelet, taking\n"
+					 "\t the same arguments as radixg().  Returns 0, or -1 if there is no\n"
+					 "\t codelet for p. */\n"
+					 "static int KERNEL(codelet)(int p, int m, int s, int sign, CPLX *x, CPLX *y,\n"
+					 "\t\tCPLX *table, int ns, int j0, int j1, int q0, int q1) {\n"
+					 "\tswitch (p) {\n");
+	} else {
+		printf("/* Do the butterflies of a split stage with its codelet.  Returns\n"
+					 "\t 0, or -1 if there is no codelet for the stage's radix. */\n"
+					 "SIMD_ATTR static int KERNEL(codelet)(split_stage *st, int j0, int j1, int q0, int q1) {\n"
+					 "\tswitch (st->p) {\n");
+	}
+	for (i = 0; i < count; i++) {
+		printf("\t\tcase %d:\n", radices[i]);
+		if (mode == MODE_FFT) {
+			printf("\t\t\tif (sign < 0) {\n"
+						 "\t\t\t\tKERNEL(radix%d_minus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);\n"
+						 "\t\t\t} else {\n"
+						 "\t\t\t\tKERNEL(radix%d_plus)(m, s, sign, x, y, table, ns, j0, j1, q0, q1);\n"
+						 "\t\t\t}\n", radices[i], radices[i]);
+		} else {
+			printf("\t\t\tif (st->sign < 0) {\n"
+						 "\t\t\t\tKERNEL(radix%d_minus)(st, j0, j1, q0, q1);\n"
+						 "\t\t\t} else {\n"
+						 "\t\t\t\tKERNEL(radix%d_plus)(st, j0, j1, q0, q1);\n"
+						 "\t\t\t}\n", radices[i], radices[i]);
+		}
+		printf("\t\t\treturn 0;\n");
+	}
+	printf("\t\tdefault:\n\t\t\treturn -1;\n\t}\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+	// index variable
+	int i;
+	// the radices
+	int radices[GEN_MAX_CODELETS];
+	int count = argc - 2;
+
+	if (argc < 3 || count > GEN_MAX_CODELETS
+		|| (strcmp(argv[1], "fft") != 0 && strcmp(argv[1], "simd") != 0)) {
+		fprintf(stderr, "Usage: gen_codelets fft|simd radix [radix...]\n");
+		return 2;
+	}
+	mode = (strcmp(argv[1], "fft") == 0) ? MODE_FFT : MODE_SIMD;
+	for (i = 0; i < count; i++) {
+		radices[i] = atoi(argv[i+2]);
+		if (radices[i] < 2 || radices[i] > GEN_MAX_RADIX) {
+			fprintf(stderr, "Radix must be from 2 to %d\n", GEN_MAX_RADIX);
+			return 2;
+		}
+	}
+
+	printf("/*\nDISCRETE FOURIER TRANSFORM\n\n"
+				 "Generated by gen_codelets.c: do not edit.\n\n"
+				 "./gen_codelets %s", argv[1]);
+	for (i = 0; i < count; i++) {
+		printf(" %d", radices[i]);
+	}
+	if (mode == MODE_FFT) {
+		printf("\n\nUnrolled butterflies for the interleaved stages, included after\n"
+					 "fft_kernels.h with the same macros.\n*/\n\n"
+					 "#ifndef FFT_CODELET_RADICES\n"
+					 "// Radices with a codelet, in the order fft_plan_create() takes them\n"
+					 "#define FFT_CODELET_RADICES");
+		for (i = 0; i < count; i++) {
+			printf((i == 0) ? " %d" : ", %d", radices[i]);
+		}
+		printf("\n#endif\n\n");
+	} else {
+		printf("\n\nUnrolled butterflies for the split stages, included after\n"
+					 "simd_kernels.h with the same macros.\n*/\n\n");
+	}
+
+	for (i = 0; i < count; i++) {
+		codelet(radices[i], -1);
+		codelet(radices[i], 1);
+	}
+	dispatch(radices, count);
+	return 0;
+}
@@ -12,9 +12,176 @@ Function prototypes, macros and external variable declarations
 
 // Some definitions and macros
 // x ranges between -N to N-1 whereas the array is zero-indexed.
-// This macro maps x to array index
+// This macro maps x to array index.  N is set at run time and
+// held in the plan; functions take a local copy of it first.
 #define indexof(x) ((x)+N)
-#define N 1000
+// N when none is given on the command line
+#define DEFAULT_N 1000
+// Below this many nonzero samples of f(x), summing the DFT directly
+// over the nonzero samples beats the FFT.  Each nonzero sample costs
+// about a fifth of a length 2N FFT once cexp() is replaced by a
+// table lookup.  This is the plan's sparse_limit unless -tune has
+// measured it.  Runs of f(x) are always weighed against this.
+#define SPARSE_LIMIT 5
+// Nonzero samples the direct sum is timed on by dft_measure_sparse()
+#define SPARSE_TRIAL 4
+// Cost of a constant run of f(x) relative to a single nonzero point
+// when dft() sums closed forms over the runs instead.
+#define RUN_COST 2
+// A band of fewer output frequencies than this is done by Goertzel's
+// recurrence, one frequency at a time; wider bands by the chirp-z
+// transform, whose cost is about that of this many recurrences.
+#define GOERTZEL_LIMIT 32
+// Points Goertzel's recurrence runs over before its sum is turned
+// by an exact phase and it starts afresh, which bounds its rounding
+#define GOERTZEL_BLOCK 1024
+// Fewest output points worth handing a thread of their own in the
+// loops shared out by parallel_for()
+#define PARALLEL_GRAIN 1024
+// Points converted to split form at a time by multiply() and
+// write_datafile(), small enough to stay in the L1 cache
+#define SPLIT_BLOCK 256
+// Number of execution modes; they run from 0 to NMODES-1
+#define NMODES 12
+// The mode that reads a signal from the -input file and finds its
+// spectrogram, rather than building an aperture.  "all" runs the
+// modes before it.
+#define STFT_MODE 9
+// The mode that transforms f(x) as read from the -input file, which
+// also sets N
+#define LOAD_MODE 10
+// Spectrogram points transformed and written at a time, shared out
+// among the threads a frame each
+#define STFT_BATCH_POINTS (1 << 18)
+// The mode that transforms every slit aperture in the ranges of
+// -width, -centre and -height into one file.  Not part of "all".
+#define SWEEP_MODE 11
+// Most runs an aperture of the sweep is made of
+#define SWEEP_MAX_RUNS 2
+// Sweep points transformed and written at a time
+#define SWEEP_BATCH_POINTS (1 << 18)
+// Frequencies dft_rle_batch() sums for every f(x) of a batch in
+// turn, few enough that the batch's rows of them stay in cache
+#define SWEEP_BLOCK 256
+
+#include "fft.h"
+#include "realfft.h"
+#include "twiddle.h"
+#include "convolve.h"
+#include "threads.h"
+#include "simd.h"
+#include "datafile.h"
+#include "stft.h"
+#include "arena.h"
+#include "tune.h"
+#include "timing.h"
+#include "render.h"
+
+/* Everything that depends on the size of the transform.
+	 Built once by set_params() from the command line.
+	 */
+typedef struct dft_plan {
+	// x and u run from -N to N-1
+	int N;
+	// FFT plan for length 2N transforms
+	fft_plan *fft;
+	// Real transform of 2N points, for f(x) that is real
+	fft_real_plan *rfft;
+	// Cosine transform of N+1 points, for f(x) that is real and
+	// even.  NULL if N is odd.
+	fft_real_plan *dct;
+	// The 4N roots of unity exp(i pi k / 2N), for the half angles
+	// in the closed form sums over runs
+	double complex *half_roots;
+	// LAYOUT_INTERLEAVED or LAYOUT_SPLIT: how the FFT, convolve()
+	// and multiply() hold the data while they work on it
+	int layout;
+	// dft() sums directly over fewer nonzero samples than this
+	int sparse_limit;
+} dft_plan;
+
+/* The data arrays a mode works in, and scratch space for dft().
+	 Each context has its own set, while the plan may be shared by
+	 several.  Every array is cut from an arena and aligned to
+	 ARENA_ALIGN.
+	 */
+typedef struct dft_buffers {
+	// Defines f(x)
+	double complex *real_space;
+	// Holds fourier transform, F(u)
+	double complex *freq_space;
+	// Holds convulution of two functions, in mode 8
+	double complex *convolved;
+	// Holds F(u) over the band, with -band
+	double complex *band;
+	// fft_work_size() points of scratch for the FFT, or NULL to use
+	// the plan's own and share each transform out among the threads
+	double complex *fft_work;
+	// For the split layout, the 2N real parts and then the 2N
+	// imaginary parts of the data being transformed
+	double *split;
+} dft_buffers;
+
+/* One transform job: the plan it works to, its own data arrays and
+	 scratch space, and how its results are written.  The transforms
+	 and the functions that write their results read nothing else, so
+	 jobs in different contexts can run on different threads of one
+	 process at once.  Contexts on the same plan that run at once each
+	 need FFT scratch space of their own.
+	 */
+typedef struct dft_context {
+	// Transform size and FFT plans.  Not freed with the context.
+	dft_plan *plan;
+	// Data arrays and scratch space
+	dft_buffers work;
+	// The arena they are cut from, if the context has one of its own
+	arena *space;
+	// Execution mode, which names the files written
+	int mode;
+	// DATAFILE_FLOAT64 or DATAFILE_FLOAT32 for binary data files,
+	// DATAFILE_TEXT for text
+	int output_precision;
+	// Precision convolve() works in: DATAFILE_FLOAT64, or
+	// DATAFILE_FLOAT32 for fast_convolve_single()
+	int precision;
+	// Band of frequencies for dft_band() results; band_count is 0
+	// for the usual transform over all u
+	double band_start;
+	double band_step;
+	int band_count;
+	// RENDER_PPM or RENDER_PNG to draw the plots as images, on the
+	// RENDER_LINEAR or RENDER_LOG scale, or RENDER_NONE for gnuplot
+	// scripts
+	int render;
+	int render_scale;
+} dft_context;
+
+/* The apertures SWEEP_MODE transforms: every combination of a
+	 width, a centre and a height from the ranges, widths outermost
+	 and heights innermost.
+	 */
+typedef struct sweep_range {
+	// 1 for single slits as construct_slit() builds, or 2 for double
+	// slits as construct_double_slit(), centred at +/- the centre
+	int slits;
+	// First, last and step of the widths and of the centres
+	int width[3];
+	int centre[3];
+	// First height, the step and how many
+	double height_start;
+	double height_step;
+	int height_count;
+} sweep_range;
+
+/* One run of constant, nonzero f(x): value at x = start to
+	 start+length-1.  The apertures built by construct_slit() and
+	 construct_double_slit() are one or two runs.
+	 */
+typedef struct rle_run {
+	int start;
+	int length;
+	double complex value;
+} rle_run;
 
 // Function prototypes
 // Functions in io.c
@@ -37,90 +204,456 @@ void _exit(int code);
 	 */
 void set_params(int count, char *argvec[]);
 
-/* Writes data in array to a file for plotting purposes
-	 Space delimited file:
+/* Writes data in array to a file for plotting purposes.
+	 By default this is a binary file (datafile.c): a header, then
+	 the real and imaginary parts of each point.  With -text it is
+	 the old space delimited file:
 	 0 index real_part imag_part magnitude
 
 	 The 0 column is to facilitate a vector plot, though this
 	 is not done from this programme
 
+	 *ctx: context the data is for, which sets the mode and format
 	 *array: data to be written to the file
 	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
 	 */
-void write_datafile(double complex *array, char name[]);
+int write_datafile(dft_context *ctx, double complex *array, char name[]);
+
+/* Writes F(u) for a band of frequencies to a file, in the same
+	 format as write_datafile() but with the frequency u in place
+	 of the index.
+
+	 *ctx: context the data is for, which sets the mode, format and band
+	 *array: data to be written to the file
+	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int write_banddata(dft_context *ctx, double complex *array, char name[]);
 
 /* Write a gnuplot script to produce the required plot
 	 Plot depends on programme execution mode.
 	 Gnuplot can then be called externally
 
+	 *ctx: context the plot is for, which sets the mode and format
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the script could not be written.
+	 */
+int plot(dft_context *ctx, char name[]);
+
+/* Draw a plot as images in place of the gnuplot script: line plots
+	 of the real part and the magnitude of array, against the index,
+	 in plots/real_<name>_m<mode>_N<N> and abs_ likewise.
+
+	 *ctx: context the plot is for, which sets the mode, the image
+				 format and the scale
+	 *array: the points
+	 count: number of points
 	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the images could not be written or memory
+	 could not be allocated.
+	 */
+int plot_image(dft_context *ctx, double complex *array, int count, char name[]);
+
+/* Create the file a spectrogram is written to as it is found,
+	 and fill in its header: a binary file (datafile.c) with a row per
+	 frame, or with -text a space delimited file of lines
+	 x u real_part imag_part magnitude
+	 with x the middle of the frame and a blank line after each frame.
+
+	 *ctx: context the data is for, which sets the mode and format
+	 *header: filled in for the file; rows counts the frames written
+	 *stream: the stream the frames come from
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *open_spectrogram(dft_context *ctx, datafile_header *header, stft_stream *stream);
+
+/* Append frames to a spectrogram file from open_spectrogram().
+
+	 *ctx: context the data is for
+	 *fp: the file
+	 *header: its header
+	 *array: frames frames of header->cols points each
+	 frames: number of frames
+
+	 Returns 0, or -1 if they could not be written.
 	 */
-void plot(char name[]);
+int write_spectrogram(dft_context *ctx, FILE *fp, datafile_header *header,
+											double complex *array, int frames);
+
+/* Finish a spectrogram file from open_spectrogram().
+
+	 *ctx: context the data is for
+	 *fp: the file
+	 *header: its header
+
+	 Returns 0, or -1 if it could not be written.
+	 */
+int close_spectrogram(dft_context *ctx, FILE *fp, datafile_header *header);
+
+/* Write a gnuplot script to plot a spectrogram file as a map of
+	 |F(u)| against x and u, or with -render draw the map as an image.
+
+	 *ctx: context the data is for
+	 *header: header of the finished file
+
+	 Returns 0, or -1 if the script or image could not be written.
+	 */
+int plot_spectrogram(dft_context *ctx, datafile_header *header);
+
+/* Create the file a sweep is written to as it is found, and fill
+	 in its header: a binary file (datafile.c) with a row per
+	 aperture, or with -text a space delimited file of lines
+	 aperture u real_part imag_part magnitude
+	 with a blank line after each aperture.  Rows are appended with
+	 write_spectrogram() and the file finished with
+	 close_spectrogram(), as for a spectrogram.
+
+	 *ctx: context the data is for, which sets the mode and format
+	 *header: filled in for the file; rows counts the apertures written
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *open_sweep(dft_context *ctx, datafile_header *header);
+
+/* Write the parameters of every aperture of a sweep to a text file,
+	 one line each in the order of the rows of the sweep file:
+	 aperture width centre height
+
+	 *ctx: context the data is for, which sets the mode
+	 *range: the sweep
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int write_sweep_params(dft_context *ctx, sweep_range *range);
+
+/* Write a gnuplot script to plot a sweep file as a map of |F(u)|
+	 against the aperture and u, or with -render draw the map as an
+	 image.
+
+	 *ctx: context the data is for
+	 *header: header of the finished file
+
+	 Returns 0, or -1 if the script or image could not be written.
+	 */
+int plot_sweep(dft_context *ctx, datafile_header *header);
 
 
 // Functions in schrodinger.c
+/* Build the plan for transforms of 2N points.
+
+	 N: x and u run from -N to N-1
+	 layout: LAYOUT_INTERLEAVED, or LAYOUT_SPLIT to work on the real
+	 				 and imaginary parts in separate arrays with SIMD kernels
+
+	 Returns NULL if memory could not be allocated, or if N is over
+	 INT_MAX/4.
+	 */
+dft_plan *dft_plan_create(int N, int layout);
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void dft_plan_destroy(dft_plan *plan);
+
+/* Fill in a context on a plan with the defaults: mode 0, double
+	 precision throughout, no band and no data arrays yet.
+
+	 *ctx: the context
+	 *plan: plan it works to
+	 */
+void dft_context_init(dft_context *ctx, dft_plan *plan);
+
+/* Cut a context's data arrays and scratch space from an arena, or
+	 with no arena only count the bytes they need, so that one arena
+	 can be sized to hold several contexts.  band_count must be set
+	 first.
+
+	 *ctx: context from dft_context_init()
+	 *a: the arena, or NULL to count
+	 shared: nonzero if other contexts on the same plan may run at
+	 				 the same time.  It then gets FFT scratch space of its
+	 				 own, and its FFTs run on the calling thread alone.
+
+	 Returns the bytes the arrays take up.
+	 */
+size_t dft_context_alloc(dft_context *ctx, arena *a, int shared);
+
+/* Create a context on a plan, with its data arrays in an arena of
+	 its own.  The defaults are those of dft_context_init().  The
+	 threads must already have been started by threads_init().
+
+	 *plan: plan it works to, which must outlive the context
+	 band_count: room for this many points of dft_band(), or 0
+	 shared: as for dft_context_alloc()
+	 pages: ARENA_SMALL, ARENA_THP or ARENA_HUGETLB
+
+	 Returns NULL if memory could not be allocated.
+	 */
+dft_context *dft_context_create(dft_plan *plan, int band_count, int shared, int pages);
+
+/* Free a context from dft_context_create() and its arena, but not
+	 its plan.  NULL is ignored.
+
+	 *ctx: context to be freed
+	 */
+void dft_context_destroy(dft_context *ctx);
+
 /* This function finds the FT of the discrete function
 	 defined in the input array, and stores it in the output
 	 array. 
 	 
+	 *ctx: context whose plan and scratch space it works with
 	 *input: pointer to the start of the array containing the 
 	 				 function to be transformed.
 	 *output: pointer to the start of the array where the FT
 	 					will be stored.
 	 */
-void dft(double complex *input, double complex *output);
+void dft(dft_context *ctx, double complex *input, double complex *output);
+
+/* Time dft() on a few nonzero samples of f(x), summed directly, and
+	 on a full f(x) through the FFT, to find how many nonzero samples
+	 the direct sum is worth it for on this machine.  It works in the
+	 context's arrays, so call it before they hold anything.
+
+	 *ctx: context whose plan and arrays it works with
+
+	 Returns the number of nonzero samples at which the FFT
+	 becomes as quick, for the plan's sparse_limit.
+	 */
+int dft_measure_sparse(dft_context *ctx);
+
+/* Break f(x) into runs of constant nonzero value.
+
+	 *ctx: context whose plan gives N
+	 *input: pointer to the start of the array holding f(x)
+	 *runs: pointer to the start of the array where the runs
+	 				are to be stored
+	 max_runs: size of the runs array
+
+	 Returns the number of runs, or -1 if there are more than
+	 max_runs of them.
+	 */
+int rle_encode(dft_context *ctx, double complex *input, rle_run *runs, int max_runs);
+
+/* Find the FT of f(x) given as constant runs.  The sum of
+	 exp(i pi x u / N) over a run is a geometric series, which sums
+	 to a Dirichlet kernel: a phase for the centre of the run times
+	 sin(pi u L / 2N) / sin(pi u / 2N) for a run of length L.  So each
+	 run costs the same whatever its width.
+
+	 *ctx: context whose plan gives N
+	 *runs: pointer to the start of the array of runs
+	 nruns: number of runs
+	 *output: pointer to the start of the array where the FT
+	 					will be stored.
+	 */
+void dft_rle(dft_context *ctx, rle_run *runs, int nruns, double complex *output);
+
+/* Find the FTs of a batch of f(x), each given as constant runs,
+	 as dft_rle() does for one.  The work is shared out among the
+	 threads by frequency, and each block of frequencies is summed
+	 for every f(x) of the batch in turn, so that sin(pi u / 2N),
+	 the same for all of them, is looked up once.
+
+	 *ctx: context whose plan gives N
+	 *runs: pointer to the start of the runs; those of f(x) number i
+	 				start at runs + i*max_runs
+	 *nruns: number of runs of each f(x)
+	 max_runs: room for runs each f(x) has
+	 count: number of f(x)
+	 *output: pointer to the start of the array where the FTs will be
+	 					stored, a row of 2N points each
+	 */
+void dft_rle_batch(dft_context *ctx, rle_run *runs, int *nruns, int max_runs, int count,
+									 double complex *output);
+
+/* Find the FT at count evenly spaced frequencies
+	 u = start, start+step, ... start+(count-1)*step
+	 which need not be integers.  This zooms in on part of F(u) at
+	 any resolution without finding the rest of it.  A few
+	 frequencies are done one at a time by Goertzel's recurrence,
+	 and anything more by the chirp-z transform.
+
+	 *ctx: context whose plan it works with
+	 *input: pointer to the start of the array containing the
+	 				 function to be transformed.
+	 *output: pointer to the start of the array where the count
+	 					points of the FT will be stored.
+	 start: first frequency
+	 step: spacing of the frequencies
+	 count: number of frequencies
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int dft_band(dft_context *ctx, double complex *input, double complex *output,
+						 double start, double step, int count);
 
 /* This function populates output with a simulated
 	 single slit light source.
 	 
+	 *ctx: context whose plan gives N
 	 *output: pointer to start of the array where the
 	 					function is to be stored
 	 width: The width of the slit
 	 height: The intensity of the light from the slit
 	 centre: The position of the centre of the slit
+
+	 Returns 0, or -1 if the slit does not fit between x = -N and N-1,
+	 when output is left as it was.
 	 */
-void construct_slit(double complex *output, int width, double height, int centre);
+int construct_slit(dft_context *ctx, double complex *output, int width, double height, int centre);
 
 /* This function populates output with a simulated
 	 double slit light source.
 	 
+	 *ctx: context whose plan gives N
 	 *output: pointer to start of the array where the
 	 					function is to be stored
 	 width: The width of the slits
 	 height: The intensity of the light from the slits
 	 centre_distance: The distance of the centres of 
 	 									the slits from x=0
+
+	 Returns 0, or -1 if the slits do not fit between x = -N and N-1,
+	 when output is left as it was.
+	 */
+int construct_double_slit(dft_context *ctx, double complex *output, int width, double height,
+													int centre_distance);
+
+/* The runs of the aperture construct_slit() or
+	 construct_double_slit() builds, without building it.  Double
+	 slits that meet are one run, as they are in the array.
+
+	 *ctx: context whose plan gives N
+	 slits: 1 for construct_slit(), 2 for construct_double_slit()
+	 width, height: as for either
+	 centre: the centre of the slit, or the distance of the centres
+	 				 of the slits from x=0
+	 *runs: room for SWEEP_MAX_RUNS runs
+
+	 Returns the number of runs, or -1 if the aperture does not fit
+	 between x = -N and N-1.
+	 */
+int slit_runs(dft_context *ctx, int slits, int width, double height, int centre, rle_run *runs);
+
+/* Whether the aperture a mode builds fits between x = -N and N-1.
+
+	 *ctx: context whose plan gives N
+	 mode: the execution mode
+
+	 Returns 1 if it does, or the mode builds none, 0 if not.
+	 */
+int mode_fits(dft_context *ctx, int mode);
+
+/* Number of apertures in a sweep.
+
+	 *range: the sweep
+	 */
+long long sweep_count(sweep_range *range);
+
+/* The parameters of one aperture of a sweep.
+
+	 *range: the sweep
+	 index: the aperture, from 0 to sweep_count()-1
+	 *width, *centre, *height: set to its parameters
 	 */
-void construct_double_slit(double complex *output, int width, double height, int centre_distance);
+void sweep_aperture(sweep_range *range, long long index, int *width, int *centre, double *height);
 
 /* Produce the convolution of the functions defined in input1
 	 and input2.
 	 
+	 *ctx: context whose plan and precision it works with
 	 *output: pointer to start of the array where convolution is
 	 					to be stored
 	 *input : pointer to start of the arrays to be convolved
+
+	 Returns 0, or -1 if memory could not be allocated.
 	 */
-void convolve(double complex *output, double complex *input1, double complex *input2);
+int convolve(dft_context *ctx, double complex *output, double complex *input1, double complex *input2);
 
 /* Multiply, element-by-element, input1 and input2.
 	 Store the result in output.
 
+	 *ctx: context whose plan it works with
 	 *output: pointer to start of array in which result
 	 					is to be stored.
 	 *input : pointers to starts of arrays to multiplied.
 	 */
-void multiply(double complex *output, double complex *input1, double complex *input2);
+void multiply(dft_context *ctx, double complex *output, double complex *input1, double complex *input2);
 
 
 /* Declare global variables */
-// Execution mode number
-extern int mode;
-
-// Data storage arrays
-// The native complex data type is ideal for this application
-// Defines f(x)
-extern double complex *real_space;
-// Holds fourier transform, F(u)
-extern double complex *freq_space;
-// Holds convulution of two functions
-extern double complex *convolved;
+// These belong to the programme, which runs the modes from the
+// command line.  set_params() sets them and the functions declared
+// after them read them; the others above use only the context they
+// are given.
+// Execution modes to run, in order
+extern int *modes;
+extern int nmodes;
+
+// A context for each thread running modes at once, all on the one
+// plan, and the one mapping all their data arrays are cut from
+extern dft_context *contexts;
+extern int ncontexts;
+extern arena *buffer_arena;
+
+// Transform size and FFT plan, built once in set_params()
+extern dft_plan *plan;
+
+// The -input file, for STFT_MODE and LOAD_MODE
+extern char *input_file;
+
+// f(x) for LOAD_MODE, mapped from the -input file by datafile_map(),
+// and its header.  NULL if that mode is not being run.
+extern double complex *input_space;
+extern datafile_header input_header;
+
+// The signal for STFT_MODE: DATAFILE_FLOAT32 or DATAFILE_FLOAT64 for
+// raw real samples or 0 for a data file of complex ones, and the hop
+// and window of the transform
+extern int stft_raw;
+extern int stft_hop;
+extern int stft_window;
+
+// The apertures for SWEEP_MODE
+extern sweep_range sweep;
+
+
+// Functions in schrodinger.c that run the programme's modes.  They
+// read the settings above and exit with its statuses on failure.
+/* Find and write out the FT for the context's execution mode, and
+	 the convolution in mode 8, with the plots for them.
+
+	 *ctx: context to work in, with the mode to run
+	 */
+void run_mode(dft_context *ctx);
+
+/* Stream the signal in the -input file through the short-time
+	 Fourier transform, a frame of 2N samples every hop, and write out
+	 its spectrogram with the plot for it.  Memory use depends on the
+	 frame and not on the length of the signal.
+
+	 *ctx: context to work in, with the mode to run
+	 */
+void spectrogram(dft_context *ctx);
+
+/* Transform every aperture of the sweep, a batch at a time shared
+	 out among the threads, and write the results as one file with a
+	 row per aperture, with the plot for it and a list of the
+	 apertures' parameters.
+
+	 *ctx: context to work in, with the mode to run
+	 */
+void run_sweep(dft_context *ctx);
+
+/* Run modes first to last-1 of the list, one after another, in the
+	 context belonging to this chunk.  A parallel_for() body.
+	 */
+void modes_body(void *arg, int chunk, int first, int last);
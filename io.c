@@ -10,6 +10,9 @@ going on here.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
 // C s native support for complex numbers is ideal
 #include <complex.h>
 #include "header.h"
@@ -18,23 +21,30 @@ going on here.
 	 Plot depends on programme execution mode.
 	 Gnuplot can then be called externally
 
+	 *ctx: context the plot is for, which sets the mode and format
 	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the script could not be written.
 	 */
-void plot (char name[]) {
+int plot(dft_context *ctx, char name[]) {
 
 	// File pointer
 	FILE *fp;
 	// Buffer to store filename
-	char filename[35] = { };
+	char filename[80] = { };
+	// The data file as gnuplot is to read it, and the columns
+	// holding Re(F(u)) and |F(u)|
+	char source[160] = { }, real_cols[80] = { }, abs_cols[80] = { };
+	// u of the first point in the data file, and the spacing
+	double start = 0.0, step = 1.0;
+	const int N = ctx->plan->N, mode = ctx->mode, precision = ctx->output_precision;
 
 	// Set filename according to execution mode, string
 	// identifier and N.
-	sprintf(filename, "plots/plot_%s_m%d_N%d.p", name, mode, N);
-	// Open file for writing if possible.  If not, quit
-	// with error message
+	snprintf(filename, sizeof(filename), "plots/plot_%s_m%d_N%d.p", name, mode, N);
+	// Open file for writing if possible
 	if ((fp = fopen(filename, "w")) == NULL) {
-		printf("Unable to open file for plotting\n");
-		_exit(3);
+		return -1;
 	}
 
 	fprintf(fp,
@@ -50,61 +60,556 @@ void plot (char name[]) {
 		"set grid\n"
 	);
 
+	// Text files hold u and |F(u)| in columns of their own.  Binary
+	// files hold only the real and imaginary parts, after a header,
+	// so u comes from the point number and |F(u)| is worked out.
+	if (precision == DATAFILE_TEXT) {
+		snprintf(source, sizeof(source), "\"../data/data_%s_m%d_N%d.dat\"", name, mode, N);
+		snprintf(real_cols, sizeof(real_cols), "2:3");
+		snprintf(abs_cols, sizeof(abs_cols), "2:5");
+	} else {
+		if (strcmp(name, "band") == 0) {
+			start = ctx->band_start;
+			step = ctx->band_step;
+		} else {
+			start = -N;
+		}
+		snprintf(source, sizeof(source),
+			"\"../data/data_%s_m%d_N%d.bin\" binary skip=%d format=\"%%float%d%%float%d\"",
+			name, mode, N, (int)sizeof(datafile_header), 8*precision, 8*precision);
+		snprintf(real_cols, sizeof(real_cols), "(%.17g+%.17g*$0):1", start, step);
+		snprintf(abs_cols, sizeof(abs_cols), "(%.17g+%.17g*$0):(sqrt($1*$1+$2*$2))", start, step);
+	}
+
 	if (mode == 8) {
 		fprintf(fp, "set ylabel \"Re(h(X))\"\n");
 		fprintf(fp, "set xlabel \"X\"\n");
 		fprintf(fp, "set output \"real_%s_m%d_N%d.jpg\"\n", name, mode, N);
-		fprintf(fp, "plot \"../data/data_%s_m%d_N%d.dat\" u 2:3 with lines\n", name, mode, N);
+		fprintf(fp, "plot %s u %s with lines\n", source, real_cols);
 		fprintf(fp, "set ylabel \"|h(X)|\"\n");
 		fprintf(fp, "set xlabel \"X\"\n");
 		fprintf(fp, "set output \"abs_%s_m%d_N%d.jpg\"\n", name, mode, N);
-		fprintf(fp, "plot \"../data/data_%s_m%d_N%d.dat\" u 2:5 with lines\n", name, mode, N);
+		fprintf(fp, "plot %s u %s with lines\n", source, abs_cols);
 	} else {
 		fprintf(fp, "set ylabel \"Re(F(u))\"\n");
 		fprintf(fp, "set output \"real_%s_m%d_N%d.jpg\"\n", name, mode, N);
-		fprintf(fp, "plot \"../data/data_%s_m%d_N%d.dat\" u 2:3 with lines\n", name, mode, N);
+		fprintf(fp, "plot %s u %s with lines\n", source, real_cols);
 		fprintf(fp, "set ylabel \"|F(u)|\"\n");
 		fprintf(fp, "set output \"abs_%s_m%d_N%d.jpg\"\n", name, mode, N);
-		fprintf(fp, "plot \"../data/data_%s_m%d_N%d.dat\" u 2:5 with lines\n", name, mode, N);
+		fprintf(fp, "plot %s u %s with lines\n", source, abs_cols);
 	}
 
 	// Close file
-	fclose(fp);
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Draw a plot as images in place of the gnuplot script: line plots
+	 of the real part and the magnitude of array, against the index,
+	 in plots/real_<name>_m<mode>_N<N> and abs_ likewise.
+
+	 *ctx: context the plot is for, which sets the mode, the image
+				 format and the scale
+	 *array: the points
+	 count: number of points
+	 name[]: string identifier for the plot
+
+	 Returns 0, or -1 if the images could not be written or memory
+	 could not be allocated.
+	 */
+int plot_image(dft_context *ctx, double complex *array, int count, char name[]) {
+	// index variable
+	int i;
+	// the real parts, then the magnitudes
+	double *values;
+	// buffer for the filename
+	char filename[80] = { };
+	int status;
+	const int N = ctx->plan->N, mode = ctx->mode;
+
+	if ((values = malloc(count * sizeof(double))) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		*(values + i) = creal(*(array + i));
+	}
+	snprintf(filename, sizeof(filename), "plots/real_%s_m%d_N%d.%s",
+		name, mode, N, render_extension(ctx->render));
+	status = render_line(values, count, ctx->render_scale, ctx->render, filename);
+
+	for (i = 0; i < count; i++) {
+		*(values + i) = cabs(*(array + i));
+	}
+	snprintf(filename, sizeof(filename), "plots/abs_%s_m%d_N%d.%s",
+		name, mode, N, render_extension(ctx->render));
+	if (status == 0) {
+		status = render_line(values, count, ctx->render_scale, ctx->render, filename);
+	}
+	free(values);
+	return status;
 }
 
-/* Writes data in array to a file for plotting purposes
-	 Space delimited file:
+/* Writes data in array to a file for plotting purposes.
+	 By default this is a binary file (datafile.c): a header, then
+	 the real and imaginary parts of each point.  With -text it is
+	 the old space delimited file:
 	 0 index real_part imag_part magnitude
 
 	 The 0 column is to facilitate a vector plot, though this
 	 is not done from this programme
 
+	 *ctx: context the data is for, which sets the mode and format
 	 *array: data to be written to the file
 	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
 	 */
-void write_datafile(double complex *array, char name[]) {
+int write_datafile(dft_context *ctx, double complex *array, char name[]) {
+	// File pointer
+	FILE *fp;
+	// index variables, and the end of a block
+	int i, k, end;
+	// a block in split form, and its magnitudes
+	double re[SPLIT_BLOCK], im[SPLIT_BLOCK], magnitude[SPLIT_BLOCK];
+	// buffer for the filename
+	char filename[80] = { };
+	// header of a binary file
+	datafile_header header;
+	const int N = ctx->plan->N, mode = ctx->mode;
+
+	// A binary file is a single write, or a block by block
+	// conversion for single precision
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.bin", name, mode, N);
+		datafile_header_init(&header, ctx->output_precision, mode, 1, 2*N);
+		header.col0 = -N;
+		return datafile_write(filename, &header, array);
+	}
+
+	// Set filename according to identifier, N and execution mode
+	snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.dat", name, mode, N);
+	// Open file if possible
+	if ((fp = fopen(filename, "w")) == NULL) {
+		return -1;
+	}
+
+	// Write data to file.  With the split layout the magnitudes
+	// come from the SIMD kernel, a block at a time.
+	if (ctx->plan->layout == LAYOUT_SPLIT) {
+		for (i = 0; i < 2*N; i += SPLIT_BLOCK) {
+			end = (2*N - i < SPLIT_BLOCK) ? 2*N - i : SPLIT_BLOCK;
+			split_from_interleaved(array + i, re, im, 0, end, 1.0, 1.0);
+			split_magnitude(re, im, magnitude, 0, end);
+			for (k = 0; k < end; k++) {
+				fprintf(fp, "0 %d %.9g %.9g %.9g\n", i+k-N, re[k], im[k], magnitude[k]);
+			}
+		}
+	} else {
+		for (i = 0; i < 2*N; i++) {
+			fprintf(fp, "0 %d %.9g %.9g %.9g\n", i-N,
+				creal(*(array+i)), cimag(*(array+i)), cabs(*(array+i)));
+		}
+	}
+	// Close file
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Writes F(u) for a band of frequencies to a file, in the same
+	 format as write_datafile() but with the frequency u in place
+	 of the index.
+
+	 *ctx: context the data is for, which sets the mode, format and band
+	 *array: data to be written to the file
+	 name[]: string identifier for data file.
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int write_banddata(dft_context *ctx, double complex *array, char name[]) {
 	// File pointer
 	FILE *fp;
 	// index variable
 	int i;
 	// buffer for the filename
-	char filename[50] = { };
+	char filename[80] = { };
+	// header of a binary file
+	datafile_header header;
+	const int N = ctx->plan->N, mode = ctx->mode;
+
+	// The header of a binary file gives the frequencies
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.bin", name, mode, N);
+		datafile_header_init(&header, ctx->output_precision, mode, 1, ctx->band_count);
+		header.col0 = ctx->band_start;
+		header.col_step = ctx->band_step;
+		return datafile_write(filename, &header, array);
+	}
 
 	// Set filename according to identifier, N and execution mode
-	sprintf(filename, "data/data_%s_m%d_N%d.dat", name, mode, N);
-	// Open file if possible, otherwise quit with error message
+	snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.dat", name, mode, N);
+	// Open file if possible
 	if ((fp = fopen(filename, "w")) == NULL) {
-		printf("Unable to open file to write data\n");
-		_exit(4);
+		return -1;
 	}
 
 	// Write data to file
-	for (i = 0; i < 2*N; i++) {
-		fprintf(fp, "0 %d %.9g %.9g %.9g\n", i-N,
+	for (i = 0; i < ctx->band_count; i++) {
+		fprintf(fp, "0 %.9g %.9g %.9g %.9g\n", ctx->band_start + i*ctx->band_step,
 			creal(*(array+i)), cimag(*(array+i)), cabs(*(array+i)));
 	}
 	// Close file
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Create the file a spectrogram is written to as it is found,
+	 and fill in its header: a binary file (datafile.c) with a row per
+	 frame, or with -text a space delimited file of lines
+	 x u real_part imag_part magnitude
+	 with x the middle of the frame and a blank line after each frame.
+
+	 *ctx: context the data is for, which sets the mode and format
+	 *header: filled in for the file; rows counts the frames written
+	 *stream: the stream the frames come from
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *open_spectrogram(dft_context *ctx, datafile_header *header, stft_stream *stream) {
+	// File pointer
+	FILE *fp;
+	// buffer for the filename
+	char filename[80] = { };
+	const int N = ctx->plan->N, mode = ctx->mode, precision = ctx->output_precision;
+
+	// Frame k is centred on sample k*hop + N.  Real signals only have
+	// u from 0 up.
+	datafile_header_init(header, (precision == DATAFILE_TEXT) ? DATAFILE_FLOAT64 : precision,
+											 mode, 0, stream->bins);
+	header->dims = 2;
+	header->row0 = N;
+	header->row_step = stream->hop;
+	header->col0 = stream->real ? 0 : -N;
+
+	if (precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_stft_m%d_N%d.bin", mode, N);
+		fp = datafile_create(filename, header);
+	} else {
+		snprintf(filename, sizeof(filename), "data/data_stft_m%d_N%d.dat", mode, N);
+		fp = fopen(filename, "w");
+	}
+	return fp;
+}
+
+/* Append frames to a spectrogram file from open_spectrogram().
+
+	 *ctx: context the data is for
+	 *fp: the file
+	 *header: its header
+	 *array: frames frames of header->cols points each
+	 frames: number of frames
+
+	 Returns 0, or -1 if they could not be written.
+	 */
+int write_spectrogram(dft_context *ctx, FILE *fp, datafile_header *header,
+											double complex *array, int frames) {
+	// index variables
+	int f, i;
+	// x of the frame
+	double x;
+	// the frame's row of the array
+	double complex *row;
+
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		if (datafile_append(fp, header, array, (size_t)frames * header->cols) != 0) {
+			return -1;
+		}
+		header->rows += frames;
+		return 0;
+	}
+
+	for (f = 0; f < frames; f++) {
+		x = header->row0 + header->rows * header->row_step;
+		row = array + (size_t)f * header->cols;
+		for (i = 0; i < header->cols; i++) {
+			fprintf(fp, "%.9g %.9g %.9g %.9g %.9g\n", x, header->col0 + i,
+				creal(*(row+i)), cimag(*(row+i)), cabs(*(row+i)));
+		}
+		fprintf(fp, "\n");
+		header->rows++;
+	}
+	return ferror(fp) ? -1 : 0;
+}
+
+/* Finish a spectrogram file from open_spectrogram().
+
+	 *ctx: context the data is for
+	 *fp: the file
+	 *header: its header
+
+	 Returns 0, or -1 if it could not be written.
+	 */
+int close_spectrogram(dft_context *ctx, FILE *fp, datafile_header *header) {
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		return datafile_close(fp, header);
+	}
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Create the file a sweep is written to as it is found, and fill
+	 in its header: a binary file (datafile.c) with a row per
+	 aperture, or with -text a space delimited file of lines
+	 aperture u real_part imag_part magnitude
+	 with a blank line after each aperture.  Rows are appended with
+	 write_spectrogram() and the file finished with
+	 close_spectrogram(), as for a spectrogram.
+
+	 *ctx: context the data is for, which sets the mode and format
+	 *header: filled in for the file; rows counts the apertures written
+
+	 Returns the file, or NULL if it could not be created.
+	 */
+FILE *open_sweep(dft_context *ctx, datafile_header *header) {
+	// File pointer
+	FILE *fp;
+	// buffer for the filename
+	char filename[80] = { };
+	const int N = ctx->plan->N, mode = ctx->mode, precision = ctx->output_precision;
+
+	// Rows are numbered by aperture, as in the list of parameters
+	datafile_header_init(header, (precision == DATAFILE_TEXT) ? DATAFILE_FLOAT64 : precision,
+											 mode, 0, 2*N);
+	header->dims = 2;
+	header->col0 = -N;
+
+	if (precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_sweep_m%d_N%d.bin", mode, N);
+		fp = datafile_create(filename, header);
+	} else {
+		snprintf(filename, sizeof(filename), "data/data_sweep_m%d_N%d.dat", mode, N);
+		fp = fopen(filename, "w");
+	}
+	return fp;
+}
+
+/* Write the parameters of every aperture of a sweep to a text file,
+	 one line each in the order of the rows of the sweep file:
+	 aperture width centre height
+
+	 *ctx: context the data is for, which sets the mode
+	 *range: the sweep
+
+	 Returns 0, or -1 if the file could not be written.
+	 */
+int write_sweep_params(dft_context *ctx, sweep_range *range) {
+	// File pointer
+	FILE *fp;
+	// buffer for the filename
+	char filename[80] = { };
+	// index variable, and the parameters of an aperture
+	long long i;
+	int width, centre;
+	double height;
+	const int N = ctx->plan->N, mode = ctx->mode;
+
+	snprintf(filename, sizeof(filename), "data/data_sweep_m%d_N%d_params.dat", mode, N);
+	if ((fp = fopen(filename, "w")) == NULL) {
+		return -1;
+	}
+	for (i = 0; i < sweep_count(range); i++) {
+		sweep_aperture(range, i, &width, &centre, &height);
+		fprintf(fp, "%lld %d %d %.9g\n", i, width, centre, height);
+	}
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Draw a file of rows of F(u), from a spectrogram or a sweep, as a
+	 heatmap of |F(u)| against the row and u, reading RENDER_BATCH rows
+	 at a time.
+	 */
+static int image_map(dft_context *ctx, datafile_header *header, char name[]) {
+	// File pointer
+	FILE *fp;
+	// buffer for the filename
+	char filename[80] = { };
+	// header of a binary file as it was read back
+	datafile_header file_header;
+	// the map, and a batch of rows of it
+	render_map *map;
+	double *values;
+	// index variables, and the rows in the batch
+	int i, k, rows;
+	int status = 0;
+	const int N = ctx->plan->N, cols = header->cols;
+
+	// A spectrogram of a signal shorter than a frame has no rows
+	if (header->rows == 0) {
+		return 0;
+	}
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.bin", name, header->mode, N);
+		fp = datafile_open(filename, &file_header);
+	} else {
+		snprintf(filename, sizeof(filename), "data/data_%s_m%d_N%d.dat", name, header->mode, N);
+		fp = fopen(filename, "r");
+	}
+	if (fp == NULL) {
+		return -1;
+	}
+	if ((map = render_map_create(header->rows, cols)) == NULL
+		|| (values = malloc(2 * (size_t)RENDER_BATCH * cols * sizeof(double))) == NULL) {
+		render_map_destroy(map);
+		fclose(fp);
+		return -1;
+	}
+
+	for (i = 0; i < header->rows && status == 0; i += rows) {
+		rows = (header->rows - i < RENDER_BATCH) ? header->rows - i : RENDER_BATCH;
+		if (ctx->output_precision != DATAFILE_TEXT) {
+			// The magnitudes overwrite the points they come from
+			if (datafile_read_values(fp, file_header.precision, values, 2 * (size_t)rows * cols)
+					!= 2 * (size_t)rows * cols) {
+				status = -1;
+			}
+			for (k = 0; k < rows * cols; k++) {
+				*(values + k) = hypot(*(values + 2*k), *(values + 2*k + 1));
+			}
+		} else {
+			// Lines of x u real_part imag_part magnitude
+			for (k = 0; k < rows * cols && status == 0; k++) {
+				if (fscanf(fp, "%*f %*f %*f %*f %lf", values + k) != 1) {
+					status = -1;
+				}
+			}
+		}
+		if (status == 0) {
+			render_map_rows(map, values, rows);
+		}
+	}
 	fclose(fp);
+	free(values);
+
+	snprintf(filename, sizeof(filename), "plots/abs_%s_m%d_N%d.%s",
+		name, header->mode, N, render_extension(ctx->render));
+	if (status == 0) {
+		status = render_map_write(map, ctx->render_scale, ctx->render, filename);
+	}
+	render_map_destroy(map);
+	return status;
+}
+
+/* Write a gnuplot script to plot a file of rows of F(u), from a
+	 spectrogram or a sweep, as a map of |F(u)| against the row and u,
+	 or with -render draw the map as an image.
+	 */
+static int plot_map(dft_context *ctx, datafile_header *header, char name[], char row_label[]) {
+	// File pointer
+	FILE *fp;
+	// buffer for the filename
+	char filename[80] = { };
+	// The data file as gnuplot is to read it
+	char source[200] = { };
+	const int N = ctx->plan->N;
+
+	if (ctx->render != RENDER_NONE) {
+		return image_map(ctx, header, name);
+	}
+
+	if (ctx->output_precision != DATAFILE_TEXT) {
+		snprintf(source, sizeof(source),
+			"\"../data/data_%s_m%d_N%d.bin\" binary skip=%d array=(%d,%d) scan=yx "
+			"origin=(%.17g,%.17g) dx=%.17g dy=1 format=\"%%float%d%%float%d\" "
+			"u (sqrt($1*$1+$2*$2))",
+			name, header->mode, N, (int)sizeof(datafile_header), header->cols, header->rows,
+			header->row0, header->col0, header->row_step, 8*header->precision, 8*header->precision);
+	} else {
+		snprintf(source, sizeof(source), "\"../data/data_%s_m%d_N%d.dat\" u 1:2:5",
+			name, header->mode, N);
+	}
+
+	snprintf(filename, sizeof(filename), "plots/plot_%s_m%d_N%d.p", name, header->mode, N);
+	if ((fp = fopen(filename, "w")) == NULL) {
+		return -1;
+	}
+	fprintf(fp,
+		"set terminal jpeg size 1000,750\n"
+
+		"set view map\n"
+		"set xlabel \"%s\"\n"
+		"set ylabel \"u\"\n"
+		"set cblabel \"|F(u)|\"\n"
+		"set key off\n",
+		row_label
+	);
+	fprintf(fp, "set output \"abs_%s_m%d_N%d.jpg\"\n", name, header->mode, N);
+	fprintf(fp, "splot %s with pm3d\n", source);
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/* Write a gnuplot script to plot a spectrogram file as a map of
+	 |F(u)| against x and u, or with -render draw the map as an image.
+
+	 *ctx: context the data is for
+	 *header: header of the finished file
+
+	 Returns 0, or -1 if the script or image could not be written.
+	 */
+int plot_spectrogram(dft_context *ctx, datafile_header *header) {
+	return plot_map(ctx, header, "stft", "x");
+}
+
+/* Write a gnuplot script to plot a sweep file as a map of |F(u)|
+	 against the aperture and u, or with -render draw the map as an
+	 image.
+
+	 *ctx: context the data is for
+	 *header: header of the finished file
+
+	 Returns 0, or -1 if the script or image could not be written.
+	 */
+int plot_sweep(dft_context *ctx, datafile_header *header) {
+	return plot_map(ctx, header, "sweep", "aperture");
+}
+
+/* Read the list of modes from the command line into modes: a
+	 single mode number, several separated by commas, or "all".
+
+	 arg[]: the argument
+
+	 Returns the number of modes, or 0 if arg is not a list of them.
+	 */
+static int parse_modes(char arg[]) {
+	// index variable, and number of modes
+	int i, n = 1;
+	// mode number read, and the character after it
+	long value;
+	char *end;
+
+	// "all" leaves out STFT_MODE and LOAD_MODE, which need a file to read
+	if (strcmp(arg, "all") == 0) {
+		n = STFT_MODE;
+	} else {
+		for (i = 0; arg[i] != '\0'; i++) {
+			if (arg[i] == ',') {
+				n++;
+			}
+		}
+	}
+
+	if ((modes = malloc(n * sizeof(int))) == NULL) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (strcmp(arg, "all") == 0) {
+			*(modes + i) = i;
+			continue;
+		}
+		value = strtol(arg, &end, 10);
+		if (end == arg || value < 0 || value >= NMODES || (*end != ',' && *end != '\0')) {
+			return 0;
+		}
+		*(modes + i) = (int)value;
+		arg = end + 1;
+	}
+	return n;
 }
 
 /* Get user parameters and set global variables accordingly.
@@ -114,40 +619,317 @@ void write_datafile(double complex *array, char name[]) {
 	 *argvec[]: pointer to string array of the parameters
 	 */
 void set_params(int count, char *argvec[]) {
+	// index variable
+	int i;
+	// Half the number of points, from the command line
+	int N = DEFAULT_N;
+	// Band of frequencies to zoom in on, and its end
+	double band_start = 0.0, band_step = 0.0, band_end;
+	int band_count = 0;
+	// Precision of the data files, or DATAFILE_TEXT, and of the
+	// convolution
+	int output_precision = DATAFILE_FLOAT64, precision = DATAFILE_FLOAT64;
+	// Number of threads, 0 for one per processor
+	int threads = 0;
+	// How the transforms hold the data
+	int layout = LAYOUT_INTERLEAVED;
+	// Pages for the data arrays, and the bytes they need
+	int pages = ARENA_THP;
+	size_t size = 0;
+	// Whether to time the plan's choices, and the directory they
+	// are kept in, NULL for the default
+	int tune = 0;
+	char *plans_dir = NULL;
+	// Image format of the plots, RENDER_NONE for gnuplot scripts,
+	// and their scale
+	int render = RENDER_NONE, render_scale = RENDER_LINEAR;
+	// The width or centre range being read, the last height of the
+	// sweep, and a width and centre of it with the runs they make
+	int *range, width, centre;
+	double height_end;
+	rle_run runs[SWEEP_MAX_RUNS];
+
 	// If _exit() is called before these are assigned then a free() will be
 	// attempted with garbage pointers.  If they are NULL, free() will
 	// do nothing.
-	real_space = NULL;
-	freq_space = NULL;
-	convolved = NULL;
+	modes = NULL;
+	nmodes = 0;
+	contexts = NULL;
+	ncontexts = 0;
+	buffer_arena = NULL;
+	plan = NULL;
+	input_file = NULL;
+	input_space = NULL;
+	stft_raw = 0;
+	stft_hop = 0;
+	stft_window = STFT_HANN;
+	sweep.slits = 1;
+	sweep.width[0] = sweep.width[1] = 10;
+	sweep.width[2] = 1;
+	sweep.centre[0] = sweep.centre[1] = 0;
+	sweep.centre[2] = 1;
+	sweep.height_start = 1.0;
+	sweep.height_step = 0.0;
+	sweep.height_count = 1;
 
 	// Check the number of inputs is correct.
 	// If not, display help and exit cleanly.
-	if (count != 2) {
+	if (count < 2) {
 		help();
 		_exit(2);
 	}
 
 	// Assign input parameters.  Display help and exit cleanly if error.
-	// Mode is the only parameter that can sensibly be zero, otherwise
-	// return value 0 indicates error.
-	if ((mode = atoi(*(++argvec))) == 0 && (*argvec)[0] != '0') {
+	if ((nmodes = parse_modes(*(++argvec))) == 0) {
 		help();
 		_exit(2);
 	}
 
-	// Allocate memory for data arrays. Exit cleanly if there is an error.
-	if ( ( real_space = malloc(2*N * sizeof(double complex)) ) == NULL
-		|| ( freq_space = malloc(2*N * sizeof(double complex)) ) == NULL ) {
+	// Any options follow the modes
+	for (i = 2; i < count; i++) {
+		if (strcmp(*(++argvec), "-N") == 0 && i+1 < count) {
+			i++;
+			if ((N = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-split") == 0) {
+			layout = LAYOUT_SPLIT;
+		} else if (strcmp(*argvec, "-text") == 0) {
+			output_precision = DATAFILE_TEXT;
+		} else if (strcmp(*argvec, "-render") == 0 && i+1 < count) {
+			i++;
+			if (strcmp(*(++argvec), "ppm") == 0) {
+				render = RENDER_PPM;
+			} else if (strcmp(*argvec, "png") == 0) {
+				render = RENDER_PNG;
+			} else {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-log") == 0) {
+			render_scale = RENDER_LOG;
+		} else if (strcmp(*argvec, "-float") == 0) {
+			output_precision = DATAFILE_FLOAT32;
+		} else if (strcmp(*argvec, "-single") == 0) {
+			precision = DATAFILE_FLOAT32;
+		} else if (strcmp(*argvec, "-t") == 0 && i+1 < count) {
+			i++;
+			if ((threads = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-band") == 0 && i+3 < count) {
+			i += 3;
+			band_start = atof(*(++argvec));
+			band_end = atof(*(++argvec));
+			if ((band_count = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+			band_step = (band_count > 1) ? (band_end - band_start) / (band_count - 1) : 0.0;
+		} else if (strcmp(*argvec, "-huge") == 0 && i+1 < count) {
+			i++;
+			if (strcmp(*(++argvec), "off") == 0) {
+				pages = ARENA_SMALL;
+			} else if (strcmp(*argvec, "thp") == 0) {
+				pages = ARENA_THP;
+			} else if (strcmp(*argvec, "tlb") == 0) {
+				pages = ARENA_HUGETLB;
+			} else {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-slits") == 0 && i+1 < count) {
+			i++;
+			if ((sweep.slits = atoi(*(++argvec))) != 1 && sweep.slits != 2) {
+				help();
+				_exit(2);
+			}
+		} else if ((strcmp(*argvec, "-width") == 0 || strcmp(*argvec, "-centre") == 0) && i+3 < count) {
+			i += 3;
+			range = (strcmp(*argvec, "-width") == 0) ? sweep.width : sweep.centre;
+			*range = atoi(*(++argvec));
+			*(range + 1) = atoi(*(++argvec));
+			*(range + 2) = atoi(*(++argvec));
+			if (*(range + 1) < *range || *(range + 2) < 1 || (range == sweep.width && *range < 1)) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-height") == 0 && i+3 < count) {
+			i += 3;
+			sweep.height_start = atof(*(++argvec));
+			height_end = atof(*(++argvec));
+			if ((sweep.height_count = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+			sweep.height_step = (sweep.height_count > 1)
+													? (height_end - sweep.height_start) / (sweep.height_count - 1) : 0.0;
+		} else if (strcmp(*argvec, "-tune") == 0) {
+			tune = 1;
+		} else if (strcmp(*argvec, "-plans") == 0 && i+1 < count) {
+			i++;
+			plans_dir = *(++argvec);
+		} else if (strcmp(*argvec, "-input") == 0 && i+1 < count) {
+			i++;
+			input_file = *(++argvec);
+		} else if (strcmp(*argvec, "-raw") == 0 && i+1 < count) {
+			i++;
+			stft_raw = atoi(*(++argvec));
+			if (stft_raw != DATAFILE_FLOAT32 && stft_raw != DATAFILE_FLOAT64) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-hop") == 0 && i+1 < count) {
+			i++;
+			if ((stft_hop = atoi(*(++argvec))) < 1) {
+				help();
+				_exit(2);
+			}
+		} else if (strcmp(*argvec, "-window") == 0 && i+1 < count) {
+			i++;
+			if (strcmp(*(++argvec), "rect") == 0) {
+				stft_window = STFT_RECTANGULAR;
+			} else if (strcmp(*argvec, "hann") == 0) {
+				stft_window = STFT_HANN;
+			} else if (strcmp(*argvec, "hamming") == 0) {
+				stft_window = STFT_HAMMING;
+			} else if (strcmp(*argvec, "blackman") == 0) {
+				stft_window = STFT_BLACKMAN;
+			} else {
+				help();
+				_exit(2);
+			}
+		} else {
+			help();
+			_exit(2);
+		}
+	}
+
+	// The sweep's apertures are numbered by the rows of one file
+	if (sweep_count(&sweep) > INT_MAX) {
+		help();
+		_exit(2);
+	}
+
+	// The spectrogram and the loaded f(x) have nothing to work on
+	// without an input file.  A loaded f(x) sets N.  Only the mode 8
+	// convolution has a single precision path, so -single is refused
+	// for the rest rather than quietly done in double.
+	for (i = 0; i < nmodes; i++) {
+		if (precision == DATAFILE_FLOAT32 && *(modes + i) != 8) {
+			printf("-single applies only to mode 8, not mode %d\n", *(modes + i));
+			_exit(2);
+		}
+		if ((*(modes + i) == STFT_MODE || *(modes + i) == LOAD_MODE) && input_file == NULL) {
+			help();
+			_exit(2);
+		}
+		if (*(modes + i) == LOAD_MODE && input_space == NULL) {
+			if ((input_space = datafile_map(input_file, &input_header)) == NULL
+				|| input_header.rows != 1 || input_header.cols % 2 != 0) {
+				printf("Unable to read input file\n");
+				_exit(5);
+			}
+			N = input_header.cols / 2;
+		}
+	}
+	// The spectrogram's frames are 2N samples, by default half
+	// overlapping
+	if (stft_hop == 0) {
+		stft_hop = N;
+	}
+
+	// Any N can be planned up to a limit set by the padding of
+	// Bluestein's algorithm, and by the 4N roots of unity of the plan
+	// fitting an int; past it, say so rather than failing to plan it
+	if (N > INT_MAX / 4 || !fft_supported(2*N)) {
+		printf("N = %d is too large to transform\n", N);
+		_exit(2);
+	}
+
+	// Start the threads the transforms and modes are shared out among,
+	// which -tune times the transforms on
+	threads_init(threads);
+
+	// Order the stages of the FFTs as the plan cache says, or as the
+	// timings say with -tune: the length 2N transform, and the half
+	// length ones inside the real and cosine transforms
+	if (tune_init(plans_dir, tune) != 0) {
+		printf("Unable to create the plan cache directory\n");
+		_exit(4);
+	}
+	if (tune_fft(2*N, layout) != 0 || tune_fft(N, LAYOUT_INTERLEAVED) != 0
+		|| (N%2 == 0 && tune_fft(N/2, LAYOUT_INTERLEAVED) != 0)) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+
+	// Build the plan used by dft()
+	if ( (plan = dft_plan_create(N, layout)) == NULL ) {
 		printf("Unable to allocate memory for data array(s)");
 		_exit(1);
 	}
 
-	// When in convolution mode we need a third array for data storage
-	if ( mode == 8 && (convolved = malloc(2*N * sizeof(double complex))) == NULL ) {
+	// Set up a context for each thread that will be running modes,
+	// with the data arrays for all of them from one arena sized to
+	// fit.  Exit cleanly if there is an error.
+	ncontexts = (nmodes < threads_count()) ? nmodes : threads_count();
+	if ( (contexts = calloc(ncontexts, sizeof(dft_context))) == NULL ) {
 		printf("Unable to allocate memory for data array(s)");
 		_exit(1);
 	}
+	for (i = 0; i < ncontexts; i++) {
+		dft_context_init(contexts + i, plan);
+		(contexts + i)->output_precision = output_precision;
+		(contexts + i)->precision = precision;
+		(contexts + i)->band_start = band_start;
+		(contexts + i)->band_step = band_step;
+		(contexts + i)->band_count = band_count;
+		(contexts + i)->render = render;
+		(contexts + i)->render_scale = render_scale;
+		size += dft_context_alloc(contexts + i, NULL, ncontexts > 1);
+	}
+	if ( (buffer_arena = arena_create(size, pages)) == NULL ) {
+		printf("Unable to allocate memory for data array(s)");
+		_exit(1);
+	}
+	for (i = 0; i < ncontexts; i++) {
+		dft_context_alloc(contexts + i, buffer_arena, ncontexts > 1);
+	}
+
+	// So must the aperture of every other mode
+	for (i = 0; i < nmodes; i++) {
+		if (!mode_fits(contexts, *(modes + i))) {
+			printf("The aperture of mode %d does not fit in N = %d\n", *(modes + i), N);
+			_exit(2);
+		}
+	}
+
+	// Every aperture of a sweep must fit between x = -N and N-1
+	for (i = 0; i < nmodes; i++) {
+		if (*(modes + i) != SWEEP_MODE) {
+			continue;
+		}
+		for (width = sweep.width[0]; width <= sweep.width[1]; width += sweep.width[2]) {
+			for (centre = sweep.centre[0]; centre <= sweep.centre[1]; centre += sweep.centre[2]) {
+				if (slit_runs(contexts, sweep.slits, width, 1.0, centre, runs) < 0) {
+					help();
+					_exit(2);
+				}
+			}
+		}
+	}
+
+	// How sparse f(x) must be for the direct sum, likewise
+	if (tune_get("sparse1d", N, 0, layout, &plan->sparse_limit, 1) != 1 && tune) {
+		plan->sparse_limit = dft_measure_sparse(contexts);
+		if (tune_put("sparse1d", N, 0, layout, &plan->sparse_limit, 1) != 0) {
+			printf("Unable to allocate memory for data array(s)");
+			_exit(1);
+		}
+	}
 }
 
 /* Exit cleanly, freeing any dynamically allocated memory first.
@@ -156,9 +938,14 @@ void set_params(int count, char *argvec[]) {
 	 code: Exit status
 	 */
 void _exit(int code) {
-	free(real_space);
-	free(freq_space);
-	free(convolved);
+	// The data arrays all go with their arena
+	arena_destroy(buffer_arena);
+	free(contexts);
+	free(modes);
+	datafile_unmap(input_space, &input_header);
+	dft_plan_destroy(plan);
+	threads_shutdown();
+	tune_finish();
 	printf("Exit status: %d\n", code);
 	exit(code);
 }
@@ -166,15 +953,63 @@ void _exit(int code) {
 /* Display parameter list and modes
 	 */
 void help(void) {
-	printf("3 input parameters are required as follows in the following order:\n\n"
-				 "int mode            The mode number\n\n\n");
+	printf("The mode number is required, optionally followed by options:\n\n"
+				 "int mode            The mode number.  Several modes separated\n"
+				 "                    by commas, or \"all\", are run in one go,\n"
+				 "                    side by side on the threads\n\n"
+				 "-N int              x runs from -N to N-1 (default %d).  Any N\n"
+				 "                    works; fastest when 2N factors into 2s, 3s, 5s\n\n"
+				 "-t int              Number of threads (default one per\n"
+				 "                    processor)\n\n"
+				 "-huge off|thp|tlb   Pages for the data arrays: small, or 2 MB\n"
+				 "                    transparent (default) or hugetlbfs ones\n\n"
+				 "-split              Transform and multiply with real and\n"
+				 "                    imaginary parts in separate arrays, using\n"
+				 "                    the widest SIMD the processor has\n\n"
+				 "-band u1 u2 int     Only find F(u) at this many evenly spaced\n"
+				 "                    u from u1 to u2, which need not be integers\n\n"
+				 "-tune               Time the ways the transforms could be\n"
+				 "                    done at this N, and keep the fastest in\n"
+				 "                    the plan cache for later runs\n\n"
+				 "-plans dir          Plan cache directory (default %s).  If\n"
+				 "                    it exists, later runs use what is in it,\n"
+				 "                    with or without -tune\n\n"
+				 "-float              Write the data files in single precision\n\n"
+				 "-single             Convolve in single precision: half the\n"
+				 "                    memory, to about 1e-7 of the largest\n"
+				 "                    point.  Mode 8 only\n\n"
+				 "-text               Write the data files as text, one point\n"
+				 "                    per line, rather than binary\n\n"
+				 "-render ppm|png     Draw the plots as images in plots/, in\n"
+				 "                    place of the gnuplot scripts\n\n"
+				 "-log                Draw the images on a log scale of the\n"
+				 "                    magnitude, %d decades deep\n\n"
+				 "-input file         Signal for mode 9: a data file, or with\n"
+				 "                    -raw, bare real samples.  f(x) for mode\n"
+				 "                    10: a data file of one row, or a text\n"
+				 "                    file as -text writes, of 2N points\n\n"
+				 "-raw 4|8            The -input file is raw floats or doubles\n\n"
+				 "-hop int            Samples from one frame of mode 9 to the\n"
+				 "                    next (default N)\n\n"
+				 "-window name        Window for mode 9: rect, hann (default),\n"
+				 "                    hamming or blackman\n\n"
+				 "-slits 1|2          Single slits, or double slits at +/- the\n"
+				 "                    centre, for mode 11 (default 1)\n\n"
+				 "-width w1 w2 int    Slit widths for mode 11, from w1 to w2 in\n"
+				 "                    steps of int (default 10 only)\n\n"
+				 "-centre c1 c2 int   Slit centres for mode 11, likewise\n"
+				 "                    (default 0 only)\n\n"
+				 "-height h1 h2 int   This many evenly spaced slit heights from\n"
+				 "                    h1 to h2 for mode 11 (default 1.0 only)\n\n\n",
+				 DEFAULT_N, TUNE_CACHE_DIR, RENDER_DECADES);
 
 	printf("EXIT STATUSES:\n\n"
 				 "0 -                 Successfully executed\n"
 				 "1 -                 Unable to allocate memory for data arrays\n"
 				 "2 -                 Input error\n"
 				 "3 -                 Unable to open file for plotting\n"
-				 "4 -                 Unable to open file to write data\n\n\n");
+				 "4 -                 Unable to open file to write data\n"
+				 "5 -                 Unable to read input file\n\n\n");
 
 	printf("MODES:\n\n"
 				 "0 -                 Single slit width 10, height 1.0, centre 0\n"
@@ -186,5 +1021,12 @@ void help(void) {
 				 "6 -                 Double slit width 40, height 1.0, centres +/- 25\n"
 				 "7 -                 Double slit width 40, height 0.5, centres +/- 25\n"
 				 "8 -                 Single slit width 20, height 1.0, centre 0\n"
-				 "                    Convolve with itself, square FT\n");
+				 "                    Convolve with itself, square FT\n"
+				 "9 -                 Spectrogram of the -input signal, frames\n"
+				 "                    of 2N samples.  Not part of \"all\"\n"
+				 "10 -                f(x) from the -input file, which sets N.\n"
+				 "                    Not part of \"all\"\n"
+				 "11 -                Every slit aperture of the -slits, -width,\n"
+				 "                    -centre and -height ranges, into one file\n"
+				 "                    with a row per aperture.  Not part of \"all\"\n");
 }
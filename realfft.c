@@ -0,0 +1,311 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Transforms of real data.
+
+The transform of n real points x is Hermitian, X[n-k] = conj(X[k]),
+so half of it is redundant.  Packing the even and odd points into
+one complex array of n/2 points, z[k] = x[2k] + i x[2k+1], and
+transforming that gives Z = E + i O, where E and O are the
+transforms of the even and odd points.  Both are Hermitian too, so
+they can be separated again from Z[k] and Z[n/2-k], and then
+X[k] = E[k] + w^k O[k] as in one radix 2 step.
+
+Real data that is also even, x[j] = x[2n-j], has a real and even
+transform, a type I cosine transform of n+1 points.  That comes
+from one real transform of n points of a suitably mixed sequence
+(Numerical Recipes, section 12.3), a quarter of the work of the
+complex transform of all 2n points.
+*/
+
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+#include "realfft.h"
+#include "twiddle.h"
+#include "threads.h"
+
+/* The arguments of the passes shared out among the threads */
+struct real_pass {
+	fft_real_plan *plan;
+	double *input;
+	int stride;
+	double complex *output;
+	// for the cosine transform: partial sums for the odd term
+	double *partial;
+};
+
+/* w^k where w = exp(sign * 2 pi i / n), taken from the table of 2n
+	 roots.  0 <= k < n.
+	 */
+static inline double complex half_root(fft_real_plan *plan, int k) {
+	return CMPLX(creal(*(plan->table + 2*k)), plan->sign * cimag(*(plan->table + 2*k)));
+}
+
+/* Pack the points from first to last-1 of the complex array:
+	 z[k] = x[2k] + i x[2k+1] */
+static void pack(struct real_pass *pass, int first, int last) {
+	// index variable
+	int k;
+	const int stride = pass->stride;
+
+	for (k = first; k < last; k++) {
+		*(pass->output + k) = CMPLX(*(pass->input + 2*k*stride),
+																*(pass->input + (2*k + 1)*stride));
+	}
+}
+
+static void pack_body(void *arg, int chunk, int first, int last) {
+	pack(arg, first, last);
+}
+
+/* Separate the transforms of the even and odd points again and
+	 combine them, for the pairs k, h-k with k from first+1 to last.
+	 Z[k] = E[k] + i O[k] and Z[h-k] = conj(E[k]) + i conj(O[k]), so
+	 E[k] = (Z[k] + conj Z[h-k])/2, O[k] = (Z[k] - conj Z[h-k])/2i,
+	 and then X[k] = E[k] + w^k O[k], X[h-k] = conj(E[k] - w^k O[k]).
+	 */
+static void unscramble(struct real_pass *pass, int first, int last) {
+	// index variable
+	int k;
+	// the pair of packed points, the halves and the twiddled odd half
+	double complex a, b, e, o;
+	double complex *out = pass->output;
+	const int h = pass->plan->n / 2;
+
+	for (k = first + 1; k <= last; k++) {
+		a = *(out + k);
+		b = *(out + h - k);
+		e = 0.5 * CMPLX(creal(a) + creal(b), cimag(a) - cimag(b));
+		o = 0.5 * CMPLX(cimag(a) + cimag(b), creal(b) - creal(a));
+		o = cmul(o, half_root(pass->plan, k));
+		*(out + k) = e + o;
+		*(out + h - k) = conj(e - o);
+	}
+}
+
+static void unscramble_body(void *arg, int chunk, int first, int last) {
+	unscramble(arg, first, last);
+}
+
+/* Real transform, shared out among the threads if parallel is set.
+	 work is only used when it is not. */
+static void execute_r2c(fft_real_plan *plan, double *input, int stride,
+												double complex *output, double complex *work, int parallel) {
+	// the packed first point
+	double complex z0;
+	struct real_pass pass = {plan, input, stride, output, NULL};
+	const int h = plan->n / 2;
+	// Consecutive points already in output are packed as they stand
+	const int packed = (stride == 1 && input == (double *)output);
+
+	if (parallel) {
+		if (!packed) {
+			parallel_for(h, FFT_PARALLEL_GRAIN, pack_body, &pass);
+		}
+		fft_execute(plan->half, output, output);
+		parallel_for(h / 2, FFT_PARALLEL_GRAIN, unscramble_body, &pass);
+	} else {
+		if (!packed) {
+			pack(&pass, 0, h);
+		}
+		fft_execute_work(plan->half, output, output, work);
+		unscramble(&pass, 0, h / 2);
+	}
+
+	// The ends are the sum and difference of the even and odd parts,
+	// and purely real
+	z0 = *output;
+	*output = creal(z0) + cimag(z0);
+	*(output + h) = creal(z0) - cimag(z0);
+}
+
+/* Mix the pairs of points j, n-j for j from first+1 to last into
+	 the sequence whose real transform gives the cosine transform:
+	 z[j] = (y[j] + y[n-j])/2 - sin(pi j/n) (y[j] - y[n-j]), and
+	 z[n-j] the same with the sign of the sine term changed.  z is
+	 written over the output array, ready packed for the real
+	 transform.  The partial sum of (y[j] - y[n-j]) cos(pi j/n), which gives the
+	 first odd point of the transform, is stored for the chunk.
+	 */
+static void mix(struct real_pass *pass, int chunk, int first, int last) {
+	// index variable
+	int j;
+	// half sum and weighted difference of the pair
+	double p, q;
+	// partial sum of the first odd point
+	double sum = 0.0;
+	double *y = pass->input;
+	double *z = (double *)pass->output;
+	const int n = pass->plan->n;
+
+	for (j = first + 1; j <= last; j++) {
+		sum += (*(y + j) - *(y + n - j)) * creal(*(pass->plan->table + j));
+		p = 0.5 * (*(y + j) + *(y + n - j));
+		q = cimag(*(pass->plan->table + j)) * (*(y + j) - *(y + n - j));
+		*(z + j) = p - q;
+		*(z + n - j) = p + q;
+	}
+	*(pass->partial + chunk) = sum;
+}
+
+static void mix_body(void *arg, int chunk, int first, int last) {
+	mix(arg, chunk, first, last);
+}
+
+/* Cosine transform, shared out among the threads if parallel is
+	 set.  work is only used when it is not. */
+static void execute_dct1(fft_real_plan *plan, double *data, double complex *spectrum,
+												 double complex *work, int parallel) {
+	// index variable
+	int k;
+	// the first odd point, and the latest one
+	double c1, odd;
+	// partial sums of the first odd point, one per chunk
+	double partial[threads_count()];
+	struct real_pass pass = {plan, data, 1, spectrum, partial};
+	const int n = plan->n;
+	const int h = n / 2;
+
+	for (k = 0; k < threads_count(); k++) {
+		partial[k] = 0.0;
+	}
+	c1 = 0.5 * (*data - *(data + n));
+	*((double *)spectrum) = 0.5 * (*data + *(data + n));
+	*((double *)spectrum + h) = *(data + h);
+	if (parallel) {
+		parallel_for(h - 1, FFT_PARALLEL_GRAIN, mix_body, &pass);
+	} else {
+		mix(&pass, 0, 0, h - 1);
+	}
+	for (k = 0; k < threads_count(); k++) {
+		c1 += partial[k];
+	}
+
+	execute_r2c(plan, (double *)spectrum, 1, spectrum, work, parallel);
+
+	// The even points are the real parts of the transform.  The odd
+	// ones are a running sum of the imaginary parts, starting from c1.
+	odd = c1;
+	*data = creal(*spectrum);
+	*(data + 1) = c1;
+	for (k = 1; k < h; k++) {
+		odd += plan->sign * cimag(*(spectrum + k));
+		*(data + 2*k) = creal(*(spectrum + k));
+		*(data + 2*k + 1) = odd;
+	}
+	*(data + n) = creal(*(spectrum + h));
+}
+
+/* Build a plan for transforms of n real points.
+	 The transform computed is the unnormalised
+	 out[k] = sum_j in[j] exp(sign * 2 pi i j k / n), k = 0 ... n/2
+
+	 n: number of points, even
+	 sign: sign of the exponent, +1 or -1
+
+	 Returns NULL if n is odd or memory could not be allocated.
+	 */
+fft_real_plan *fft_real_plan_create(int n, int sign) {
+	// plan under construction
+	fft_real_plan *plan;
+
+	if (n < 2 || n % 2 != 0 || (plan = calloc(1, sizeof(fft_real_plan))) == NULL) {
+		return NULL;
+	}
+	plan->n = n;
+	plan->sign = (sign < 0) ? -1 : 1;
+
+	if ( (plan->half = fft_plan_create(n / 2, plan->sign)) == NULL
+		|| (plan->table = twiddle_acquire(2*n)) == NULL ) {
+		fft_real_plan_destroy(plan);
+		return NULL;
+	}
+
+	return plan;
+}
+
+/* Transform n real points into the n/2+1 points of their transform
+	 that are not conjugates of others.  The input points are stride
+	 doubles apart, so the real parts of a complex array can be
+	 transformed where they are.  Long transforms are shared out among
+	 the threads; the half length plan's own scratch space is used, so
+	 a plan must not be executed this way by two threads at once.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *input: pointer to the first of the n real points
+	 stride: distance between the input points, in doubles
+	 *output: pointer to the start of the array where the n/2+1
+	 					transformed points will be stored
+	 */
+void fft_execute_r2c(fft_real_plan *plan, double *input, int stride, double complex *output) {
+	execute_r2c(plan, input, stride, output, NULL, 1);
+}
+
+/* As fft_execute_r2c(), on the calling thread alone with scratch
+	 space supplied by the caller.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *input: pointer to the first of the n real points
+	 stride: distance between the input points, in doubles
+	 *output: pointer to the start of the array where the n/2+1
+	 					transformed points will be stored
+	 *work: scratch space of fft_real_work_size(plan) points
+	 */
+void fft_execute_r2c_work(fft_real_plan *plan, double *input, int stride,
+													double complex *output, double complex *work) {
+	execute_r2c(plan, input, stride, output, work, 0);
+}
+
+/* Type I discrete cosine transform of n+1 points, in place:
+	 out[k] = (in[0] + (-1)^k in[n])/2 + sum_{j=1}^{n-1} in[j] cos(pi j k / n)
+	 for k = 0 ... n.  This is the transform of real data that is
+	 even about 0 and n, found from a real transform of n points, so
+	 it costs about a quarter of the complex transform of the 2n
+	 points of the data extended by symmetry.  Long transforms are
+	 shared out among the threads as by fft_execute_r2c().
+
+	 *plan: plan built by fft_real_plan_create()
+	 *data: the n+1 points, replaced by their transform
+	 *spectrum: scratch space of n/2+1 points
+	 */
+void fft_execute_dct1(fft_real_plan *plan, double *data, double complex *spectrum) {
+	execute_dct1(plan, data, spectrum, NULL, 1);
+}
+
+/* As fft_execute_dct1(), on the calling thread alone with scratch
+	 space supplied by the caller.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *data: the n+1 points, replaced by their transform
+	 *spectrum: scratch space of n/2+1 points
+	 *work: scratch space of fft_real_work_size(plan) points
+	 */
+void fft_execute_dct1_work(fft_real_plan *plan, double *data, double complex *spectrum,
+													 double complex *work) {
+	execute_dct1(plan, data, spectrum, work, 0);
+}
+
+/* Number of points of scratch space the _work functions need.
+
+	 *plan: plan built by fft_real_plan_create()
+	 */
+int fft_real_work_size(fft_real_plan *plan) {
+	return fft_work_size(plan->half);
+}
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void fft_real_plan_destroy(fft_real_plan *plan) {
+	if (plan == NULL) {
+		return;
+	}
+	fft_plan_destroy(plan->half);
+	twiddle_release(plan->table);
+	free(plan);
+}
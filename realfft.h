@@ -0,0 +1,112 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the transforms of real data.
+Plan structure and function prototypes.
+
+*/
+
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <complex.h>
+#include "fft.h"
+
+/* A plan for transforms of n real points, n even.  The transform of
+	 real data is Hermitian, out[n-k] = conj(out[k]), so only points
+	 0 to n/2 need finding, and they come from one complex FFT of half
+	 the length.  The same plan does the type I cosine transform of
+	 n+1 points.
+	 */
+typedef struct fft_real_plan {
+	// Number of real points, and the sign of the exponent
+	int n;
+	int sign;
+	// Complex FFT of n/2 points
+	fft_plan *half;
+	// The 2n roots of unity exp(pi i k / n), shared through
+	// twiddle_acquire(): the twiddles for length n are every other
+	// one, and the cosine transform needs the half angles
+	double complex *table;
+} fft_real_plan;
+
+/* Build a plan for transforms of n real points.
+	 The transform computed is the unnormalised
+	 out[k] = sum_j in[j] exp(sign * 2 pi i j k / n), k = 0 ... n/2
+
+	 n: number of points, even
+	 sign: sign of the exponent, +1 or -1
+
+	 Returns NULL if n is odd or memory could not be allocated.
+	 */
+fft_real_plan *fft_real_plan_create(int n, int sign);
+
+/* Transform n real points into the n/2+1 points of their transform
+	 that are not conjugates of others.  The input points are stride
+	 doubles apart, so the real parts of a complex array can be
+	 transformed where they are.  Long transforms are shared out among
+	 the threads; the half length plan's own scratch space is used, so
+	 a plan must not be executed this way by two threads at once.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *input: pointer to the first of the n real points
+	 stride: distance between the input points, in doubles
+	 *output: pointer to the start of the array where the n/2+1
+	 					transformed points will be stored
+	 */
+void fft_execute_r2c(fft_real_plan *plan, double *input, int stride, double complex *output);
+
+/* As fft_execute_r2c(), on the calling thread alone with scratch
+	 space supplied by the caller.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *input: pointer to the first of the n real points
+	 stride: distance between the input points, in doubles
+	 *output: pointer to the start of the array where the n/2+1
+	 					transformed points will be stored
+	 *work: scratch space of fft_real_work_size(plan) points
+	 */
+void fft_execute_r2c_work(fft_real_plan *plan, double *input, int stride,
+													double complex *output, double complex *work);
+
+/* Type I discrete cosine transform of n+1 points, in place:
+	 out[k] = (in[0] + (-1)^k in[n])/2 + sum_{j=1}^{n-1} in[j] cos(pi j k / n)
+	 for k = 0 ... n.  This is the transform of real data that is
+	 even about 0 and n, found from a real transform of n points, so
+	 it costs about a quarter of the complex transform of the 2n
+	 points of the data extended by symmetry.  Long transforms are
+	 shared out among the threads as by fft_execute_r2c().
+
+	 *plan: plan built by fft_real_plan_create()
+	 *data: the n+1 points, replaced by their transform
+	 *spectrum: scratch space of n/2+1 points
+	 */
+void fft_execute_dct1(fft_real_plan *plan, double *data, double complex *spectrum);
+
+/* As fft_execute_dct1(), on the calling thread alone with scratch
+	 space supplied by the caller.
+
+	 *plan: plan built by fft_real_plan_create()
+	 *data: the n+1 points, replaced by their transform
+	 *spectrum: scratch space of n/2+1 points
+	 *work: scratch space of fft_real_work_size(plan) points
+	 */
+void fft_execute_dct1_work(fft_real_plan *plan, double *data, double complex *spectrum,
+													 double complex *work);
+
+/* Number of points of scratch space the _work functions need.
+
+	 *plan: plan built by fft_real_plan_create()
+	 */
+int fft_real_work_size(fft_real_plan *plan);
+
+/* Free a plan and everything it holds.  NULL is ignored.
+
+	 *plan: plan to be freed
+	 */
+void fft_real_plan_destroy(fft_real_plan *plan);
+
+#endif
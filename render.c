@@ -0,0 +1,660 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Images drawn in the programme itself.
+
+Gnuplot takes longer to draw a plot than the transform takes to
+find it, so the plots can instead be drawn here, straight from the
+data, as line plots of F(u) and heatmaps of the maps and of
+F(u,v).  The pixels are shared out among the threads.  The images
+are written as binary PPM, or as PNG compressed with a small deflate
+of its own: fixed Huffman codes, with the only matches those against
+the pixel before and the row above, which is where plots repeat
+themselves.  There are no axis labels; the images are for looking
+over a sweep quickly, and without -render the gnuplot scripts are
+written as before, for figures.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "render.h"
+#include "threads.h"
+
+// Colours of a line plot: the background, the frame and zero axis,
+// and the line
+#define BACKGROUND 255
+#define FRAME 160
+#define LINE_RED 32
+#define LINE_GREEN 64
+#define LINE_BLUE 192
+
+// Longest match deflate allows
+#define DEFLATE_MAX_MATCH 258
+// Furthest back a match can reach
+#define DEFLATE_WINDOW 32768
+
+/* The range of data points, first to last-1, that pixel k of size
+	 pixels covers, for count points in all.  Every point is covered,
+	 and every pixel covers at least one.
+	 */
+static void pixel_span(int k, int size, int count, int *first, int *last) {
+	*first = (int)((long long)k * count / size);
+	*last = (int)((long long)(k+1) * count / size);
+	if (*last <= *first) {
+		*last = *first + 1;
+	}
+}
+
+/* Colour of a point on a scale from 0 to 1, on gnuplot's default
+	 palette for pm3d: black through blue, red and yellow.
+
+	 t: the point on the scale
+	 *rgb: its colour
+	 */
+static void palette(double t, unsigned char *rgb) {
+	double blue = sin(2.0 * M_PI * t);
+
+	*rgb = (unsigned char)(255.0 * sqrt(t) + 0.5);
+	*(rgb + 1) = (unsigned char)(255.0 * t*t*t + 0.5);
+	*(rgb + 2) = (unsigned char)(255.0 * (blue > 0.0 ? blue : 0.0) + 0.5);
+}
+
+/* Start a heatmap of RENDER_WIDTH by RENDER_HEIGHT pixels.
+
+	 rows, cols: size of the data
+
+	 Returns the map, or NULL if memory could not be allocated.
+	 */
+render_map *render_map_create(int rows, int cols) {
+	render_map *map;
+
+	if (rows < 1 || cols < 1 || (map = malloc(sizeof(render_map))) == NULL) {
+		return NULL;
+	}
+	if ((map->cells = calloc((size_t)RENDER_WIDTH * RENDER_HEIGHT, sizeof(double))) == NULL) {
+		free(map);
+		return NULL;
+	}
+	map->rows = rows;
+	map->cols = cols;
+	map->done = 0;
+	return map;
+}
+
+// What each thread needs to fold rows into a heatmap
+struct map_args {
+	render_map *map;
+	const double *values;
+	int count;
+};
+
+/* Fold the rows in args into columns first to last-1 of the image.
+	 Each thread has columns of its own, so no pixel is shared.
+	 */
+static void map_rows_body(void *arg, int chunk, int first, int last) {
+	struct map_args *args = arg;
+	render_map *map = args->map;
+	// index variables
+	int x, y, i, j;
+	// the data rows and columns a pixel covers
+	int row_first, row_last, col_first, col_last;
+	// the pixel being worked on
+	double *cell;
+	const double *point;
+
+	for (x = first; x < last; x++) {
+		pixel_span(x, RENDER_WIDTH, map->rows, &row_first, &row_last);
+		// Only the part of the column's rows in this batch
+		if (row_first < map->done) {
+			row_first = map->done;
+		}
+		if (row_last > map->done + args->count) {
+			row_last = map->done + args->count;
+		}
+		if (row_first >= row_last) {
+			continue;
+		}
+		for (y = 0; y < RENDER_HEIGHT; y++) {
+			pixel_span(y, RENDER_HEIGHT, map->cols, &col_first, &col_last);
+			cell = map->cells + (size_t)x*RENDER_HEIGHT + y;
+			for (i = row_first; i < row_last; i++) {
+				point = args->values + (size_t)(i - map->done) * map->cols;
+				for (j = col_first; j < col_last; j++) {
+					if (fabs(*(point + j)) > fabs(*cell)) {
+						*cell = *(point + j);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Fold the next rows of data into a heatmap.  The pixels are shared
+	 out among the threads.
+
+	 *map: the heatmap
+	 *values: count rows of cols values
+	 count: number of rows
+	 */
+void render_map_rows(render_map *map, const double *values, int count) {
+	struct map_args args;
+
+	if (count > map->rows - map->done) {
+		count = map->rows - map->done;
+	}
+	args.map = map;
+	args.values = values;
+	args.count = count;
+	parallel_for(RENDER_WIDTH, RENDER_GRAIN, map_rows_body, &args);
+	map->done += count;
+}
+
+// What each thread needs to colour a heatmap
+struct colour_args {
+	const render_map *map;
+	int scale;
+	// the value at the bottom of the scale and the scale's length
+	double low;
+	double range;
+	unsigned char *pixels;
+};
+
+/* Colour image rows first to last-1 of a heatmap, counting from
+	 the top.
+	 */
+static void colour_body(void *arg, int chunk, int first, int last) {
+	struct colour_args *args = arg;
+	// index variables
+	int x, y;
+	// the pixel's value, and where it lies on the scale
+	double value, t;
+
+	for (y = first; y < last; y++) {
+		for (x = 0; x < RENDER_WIDTH; x++) {
+			value = *(args->map->cells + (size_t)x*RENDER_HEIGHT + (RENDER_HEIGHT - 1 - y));
+			if (args->scale == RENDER_LOG) {
+				value = (value != 0.0) ? log10(fabs(value)) : args->low;
+			}
+			t = (args->range > 0.0) ? (value - args->low) / args->range : 0.0;
+			t = (t < 0.0) ? 0.0 : (t > 1.0) ? 1.0 : t;
+			palette(t, args->pixels + 3*((size_t)y*RENDER_WIDTH + x));
+		}
+	}
+}
+
+/* Write pixels out as a binary PPM: a short text header, then the
+	 red, green and blue bytes of each pixel.
+	 */
+static int write_ppm(const unsigned char *pixels, int width, int height, const char filename[]) {
+	FILE *fp;
+	size_t size = 3 * (size_t)width * height;
+
+	if ((fp = fopen(filename, "wb")) == NULL) {
+		return -1;
+	}
+	if (fprintf(fp, "P6\n%d %d\n255\n", width, height) < 0
+		|| fwrite(pixels, 1, size, fp) != size) {
+		fclose(fp);
+		return -1;
+	}
+	return (fclose(fp) == 0) ? 0 : -1;
+}
+
+// Bits on their way into a deflate stream, least significant first
+struct bit_writer {
+	unsigned char *out;
+	size_t size;
+	uint32_t bits;
+	int count;
+};
+
+/* Append the low count bits of value to the stream.
+	 */
+static void put_bits(struct bit_writer *w, uint32_t value, int count) {
+	w->bits |= value << w->count;
+	w->count += count;
+	while (w->count >= 8) {
+		*(w->out + w->size++) = w->bits & 0xff;
+		w->bits >>= 8;
+		w->count -= 8;
+	}
+}
+
+/* Append a Huffman code of length bits, which deflate sends most
+	 significant bit first.
+	 */
+static void put_code(struct bit_writer *w, uint32_t code, int length) {
+	uint32_t reversed = 0;
+	int i;
+
+	for (i = 0; i < length; i++) {
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+	put_bits(w, reversed, length);
+}
+
+/* Append a literal, length or end of block symbol in the fixed
+	 Huffman code.
+	 */
+static void put_symbol(struct bit_writer *w, int symbol) {
+	if (symbol < 144) {
+		put_code(w, 0x30 + symbol, 8);
+	} else if (symbol < 256) {
+		put_code(w, 0x190 + symbol - 144, 9);
+	} else if (symbol < 280) {
+		put_code(w, symbol - 256, 7);
+	} else {
+		put_code(w, 0xc0 + symbol - 280, 8);
+	}
+}
+
+/* Append a match of length bytes, distance bytes back.
+	 */
+static void put_match(struct bit_writer *w, int length, int distance) {
+	static const int length_base[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const int length_extra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const int distance_base[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const int distance_extra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	int code;
+
+	// 258 has a code of its own, which must be used
+	for (code = 28; length_base[code] > length || (code == 28 && length != 258); code--);
+	put_symbol(w, 257 + code);
+	put_bits(w, length - length_base[code], length_extra[code]);
+	for (code = 29; distance_base[code] > distance; code--);
+	put_code(w, code, 5);
+	put_bits(w, distance - distance_base[code], distance_extra[code]);
+}
+
+/* Compress data into a zlib stream of one fixed Huffman block.
+	 Each byte is matched against the bytes back and stride back, the
+	 longer match winning.
+
+	 *data, size: the bytes to compress
+	 back, stride: the distances to match at
+	 *out: room for the stream, at least size*9/8 + 16 bytes
+
+	 Returns the length of the stream.
+	 */
+static size_t deflate_fixed(const unsigned char *data, size_t size, int back, int stride, unsigned char *out) {
+	struct bit_writer w = { out, 0, 0, 0 };
+	// position, the best match there, and a candidate
+	size_t i;
+	int best, best_distance, length, k;
+	int distances[2];
+	// running sums of the Adler-32 checksum
+	uint32_t a = 1, b = 0;
+
+	distances[0] = back;
+	distances[1] = (stride <= DEFLATE_WINDOW) ? stride : back;
+
+	// zlib header: deflate with a 32K window, no dictionary.  The
+	// block is final and uses the fixed codes.
+	*(w.out + w.size++) = 0x78;
+	*(w.out + w.size++) = 0x01;
+	put_bits(&w, 1, 1);
+	put_bits(&w, 1, 2);
+
+	for (i = 0; i < size; ) {
+		best = 0;
+		best_distance = 0;
+		for (k = 0; k < 2; k++) {
+			if (i < (size_t)distances[k]) {
+				continue;
+			}
+			for (length = 0; length < DEFLATE_MAX_MATCH && i + length < size
+					 && *(data + i + length) == *(data + i + length - distances[k]); length++);
+			if (length > best) {
+				best = length;
+				best_distance = distances[k];
+			}
+		}
+		if (best >= 3) {
+			put_match(&w, best, best_distance);
+			i += best;
+		} else {
+			put_symbol(&w, *(data + i));
+			i++;
+		}
+	}
+	put_symbol(&w, 256);
+	// Flush the last byte
+	put_bits(&w, 0, 7);
+
+	for (i = 0; i < size; i++) {
+		a = (a + *(data + i)) % 65521;
+		b = (b + a) % 65521;
+	}
+	for (k = 3; k >= 0; k--) {
+		*(w.out + w.size++) = ((b << 16 | a) >> (8*k)) & 0xff;
+	}
+	return w.size;
+}
+
+/* Write a 32 bit number most significant byte first.
+	 */
+static void put_u32(unsigned char *p, uint32_t value) {
+	*p = value >> 24;
+	*(p + 1) = (value >> 16) & 0xff;
+	*(p + 2) = (value >> 8) & 0xff;
+	*(p + 3) = value & 0xff;
+}
+
+/* Write a PNG chunk: its length, type and data, then the CRC of the
+	 type and data.
+
+	 *fp: the file
+	 *crc_table: the CRC-32 of each byte
+	 type[]: four letter chunk type
+	 *data, size: the chunk's data
+	 */
+static int write_chunk(FILE *fp, const uint32_t *crc_table, const char type[], const unsigned char *data, size_t size) {
+	unsigned char word[4];
+	uint32_t crc = 0xffffffff;
+	size_t i;
+
+	for (i = 0; i < 4; i++) {
+		crc = *(crc_table + ((crc ^ (unsigned char)type[i]) & 0xff)) ^ (crc >> 8);
+	}
+	for (i = 0; i < size; i++) {
+		crc = *(crc_table + ((crc ^ *(data + i)) & 0xff)) ^ (crc >> 8);
+	}
+	put_u32(word, size);
+	if (fwrite(word, 1, 4, fp) != 4 || fwrite(type, 1, 4, fp) != 4
+		|| (size > 0 && fwrite(data, 1, size, fp) != size)) {
+		return -1;
+	}
+	put_u32(word, crc ^ 0xffffffff);
+	return (fwrite(word, 1, 4, fp) == 4) ? 0 : -1;
+}
+
+/* Write pixels out as an 8 bit RGB PNG.
+	 */
+static int write_png(const unsigned char *pixels, int width, int height, const char filename[]) {
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+	FILE *fp;
+	// index variables
+	int y, k;
+	uint32_t crc_table[256], c;
+	// the header, the rows each led by their filter type, and the
+	// compressed stream
+	unsigned char header[13];
+	unsigned char *raw, *stream;
+	const size_t stride = 3 * (size_t)width + 1, size = stride * height;
+	size_t length;
+	int status = 0;
+
+	for (y = 0; y < 256; y++) {
+		for (c = y, k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		}
+		crc_table[y] = c;
+	}
+
+	// The rows go in unfiltered
+	if ((raw = malloc(size)) == NULL) {
+		return -1;
+	}
+	if ((stream = malloc(size + size/8 + 16)) == NULL) {
+		free(raw);
+		return -1;
+	}
+	for (y = 0; y < height; y++) {
+		*(raw + y*stride) = 0;
+		memcpy(raw + y*stride + 1, pixels + 3*(size_t)y*width, 3*(size_t)width);
+	}
+	length = deflate_fixed(raw, size, 3, stride, stream);
+
+	put_u32(header, width);
+	put_u32(header + 4, height);
+	// 8 bits per channel, RGB, deflate, adaptive filtering, not interlaced
+	header[8] = 8;
+	header[9] = 2;
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+
+	if ((fp = fopen(filename, "wb")) == NULL) {
+		status = -1;
+	} else {
+		if (fwrite(signature, 1, 8, fp) != 8
+			|| write_chunk(fp, crc_table, "IHDR", header, sizeof(header)) != 0
+			|| write_chunk(fp, crc_table, "IDAT", stream, length) != 0
+			|| write_chunk(fp, crc_table, "IEND", NULL, 0) != 0) {
+			status = -1;
+		}
+		if (fclose(fp) != 0) {
+			status = -1;
+		}
+	}
+	free(raw);
+	free(stream);
+	return status;
+}
+
+/* Write pixels out in an image format.
+	 */
+static int write_image(const unsigned char *pixels, int format, const char filename[]) {
+	if (format == RENDER_PNG) {
+		return write_png(pixels, RENDER_WIDTH, RENDER_HEIGHT, filename);
+	}
+	return write_ppm(pixels, RENDER_WIDTH, RENDER_HEIGHT, filename);
+}
+
+/* Colour a heatmap and write it out as an image.
+
+	 *map: the heatmap, with all its rows passed in
+	 scale: RENDER_LINEAR or RENDER_LOG
+	 format: RENDER_PPM or RENDER_PNG
+	 filename[]: file to write
+
+	 Returns 0, or -1 if the file could not be written or memory
+	 could not be allocated.
+	 */
+int render_map_write(render_map *map, int scale, int format, const char filename[]) {
+	struct colour_args args;
+	// index variable
+	size_t i;
+	// the extremes of the map
+	double low, high, value;
+	int status;
+
+	low = high = (scale == RENDER_LOG) ? 0.0 : *map->cells;
+	for (i = 0; i < (size_t)RENDER_WIDTH * RENDER_HEIGHT; i++) {
+		value = (scale == RENDER_LOG) ? fabs(*(map->cells + i)) : *(map->cells + i);
+		low = (value < low) ? value : low;
+		high = (value > high) ? value : high;
+	}
+	if (scale == RENDER_LOG) {
+		// Nothing but zeros is all at the bottom of the scale
+		high = (high > 0.0) ? log10(high) : 0.0;
+		low = high - RENDER_DECADES;
+	}
+
+	args.map = map;
+	args.scale = scale;
+	args.low = low;
+	args.range = high - low;
+	if ((args.pixels = malloc(3 * (size_t)RENDER_WIDTH * RENDER_HEIGHT)) == NULL) {
+		return -1;
+	}
+	parallel_for(RENDER_HEIGHT, RENDER_GRAIN, colour_body, &args);
+	status = write_image(args.pixels, format, filename);
+	free(args.pixels);
+	return status;
+}
+
+/* Free a heatmap.  NULL is ignored.
+	 */
+void render_map_destroy(render_map *map) {
+	if (map != NULL) {
+		free(map->cells);
+		free(map);
+	}
+}
+
+// What each thread needs to draw part of a line plot
+struct line_args {
+	const double *values;
+	int count;
+	int scale;
+	// the values at the bottom and top of the plot
+	double low;
+	double high;
+	unsigned char *pixels;
+};
+
+/* A value as it is plotted: itself, or on a logarithmic scale the
+	 log of its magnitude, held at the bottom of the plot.
+	 */
+static double line_value(const struct line_args *args, int k) {
+	double value = *(args->values + k);
+
+	if (args->scale == RENDER_LOG) {
+		value = (value != 0.0) ? log10(fabs(value)) : args->low;
+		value = (value < args->low) ? args->low : value;
+	}
+	return value;
+}
+
+/* The plotted value at a point between two data points, joining them
+	 with a straight line.
+	 */
+static double line_at(const struct line_args *args, double position) {
+	int k = (int)position;
+
+	if (k >= args->count - 1) {
+		return line_value(args, args->count - 1);
+	}
+	return line_value(args, k) + (position - k) * (line_value(args, k+1) - line_value(args, k));
+}
+
+/* Pixel row of a plotted value, counting from the top of the image.
+	 */
+static int line_row(const struct line_args *args, double value) {
+	const int height = RENDER_HEIGHT - 2*RENDER_MARGIN;
+
+	return RENDER_MARGIN + (height - 1)
+				 - (int)lround((value - args->low) / (args->high - args->low) * (height - 1));
+}
+
+/* Draw plot columns first to last-1 of a line plot.  Each column
+	 covers a stretch of the data, and is drawn from the least to the
+	 greatest value in it, so that the line is unbroken and spikes
+	 between columns still show.
+	 */
+static void line_body(void *arg, int chunk, int first, int last) {
+	struct line_args *args = arg;
+	// index variables
+	int column, row, k;
+	// the stretch of the data the column covers, and the least and
+	// greatest value in it
+	double start, end, least, most, value;
+	unsigned char *pixel;
+	const int width = RENDER_WIDTH - 2*RENDER_MARGIN;
+
+	for (column = first; column < last; column++) {
+		start = (double)column * (args->count - 1) / width;
+		end = (double)(column + 1) * (args->count - 1) / width;
+		least = most = line_at(args, start);
+		value = line_at(args, end);
+		least = (value < least) ? value : least;
+		most = (value > most) ? value : most;
+		for (k = (int)ceil(start); k <= (int)end && k < args->count; k++) {
+			value = line_value(args, k);
+			least = (value < least) ? value : least;
+			most = (value > most) ? value : most;
+		}
+		for (row = line_row(args, most); row <= line_row(args, least); row++) {
+			pixel = args->pixels + 3*((size_t)row*RENDER_WIDTH + RENDER_MARGIN + column);
+			*pixel = LINE_RED;
+			*(pixel + 1) = LINE_GREEN;
+			*(pixel + 2) = LINE_BLUE;
+		}
+	}
+}
+
+/* Draw values as a line plot, against their index, and write it out
+	 as an image.  The pixel columns are shared out among the threads.
+
+	 *values: the points
+	 count: number of points
+	 scale: RENDER_LINEAR or RENDER_LOG
+	 format: RENDER_PPM or RENDER_PNG
+	 filename[]: file to write
+
+	 Returns 0, or -1 if the file could not be written or memory
+	 could not be allocated.
+	 */
+int render_line(const double *values, int count, int scale, int format, const char filename[]) {
+	struct line_args args;
+	// index variables
+	int i, row;
+	double value;
+	int status;
+
+	if (count < 1) {
+		return -1;
+	}
+	args.values = values;
+	args.count = count;
+	args.scale = scale;
+	args.low = args.high = (scale == RENDER_LOG) ? 0.0 : *values;
+	for (i = 0; i < count; i++) {
+		value = (scale == RENDER_LOG) ? fabs(*(values + i)) : *(values + i);
+		args.low = (value < args.low) ? value : args.low;
+		args.high = (value > args.high) ? value : args.high;
+	}
+	if (scale == RENDER_LOG) {
+		args.high = (args.high > 0.0) ? log10(args.high) : 0.0;
+		args.low = args.high - RENDER_DECADES;
+	} else if (args.high == args.low) {
+		args.low -= 1.0;
+		args.high += 1.0;
+	}
+
+	if ((args.pixels = malloc(3 * (size_t)RENDER_WIDTH * RENDER_HEIGHT)) == NULL) {
+		return -1;
+	}
+	memset(args.pixels, BACKGROUND, 3 * (size_t)RENDER_WIDTH * RENDER_HEIGHT);
+
+	// The frame just outside the plot, and the zero axis
+	for (i = RENDER_MARGIN - 1; i <= RENDER_WIDTH - RENDER_MARGIN; i++) {
+		memset(args.pixels + 3*((size_t)(RENDER_MARGIN - 1)*RENDER_WIDTH + i), FRAME, 3);
+		memset(args.pixels + 3*((size_t)(RENDER_HEIGHT - RENDER_MARGIN)*RENDER_WIDTH + i), FRAME, 3);
+	}
+	for (i = RENDER_MARGIN - 1; i <= RENDER_HEIGHT - RENDER_MARGIN; i++) {
+		memset(args.pixels + 3*((size_t)i*RENDER_WIDTH + RENDER_MARGIN - 1), FRAME, 3);
+		memset(args.pixels + 3*((size_t)i*RENDER_WIDTH + RENDER_WIDTH - RENDER_MARGIN), FRAME, 3);
+	}
+	if (scale == RENDER_LINEAR && args.low < 0.0 && args.high > 0.0) {
+		row = line_row(&args, 0.0);
+		memset(args.pixels + 3*((size_t)row*RENDER_WIDTH + RENDER_MARGIN), FRAME,
+					 3 * (size_t)(RENDER_WIDTH - 2*RENDER_MARGIN));
+	}
+
+	parallel_for(RENDER_WIDTH - 2*RENDER_MARGIN, RENDER_GRAIN, line_body, &args);
+	status = write_image(args.pixels, format, filename);
+	free(args.pixels);
+	return status;
+}
+
+/* File extension for an image format, without the dot.
+	 */
+const char *render_extension(int format) {
+	return (format == RENDER_PNG) ? "png" : "ppm";
+}
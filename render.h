@@ -0,0 +1,106 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the image renderer.
+Image constants, the heatmap type and function prototypes.
+
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+// Image formats: none (gnuplot scripts instead), binary PPM or PNG
+#define RENDER_NONE 0
+#define RENDER_PPM 1
+#define RENDER_PNG 2
+
+// Colour scales: linear in the value, or logarithmic in its
+// magnitude
+#define RENDER_LINEAR 0
+#define RENDER_LOG 1
+
+// Size of every image, as the gnuplot scripts draw them
+#define RENDER_WIDTH 1000
+#define RENDER_HEIGHT 750
+// Pixels left blank around a line plot
+#define RENDER_MARGIN 10
+// Decades below the largest magnitude a logarithmic scale covers
+#define RENDER_DECADES 6
+// Fewest pixel rows or columns worth handing a thread of their own
+#define RENDER_GRAIN 16
+// Rows of data a caller converts before passing them to
+// render_map_rows()
+#define RENDER_BATCH 64
+
+/* A heatmap being drawn from rows of data that may not all fit in
+	 memory at once.  Data rows run along the image from left to
+	 right and data columns up it.  Each pixel keeps the value of
+	 largest magnitude among the points it covers, so peaks narrower
+	 than a pixel still show; on grids smaller than the image each
+	 point covers several pixels.
+	 */
+typedef struct render_map {
+	// Size of the data, and rows passed in so far
+	int rows;
+	int cols;
+	int done;
+	// The value of each pixel, a column of the image at a time, each
+	// from the bottom up
+	double *cells;
+} render_map;
+
+/* Start a heatmap of RENDER_WIDTH by RENDER_HEIGHT pixels.
+
+	 rows, cols: size of the data
+
+	 Returns the map, or NULL if memory could not be allocated.
+	 */
+render_map *render_map_create(int rows, int cols);
+
+/* Fold the next rows of data into a heatmap.  The pixels are shared
+	 out among the threads.
+
+	 *map: the heatmap
+	 *values: count rows of cols values
+	 count: number of rows
+	 */
+void render_map_rows(render_map *map, const double *values, int count);
+
+/* Colour a heatmap and write it out as an image.
+
+	 *map: the heatmap, with all its rows passed in
+	 scale: RENDER_LINEAR or RENDER_LOG
+	 format: RENDER_PPM or RENDER_PNG
+	 filename[]: file to write
+
+	 Returns 0, or -1 if the file could not be written or memory
+	 could not be allocated.
+	 */
+int render_map_write(render_map *map, int scale, int format, const char filename[]);
+
+/* Free a heatmap.  NULL is ignored.
+	 */
+void render_map_destroy(render_map *map);
+
+/* Draw values as a line plot, against their index, and write it out
+	 as an image.  The pixel columns are shared out among the threads.
+
+	 *values: the points
+	 count: number of points
+	 scale: RENDER_LINEAR or RENDER_LOG
+	 format: RENDER_PPM or RENDER_PNG
+	 filename[]: file to write
+
+	 Returns 0, or -1 if the file could not be written or memory
+	 could not be allocated.
+	 */
+int render_line(const double *values, int count, int scale, int format, const char filename[]);
+
+/* File extension for an image format, without the dot.
+	 */
+const char *render_extension(int format);
+
+#endif
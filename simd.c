@@ -0,0 +1,421 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Split-complex SIMD kernels and run time dispatch.
+
+With real and imaginary parts in separate arrays, the q loop of a
+Stockham stage reads and writes whole vectors of consecutive
+points, and a complex multiply is four multiplies and two adds on
+full registers with no shuffling.  The kernels are written once in
+simd_kernels.h, with the unrolled codelets from gen_codelets.c in
+simd_codelets.h, and built here for SSE2, AVX2 and AVX-512, each with
+GCC's target attribute so that the rest of the programme needs no
+special compiler flags.  The first call picks the best set the
+processor supports.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <pthread.h>
+#include "fft.h"
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+/* Scalar copies: every instruction set falls back on these for
+	 whatever does not fill a whole vector. */
+#define SIMD_ATTR
+#define KERNEL(name) name##_scalar
+#define VW 1
+#define VEC double
+#define VLOAD(p) (*(p))
+#define VSTORE(p, v) (*(p) = (v))
+#define VSET1(x) (x)
+#define VADD(a, b) ((a) + (b))
+#define VSUB(a, b) ((a) - (b))
+#define VMUL(a, b) ((a) * (b))
+#define VDIV(a, b) ((a) / (b))
+#define VSQRT(a) sqrt(a)
+#include "simd_kernels.h"
+#undef SIMD_ATTR
+#undef KERNEL
+#undef VW
+#undef VEC
+#undef VLOAD
+#undef VSTORE
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VDIV
+#undef VSQRT
+
+#ifdef SIMD_X86
+/* SSE2: two points per vector */
+#define SIMD_ATTR __attribute__((target("sse2")))
+#define KERNEL(name) name##_sse2
+#define VW 2
+#define VEC __m128d
+#define VLOAD(p) _mm_loadu_pd(p)
+#define VSTORE(p, v) _mm_storeu_pd((p), (v))
+#define VSET1(x) _mm_set1_pd(x)
+#define VADD(a, b) _mm_add_pd((a), (b))
+#define VSUB(a, b) _mm_sub_pd((a), (b))
+#define VMUL(a, b) _mm_mul_pd((a), (b))
+#define VDIV(a, b) _mm_div_pd((a), (b))
+#define VSQRT(a) _mm_sqrt_pd(a)
+// [r0 i0] [r1 i1] <-> [r0 r1] [i0 i1]
+#define VDEINTERLEAVE(p, r, i) { \
+	__m128d lo = _mm_loadu_pd((double *)(p)), hi = _mm_loadu_pd((double *)(p) + 2); \
+	r = _mm_unpacklo_pd(lo, hi); \
+	i = _mm_unpackhi_pd(lo, hi); \
+}
+#define VINTERLEAVE(p, r, i) { \
+	__m128d vr = (r), vi = (i); \
+	_mm_storeu_pd((double *)(p), _mm_unpacklo_pd(vr, vi)); \
+	_mm_storeu_pd((double *)(p) + 2, _mm_unpackhi_pd(vr, vi)); \
+}
+#include "simd_kernels.h"
+#undef SIMD_ATTR
+#undef KERNEL
+#undef VW
+#undef VEC
+#undef VLOAD
+#undef VSTORE
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VDIV
+#undef VSQRT
+#undef VDEINTERLEAVE
+#undef VINTERLEAVE
+
+/* AVX2: four points per vector.  FMA is left out so that the
+	 results match the scalar code exactly. */
+#define SIMD_ATTR __attribute__((target("avx2")))
+#define KERNEL(name) name##_avx2
+#define VW 4
+#define VEC __m256d
+#define VLOAD(p) _mm256_loadu_pd(p)
+#define VSTORE(p, v) _mm256_storeu_pd((p), (v))
+#define VSET1(x) _mm256_set1_pd(x)
+#define VADD(a, b) _mm256_add_pd((a), (b))
+#define VSUB(a, b) _mm256_sub_pd((a), (b))
+#define VMUL(a, b) _mm256_mul_pd((a), (b))
+#define VDIV(a, b) _mm256_div_pd((a), (b))
+#define VSQRT(a) _mm256_sqrt_pd(a)
+// Unpacking within 128 bit lanes gives r0 r2 r1 r3, so swap the
+// middle two 64 bit elements across lanes
+#define VDEINTERLEAVE(p, r, i) { \
+	__m256d lo = _mm256_loadu_pd((double *)(p)), hi = _mm256_loadu_pd((double *)(p) + 4); \
+	r = _mm256_permute4x64_pd(_mm256_unpacklo_pd(lo, hi), 0xD8); \
+	i = _mm256_permute4x64_pd(_mm256_unpackhi_pd(lo, hi), 0xD8); \
+}
+#define VINTERLEAVE(p, r, i) { \
+	__m256d vr = _mm256_permute4x64_pd((r), 0xD8), vi = _mm256_permute4x64_pd((i), 0xD8); \
+	_mm256_storeu_pd((double *)(p), _mm256_unpacklo_pd(vr, vi)); \
+	_mm256_storeu_pd((double *)(p) + 4, _mm256_unpackhi_pd(vr, vi)); \
+}
+#include "simd_kernels.h"
+#undef SIMD_ATTR
+#undef KERNEL
+#undef VW
+#undef VEC
+#undef VLOAD
+#undef VSTORE
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VDIV
+#undef VSQRT
+#undef VDEINTERLEAVE
+#undef VINTERLEAVE
+
+/* AVX-512: eight points per vector */
+#define SIMD_ATTR __attribute__((target("avx512f")))
+#define KERNEL(name) name##_avx512
+#define VW 8
+#define VEC __m512d
+#define VLOAD(p) _mm512_loadu_pd(p)
+#define VSTORE(p, v) _mm512_storeu_pd((p), (v))
+#define VSET1(x) _mm512_set1_pd(x)
+#define VADD(a, b) _mm512_add_pd((a), (b))
+#define VSUB(a, b) _mm512_sub_pd((a), (b))
+#define VMUL(a, b) _mm512_mul_pd((a), (b))
+#define VDIV(a, b) _mm512_div_pd((a), (b))
+#define VSQRT(a) _mm512_sqrt_pd(a)
+// Two-source permutes pick the even and odd elements of a pair of
+// vectors, and put them back
+#define VDEINTERLEAVE(p, r, i) { \
+	__m512d lo = _mm512_loadu_pd((double *)(p)), hi = _mm512_loadu_pd((double *)(p) + 8); \
+	r = _mm512_permutex2var_pd(lo, _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0), hi); \
+	i = _mm512_permutex2var_pd(lo, _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1), hi); \
+}
+#define VINTERLEAVE(p, r, i) { \
+	__m512d vr = (r), vi = (i); \
+	_mm512_storeu_pd((double *)(p), \
+		_mm512_permutex2var_pd(vr, _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0), vi)); \
+	_mm512_storeu_pd((double *)(p) + 8, \
+		_mm512_permutex2var_pd(vr, _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4), vi)); \
+}
+#include "simd_kernels.h"
+#undef SIMD_ATTR
+#undef KERNEL
+#undef VW
+#undef VEC
+#undef VLOAD
+#undef VSTORE
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VDIV
+#undef VSQRT
+#undef VDEINTERLEAVE
+#undef VINTERLEAVE
+#endif
+
+/* The kernels for one instruction set */
+struct simd_kernels {
+	void (*radix[6])(split_stage *, int, int, int, int);
+	void (*from_interleaved)(double complex *, double *, double *, int, int, double, double);
+	void (*to_interleaved)(double *, double *, double complex *, int, int, double, double);
+	void (*multiply)(double *, double *, double *, double *, double *, double *, int, int, double);
+	void (*magnitude)(double *, double *, double *, int, int);
+	int (*codelet)(split_stage *, int, int, int, int);
+};
+
+// Indexed by the SIMD_ constants.  Sets not built for this
+// processor family fall back on the scalar copies.
+static const struct simd_kernels kernels[4] = {
+	{ {NULL, NULL, radix2_scalar, radix3_scalar, radix4_scalar, radix5_scalar},
+		from_interleaved_scalar, to_interleaved_scalar, multiply_scalar, magnitude_scalar,
+		codelet_scalar },
+#ifdef SIMD_X86
+	{ {NULL, NULL, radix2_sse2, radix3_sse2, radix4_sse2, radix5_sse2},
+		from_interleaved_sse2, to_interleaved_sse2, multiply_sse2, magnitude_sse2,
+		codelet_sse2 },
+	{ {NULL, NULL, radix2_avx2, radix3_avx2, radix4_avx2, radix5_avx2},
+		from_interleaved_avx2, to_interleaved_avx2, multiply_avx2, magnitude_avx2,
+		codelet_avx2 },
+	{ {NULL, NULL, radix2_avx512, radix3_avx512, radix4_avx512, radix5_avx512},
+		from_interleaved_avx512, to_interleaved_avx512, multiply_avx512, magnitude_avx512,
+		codelet_avx512 },
+#else
+	{ {NULL, NULL, radix2_scalar, radix3_scalar, radix4_scalar, radix5_scalar},
+		from_interleaved_scalar, to_interleaved_scalar, multiply_scalar, magnitude_scalar,
+		codelet_scalar },
+	{ {NULL, NULL, radix2_scalar, radix3_scalar, radix4_scalar, radix5_scalar},
+		from_interleaved_scalar, to_interleaved_scalar, multiply_scalar, magnitude_scalar,
+		codelet_scalar },
+	{ {NULL, NULL, radix2_scalar, radix3_scalar, radix4_scalar, radix5_scalar},
+		from_interleaved_scalar, to_interleaved_scalar, multiply_scalar, magnitude_scalar,
+		codelet_scalar },
+#endif
+};
+
+// Best instruction set the processor supports, and the one in use
+static int best = SIMD_SCALAR;
+static int current = SIMD_SCALAR;
+static pthread_once_t detected = PTHREAD_ONCE_INIT;
+
+/* Ask the processor what it supports */
+static void detect(void) {
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		best = SIMD_AVX512;
+	} else if (__builtin_cpu_supports("avx2")) {
+		best = SIMD_AVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		best = SIMD_SSE2;
+	}
+#endif
+	current = best;
+}
+
+/* Instruction set the kernels are using.  On first call this is
+	 the best one the processor supports.
+	 */
+int simd_level(void) {
+	pthread_once(&detected, detect);
+	return current;
+}
+
+/* Use a lower instruction set than the best available, for
+	 comparison.  Asking for more than the processor has gets the
+	 most it has.
+
+	 level: one of the SIMD_ constants
+
+	 Returns the instruction set now in use.
+	 */
+int simd_select(int level) {
+	pthread_once(&detected, detect);
+	current = (level < SIMD_SCALAR) ? SIMD_SCALAR : (level > best) ? best : level;
+	return current;
+}
+
+/* Name of an instruction set, for messages.
+
+	 level: one of the SIMD_ constants
+	 */
+const char *simd_name(int level) {
+	switch (level) {
+		case SIMD_SSE2:
+			return "sse2";
+		case SIMD_AVX2:
+			return "avx2";
+		case SIMD_AVX512:
+			return "avx512";
+		default:
+			return "scalar";
+	}
+}
+
+/* Any radix without a vector kernel: a direct length p DFT per
+	 butterfly, with conjugate pairs of inputs combined as in
+	 radixg() in fft.c.
+	 */
+static void radixg_split(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q, r, t, k;
+	int p = st->p, m = st->m, s = st->s;
+	// number of conjugate pairs
+	int h = (p - 1) / 2;
+	// cos and sign*sin of 2 pi k / p, and of the twiddles for this j
+	double c[FFT_MAX_RADIX], sn[FFT_MAX_RADIX], wr, wi;
+	// sums and differences of paired inputs, and the butterfly outputs
+	double sum_r[FFT_MAX_RADIX], sum_i[FFT_MAX_RADIX], diff_r[FFT_MAX_RADIX], diff_i[FFT_MAX_RADIX];
+	double b_r[FFT_MAX_RADIX], b_i[FFT_MAX_RADIX];
+	double re_r, re_i, im_r, im_i;
+	double *xr = st->x_re, *xi = st->x_im;
+
+	for (k = 0; k < p; k++) {
+		c[k] = creal(*(st->table + k*s*m));
+		sn[k] = st->sign * cimag(*(st->table + k*s*m));
+	}
+
+	for (j = j0; j < j1; j++) {
+		for (q = q0; q < q1; q++) {
+			*b_r = *(xr + q + s*j);
+			*b_i = *(xi + q + s*j);
+			for (r = 1; r <= h; r++) {
+				sum_r[r] = *(xr + q + s*(j + r*m)) + *(xr + q + s*(j + (p-r)*m));
+				sum_i[r] = *(xi + q + s*(j + r*m)) + *(xi + q + s*(j + (p-r)*m));
+				diff_r[r] = *(xr + q + s*(j + r*m)) - *(xr + q + s*(j + (p-r)*m));
+				diff_i[r] = *(xi + q + s*(j + r*m)) - *(xi + q + s*(j + (p-r)*m));
+			}
+			for (t = 1; t <= h; t++) {
+				re_r = *(xr + q + s*j);
+				re_i = *(xi + q + s*j);
+				im_r = im_i = 0;
+				k = 0;
+				for (r = 1; r <= h; r++) {
+					k += t;
+					if (k >= p) {
+						k -= p;
+					}
+					re_r += c[k] * sum_r[r];
+					re_i += c[k] * sum_i[r];
+					im_r += sn[k] * diff_r[r];
+					im_i += sn[k] * diff_i[r];
+				}
+				// im already carries the sign, so only rotate by +i
+				b_r[t] = re_r - im_i;
+				b_i[t] = re_i + im_r;
+				b_r[p-t] = re_r + im_i;
+				b_i[p-t] = re_i - im_r;
+			}
+			for (r = 1; r <= h; r++) {
+				*b_r += sum_r[r];
+				*b_i += sum_i[r];
+			}
+			*(st->y_re + q + s*(p*j)) = *b_r;
+			*(st->y_im + q + s*(p*j)) = *b_i;
+			for (t = 1; t < p; t++) {
+				wr = creal(*(st->table + j*t*s));
+				wi = st->sign * cimag(*(st->table + j*t*s));
+				*(st->y_re + q + s*(p*j + t)) = b_r[t]*wr - b_i[t]*wi;
+				*(st->y_im + q + s*(p*j + t)) = b_r[t]*wi + b_i[t]*wr;
+			}
+		}
+	}
+}
+
+/* Do the butterflies of a stage with j from j0 to j1-1 and q from
+	 q0 to q1-1.  Radix 2 to 5, and those with a codelet in
+	 simd_codelets.h, are vectorised across q, so stages with a stride
+	 of at least the vector width run fully in SIMD.
+
+	 *stage: the stage
+	 j0, j1, q0, q1: range of butterflies
+	 */
+void split_butterflies(split_stage *stage, int j0, int j1, int q0, int q1) {
+	if (stage->p <= 5) {
+		kernels[simd_level()].radix[stage->p](stage, j0, j1, q0, q1);
+	} else if (kernels[simd_level()].codelet(stage, j0, j1, q0, q1) != 0) {
+		radixg_split(stage, j0, j1, q0, q1);
+	}
+}
+
+/* Convert points first to last-1 of an interleaved array to split
+	 form, multiplying the points at even indices by even and those
+	 at odd indices by odd on the way.  This folds the (-1)^x shifts
+	 of origin into the conversion.
+
+	 *input: interleaved array
+	 *re, *im: split arrays, indexed as input
+	 first, last: range of indices
+	 even, odd: factors for even and odd indices
+	 */
+void split_from_interleaved(double complex *input, double *re, double *im,
+														int first, int last, double even, double odd) {
+	kernels[simd_level()].from_interleaved(input, re, im, first, last, even, odd);
+}
+
+/* Convert points first to last-1 of split arrays back to an
+	 interleaved array, multiplying by even or odd as above.
+
+	 *re, *im: split arrays
+	 *output: interleaved array, indexed as re and im
+	 first, last: range of indices
+	 even, odd: factors for even and odd indices
+	 */
+void split_to_interleaved(double *re, double *im, double complex *output,
+													int first, int last, double even, double odd) {
+	kernels[simd_level()].to_interleaved(re, im, output, first, last, even, odd);
+}
+
+/* Pointwise complex product of split arrays, divided by divisor,
+	 for indices first to last-1.  The output may be either input.
+
+	 *out_re, *out_im: product
+	 *a_re, *a_im, *b_re, *b_im: factors
+	 first, last: range of indices
+	 divisor: the product is divided by this
+	 */
+void split_multiply(double *out_re, double *out_im, double *a_re, double *a_im,
+										double *b_re, double *b_im, int first, int last, double divisor) {
+	kernels[simd_level()].multiply(out_re, out_im, a_re, a_im, b_re, b_im, first, last, divisor);
+}
+
+/* Magnitudes sqrt(re^2 + im^2) of split arrays for indices first to
+	 last-1.  Unlike cabs() this does not guard against overflow, so
+	 it is only for values well inside the range of a double.
+
+	 *re, *im: split arrays
+	 *out: magnitudes
+	 first, last: range of indices
+	 */
+void split_magnitude(double *re, double *im, double *out, int first, int last) {
+	kernels[simd_level()].magnitude(re, im, out, first, last);
+}
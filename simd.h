@@ -0,0 +1,124 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the split-complex SIMD kernels.
+Instruction set and layout constants, stage structure and
+function prototypes.
+
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <complex.h>
+
+// Instruction sets the kernels are built for, in order of
+// preference.  The best one the processor has is used.
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+
+// Storage layouts.  Interleaved is the C99 double complex array,
+// real and imaginary parts side by side.  Split keeps all the real
+// parts in one array and all the imaginary parts in another, so a
+// vector register holds the same part of several points.
+#define LAYOUT_INTERLEAVED 0
+#define LAYOUT_SPLIT 1
+
+/* One radix p stage of a split-complex Stockham transform, laid out
+	 as in fft.c: inputs x[q + s*(j + r*m)], r = 0..p-1, form one
+	 butterfly whose outputs, times the twiddles w^(j*t), go to
+	 y[q + s*(p*j + t)].  w^k is entry k*s of table.
+	 */
+typedef struct split_stage {
+	int p;
+	int m;
+	int s;
+	int sign;
+	double complex *table;
+	double *x_re;
+	double *x_im;
+	double *y_re;
+	double *y_im;
+} split_stage;
+
+/* Instruction set the kernels are using.  On first call this is
+	 the best one the processor supports.
+	 */
+int simd_level(void);
+
+/* Use a lower instruction set than the best available, for
+	 comparison.  Asking for more than the processor has gets the
+	 most it has.
+
+	 level: one of the SIMD_ constants
+
+	 Returns the instruction set now in use.
+	 */
+int simd_select(int level);
+
+/* Name of an instruction set, for messages.
+
+	 level: one of the SIMD_ constants
+	 */
+const char *simd_name(int level);
+
+/* Do the butterflies of a stage with j from j0 to j1-1 and q from
+	 q0 to q1-1.  Radix 2 to 5 are vectorised across q, so stages with
+	 a stride of at least the vector width run fully in SIMD.
+
+	 *stage: the stage
+	 j0, j1, q0, q1: range of butterflies
+	 */
+void split_butterflies(split_stage *stage, int j0, int j1, int q0, int q1);
+
+/* Convert points first to last-1 of an interleaved array to split
+	 form, multiplying the points at even indices by even and those
+	 at odd indices by odd on the way.  This folds the (-1)^x shifts
+	 of origin into the conversion.
+
+	 *input: interleaved array
+	 *re, *im: split arrays, indexed as input
+	 first, last: range of indices
+	 even, odd: factors for even and odd indices
+	 */
+void split_from_interleaved(double complex *input, double *re, double *im,
+														int first, int last, double even, double odd);
+
+/* Convert points first to last-1 of split arrays back to an
+	 interleaved array, multiplying by even or odd as above.
+
+	 *re, *im: split arrays
+	 *output: interleaved array, indexed as re and im
+	 first, last: range of indices
+	 even, odd: factors for even and odd indices
+	 */
+void split_to_interleaved(double *re, double *im, double complex *output,
+													int first, int last, double even, double odd);
+
+/* Pointwise complex product of split arrays, divided by divisor,
+	 for indices first to last-1.  The output may be either input.
+
+	 *out_re, *out_im: product
+	 *a_re, *a_im, *b_re, *b_im: factors
+	 first, last: range of indices
+	 divisor: the product is divided by this
+	 */
+void split_multiply(double *out_re, double *out_im, double *a_re, double *a_im,
+										double *b_re, double *b_im, int first, int last, double divisor);
+
+/* Magnitudes sqrt(re^2 + im^2) of split arrays for indices first to
+	 last-1.  Unlike cabs() this does not guard against overflow, so
+	 it is only for values well inside the range of a double.
+
+	 *re, *im: split arrays
+	 *out: magnitudes
+	 first, last: range of indices
+	 */
+void split_magnitude(double *re, double *im, double *out, int first, int last);
+
+#endif
@@ -0,0 +1,663 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Generated by gen_codelets.c: do not edit.
+
+./gen_codelets simd 8 9
+
+Unrolled butterflies for the split stages, included after
+simd_kernels.h with the same macros.
+*/
+
+/* Radix 8, exponent negative */
+SIMD_ATTR static void KERNEL(radix8_minus)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC wr[8], wi[8];
+	const VEC K0 = VSET1(0.70710678118654752438);
+	VEC t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	VEC t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	VEC t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	VEC t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	VEC t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	VEC t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		for (t = 1; t < 8; t++) {
+			TWIDDLE(st, j*t*s, wr[t], wi[t]);
+		}
+		for (q = q0; q < qv; q += VW) {
+			t0 = VLOAD(xr + q + s*j);
+			t1 = VLOAD(xi + q + s*j);
+			t8 = VLOAD(xr + q + s*(j + 4*m));
+			t9 = VLOAD(xi + q + s*(j + 4*m));
+			t16 = VADD(t0, t8);
+			t17 = VADD(t1, t9);
+			t18 = VSUB(t0, t8);
+			t19 = VSUB(t1, t9);
+			t4 = VLOAD(xr + q + s*(j + 2*m));
+			t5 = VLOAD(xi + q + s*(j + 2*m));
+			t12 = VLOAD(xr + q + s*(j + 6*m));
+			t13 = VLOAD(xi + q + s*(j + 6*m));
+			t20 = VADD(t4, t12);
+			t21 = VADD(t5, t13);
+			t22 = VSUB(t4, t12);
+			t23 = VSUB(t5, t13);
+			t24 = VADD(t16, t20);
+			t25 = VADD(t17, t21);
+			t26 = VADD(t18, t23);
+			t27 = VSUB(t19, t22);
+			t28 = VSUB(t16, t20);
+			t29 = VSUB(t17, t21);
+			t30 = VSUB(t18, t23);
+			t31 = VADD(t19, t22);
+			t2 = VLOAD(xr + q + s*(j + m));
+			t3 = VLOAD(xi + q + s*(j + m));
+			t10 = VLOAD(xr + q + s*(j + 5*m));
+			t11 = VLOAD(xi + q + s*(j + 5*m));
+			t32 = VADD(t2, t10);
+			t33 = VADD(t3, t11);
+			t34 = VSUB(t2, t10);
+			t35 = VSUB(t3, t11);
+			t6 = VLOAD(xr + q + s*(j + 3*m));
+			t7 = VLOAD(xi + q + s*(j + 3*m));
+			t14 = VLOAD(xr + q + s*(j + 7*m));
+			t15 = VLOAD(xi + q + s*(j + 7*m));
+			t36 = VADD(t6, t14);
+			t37 = VADD(t7, t15);
+			t38 = VSUB(t6, t14);
+			t39 = VSUB(t7, t15);
+			t40 = VADD(t32, t36);
+			t41 = VADD(t33, t37);
+			t42 = VADD(t34, t39);
+			t43 = VSUB(t35, t38);
+			t44 = VSUB(t32, t36);
+			t45 = VSUB(t33, t37);
+			t46 = VSUB(t34, t39);
+			t47 = VADD(t35, t38);
+			t48 = VADD(t42, t43);
+			t49 = VMUL(K0, t48);
+			t50 = VSUB(t43, t42);
+			t51 = VMUL(K0, t50);
+			t52 = VSUB(t47, t46);
+			t53 = VMUL(K0, t52);
+			t54 = VADD(t46, t47);
+			t55 = VMUL(K0, t54);
+			t56 = VADD(t24, t40);
+			t57 = VADD(t25, t41);
+			t58 = VSUB(t24, t40);
+			t59 = VSUB(t25, t41);
+			VSTORE(yr + q + s*(8*j), t56);
+			VSTORE(yi + q + s*(8*j), t57);
+			VSTORE(yr + q + s*(8*j + 4), CMUL_RE(t58, t59, wr[4], wi[4]));
+			VSTORE(yi + q + s*(8*j + 4), CMUL_IM(t58, t59, wr[4], wi[4]));
+			t60 = VADD(t26, t49);
+			t61 = VADD(t27, t51);
+			t62 = VSUB(t26, t49);
+			t63 = VSUB(t27, t51);
+			VSTORE(yr + q + s*(8*j + 1), CMUL_RE(t60, t61, wr[1], wi[1]));
+			VSTORE(yi + q + s*(8*j + 1), CMUL_IM(t60, t61, wr[1], wi[1]));
+			VSTORE(yr + q + s*(8*j + 5), CMUL_RE(t62, t63, wr[5], wi[5]));
+			VSTORE(yi + q + s*(8*j + 5), CMUL_IM(t62, t63, wr[5], wi[5]));
+			t64 = VADD(t28, t45);
+			t65 = VSUB(t29, t44);
+			t66 = VSUB(t28, t45);
+			t67 = VADD(t29, t44);
+			VSTORE(yr + q + s*(8*j + 2), CMUL_RE(t64, t65, wr[2], wi[2]));
+			VSTORE(yi + q + s*(8*j + 2), CMUL_IM(t64, t65, wr[2], wi[2]));
+			VSTORE(yr + q + s*(8*j + 6), CMUL_RE(t66, t67, wr[6], wi[6]));
+			VSTORE(yi + q + s*(8*j + 6), CMUL_IM(t66, t67, wr[6], wi[6]));
+			t68 = VADD(t30, t53);
+			t69 = VSUB(t31, t55);
+			t70 = VSUB(t30, t53);
+			t71 = VADD(t31, t55);
+			VSTORE(yr + q + s*(8*j + 3), CMUL_RE(t68, t69, wr[3], wi[3]));
+			VSTORE(yi + q + s*(8*j + 3), CMUL_IM(t68, t69, wr[3], wi[3]));
+			VSTORE(yr + q + s*(8*j + 7), CMUL_RE(t70, t71, wr[7], wi[7]));
+			VSTORE(yi + q + s*(8*j + 7), CMUL_IM(t70, t71, wr[7], wi[7]));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix8_minus_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+/* Radix 8, exponent positive */
+SIMD_ATTR static void KERNEL(radix8_plus)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC wr[8], wi[8];
+	const VEC K0 = VSET1(0.70710678118654752438);
+	VEC t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	VEC t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	VEC t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	VEC t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	VEC t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	VEC t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		for (t = 1; t < 8; t++) {
+			TWIDDLE(st, j*t*s, wr[t], wi[t]);
+		}
+		for (q = q0; q < qv; q += VW) {
+			t0 = VLOAD(xr + q + s*j);
+			t1 = VLOAD(xi + q + s*j);
+			t8 = VLOAD(xr + q + s*(j + 4*m));
+			t9 = VLOAD(xi + q + s*(j + 4*m));
+			t16 = VADD(t0, t8);
+			t17 = VADD(t1, t9);
+			t18 = VSUB(t0, t8);
+			t19 = VSUB(t1, t9);
+			t4 = VLOAD(xr + q + s*(j + 2*m));
+			t5 = VLOAD(xi + q + s*(j + 2*m));
+			t12 = VLOAD(xr + q + s*(j + 6*m));
+			t13 = VLOAD(xi + q + s*(j + 6*m));
+			t20 = VADD(t4, t12);
+			t21 = VADD(t5, t13);
+			t22 = VSUB(t4, t12);
+			t23 = VSUB(t5, t13);
+			t24 = VADD(t16, t20);
+			t25 = VADD(t17, t21);
+			t26 = VSUB(t18, t23);
+			t27 = VADD(t19, t22);
+			t28 = VSUB(t16, t20);
+			t29 = VSUB(t17, t21);
+			t30 = VADD(t18, t23);
+			t31 = VSUB(t19, t22);
+			t2 = VLOAD(xr + q + s*(j + m));
+			t3 = VLOAD(xi + q + s*(j + m));
+			t10 = VLOAD(xr + q + s*(j + 5*m));
+			t11 = VLOAD(xi + q + s*(j + 5*m));
+			t32 = VADD(t2, t10);
+			t33 = VADD(t3, t11);
+			t34 = VSUB(t2, t10);
+			t35 = VSUB(t3, t11);
+			t6 = VLOAD(xr + q + s*(j + 3*m));
+			t7 = VLOAD(xi + q + s*(j + 3*m));
+			t14 = VLOAD(xr + q + s*(j + 7*m));
+			t15 = VLOAD(xi + q + s*(j + 7*m));
+			t36 = VADD(t6, t14);
+			t37 = VADD(t7, t15);
+			t38 = VSUB(t6, t14);
+			t39 = VSUB(t7, t15);
+			t40 = VADD(t32, t36);
+			t41 = VADD(t33, t37);
+			t42 = VSUB(t34, t39);
+			t43 = VADD(t35, t38);
+			t44 = VSUB(t32, t36);
+			t45 = VSUB(t33, t37);
+			t46 = VADD(t34, t39);
+			t47 = VSUB(t35, t38);
+			t48 = VSUB(t42, t43);
+			t49 = VMUL(K0, t48);
+			t50 = VADD(t43, t42);
+			t51 = VMUL(K0, t50);
+			t52 = VADD(t47, t46);
+			t53 = VMUL(K0, t52);
+			t54 = VSUB(t46, t47);
+			t55 = VMUL(K0, t54);
+			t56 = VADD(t24, t40);
+			t57 = VADD(t25, t41);
+			t58 = VSUB(t24, t40);
+			t59 = VSUB(t25, t41);
+			VSTORE(yr + q + s*(8*j), t56);
+			VSTORE(yi + q + s*(8*j), t57);
+			VSTORE(yr + q + s*(8*j + 4), CMUL_RE(t58, t59, wr[4], wi[4]));
+			VSTORE(yi + q + s*(8*j + 4), CMUL_IM(t58, t59, wr[4], wi[4]));
+			t60 = VADD(t26, t49);
+			t61 = VADD(t27, t51);
+			t62 = VSUB(t26, t49);
+			t63 = VSUB(t27, t51);
+			VSTORE(yr + q + s*(8*j + 1), CMUL_RE(t60, t61, wr[1], wi[1]));
+			VSTORE(yi + q + s*(8*j + 1), CMUL_IM(t60, t61, wr[1], wi[1]));
+			VSTORE(yr + q + s*(8*j + 5), CMUL_RE(t62, t63, wr[5], wi[5]));
+			VSTORE(yi + q + s*(8*j + 5), CMUL_IM(t62, t63, wr[5], wi[5]));
+			t64 = VSUB(t28, t45);
+			t65 = VADD(t29, t44);
+			t66 = VADD(t28, t45);
+			t67 = VSUB(t29, t44);
+			VSTORE(yr + q + s*(8*j + 2), CMUL_RE(t64, t65, wr[2], wi[2]));
+			VSTORE(yi + q + s*(8*j + 2), CMUL_IM(t64, t65, wr[2], wi[2]));
+			VSTORE(yr + q + s*(8*j + 6), CMUL_RE(t66, t67, wr[6], wi[6]));
+			VSTORE(yi + q + s*(8*j + 6), CMUL_IM(t66, t67, wr[6], wi[6]));
+			t68 = VSUB(t30, t53);
+			t69 = VADD(t31, t55);
+			t70 = VADD(t30, t53);
+			t71 = VSUB(t31, t55);
+			VSTORE(yr + q + s*(8*j + 3), CMUL_RE(t68, t69, wr[3], wi[3]));
+			VSTORE(yi + q + s*(8*j + 3), CMUL_IM(t68, t69, wr[3], wi[3]));
+			VSTORE(yr + q + s*(8*j + 7), CMUL_RE(t70, t71, wr[7], wi[7]));
+			VSTORE(yi + q + s*(8*j + 7), CMUL_IM(t70, t71, wr[7], wi[7]));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix8_plus_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+/* Radix 9, exponent negative */
+SIMD_ATTR static void KERNEL(radix9_minus)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC wr[9], wi[9];
+	const VEC K0 = VSET1(0.49999999999999999997);
+	const VEC K1 = VSET1(0.86602540378443864679);
+	const VEC K2 = VSET1(0.64278760968653932633);
+	const VEC K3 = VSET1(0.76604444311897803519);
+	const VEC K4 = VSET1(0.98480775301220805940);
+	const VEC K5 = VSET1(0.17364817766693034880);
+	const VEC K6 = VSET1(0.34202014332566873297);
+	const VEC K7 = VSET1(0.93969262078590838410);
+	VEC t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	VEC t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	VEC t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	VEC t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	VEC t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	VEC t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+	VEC t72, t73, t74, t75, t76, t77, t78, t79, t80, t81, t82, t83;
+	VEC t84, t85, t86, t87, t88, t89, t90, t91, t92, t93, t94, t95;
+	VEC t96, t97, t98, t99, t100, t101, t102, t103, t104, t105, t106, t107;
+	VEC t108, t109, t110, t111, t112, t113, t114, t115, t116, t117, t118, t119;
+	VEC t120, t121, t122, t123, t124, t125, t126, t127, t128, t129, t130, t131;
+	VEC t132, t133, t134, t135, t136, t137;
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		for (t = 1; t < 9; t++) {
+			TWIDDLE(st, j*t*s, wr[t], wi[t]);
+		}
+		for (q = q0; q < qv; q += VW) {
+			t6 = VLOAD(xr + q + s*(j + 3*m));
+			t7 = VLOAD(xi + q + s*(j + 3*m));
+			t12 = VLOAD(xr + q + s*(j + 6*m));
+			t13 = VLOAD(xi + q + s*(j + 6*m));
+			t18 = VADD(t6, t12);
+			t19 = VADD(t7, t13);
+			t20 = VSUB(t6, t12);
+			t21 = VSUB(t7, t13);
+			t0 = VLOAD(xr + q + s*j);
+			t1 = VLOAD(xi + q + s*j);
+			t22 = VADD(t0, t18);
+			t23 = VADD(t1, t19);
+			t24 = VMUL(K0, t18);
+			t25 = VMUL(K0, t19);
+			t26 = VSUB(t0, t24);
+			t27 = VSUB(t1, t25);
+			t28 = VMUL(K1, t20);
+			t29 = VMUL(K1, t21);
+			t30 = VADD(t26, t29);
+			t31 = VSUB(t27, t28);
+			t32 = VSUB(t26, t29);
+			t33 = VADD(t27, t28);
+			t8 = VLOAD(xr + q + s*(j + 4*m));
+			t9 = VLOAD(xi + q + s*(j + 4*m));
+			t14 = VLOAD(xr + q + s*(j + 7*m));
+			t15 = VLOAD(xi + q + s*(j + 7*m));
+			t34 = VADD(t8, t14);
+			t35 = VADD(t9, t15);
+			t36 = VSUB(t8, t14);
+			t37 = VSUB(t9, t15);
+			t2 = VLOAD(xr + q + s*(j + m));
+			t3 = VLOAD(xi + q + s*(j + m));
+			t38 = VADD(t2, t34);
+			t39 = VADD(t3, t35);
+			t40 = VMUL(K0, t34);
+			t41 = VMUL(K0, t35);
+			t42 = VSUB(t2, t40);
+			t43 = VSUB(t3, t41);
+			t44 = VMUL(K1, t36);
+			t45 = VMUL(K1, t37);
+			t46 = VADD(t42, t45);
+			t47 = VSUB(t43, t44);
+			t48 = VSUB(t42, t45);
+			t49 = VADD(t43, t44);
+			t50 = VMUL(K2, t47);
+			t51 = VMUL(K3, t46);
+			t52 = VADD(t51, t50);
+			t53 = VMUL(K2, t46);
+			t54 = VMUL(K3, t47);
+			t55 = VSUB(t54, t53);
+			t56 = VMUL(K4, t49);
+			t57 = VMUL(K5, t48);
+			t58 = VADD(t57, t56);
+			t59 = VMUL(K4, t48);
+			t60 = VMUL(K5, t49);
+			t61 = VSUB(t60, t59);
+			t10 = VLOAD(xr + q + s*(j + 5*m));
+			t11 = VLOAD(xi + q + s*(j + 5*m));
+			t16 = VLOAD(xr + q + s*(j + 8*m));
+			t17 = VLOAD(xi + q + s*(j + 8*m));
+			t62 = VADD(t10, t16);
+			t63 = VADD(t11, t17);
+			t64 = VSUB(t10, t16);
+			t65 = VSUB(t11, t17);
+			t4 = VLOAD(xr + q + s*(j + 2*m));
+			t5 = VLOAD(xi + q + s*(j + 2*m));
+			t66 = VADD(t4, t62);
+			t67 = VADD(t5, t63);
+			t68 = VMUL(K0, t62);
+			t69 = VMUL(K0, t63);
+			t70 = VSUB(t4, t68);
+			t71 = VSUB(t5, t69);
+			t72 = VMUL(K1, t64);
+			t73 = VMUL(K1, t65);
+			t74 = VADD(t70, t73);
+			t75 = VSUB(t71, t72);
+			t76 = VSUB(t70, t73);
+			t77 = VADD(t71, t72);
+			t78 = VMUL(K4, t75);
+			t79 = VMUL(K5, t74);
+			t80 = VADD(t79, t78);
+			t81 = VMUL(K4, t74);
+			t82 = VMUL(K5, t75);
+			t83 = VSUB(t82, t81);
+			t84 = VMUL(K6, t77);
+			t85 = VMUL(K7, t76);
+			t86 = VSUB(t84, t85);
+			t87 = VMUL(K6, t76);
+			t88 = VMUL(K7, t77);
+			t89 = VADD(t88, t87);
+			t90 = VADD(t38, t66);
+			t91 = VADD(t39, t67);
+			t92 = VSUB(t38, t66);
+			t93 = VSUB(t39, t67);
+			t94 = VADD(t22, t90);
+			t95 = VADD(t23, t91);
+			t96 = VMUL(K0, t90);
+			t97 = VMUL(K0, t91);
+			t98 = VSUB(t22, t96);
+			t99 = VSUB(t23, t97);
+			t100 = VMUL(K1, t92);
+			t101 = VMUL(K1, t93);
+			t102 = VADD(t98, t101);
+			t103 = VSUB(t99, t100);
+			t104 = VSUB(t98, t101);
+			t105 = VADD(t99, t100);
+			VSTORE(yr + q + s*(9*j), t94);
+			VSTORE(yi + q + s*(9*j), t95);
+			VSTORE(yr + q + s*(9*j + 3), CMUL_RE(t102, t103, wr[3], wi[3]));
+			VSTORE(yi + q + s*(9*j + 3), CMUL_IM(t102, t103, wr[3], wi[3]));
+			VSTORE(yr + q + s*(9*j + 6), CMUL_RE(t104, t105, wr[6], wi[6]));
+			VSTORE(yi + q + s*(9*j + 6), CMUL_IM(t104, t105, wr[6], wi[6]));
+			t106 = VADD(t52, t80);
+			t107 = VADD(t55, t83);
+			t108 = VSUB(t52, t80);
+			t109 = VSUB(t55, t83);
+			t110 = VADD(t30, t106);
+			t111 = VADD(t31, t107);
+			t112 = VMUL(K0, t106);
+			t113 = VMUL(K0, t107);
+			t114 = VSUB(t30, t112);
+			t115 = VSUB(t31, t113);
+			t116 = VMUL(K1, t108);
+			t117 = VMUL(K1, t109);
+			t118 = VADD(t114, t117);
+			t119 = VSUB(t115, t116);
+			t120 = VSUB(t114, t117);
+			t121 = VADD(t115, t116);
+			VSTORE(yr + q + s*(9*j + 1), CMUL_RE(t110, t111, wr[1], wi[1]));
+			VSTORE(yi + q + s*(9*j + 1), CMUL_IM(t110, t111, wr[1], wi[1]));
+			VSTORE(yr + q + s*(9*j + 4), CMUL_RE(t118, t119, wr[4], wi[4]));
+			VSTORE(yi + q + s*(9*j + 4), CMUL_IM(t118, t119, wr[4], wi[4]));
+			VSTORE(yr + q + s*(9*j + 7), CMUL_RE(t120, t121, wr[7], wi[7]));
+			VSTORE(yi + q + s*(9*j + 7), CMUL_IM(t120, t121, wr[7], wi[7]));
+			t122 = VADD(t58, t86);
+			t123 = VSUB(t61, t89);
+			t124 = VSUB(t58, t86);
+			t125 = VADD(t61, t89);
+			t126 = VADD(t32, t122);
+			t127 = VADD(t33, t123);
+			t128 = VMUL(K0, t122);
+			t129 = VMUL(K0, t123);
+			t130 = VSUB(t32, t128);
+			t131 = VSUB(t33, t129);
+			t132 = VMUL(K1, t124);
+			t133 = VMUL(K1, t125);
+			t134 = VADD(t130, t133);
+			t135 = VSUB(t131, t132);
+			t136 = VSUB(t130, t133);
+			t137 = VADD(t131, t132);
+			VSTORE(yr + q + s*(9*j + 2), CMUL_RE(t126, t127, wr[2], wi[2]));
+			VSTORE(yi + q + s*(9*j + 2), CMUL_IM(t126, t127, wr[2], wi[2]));
+			VSTORE(yr + q + s*(9*j + 5), CMUL_RE(t134, t135, wr[5], wi[5]));
+			VSTORE(yi + q + s*(9*j + 5), CMUL_IM(t134, t135, wr[5], wi[5]));
+			VSTORE(yr + q + s*(9*j + 8), CMUL_RE(t136, t137, wr[8], wi[8]));
+			VSTORE(yi + q + s*(9*j + 8), CMUL_IM(t136, t137, wr[8], wi[8]));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix9_minus_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+/* Radix 9, exponent positive */
+SIMD_ATTR static void KERNEL(radix9_plus)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q, t;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC wr[9], wi[9];
+	const VEC K0 = VSET1(0.49999999999999999997);
+	const VEC K1 = VSET1(0.86602540378443864679);
+	const VEC K2 = VSET1(0.64278760968653932633);
+	const VEC K3 = VSET1(0.76604444311897803519);
+	const VEC K4 = VSET1(0.98480775301220805940);
+	const VEC K5 = VSET1(0.17364817766693034880);
+	const VEC K6 = VSET1(0.34202014332566873297);
+	const VEC K7 = VSET1(0.93969262078590838410);
+	VEC t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	VEC t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+	VEC t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+	VEC t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+	VEC t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	VEC t60, t61, t62, t63, t64, t65, t66, t67, t68, t69, t70, t71;
+	VEC t72, t73, t74, t75, t76, t77, t78, t79, t80, t81, t82, t83;
+	VEC t84, t85, t86, t87, t88, t89, t90, t91, t92, t93, t94, t95;
+	VEC t96, t97, t98, t99, t100, t101, t102, t103, t104, t105, t106, t107;
+	VEC t108, t109, t110, t111, t112, t113, t114, t115, t116, t117, t118, t119;
+	VEC t120, t121, t122, t123, t124, t125, t126, t127, t128, t129, t130, t131;
+	VEC t132, t133, t134, t135, t136, t137;
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		for (t = 1; t < 9; t++) {
+			TWIDDLE(st, j*t*s, wr[t], wi[t]);
+		}
+		for (q = q0; q < qv; q += VW) {
+			t6 = VLOAD(xr + q + s*(j + 3*m));
+			t7 = VLOAD(xi + q + s*(j + 3*m));
+			t12 = VLOAD(xr + q + s*(j + 6*m));
+			t13 = VLOAD(xi + q + s*(j + 6*m));
+			t18 = VADD(t6, t12);
+			t19 = VADD(t7, t13);
+			t20 = VSUB(t6, t12);
+			t21 = VSUB(t7, t13);
+			t0 = VLOAD(xr + q + s*j);
+			t1 = VLOAD(xi + q + s*j);
+			t22 = VADD(t0, t18);
+			t23 = VADD(t1, t19);
+			t24 = VMUL(K0, t18);
+			t25 = VMUL(K0, t19);
+			t26 = VSUB(t0, t24);
+			t27 = VSUB(t1, t25);
+			t28 = VMUL(K1, t20);
+			t29 = VMUL(K1, t21);
+			t30 = VSUB(t26, t29);
+			t31 = VADD(t27, t28);
+			t32 = VADD(t26, t29);
+			t33 = VSUB(t27, t28);
+			t8 = VLOAD(xr + q + s*(j + 4*m));
+			t9 = VLOAD(xi + q + s*(j + 4*m));
+			t14 = VLOAD(xr + q + s*(j + 7*m));
+			t15 = VLOAD(xi + q + s*(j + 7*m));
+			t34 = VADD(t8, t14);
+			t35 = VADD(t9, t15);
+			t36 = VSUB(t8, t14);
+			t37 = VSUB(t9, t15);
+			t2 = VLOAD(xr + q + s*(j + m));
+			t3 = VLOAD(xi + q + s*(j + m));
+			t38 = VADD(t2, t34);
+			t39 = VADD(t3, t35);
+			t40 = VMUL(K0, t34);
+			t41 = VMUL(K0, t35);
+			t42 = VSUB(t2, t40);
+			t43 = VSUB(t3, t41);
+			t44 = VMUL(K1, t36);
+			t45 = VMUL(K1, t37);
+			t46 = VSUB(t42, t45);
+			t47 = VADD(t43, t44);
+			t48 = VADD(t42, t45);
+			t49 = VSUB(t43, t44);
+			t50 = VMUL(K2, t47);
+			t51 = VMUL(K3, t46);
+			t52 = VSUB(t51, t50);
+			t53 = VMUL(K2, t46);
+			t54 = VMUL(K3, t47);
+			t55 = VADD(t54, t53);
+			t56 = VMUL(K4, t49);
+			t57 = VMUL(K5, t48);
+			t58 = VSUB(t57, t56);
+			t59 = VMUL(K4, t48);
+			t60 = VMUL(K5, t49);
+			t61 = VADD(t60, t59);
+			t10 = VLOAD(xr + q + s*(j + 5*m));
+			t11 = VLOAD(xi + q + s*(j + 5*m));
+			t16 = VLOAD(xr + q + s*(j + 8*m));
+			t17 = VLOAD(xi + q + s*(j + 8*m));
+			t62 = VADD(t10, t16);
+			t63 = VADD(t11, t17);
+			t64 = VSUB(t10, t16);
+			t65 = VSUB(t11, t17);
+			t4 = VLOAD(xr + q + s*(j + 2*m));
+			t5 = VLOAD(xi + q + s*(j + 2*m));
+			t66 = VADD(t4, t62);
+			t67 = VADD(t5, t63);
+			t68 = VMUL(K0, t62);
+			t69 = VMUL(K0, t63);
+			t70 = VSUB(t4, t68);
+			t71 = VSUB(t5, t69);
+			t72 = VMUL(K1, t64);
+			t73 = VMUL(K1, t65);
+			t74 = VSUB(t70, t73);
+			t75 = VADD(t71, t72);
+			t76 = VADD(t70, t73);
+			t77 = VSUB(t71, t72);
+			t78 = VMUL(K4, t75);
+			t79 = VMUL(K5, t74);
+			t80 = VSUB(t79, t78);
+			t81 = VMUL(K4, t74);
+			t82 = VMUL(K5, t75);
+			t83 = VADD(t82, t81);
+			t84 = VMUL(K6, t77);
+			t85 = VMUL(K7, t76);
+			t86 = VADD(t85, t84);
+			t87 = VMUL(K6, t76);
+			t88 = VMUL(K7, t77);
+			t89 = VSUB(t87, t88);
+			t90 = VADD(t38, t66);
+			t91 = VADD(t39, t67);
+			t92 = VSUB(t38, t66);
+			t93 = VSUB(t39, t67);
+			t94 = VADD(t22, t90);
+			t95 = VADD(t23, t91);
+			t96 = VMUL(K0, t90);
+			t97 = VMUL(K0, t91);
+			t98 = VSUB(t22, t96);
+			t99 = VSUB(t23, t97);
+			t100 = VMUL(K1, t92);
+			t101 = VMUL(K1, t93);
+			t102 = VSUB(t98, t101);
+			t103 = VADD(t99, t100);
+			t104 = VADD(t98, t101);
+			t105 = VSUB(t99, t100);
+			VSTORE(yr + q + s*(9*j), t94);
+			VSTORE(yi + q + s*(9*j), t95);
+			VSTORE(yr + q + s*(9*j + 3), CMUL_RE(t102, t103, wr[3], wi[3]));
+			VSTORE(yi + q + s*(9*j + 3), CMUL_IM(t102, t103, wr[3], wi[3]));
+			VSTORE(yr + q + s*(9*j + 6), CMUL_RE(t104, t105, wr[6], wi[6]));
+			VSTORE(yi + q + s*(9*j + 6), CMUL_IM(t104, t105, wr[6], wi[6]));
+			t106 = VADD(t52, t80);
+			t107 = VADD(t55, t83);
+			t108 = VSUB(t52, t80);
+			t109 = VSUB(t55, t83);
+			t110 = VADD(t30, t106);
+			t111 = VADD(t31, t107);
+			t112 = VMUL(K0, t106);
+			t113 = VMUL(K0, t107);
+			t114 = VSUB(t30, t112);
+			t115 = VSUB(t31, t113);
+			t116 = VMUL(K1, t108);
+			t117 = VMUL(K1, t109);
+			t118 = VSUB(t114, t117);
+			t119 = VADD(t115, t116);
+			t120 = VADD(t114, t117);
+			t121 = VSUB(t115, t116);
+			VSTORE(yr + q + s*(9*j + 1), CMUL_RE(t110, t111, wr[1], wi[1]));
+			VSTORE(yi + q + s*(9*j + 1), CMUL_IM(t110, t111, wr[1], wi[1]));
+			VSTORE(yr + q + s*(9*j + 4), CMUL_RE(t118, t119, wr[4], wi[4]));
+			VSTORE(yi + q + s*(9*j + 4), CMUL_IM(t118, t119, wr[4], wi[4]));
+			VSTORE(yr + q + s*(9*j + 7), CMUL_RE(t120, t121, wr[7], wi[7]));
+			VSTORE(yi + q + s*(9*j + 7), CMUL_IM(t120, t121, wr[7], wi[7]));
+			t122 = VSUB(t58, t86);
+			t123 = VADD(t61, t89);
+			t124 = VADD(t58, t86);
+			t125 = VSUB(t61, t89);
+			t126 = VADD(t32, t122);
+			t127 = VADD(t33, t123);
+			t128 = VMUL(K0, t122);
+			t129 = VMUL(K0, t123);
+			t130 = VSUB(t32, t128);
+			t131 = VSUB(t33, t129);
+			t132 = VMUL(K1, t124);
+			t133 = VMUL(K1, t125);
+			t134 = VSUB(t130, t133);
+			t135 = VADD(t131, t132);
+			t136 = VADD(t130, t133);
+			t137 = VSUB(t131, t132);
+			VSTORE(yr + q + s*(9*j + 2), CMUL_RE(t126, t127, wr[2], wi[2]));
+			VSTORE(yi + q + s*(9*j + 2), CMUL_IM(t126, t127, wr[2], wi[2]));
+			VSTORE(yr + q + s*(9*j + 5), CMUL_RE(t134, t135, wr[5], wi[5]));
+			VSTORE(yi + q + s*(9*j + 5), CMUL_IM(t134, t135, wr[5], wi[5]));
+			VSTORE(yr + q + s*(9*j + 8), CMUL_RE(t136, t137, wr[8], wi[8]));
+			VSTORE(yi + q + s*(9*j + 8), CMUL_IM(t136, t137, wr[8], wi[8]));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix9_plus_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+/* Do the butterflies of a split stage with its codelet.  Returns
+	 0, or -1 if there is no codelet for the stage's radix. */
+SIMD_ATTR static int KERNEL(codelet)(split_stage *st, int j0, int j1, int q0, int q1) {
+	switch (st->p) {
+		case 8:
+			if (st->sign < 0) {
+				KERNEL(radix8_minus)(st, j0, j1, q0, q1);
+			} else {
+				KERNEL(radix8_plus)(st, j0, j1, q0, q1);
+			}
+			return 0;
+		case 9:
+			if (st->sign < 0) {
+				KERNEL(radix9_minus)(st, j0, j1, q0, q1);
+			} else {
+				KERNEL(radix9_plus)(st, j0, j1, q0, q1);
+			}
+			return 0;
+		default:
+			return -1;
+	}
+}
@@ -0,0 +1,362 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Split-complex kernels, written once for any vector width.
+
+This file is not a header in the usual sense: simd.c includes it
+once per instruction set, each time with the vector macros below
+defined for that set.  KERNEL(name) gives each copy its own names.
+
+	SIMD_ATTR              attributes for every kernel, eg. the target
+	VW                     points per vector
+	VEC                    vector of VW doubles
+	VLOAD(p), VSTORE(p, v) unaligned load and store of VW doubles
+	VSET1(x)               VW copies of x
+	VADD, VSUB, VMUL, VDIV, VSQRT
+	VDEINTERLEAVE(p, r, i) load VW interleaved points as split vectors
+	VINTERLEAVE(p, r, i)   store split vectors as VW interleaved points
+
+The butterflies do exactly the operations of those in fft.c, in
+the same order, so the results only differ where the compiler
+fuses a multiply and an add.  Whatever does not fill a whole
+vector is passed on to the scalar copy, which must come first.
+The codelets from gen_codelets.c are pulled in at the end, and
+follow the same rules.
+*/
+
+// The real and imaginary parts of the complex product of a and b
+#define CMUL_RE(ar, ai, br, bi) VSUB(VMUL(ar, br), VMUL(ai, bi))
+#define CMUL_IM(ar, ai, br, bi) VADD(VMUL(ar, bi), VMUL(ai, br))
+
+/* Multiply (xr, xi) by sign*i, into (or, oi) */
+#define ROT90(sign, xr, xi, or, oi) \
+	if ((sign) > 0) { \
+		or = VMUL(xi, minus_one); \
+		oi = xr; \
+	} else { \
+		or = xi; \
+		oi = VMUL(xr, minus_one); \
+	}
+
+/* Twiddle w^k for this stage as a pair of vectors */
+#define TWIDDLE(st, k, wr, wi) \
+	wr = VSET1(creal(*((st)->table + (k)))); \
+	wi = VSET1((st)->sign * cimag(*((st)->table + (k))));
+
+SIMD_ATTR static void KERNEL(radix2)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q;
+	// end of the part of the q range that fills whole vectors
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC ar, ai, br, bi, dr, di, wr, wi;
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		TWIDDLE(st, j*s, wr, wi);
+		for (q = q0; q < qv; q += VW) {
+			ar = VLOAD(xr + q + s*j);
+			ai = VLOAD(xi + q + s*j);
+			br = VLOAD(xr + q + s*(j + m));
+			bi = VLOAD(xi + q + s*(j + m));
+			VSTORE(yr + q + s*(2*j), VADD(ar, br));
+			VSTORE(yi + q + s*(2*j), VADD(ai, bi));
+			dr = VSUB(ar, br);
+			di = VSUB(ai, bi);
+			VSTORE(yr + q + s*(2*j + 1), CMUL_RE(dr, di, wr, wi));
+			VSTORE(yi + q + s*(2*j + 1), CMUL_IM(dr, di, wr, wi));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix2_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+SIMD_ATTR static void KERNEL(radix3)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC a0r, a0i, a1r, a1i, a2r, a2i, t1r, t1i, t2r, t2i, t3r, t3i, dr, di;
+	VEC w1r, w1i, w2r, w2i;
+	// sin(2 pi/3)
+	const VEC s3 = VSET1(0.86602540378443864676), half = VSET1(0.5);
+	const VEC minus_one = VSET1(-1.0);
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		TWIDDLE(st, j*s, w1r, w1i);
+		TWIDDLE(st, 2*j*s, w2r, w2i);
+		for (q = q0; q < qv; q += VW) {
+			a0r = VLOAD(xr + q + s*j);
+			a0i = VLOAD(xi + q + s*j);
+			a1r = VLOAD(xr + q + s*(j + m));
+			a1i = VLOAD(xi + q + s*(j + m));
+			a2r = VLOAD(xr + q + s*(j + 2*m));
+			a2i = VLOAD(xi + q + s*(j + 2*m));
+			t1r = VADD(a1r, a2r);
+			t1i = VADD(a1i, a2i);
+			t2r = VSUB(a0r, VMUL(half, t1r));
+			t2i = VSUB(a0i, VMUL(half, t1i));
+			ROT90(st->sign, VSUB(a1r, a2r), VSUB(a1i, a2i), dr, di);
+			t3r = VMUL(s3, dr);
+			t3i = VMUL(s3, di);
+			VSTORE(yr + q + s*(3*j), VADD(a0r, t1r));
+			VSTORE(yi + q + s*(3*j), VADD(a0i, t1i));
+			dr = VADD(t2r, t3r);
+			di = VADD(t2i, t3i);
+			VSTORE(yr + q + s*(3*j + 1), CMUL_RE(dr, di, w1r, w1i));
+			VSTORE(yi + q + s*(3*j + 1), CMUL_IM(dr, di, w1r, w1i));
+			dr = VSUB(t2r, t3r);
+			di = VSUB(t2i, t3i);
+			VSTORE(yr + q + s*(3*j + 2), CMUL_RE(dr, di, w2r, w2i));
+			VSTORE(yi + q + s*(3*j + 2), CMUL_IM(dr, di, w2r, w2i));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix3_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+SIMD_ATTR static void KERNEL(radix4)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC a0r, a0i, a1r, a1i, a2r, a2i, a3r, a3i;
+	VEC t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i, dr, di;
+	VEC w1r, w1i, w2r, w2i, w3r, w3i;
+	const VEC minus_one = VSET1(-1.0);
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		TWIDDLE(st, j*s, w1r, w1i);
+		TWIDDLE(st, 2*j*s, w2r, w2i);
+		TWIDDLE(st, 3*j*s, w3r, w3i);
+		for (q = q0; q < qv; q += VW) {
+			a0r = VLOAD(xr + q + s*j);
+			a0i = VLOAD(xi + q + s*j);
+			a1r = VLOAD(xr + q + s*(j + m));
+			a1i = VLOAD(xi + q + s*(j + m));
+			a2r = VLOAD(xr + q + s*(j + 2*m));
+			a2i = VLOAD(xi + q + s*(j + 2*m));
+			a3r = VLOAD(xr + q + s*(j + 3*m));
+			a3i = VLOAD(xi + q + s*(j + 3*m));
+			t0r = VADD(a0r, a2r);
+			t0i = VADD(a0i, a2i);
+			t1r = VSUB(a0r, a2r);
+			t1i = VSUB(a0i, a2i);
+			t2r = VADD(a1r, a3r);
+			t2i = VADD(a1i, a3i);
+			ROT90(st->sign, VSUB(a1r, a3r), VSUB(a1i, a3i), t3r, t3i);
+			VSTORE(yr + q + s*(4*j), VADD(t0r, t2r));
+			VSTORE(yi + q + s*(4*j), VADD(t0i, t2i));
+			dr = VADD(t1r, t3r);
+			di = VADD(t1i, t3i);
+			VSTORE(yr + q + s*(4*j + 1), CMUL_RE(dr, di, w1r, w1i));
+			VSTORE(yi + q + s*(4*j + 1), CMUL_IM(dr, di, w1r, w1i));
+			dr = VSUB(t0r, t2r);
+			di = VSUB(t0i, t2i);
+			VSTORE(yr + q + s*(4*j + 2), CMUL_RE(dr, di, w2r, w2i));
+			VSTORE(yi + q + s*(4*j + 2), CMUL_IM(dr, di, w2r, w2i));
+			dr = VSUB(t1r, t3r);
+			di = VSUB(t1i, t3i);
+			VSTORE(yr + q + s*(4*j + 3), CMUL_RE(dr, di, w3r, w3i));
+			VSTORE(yi + q + s*(4*j + 3), CMUL_IM(dr, di, w3r, w3i));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix4_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+SIMD_ATTR static void KERNEL(radix5)(split_stage *st, int j0, int j1, int q0, int q1) {
+	int j, q;
+	int qv = q0 + (q1 - q0) / VW * VW;
+	int m = st->m, s = st->s;
+	double *xr = st->x_re, *xi = st->x_im, *yr = st->y_re, *yi = st->y_im;
+	VEC a0r, a0i, a1r, a1i, a2r, a2i, a3r, a3i, a4r, a4i;
+	VEC t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+	VEC u1r, u1i, u2r, u2i, v1r, v1i, v2r, v2i, dr, di;
+	VEC w1r, w1i, w2r, w2i, w3r, w3i, w4r, w4i;
+	// cos and sin of 2 pi/5 and 4 pi/5
+	const VEC c1 = VSET1(0.30901699437494742410), c2 = VSET1(-0.80901699437494742410);
+	const VEC s1 = VSET1(0.95105651629515357212), s2 = VSET1(0.58778525229247312917);
+	const VEC minus_one = VSET1(-1.0);
+
+	for (j = j0; j < j1 && q0 < qv; j++) {
+		TWIDDLE(st, j*s, w1r, w1i);
+		TWIDDLE(st, 2*j*s, w2r, w2i);
+		TWIDDLE(st, 3*j*s, w3r, w3i);
+		TWIDDLE(st, 4*j*s, w4r, w4i);
+		for (q = q0; q < qv; q += VW) {
+			a0r = VLOAD(xr + q + s*j);
+			a0i = VLOAD(xi + q + s*j);
+			a1r = VLOAD(xr + q + s*(j + m));
+			a1i = VLOAD(xi + q + s*(j + m));
+			a2r = VLOAD(xr + q + s*(j + 2*m));
+			a2i = VLOAD(xi + q + s*(j + 2*m));
+			a3r = VLOAD(xr + q + s*(j + 3*m));
+			a3i = VLOAD(xi + q + s*(j + 3*m));
+			a4r = VLOAD(xr + q + s*(j + 4*m));
+			a4i = VLOAD(xi + q + s*(j + 4*m));
+			t1r = VADD(a1r, a4r);
+			t1i = VADD(a1i, a4i);
+			t2r = VADD(a2r, a3r);
+			t2i = VADD(a2i, a3i);
+			t3r = VSUB(a1r, a4r);
+			t3i = VSUB(a1i, a4i);
+			t4r = VSUB(a2r, a3r);
+			t4i = VSUB(a2i, a3i);
+			u1r = VADD(VADD(a0r, VMUL(c1, t1r)), VMUL(c2, t2r));
+			u1i = VADD(VADD(a0i, VMUL(c1, t1i)), VMUL(c2, t2i));
+			u2r = VADD(VADD(a0r, VMUL(c2, t1r)), VMUL(c1, t2r));
+			u2i = VADD(VADD(a0i, VMUL(c2, t1i)), VMUL(c1, t2i));
+			ROT90(st->sign, VADD(VMUL(s1, t3r), VMUL(s2, t4r)),
+						VADD(VMUL(s1, t3i), VMUL(s2, t4i)), v1r, v1i);
+			ROT90(st->sign, VSUB(VMUL(s2, t3r), VMUL(s1, t4r)),
+						VSUB(VMUL(s2, t3i), VMUL(s1, t4i)), v2r, v2i);
+			VSTORE(yr + q + s*(5*j), VADD(VADD(a0r, t1r), t2r));
+			VSTORE(yi + q + s*(5*j), VADD(VADD(a0i, t1i), t2i));
+			dr = VADD(u1r, v1r);
+			di = VADD(u1i, v1i);
+			VSTORE(yr + q + s*(5*j + 1), CMUL_RE(dr, di, w1r, w1i));
+			VSTORE(yi + q + s*(5*j + 1), CMUL_IM(dr, di, w1r, w1i));
+			dr = VADD(u2r, v2r);
+			di = VADD(u2i, v2i);
+			VSTORE(yr + q + s*(5*j + 2), CMUL_RE(dr, di, w2r, w2i));
+			VSTORE(yi + q + s*(5*j + 2), CMUL_IM(dr, di, w2r, w2i));
+			dr = VSUB(u2r, v2r);
+			di = VSUB(u2i, v2i);
+			VSTORE(yr + q + s*(5*j + 3), CMUL_RE(dr, di, w3r, w3i));
+			VSTORE(yi + q + s*(5*j + 3), CMUL_IM(dr, di, w3r, w3i));
+			dr = VSUB(u1r, v1r);
+			di = VSUB(u1i, v1i);
+			VSTORE(yr + q + s*(5*j + 4), CMUL_RE(dr, di, w4r, w4i));
+			VSTORE(yi + q + s*(5*j + 4), CMUL_IM(dr, di, w4r, w4i));
+		}
+	}
+#if VW > 1
+	if (qv < q1) {
+		radix5_scalar(st, j0, j1, qv, q1);
+	}
+#endif
+}
+
+/* Interleaved to split, times even or odd by index.  A vector
+	 always starts at an even index, so its factors alternate
+	 even, odd, even ... */
+SIMD_ATTR static void KERNEL(from_interleaved)(double complex *input, double *re, double *im,
+																								int first, int last, double even, double odd) {
+	int i = first;
+#if VW > 1
+	// index within a vector
+	int k;
+	double pattern[VW];
+	VEC f, r, m;
+
+	for (k = 0; k < VW; k++) {
+		pattern[k] = (k%2) ? odd : even;
+	}
+	f = VLOAD(pattern);
+	if (i%2 && i < last) {
+		from_interleaved_scalar(input, re, im, i, i + 1, even, odd);
+		i++;
+	}
+	for (; i + VW <= last; i += VW) {
+		VDEINTERLEAVE(input + i, r, m);
+		VSTORE(re + i, VMUL(r, f));
+		VSTORE(im + i, VMUL(m, f));
+	}
+	if (i < last) {
+		from_interleaved_scalar(input, re, im, i, last, even, odd);
+	}
+#else
+	for (; i < last; i++) {
+		*(re + i) = creal(*(input + i)) * ((i%2) ? odd : even);
+		*(im + i) = cimag(*(input + i)) * ((i%2) ? odd : even);
+	}
+#endif
+}
+
+/* Split to interleaved, times even or odd by index */
+SIMD_ATTR static void KERNEL(to_interleaved)(double *re, double *im, double complex *output,
+																							int first, int last, double even, double odd) {
+	int i = first;
+#if VW > 1
+	int k;
+	double pattern[VW];
+	VEC f;
+
+	for (k = 0; k < VW; k++) {
+		pattern[k] = (k%2) ? odd : even;
+	}
+	f = VLOAD(pattern);
+	if (i%2 && i < last) {
+		to_interleaved_scalar(re, im, output, i, i + 1, even, odd);
+		i++;
+	}
+	for (; i + VW <= last; i += VW) {
+		VINTERLEAVE(output + i, VMUL(VLOAD(re + i), f), VMUL(VLOAD(im + i), f));
+	}
+	if (i < last) {
+		to_interleaved_scalar(re, im, output, i, last, even, odd);
+	}
+#else
+	for (; i < last; i++) {
+		*(output + i) = CMPLX(*(re + i) * ((i%2) ? odd : even), *(im + i) * ((i%2) ? odd : even));
+	}
+#endif
+}
+
+/* Pointwise complex product, divided by divisor */
+SIMD_ATTR static void KERNEL(multiply)(double *out_re, double *out_im, double *a_re, double *a_im,
+																				double *b_re, double *b_im, int first, int last, double divisor) {
+	int i;
+	VEC ar, ai, br, bi, d = VSET1(divisor);
+
+	for (i = first; i + VW <= last; i += VW) {
+		ar = VLOAD(a_re + i);
+		ai = VLOAD(a_im + i);
+		br = VLOAD(b_re + i);
+		bi = VLOAD(b_im + i);
+		VSTORE(out_re + i, VDIV(CMUL_RE(ar, ai, br, bi), d));
+		VSTORE(out_im + i, VDIV(CMUL_IM(ar, ai, br, bi), d));
+	}
+#if VW > 1
+	if (i < last) {
+		multiply_scalar(out_re, out_im, a_re, a_im, b_re, b_im, i, last, divisor);
+	}
+#endif
+}
+
+/* Magnitudes */
+SIMD_ATTR static void KERNEL(magnitude)(double *re, double *im, double *out, int first, int last) {
+	int i;
+	VEC r, m;
+
+	for (i = first; i + VW <= last; i += VW) {
+		r = VLOAD(re + i);
+		m = VLOAD(im + i);
+		VSTORE(out + i, VSQRT(VADD(VMUL(r, r), VMUL(m, m))));
+	}
+#if VW > 1
+	if (i < last) {
+		magnitude_scalar(re, im, out, i, last);
+	}
+#endif
+}
+
+// The unrolled codelets use the macros above too
+#include "simd_codelets.h"
+
+#undef CMUL_RE
+#undef CMUL_IM
+#undef ROT90
+#undef TWIDDLE
@@ -0,0 +1,272 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Short-time Fourier transform.
+
+A signal too long to transform in one go, or whose spectrum changes
+along it, is cut into frames a hop apart, each frame is multiplied
+by a window that tapers it to zero at the ends, and each is
+transformed on its own.  The result is a spectrogram: one row of
+frequencies per frame.
+
+Samples are gathered straight into the stream's buffer, a batch of
+frames at a time.  The frames of a batch are transformed side by
+side, one per thread, each windowed into its own row of the output
+and transformed there, and only the samples the next batch needs
+are kept.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#include "stft.h"
+#include "threads.h"
+
+/* Window coefficient j of a frame of n samples.  The windows are
+	 periodic, so that the ones a hop of n/2 apart add up evenly, and
+	 peak at j = n/2, the middle of the frame. */
+static double window_at(int window, int j, int n) {
+	// angle through the frame
+	double t = 2.0 * M_PI * j / n;
+
+	switch (window) {
+		case STFT_HANN:
+			return 0.5 - 0.5*cos(t);
+		case STFT_HAMMING:
+			return 0.54 - 0.46*cos(t);
+		case STFT_BLACKMAN:
+			return 0.42 - 0.5*cos(t) + 0.08*cos(2.0*t);
+		default:
+			return 1.0;
+	}
+}
+
+/* Set up a short-time Fourier transform.  The threads must already
+	 have been started by threads_init().
+
+	 frame: samples per frame, even
+	 hop: samples from the start of one frame to the next
+	 window: STFT_RECTANGULAR, STFT_HANN, STFT_HAMMING or STFT_BLACKMAN
+	 real: nonzero if the samples are real
+	 batch: frames to transform at a time.  Some multiple of the
+	 				number of threads keeps them all busy.
+
+	 Returns NULL if frame is odd or memory could not be allocated.
+	 */
+stft_stream *stft_stream_create(int frame, int hop, int window, int real, int batch) {
+	// stream under construction
+	stft_stream *stream;
+	// index variable
+	int j;
+	// doubles per sample
+	int width = real ? 1 : 2;
+
+	if (frame < 2 || frame%2 != 0 || hop < 1 || batch < 1
+		|| (stream = calloc(1, sizeof(stft_stream))) == NULL) {
+		return NULL;
+	}
+	stream->frame = frame;
+	stream->hop = hop;
+	stream->real = real;
+	stream->batch = batch;
+	stream->bins = real ? frame/2 + 1 : frame;
+	stream->capacity = frame + (batch - 1)*hop;
+
+	if ( (stream->window = malloc(frame * sizeof(double))) == NULL
+		|| (stream->buffer = malloc((size_t)stream->capacity * width * sizeof(double))) == NULL ) {
+		stft_stream_destroy(stream);
+		return NULL;
+	}
+	if (real) {
+		if ((stream->rfft = fft_real_plan_create(frame, 1)) == NULL) {
+			stft_stream_destroy(stream);
+			return NULL;
+		}
+		stream->scratch_size = fft_real_work_size(stream->rfft);
+	} else {
+		if ((stream->fft = fft_plan_create(frame, 1)) == NULL) {
+			stft_stream_destroy(stream);
+			return NULL;
+		}
+		stream->scratch_size = fft_work_size(stream->fft);
+	}
+	if ((stream->scratch = malloc(threads_count() * stream->scratch_size
+																* sizeof(double complex))) == NULL) {
+		stft_stream_destroy(stream);
+		return NULL;
+	}
+
+	/* Sample j of the frame is x = j - frame/2.  Putting it at index
+		 (j + frame/2) mod frame of the FFT input turns the plain FFT's
+		 exp(2 pi i j u / frame) into exp(2 pi i x u / frame), and for
+		 complex samples a further (-1)^(j + frame/2) moves u = 0 to
+		 the middle of the output, as in dft(). */
+	for (j = 0; j < frame; j++) {
+		*(stream->window + j) = window_at(window, j, frame) / frame;
+		if (!real && (j + frame/2)%2 == 1) {
+			*(stream->window + j) = -*(stream->window + j);
+		}
+	}
+	return stream;
+}
+
+/* The arguments of frame_body() */
+struct frame_args {
+	stft_stream *stream;
+	double complex *output;
+};
+
+/* Window and transform frames first to last-1 of the batch, each
+	 in its own row of the output */
+static void frame_body(void *arg, int chunk, int first, int last) {
+	struct frame_args *args = arg;
+	stft_stream *stream = args->stream;
+	// index variables
+	int f, j;
+	// the frame's samples, and its row of the output
+	double *in, *row;
+	double complex *work = stream->scratch + chunk * stream->scratch_size;
+	const int h = stream->frame / 2;
+
+	for (f = first; f < last; f++) {
+		row = (double *)(args->output + (size_t)f * stream->bins);
+		if (stream->real) {
+			// The row has room for frame+2 doubles, so the windowed
+			// samples go in as they are and are transformed in place
+			in = stream->buffer + (size_t)f * stream->hop;
+			for (j = 0; j < h; j++) {
+				*(row + j + h) = *(stream->window + j) * *(in + j);
+				*(row + j) = *(stream->window + j + h) * *(in + j + h);
+			}
+			fft_execute_r2c_work(stream->rfft, row, 1, (double complex *)row, work);
+		} else {
+			in = stream->buffer + 2 * (size_t)f * stream->hop;
+			for (j = 0; j < h; j++) {
+				*(row + 2*(j + h)) = *(stream->window + j) * *(in + 2*j);
+				*(row + 2*(j + h) + 1) = *(stream->window + j) * *(in + 2*j + 1);
+				*(row + 2*j) = *(stream->window + j + h) * *(in + 2*(j + h));
+				*(row + 2*j + 1) = *(stream->window + j + h) * *(in + 2*(j + h) + 1);
+			}
+			fft_execute_work(stream->fft, (double complex *)row, (double complex *)row, work);
+		}
+	}
+}
+
+/* Transform the first count frames in the buffer, then drop the
+	 samples no later frame needs. */
+static void transform(stft_stream *stream, int count, double complex *output) {
+	// arguments for the frames shared out among the threads
+	struct frame_args args = {stream, output};
+	// samples to drop, and doubles per sample
+	long long drop = (long long)count * stream->hop;
+	int width = stream->real ? 1 : 2;
+
+	parallel_for(count, 1, frame_body, &args);
+
+	if (drop < stream->filled) {
+		memmove(stream->buffer, stream->buffer + drop * width,
+						(stream->filled - drop) * width * sizeof(double));
+		stream->filled -= drop;
+	} else {
+		stream->skip += drop - stream->filled;
+		stream->filled = 0;
+	}
+}
+
+/* Where the next samples are to be put: straight into the stream,
+	 so that they can be read from a file without a copy.  Real
+	 samples take one double each, complex ones two, real part first.
+
+	 *stream: stream from stft_stream_create()
+	 *wanted: set to the number of samples that will complete the
+	 					current batch, and so the most there is room for
+
+	 Returns a pointer to the first double of the space.
+	 */
+double *stft_stream_buffer(stft_stream *stream, int *wanted) {
+	*wanted = stream->capacity - stream->filled;
+	return stream->buffer + (size_t)stream->filled * (stream->real ? 1 : 2);
+}
+
+/* Take count more samples, which have been put where
+	 stft_stream_buffer() said.  Once they complete a batch, its
+	 frames are transformed.
+
+	 *stream: stream from stft_stream_create()
+	 count: number of new samples
+	 *output: pointer to room for batch frames of bins points each
+
+	 Returns the number of frames written to output, 0 or batch.
+	 */
+int stft_stream_process(stft_stream *stream, int count, double complex *output) {
+	// samples dropped from the new ones, and doubles per sample
+	int drop;
+	int width = stream->real ? 1 : 2;
+
+	// Samples that fall between frames are dropped as they come
+	if (stream->skip > 0) {
+		drop = (stream->skip < count) ? (int)stream->skip : count;
+		memmove(stream->buffer + (size_t)stream->filled * width,
+						stream->buffer + (size_t)(stream->filled + drop) * width,
+						(size_t)(count - drop) * width * sizeof(double));
+		stream->skip -= drop;
+		count -= drop;
+	}
+	stream->filled += count;
+
+	if (stream->filled < stream->capacity) {
+		return 0;
+	}
+	transform(stream, stream->batch, output);
+	return stream->batch;
+}
+
+/* At the end of the input, transform the frames that are left,
+	 padding the samples with zeros.  Every frame that starts before
+	 the end of the input comes out, up to batch at a time, so call
+	 this until it returns 0.
+
+	 *stream: stream from stft_stream_create()
+	 *output: pointer to room for batch frames of bins points each
+
+	 Returns the number of frames written to output.
+	 */
+int stft_stream_flush(stft_stream *stream, double complex *output) {
+	// frames that start before the end of the input
+	int count;
+	int width = stream->real ? 1 : 2;
+
+	if (stream->filled == 0) {
+		stream->skip = 0;
+		return 0;
+	}
+	count = (stream->filled - 1) / stream->hop + 1;
+	if (count > stream->batch) {
+		count = stream->batch;
+	}
+	memset(stream->buffer + (size_t)stream->filled * width, 0,
+				 (size_t)(stream->capacity - stream->filled) * width * sizeof(double));
+	transform(stream, count, output);
+	stream->skip = 0;
+	return count;
+}
+
+/* Free a stream and everything it holds.  NULL is ignored.
+
+	 *stream: stream to be freed
+	 */
+void stft_stream_destroy(stft_stream *stream) {
+	if (stream == NULL) {
+		return;
+	}
+	free(stream->window);
+	free(stream->buffer);
+	fft_plan_destroy(stream->fft);
+	fft_real_plan_destroy(stream->rfft);
+	free(stream->scratch);
+	free(stream);
+}
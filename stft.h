@@ -0,0 +1,128 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the short-time Fourier transform.
+Stream structure and function prototypes.
+
+*/
+
+#ifndef STFT_H
+#define STFT_H
+
+#include <stddef.h>
+#include <complex.h>
+#include "fft.h"
+#include "realfft.h"
+
+// Window functions
+#define STFT_RECTANGULAR 0
+#define STFT_HANN 1
+#define STFT_HAMMING 2
+#define STFT_BLACKMAN 3
+
+/* State for the short-time Fourier transform of a stream of samples
+	 of any length.  Frames of samples a hop apart are windowed and
+	 transformed a batch at a time, the batch shared out among the
+	 threads, and the samples the next batch shares with this one are
+	 carried over.  Memory use depends only on the frame length, the
+	 hop and the batch size.
+
+	 Frame k covers samples k*hop to k*hop + frame-1.  With x running
+	 from -frame/2 to frame/2-1 across it, its transform is
+	 F(u) = 1/frame sum_x w(x) f(x) exp(2 pi i x u / frame)
+	 which with a rectangular window is what dft() finds for the
+	 frame.  For complex samples u runs from -frame/2 to frame/2-1;
+	 real samples have F(-u) = conj(F(u)), so only u from 0 to frame/2
+	 is kept.
+	 */
+typedef struct stft_stream {
+	// Samples per frame, which must be even, and from one frame to
+	// the next
+	int frame;
+	int hop;
+	// Nonzero if the samples are real
+	int real;
+	// Frames transformed at a time
+	int batch;
+	// Points in the transform of a frame: frame/2+1 for real
+	// samples, frame for complex ones
+	int bins;
+	// The window, with the normalisation folded in, and for complex
+	// samples the (-1)^x factors that centre u
+	double *window;
+	// Plan for complex samples, or for real ones
+	fft_plan *fft;
+	fft_real_plan *rfft;
+	// Samples gathered for the current batch: one double each if
+	// they are real, two if complex.  capacity samples fill a batch.
+	double *buffer;
+	int capacity;
+	int filled;
+	// Samples to drop before the next frame starts, when the hop is
+	// longer than a frame
+	long long skip;
+	// FFT scratch space for each thread
+	double complex *scratch;
+	size_t scratch_size;
+} stft_stream;
+
+/* Set up a short-time Fourier transform.  The threads must already
+	 have been started by threads_init().
+
+	 frame: samples per frame, even
+	 hop: samples from the start of one frame to the next
+	 window: STFT_RECTANGULAR, STFT_HANN, STFT_HAMMING or STFT_BLACKMAN
+	 real: nonzero if the samples are real
+	 batch: frames to transform at a time.  Some multiple of the
+	 				number of threads keeps them all busy.
+
+	 Returns NULL if frame is odd or memory could not be allocated.
+	 */
+stft_stream *stft_stream_create(int frame, int hop, int window, int real, int batch);
+
+/* Where the next samples are to be put: straight into the stream,
+	 so that they can be read from a file without a copy.  Real
+	 samples take one double each, complex ones two, real part first.
+
+	 *stream: stream from stft_stream_create()
+	 *wanted: set to the number of samples that will complete the
+	 					current batch, and so the most there is room for
+
+	 Returns a pointer to the first double of the space.
+	 */
+double *stft_stream_buffer(stft_stream *stream, int *wanted);
+
+/* Take count more samples, which have been put where
+	 stft_stream_buffer() said.  Once they complete a batch, its
+	 frames are transformed.
+
+	 *stream: stream from stft_stream_create()
+	 count: number of new samples
+	 *output: pointer to room for batch frames of bins points each
+
+	 Returns the number of frames written to output, 0 or batch.
+	 */
+int stft_stream_process(stft_stream *stream, int count, double complex *output);
+
+/* At the end of the input, transform the frames that are left,
+	 padding the samples with zeros.  Every frame that starts before
+	 the end of the input comes out, up to batch at a time, so call
+	 this until it returns 0.
+
+	 *stream: stream from stft_stream_create()
+	 *output: pointer to room for batch frames of bins points each
+
+	 Returns the number of frames written to output.
+	 */
+int stft_stream_flush(stft_stream *stream, double complex *output);
+
+/* Free a stream and everything it holds.  NULL is ignored.
+
+	 *stream: stream to be freed
+	 */
+void stft_stream_destroy(stft_stream *stream);
+
+#endif
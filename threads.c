@@ -0,0 +1,204 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Worker threads.
+
+A fixed pool of threads is started once and then handed loops to
+run.  Each loop is cut into as many contiguous chunks as there are
+threads; the calling thread does the first chunk and waits for the
+rest.  Starting threads costs far more than a typical transform, so
+the pool sleeps between loops rather than being started afresh.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "threads.h"
+
+// Number of threads, including the calling one
+static int nthreads = 1;
+// The workers, nthreads-1 of them
+static pthread_t *workers = NULL;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when a new loop is posted, and when the last chunk is done
+static pthread_cond_t posted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+
+/* The loop being run.  generation goes up by one for each loop, so
+	 a worker can tell a new loop from one it has already done. */
+static struct {
+	parallel_body body;
+	void *arg;
+	int count;
+	int chunks;
+} job;
+static unsigned long generation = 0;
+// Workers yet to finish the current loop
+static int pending = 0;
+// Set while a loop is running, so nested loops, and loops from
+// other threads, run inline
+static int running = 0;
+// Set to make the workers exit
+static int stopping = 0;
+
+/* First index of chunk k when count iterations are cut into chunks */
+static int chunk_start(int count, int chunks, int k) {
+	return (int)(((long long)count * k) / chunks);
+}
+
+/* Worker thread.  id is its chunk number, 1 to nthreads-1. */
+static void *worker(void *id) {
+	int k = (int)(long)id;
+	// last loop done
+	unsigned long seen = 0;
+	// copy of the loop, taken under the lock
+	parallel_body body;
+	void *arg;
+	int count, chunks;
+
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		while (generation == seen && !stopping) {
+			pthread_cond_wait(&posted, &lock);
+		}
+		if (stopping) {
+			pthread_mutex_unlock(&lock);
+			return NULL;
+		}
+		seen = generation;
+		body = job.body;
+		arg = job.arg;
+		count = job.count;
+		chunks = job.chunks;
+		pthread_mutex_unlock(&lock);
+
+		if (k < chunks) {
+			body(arg, k, chunk_start(count, chunks, k), chunk_start(count, chunks, k + 1));
+		}
+
+		pthread_mutex_lock(&lock);
+		if (--pending == 0) {
+			pthread_cond_signal(&finished);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/* Start the worker threads.  Call once, before any parallel_for().
+
+	 count: number of threads including the calling one.  0 or less
+	 			 means one per online processor.
+
+	 Returns the number of threads actually running, which is 1 if
+	 none could be started.
+	 */
+int threads_init(int count) {
+	// index variable
+	int i;
+
+	if (count < 1) {
+		count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (count <= 1 || workers != NULL
+		|| (workers = malloc((count - 1) * sizeof(pthread_t))) == NULL) {
+		return nthreads;
+	}
+
+	stopping = 0;
+	for (i = 1; i < count; i++) {
+		if (pthread_create(workers + i - 1, NULL, worker, (void *)(long)i) != 0) {
+			break;
+		}
+	}
+	// Make do with however many started
+	nthreads = i;
+	return nthreads;
+}
+
+/* Number of threads, including the calling one.  Scratch space for
+	 a parallel_for() needs this many chunks' worth.
+	 */
+int threads_count(void) {
+	return nthreads;
+}
+
+/* Run body over the index range 0 to count-1, split into contiguous
+	 chunks across the threads, and wait for all of them to finish.
+	 The calling thread does the first chunk itself.  Called from
+	 inside a body, while another thread has a loop running, or with
+	 too little work to split, the whole range runs as one chunk on
+	 the calling thread.
+
+	 count: number of iterations
+	 grain: fewest iterations worth giving a thread of its own
+	 body: loop body
+	 *arg: passed through to body
+	 */
+void parallel_for(int count, int grain, parallel_body body, void *arg) {
+	// number of chunks
+	int chunks = nthreads;
+
+	if (grain > 0 && count / grain < chunks) {
+		chunks = count / grain;
+	}
+	if (chunks <= 1) {
+		if (count > 0) {
+			body(arg, 0, 0, count);
+		}
+		return;
+	}
+
+	// The pool runs one loop at a time
+	pthread_mutex_lock(&lock);
+	if (running) {
+		pthread_mutex_unlock(&lock);
+		body(arg, 0, 0, count);
+		return;
+	}
+	job.body = body;
+	job.arg = arg;
+	job.count = count;
+	job.chunks = chunks;
+	pending = nthreads - 1;
+	running = 1;
+	generation++;
+	pthread_cond_broadcast(&posted);
+	pthread_mutex_unlock(&lock);
+
+	body(arg, 0, 0, chunk_start(count, chunks, 1));
+
+	pthread_mutex_lock(&lock);
+	while (pending > 0) {
+		pthread_cond_wait(&finished, &lock);
+	}
+	running = 0;
+	pthread_mutex_unlock(&lock);
+}
+
+/* Stop the worker threads and free them.  Safe to call when
+	 threads_init() never was.
+	 */
+void threads_shutdown(void) {
+	// index variable
+	int i;
+
+	if (workers == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	stopping = 1;
+	pthread_cond_broadcast(&posted);
+	pthread_mutex_unlock(&lock);
+
+	for (i = 1; i < nthreads; i++) {
+		pthread_join(*(workers + i - 1), NULL);
+	}
+	free(workers);
+	workers = NULL;
+	nthreads = 1;
+}
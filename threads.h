@@ -0,0 +1,56 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the worker threads.
+Loop body type and function prototypes.
+
+*/
+
+#ifndef THREADS_H
+#define THREADS_H
+
+/* The body of a parallel loop.  It is called once per chunk with
+	 a contiguous range of the loop index, first to last-1.  chunk
+	 runs from 0 to threads_count()-1 and is never shared by two
+	 calls at once, so it can pick out per-thread scratch space.
+	 */
+typedef void (*parallel_body)(void *arg, int chunk, int first, int last);
+
+/* Start the worker threads.  Call once, before any parallel_for().
+
+	 count: number of threads including the calling one.  0 or less
+	 			 means one per online processor.
+
+	 Returns the number of threads actually running, which is 1 if
+	 none could be started.
+	 */
+int threads_init(int count);
+
+/* Number of threads, including the calling one.  Scratch space for
+	 a parallel_for() needs this many chunks' worth.
+	 */
+int threads_count(void);
+
+/* Run body over the index range 0 to count-1, split into contiguous
+	 chunks across the threads, and wait for all of them to finish.
+	 The calling thread does the first chunk itself.  Called from
+	 inside a body, while another thread has a loop running, or with
+	 too little work to split, the whole range runs as one chunk on
+	 the calling thread.
+
+	 count: number of iterations
+	 grain: fewest iterations worth giving a thread of its own
+	 body: loop body
+	 *arg: passed through to body
+	 */
+void parallel_for(int count, int grain, parallel_body body, void *arg);
+
+/* Stop the worker threads and free them.  Safe to call when
+	 threads_init() never was.
+	 */
+void threads_shutdown(void);
+
+#endif
@@ -0,0 +1,114 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Benchmark timing and reporting, shared by the 1D and 2D
+benchmarks.
+
+Each call is timed over enough repetitions to swamp the clock's
+resolution, and the results are printed as comma separated values
+so that runs can be compared by script, one line per kernel, input
+and size.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "timing.h"
+#include "threads.h"
+#include "simd.h"
+
+/* Seconds since some fixed point, from a monotonic clock.
+	 */
+double time_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+/* Time a call.  It is made once to warm the caches up, then
+	 repeatedly, doubling the number of calls until they take at
+	 least min_seconds between them.
+
+	 call: the call to time
+	 *arg: passed through to call
+	 min_seconds: shortest total time to measure over
+
+	 Returns the mean time of one call, in seconds.
+	 */
+double time_call(timed_call call, void *arg, double min_seconds) {
+	// index variable, and calls in this round
+	long i, calls;
+	// start of the round, and its length
+	double start, elapsed;
+
+	call(arg);
+	for (calls = 1; ; calls *= 2) {
+		start = time_now();
+		for (i = 0; i < calls; i++) {
+			call(arg);
+		}
+		elapsed = time_now() - start;
+		if (elapsed >= min_seconds) {
+			return elapsed / calls;
+		}
+	}
+}
+
+/* Print the column names of the lines report() prints.
+	 */
+void report_header(void) {
+	printf("kernel,input,N,M,threads,layout,simd,seconds,ns_per_point,gflops,mb_per_s\n");
+}
+
+/* Print one line of results as comma separated values:
+	 the kernel and input, the sizes, the threads, layout and
+	 instruction set it ran with, then seconds per call, ns per
+	 point, GFLOP/s and MB/s.
+
+	 kernel[]: name of the function timed
+	 input[]: description of the input it was given
+	 N, M: half sizes; M is 0 in 1D
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 seconds: time of one call
+	 points: number of points the call produces
+	 flops: nominal floating point operations per call, 0 if none
+	 bytes: bytes read and written per call
+	 */
+void report(const char kernel[], const char input[], int N, int M, int layout,
+						double seconds, double points, double flops, double bytes) {
+	printf("%s,%s,%d,%d,%d,%s,%s,%.6g,%.6g,%.6g,%.6g\n", kernel, input, N, M,
+				 threads_count(), (layout == LAYOUT_SPLIT) ? "split" : "interleaved",
+				 simd_name(simd_level()), seconds, 1e9 * seconds / points,
+				 1e-9 * flops / seconds, 1e-6 * bytes / seconds);
+	fflush(stdout);
+}
+
+/* Print how far a kernel's results were from those of a reference,
+	 eg. a single precision kernel's from its double precision
+	 counterpart's.  The line starts with #, so that it reads as a
+	 comment between the CSV lines.
+
+	 kernel[]: name of the function
+	 input[]: description of the input it was given
+	 N, M: half sizes; M is 0 in 1D
+	 error: largest difference, relative to the largest point of the
+	 			  reference result
+	 */
+void report_error(const char kernel[], const char input[], int N, int M, double error) {
+	printf("# %s,%s,%d,%d: max relative error %.3g\n", kernel, input, N, M, error);
+	fflush(stdout);
+}
+
+/* The nominal operation count of a complex FFT of n points,
+	 5 n log2(n).  This is the usual convention for quoting FFT
+	 speeds, whatever algorithm actually ran.
+
+	 n: transform length
+	 */
+double fft_flops(double n) {
+	return 5.0 * n * log2(n);
+}
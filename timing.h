@@ -0,0 +1,78 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the benchmark timing and reporting.
+Timed function type and function prototypes.
+
+*/
+
+#ifndef TIMING_H
+#define TIMING_H
+
+/* A call to be timed.  It is made many times over with the same
+	 argument, so it must leave its input as it found it.
+	 */
+typedef void (*timed_call)(void *arg);
+
+/* Seconds since some fixed point, from a monotonic clock.
+	 */
+double time_now(void);
+
+/* Time a call.  It is made once to warm the caches up, then
+	 repeatedly, doubling the number of calls until they take at
+	 least min_seconds between them.
+
+	 call: the call to time
+	 *arg: passed through to call
+	 min_seconds: shortest total time to measure over
+
+	 Returns the mean time of one call, in seconds.
+	 */
+double time_call(timed_call call, void *arg, double min_seconds);
+
+/* Print the column names of the lines report() prints.
+	 */
+void report_header(void);
+
+/* Print one line of results as comma separated values:
+	 the kernel and input, the sizes, the threads, layout and
+	 instruction set it ran with, then seconds per call, ns per
+	 point, GFLOP/s and MB/s.
+
+	 kernel[]: name of the function timed
+	 input[]: description of the input it was given
+	 N, M: half sizes; M is 0 in 1D
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 seconds: time of one call
+	 points: number of points the call produces
+	 flops: nominal floating point operations per call, 0 if none
+	 bytes: bytes read and written per call
+	 */
+void report(const char kernel[], const char input[], int N, int M, int layout,
+						double seconds, double points, double flops, double bytes);
+
+/* Print how far a kernel's results were from those of a reference,
+	 eg. a single precision kernel's from its double precision
+	 counterpart's.  The line starts with #, so that it reads as a
+	 comment between the CSV lines.
+
+	 kernel[]: name of the function
+	 input[]: description of the input it was given
+	 N, M: half sizes; M is 0 in 1D
+	 error: largest difference, relative to the largest point of the
+	 			  reference result
+	 */
+void report_error(const char kernel[], const char input[], int N, int M, double error);
+
+/* The nominal operation count of a complex FFT of n points,
+	 5 n log2(n).  This is the usual convention for quoting FFT
+	 speeds, whatever algorithm actually ran.
+
+	 n: transform length
+	 */
+double fft_flops(double n);
+
+#endif
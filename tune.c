@@ -0,0 +1,410 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Tuning the planner, and a cache of what it chose.
+
+Which order of FFT stages runs fastest, and how sparse f(x) must be
+before the direct sum beats the FFT, depend on the machine as much
+as on the size.  Rather than guess, -tune times the candidates and
+keeps the winner.  The choices go in a text file in the cache
+directory, one per line:
+
+kind n m layout simd = value value ...
+
+and the large twiddle tables go there too, so that later runs at
+the same sizes start with the tuned plan and their tables ready.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <complex.h>
+#include <sys/stat.h>
+#include "tune.h"
+#include "fft.h"
+#include "twiddle.h"
+#include "simd.h"
+#include "arena.h"
+#include "timing.h"
+
+// Longest key, with its terminating null
+#define KEY_SIZE 96
+
+/* One choice from the cache. */
+struct tune_entry {
+	// kind, sizes, layout and instruction set, as in the file
+	char key[KEY_SIZE];
+	int count;
+	int values[TUNE_MAX_VALUES];
+	struct tune_entry *next;
+};
+
+// The choices read in or made so far
+static struct tune_entry *entries = NULL;
+// The cache file, empty if there is no cache directory
+static char cache_file[300] = "";
+// Whether to time what the cache does not have
+static int measuring = 0;
+
+/* A plan and the data to time it on. */
+struct fft_call {
+	fft_plan *plan;
+	int layout;
+	double complex *data;
+};
+
+/* One transform, out of place when interleaved.  The data are all
+	 0, so repeating it changes nothing. */
+static void fft_call(void *arg) {
+	struct fft_call *call = arg;
+	const int n = call->plan->n;
+
+	if (call->layout == LAYOUT_SPLIT) {
+		fft_execute_split(call->plan, (double *)call->data, (double *)call->data + n);
+	} else {
+		fft_execute(call->plan, call->data, call->data + n);
+	}
+}
+
+/* The key a choice is kept under. */
+static void make_key(char key[], size_t size, const char kind[], int n, int m, int layout) {
+	snprintf(key, size, "%s %d %d %s %s", kind, n, m,
+					 (layout == LAYOUT_SPLIT) ? "split" : "interleaved", simd_name(simd_level()));
+}
+
+/* Add a choice to the list.  Returns 0, or -1 if memory could not
+	 be allocated. */
+static int add_entry(const char key[], const int *values, int count) {
+	// the new entry
+	struct tune_entry *entry;
+
+	if ((entry = malloc(sizeof(struct tune_entry))) == NULL) {
+		return -1;
+	}
+	strcpy(entry->key, key);
+	entry->count = count;
+	memcpy(entry->values, values, count * sizeof(int));
+	// Later lines go in front, so they override earlier ones
+	entry->next = entries;
+	entries = entry;
+	return 0;
+}
+
+/* Read the choices in the cache file.  Lines that do not parse are
+	 skipped. */
+static void read_cache(void) {
+	// the file, and one line of it
+	FILE *fp;
+	char line[1024];
+	// the = sign, and where the next number starts and ends
+	char *equals, *start, *end;
+	// the numbers on the line
+	int values[TUNE_MAX_VALUES];
+	int count;
+
+	if ((fp = fopen(cache_file, "r")) == NULL) {
+		return;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if ((equals = strstr(line, " = ")) == NULL || equals - line >= KEY_SIZE) {
+			continue;
+		}
+		*equals = '\0';
+		start = equals + 3;
+		for (count = 0; count < TUNE_MAX_VALUES; count++) {
+			*(values + count) = (int)strtol(start, &end, 10);
+			if (end == start) {
+				break;
+			}
+			start = end;
+		}
+		if (count > 0) {
+			add_entry(line, values, count);
+		}
+	}
+	fclose(fp);
+}
+
+/* Start tuning with a cache directory.  If the directory exists, the
+	 choices in it are read in, and large twiddle tables are read from
+	 it and written to it from then on.  Call before any plans are
+	 built, after threads_init() if measuring.
+
+	 dir[]: cache directory, or NULL for TUNE_CACHE_DIR
+	 measure: nonzero to time whatever the cache does not have, and
+	 					create the directory if need be, or 0 to use the cache
+	 					as it is
+
+	 Returns 0, or -1 if the directory could not be created.
+	 */
+int tune_init(const char dir[], int measure) {
+	// what is at dir
+	struct stat info;
+
+	if (dir == NULL) {
+		dir = TUNE_CACHE_DIR;
+	}
+	measuring = measure;
+	if (measure && mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	// Without the directory there is nothing to read, and nowhere to
+	// write: every choice is the default, or measured afresh
+	if (stat(dir, &info) != 0 || !S_ISDIR(info.st_mode)) {
+		return 0;
+	}
+	if (twiddle_cache(dir) != 0) {
+		return 0;
+	}
+	snprintf(cache_file, sizeof(cache_file), "%s/%s", dir, TUNE_CACHE_FILE);
+	read_cache();
+	return 0;
+}
+
+/* Whether tune_init() was asked to measure.
+	 */
+int tune_measuring(void) {
+	return measuring;
+}
+
+/* Look up a choice in the cache.  Choices are kept for the
+	 instruction set in use, so a cache copied to another machine
+	 does not mislead it.
+
+	 kind[]: what was chosen, one word
+	 n, m: the sizes it was chosen for; m is 0 for one size
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 *values: places for up to max numbers
+	 max: most numbers to read
+
+	 Returns the number of numbers read, or -1 if there is no such
+	 choice.
+	 */
+int tune_get(const char kind[], int n, int m, int layout, int *values, int max) {
+	// the key, and the entry under it
+	char key[KEY_SIZE];
+	struct tune_entry *entry;
+
+	make_key(key, sizeof(key), kind, n, m, layout);
+	for (entry = entries; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->key, key) == 0) {
+			if (entry->count < max) {
+				max = entry->count;
+			}
+			memcpy(values, entry->values, max * sizeof(int));
+			return max;
+		}
+	}
+	return -1;
+}
+
+/* Record a choice, in the cache file and for tune_get().  Nothing is
+	 written if there is no cache directory.
+
+	 kind[], n, m, layout: as for tune_get()
+	 *values: the numbers to record
+	 count: how many, at most TUNE_MAX_VALUES
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int tune_put(const char kind[], int n, int m, int layout, const int *values, int count) {
+	// the key, and the cache file
+	char key[KEY_SIZE];
+	FILE *fp;
+	// index variable
+	int i;
+
+	if (count > TUNE_MAX_VALUES) {
+		count = TUNE_MAX_VALUES;
+	}
+	make_key(key, sizeof(key), kind, n, m, layout);
+	if (add_entry(key, values, count) != 0) {
+		return -1;
+	}
+	// A line at a time, appended, so that runs sharing the cache
+	// never lose each other's choices.  A file that cannot be
+	// written only means measuring again next time.
+	if (*cache_file == '\0' || (fp = fopen(cache_file, "a")) == NULL) {
+		return 0;
+	}
+	fprintf(fp, "%s =", key);
+	for (i = 0; i < count; i++) {
+		fprintf(fp, " %d", *(values + i));
+	}
+	fprintf(fp, "\n");
+	fclose(fp);
+	return 0;
+}
+
+/* Factorise n as fft_factor() did before there were codelets: 4s,
+	 then the other small primes, then whatever is left.  Returns the
+	 number of stages. */
+static int plain_factor(int n, int *radix) {
+	// number of stages so far, length still to be factored, and
+	// candidate factor
+	int nstages = 0, left = n, f;
+
+	while (left % 4 == 0) {
+		*(radix + nstages++) = 4;
+		left /= 4;
+	}
+	for (f = 2; f <= 5; f++) {
+		while (left % f == 0) {
+			*(radix + nstages++) = f;
+			left /= f;
+		}
+	}
+	for (f = 7; left > 1; f += 2) {
+		// As in fft_factor(), one last stage for Bluestein's algorithm
+		if (f > FFT_MAX_RADIX) {
+			*(radix + nstages++) = left;
+			break;
+		}
+		if (f > left / f) {
+			f = left;
+		}
+		while (left % f == 0) {
+			*(radix + nstages++) = f;
+			left /= f;
+		}
+	}
+	return nstages;
+}
+
+/* A candidate order of stages, and its best time so far. */
+struct candidate {
+	int nstages;
+	int radix[FFT_MAX_STAGES];
+	fft_plan *plan;
+	double seconds;
+};
+
+/* Add a candidate order to the list, reversed if asked, unless it
+	 is there already.  Returns the number of candidates. */
+static int add_candidate(struct candidate *candidates, int ncandidates,
+												 const int *radix, int nstages, int reverse) {
+	// the new candidate, and index variables
+	struct candidate *next = candidates + ncandidates;
+	int c, i;
+
+	next->nstages = nstages;
+	for (i = 0; i < nstages; i++) {
+		*(next->radix + i) = reverse ? *(radix + nstages - 1 - i) : *(radix + i);
+	}
+	for (c = 0; c < ncandidates; c++) {
+		if ((candidates + c)->nstages == nstages
+			&& memcmp((candidates + c)->radix, next->radix, nstages * sizeof(int)) == 0) {
+			return ncandidates;
+		}
+	}
+	return ncandidates + 1;
+}
+
+/* Give FFTs of length n the factorisation in the cache, if there is
+	 one, or when measuring the fastest of a few candidate orders of
+	 their stages, through fft_prefer_radices().
+
+	 n: transform length
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT, as it will be executed
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int tune_fft(int n, int layout) {
+	// the candidates: the usual order, the one without codelets, and
+	// each of them backwards
+	struct candidate candidates[4];
+	int ncandidates = 0;
+	// a factorisation
+	int radix[FFT_MAX_STAGES];
+	int nstages;
+	// what the plans are timed on
+	struct fft_call call;
+	void *data;
+	// time of one call, the winner, index variables and the result
+	double seconds;
+	struct candidate *winner;
+	int c, round, status = 0;
+
+	if (n < 1) {
+		return 0;
+	}
+	if ((nstages = tune_get("fft", n, 0, layout, radix, FFT_MAX_STAGES)) > 0) {
+		// A line that no longer fits, say from an older version, is
+		// only ignored
+		fft_prefer_radices(n, radix, nstages);
+		return 0;
+	}
+
+	// Bluestein lengths, and those of one stage, have no choice
+	nstages = fft_factor(n, radix);
+	if (!measuring || nstages < 2 || *(radix + nstages - 1) > FFT_MAX_RADIX) {
+		return 0;
+	}
+	ncandidates = add_candidate(candidates, ncandidates, radix, nstages, 0);
+	ncandidates = add_candidate(candidates, ncandidates, radix, nstages, 1);
+	nstages = plain_factor(n, radix);
+	ncandidates = add_candidate(candidates, ncandidates, radix, nstages, 0);
+	ncandidates = add_candidate(candidates, ncandidates, radix, nstages, 1);
+
+	if (posix_memalign(&data, ARENA_ALIGN, 2*(size_t)n * sizeof(double complex)) != 0) {
+		return -1;
+	}
+	memset(data, 0, 2*(size_t)n * sizeof(double complex));
+	for (c = 0; c < ncandidates; c++) {
+		(candidates + c)->seconds = -1.0;
+		(candidates + c)->plan = fft_plan_create_radices(n, 1, (candidates + c)->radix,
+																										 (candidates + c)->nstages);
+		if ((candidates + c)->plan == NULL) {
+			status = -1;
+		}
+	}
+
+	// The candidates take turns, so that they all see much the same
+	// of whatever else the machine is doing
+	call.layout = layout;
+	call.data = data;
+	for (round = 0; round < TUNE_ROUNDS && status == 0; round++) {
+		for (c = 0; c < ncandidates; c++) {
+			call.plan = (candidates + c)->plan;
+			seconds = time_call(fft_call, &call, TUNE_SECONDS);
+			if ((candidates + c)->seconds < 0.0 || seconds < (candidates + c)->seconds) {
+				(candidates + c)->seconds = seconds;
+			}
+		}
+	}
+
+	if (status == 0) {
+		winner = candidates;
+		for (c = 1; c < ncandidates; c++) {
+			if ((candidates + c)->seconds < winner->seconds) {
+				winner = candidates + c;
+			}
+		}
+		if (tune_put("fft", n, 0, layout, winner->radix, winner->nstages) != 0
+			|| fft_prefer_radices(n, winner->radix, winner->nstages) != 0) {
+			status = -1;
+		}
+	}
+	for (c = 0; c < ncandidates; c++) {
+		fft_plan_destroy((candidates + c)->plan);
+	}
+	free(data);
+	return status;
+}
+
+/* Free the cache read by tune_init().
+	 */
+void tune_finish(void) {
+	// entry to be freed
+	struct tune_entry *entry;
+
+	while ((entry = entries) != NULL) {
+		entries = entry->next;
+		free(entry);
+	}
+	*cache_file = '\0';
+}
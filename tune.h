@@ -0,0 +1,88 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the planner's tuning and its cache.
+Cache constants and function prototypes.
+
+*/
+
+#ifndef TUNE_H
+#define TUNE_H
+
+// Directory the tuned choices and large twiddle tables are kept in,
+// when none is given
+#define TUNE_CACHE_DIR "plans"
+// File in it holding the tuned choices, one per line
+#define TUNE_CACHE_FILE "plans.txt"
+// Shortest time each candidate is measured over, in seconds
+#define TUNE_SECONDS 0.02
+// Times each candidate is measured, the best time counting.  Taking
+// turns and the best of several keeps a burst of other work on the
+// machine from picking the winner.
+#define TUNE_ROUNDS 3
+// Most numbers a choice can hold
+#define TUNE_MAX_VALUES 64
+
+/* Start tuning with a cache directory.  If the directory exists, the
+	 choices in it are read in, and large twiddle tables are read from
+	 it and written to it from then on.  Call before any plans are
+	 built, after threads_init() if measuring.
+
+	 dir[]: cache directory, or NULL for TUNE_CACHE_DIR
+	 measure: nonzero to time whatever the cache does not have, and
+	 					create the directory if need be, or 0 to use the cache
+	 					as it is
+
+	 Returns 0, or -1 if the directory could not be created.
+	 */
+int tune_init(const char dir[], int measure);
+
+/* Whether tune_init() was asked to measure.
+	 */
+int tune_measuring(void);
+
+/* Look up a choice in the cache.  Choices are kept for the
+	 instruction set in use, so a cache copied to another machine
+	 does not mislead it.
+
+	 kind[]: what was chosen, one word
+	 n, m: the sizes it was chosen for; m is 0 for one size
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT
+	 *values: places for up to max numbers
+	 max: most numbers to read
+
+	 Returns the number of numbers read, or -1 if there is no such
+	 choice.
+	 */
+int tune_get(const char kind[], int n, int m, int layout, int *values, int max);
+
+/* Record a choice, in the cache file and for tune_get().  Nothing is
+	 written if there is no cache directory.
+
+	 kind[], n, m, layout: as for tune_get()
+	 *values: the numbers to record
+	 count: how many, at most TUNE_MAX_VALUES
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int tune_put(const char kind[], int n, int m, int layout, const int *values, int count);
+
+/* Give FFTs of length n the factorisation in the cache, if there is
+	 one, or when measuring the fastest of a few candidate orders of
+	 their stages, through fft_prefer_radices().
+
+	 n: transform length
+	 layout: LAYOUT_INTERLEAVED or LAYOUT_SPLIT, as it will be executed
+
+	 Returns 0, or -1 if memory could not be allocated.
+	 */
+int tune_fft(int n, int layout);
+
+/* Free the cache read by tune_init().
+	 */
+void tune_finish(void);
+
+#endif
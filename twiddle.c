@@ -0,0 +1,293 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Twiddle factor tables.
+
+Every kernel needs exp(2 pi i k / n) for integer k.  Calling
+cexp() for each one is slow, and for large k the argument loses
+precision before cexp() ever sees it.  Instead each size gets one
+table of its n roots of unity, built once and shared by every
+kernel that transforms at that size.  Indices are reduced mod n
+in integers before the lookup.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <complex.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "twiddle.h"
+
+// CMPLX() only arrived in C11.  Older standards get the GCC builtin.
+#ifndef CMPLX
+#define CMPLX(x, y) __builtin_complex((double)(x), (double)(y))
+#endif
+
+/* One shared table.  Entries form a linked list; there are only
+	 ever a handful of distinct sizes in use. */
+struct twiddle_entry {
+	// order of the roots of unity
+	int n;
+	// number of users holding the table
+	int users;
+	double complex *table;
+	struct twiddle_entry *next;
+};
+
+// Head of the list of tables currently in use
+static struct twiddle_entry *tables = NULL;
+// Plans may be built and freed from any thread
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+// Directory large tables are kept in, empty for none
+static char cache_dir[256] = "";
+
+/* The header at the start of a cached table.  The n roots follow
+	 it in native byte order. */
+struct table_header {
+	char magic[8];
+	int32_t version;
+	int32_t n;
+};
+
+/* Root k of the n roots of unity, exp(2 pi i k / n), for k from 0
+	 to n-1.  Only the first eighth of the circle is computed with sin
+	 and cos; the rest follow from symmetry, so the table is exactly
+	 symmetric and every angle passed to sin and cos is at most pi/4.
+	 */
+static double complex root_of_unity(long k, int n) {
+	// angle and its sine and cosine
+	double angle, c, s;
+	// octant the index falls in, and its offset within the octant
+	long oct, r;
+
+	// 8k/n gives the octant.  Work out the offset from the
+	// nearest multiple of pi/2 without leaving integers.
+	oct = (8*k) / n;
+	switch (oct) {
+		case 0: case 7:
+			r = (oct == 0) ? k : k - n;
+			break;
+		case 1: case 2:
+			r = 4*k - n;
+			break;
+		case 3: case 4:
+			r = 2*k - n;
+			break;
+		default:
+			r = 4*k - 3*n;
+			break;
+	}
+	// Offsets in octants 1 to 6 were scaled to stay integral
+	angle = 2.0 * M_PI * (double)r / (double)n;
+	if (oct == 1 || oct == 2 || oct == 5 || oct == 6) {
+		angle /= 4.0;
+	} else if (oct == 3 || oct == 4) {
+		angle /= 2.0;
+	}
+	c = cos(angle);
+	s = sin(angle);
+	switch (oct) {
+		case 0: case 7:
+			return CMPLX(c, s);
+		case 1: case 2:
+			// angle measured from pi/2
+			return CMPLX(-s, c);
+		case 3: case 4:
+			// angle measured from pi
+			return CMPLX(-c, -s);
+		default:
+			// angle measured from 3 pi/2
+			return CMPLX(s, -c);
+	}
+}
+
+/* Fill table with the n roots of unity */
+static void fill_table(double complex *table, int n) {
+	// index variable
+	long k;
+
+	for (k = 0; k < n; k++) {
+		*(table + k) = root_of_unity(k, n);
+	}
+}
+
+/* Read a table of the n roots of unity from the cache directory.
+	 A few of the roots are worked out afresh and compared, so that a
+	 stale or damaged file is caught rather than used.  Returns 0, or
+	 -1 if there is no such file or it does not check out. */
+static int read_table(double complex *table, int n) {
+	// file name, and the file
+	char name[300];
+	FILE *file;
+	// its header, and the number of roots read
+	struct table_header header;
+	size_t got;
+	// index variable, and the root checked
+	int i;
+	long k;
+
+	snprintf(name, sizeof(name), "%s/twiddle_%d.bin", cache_dir, n);
+	if ((file = fopen(name, "rb")) == NULL) {
+		return -1;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| memcmp(header.magic, TWIDDLE_MAGIC, sizeof(TWIDDLE_MAGIC)) != 0
+		|| header.version != TWIDDLE_VERSION || header.n != n) {
+		fclose(file);
+		return -1;
+	}
+	got = fread(table, sizeof(double complex), n, file);
+	// A longer file belongs to something else
+	if (got != (size_t)n || fgetc(file) != EOF) {
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+
+	// One root in each quarter of the circle
+	for (i = 0; i < 4; i++) {
+		k = (long)n * i / 4 + 1;
+		if (k < n && cabs(*(table + k) - root_of_unity(k, n)) > TWIDDLE_CHECK_TOLERANCE) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Write a table of the n roots of unity to the cache directory.
+	 It goes to a temporary name first, so another process never
+	 reads half a table.  Failures are ignored: the table is
+	 only rebuilt next time. */
+static void write_table(const double complex *table, int n) {
+	// temporary and final file names, and the file
+	char temp[300], name[300];
+	FILE *file;
+	// its header
+	struct table_header header = { };
+
+	snprintf(temp, sizeof(temp), "%s/twiddle_%d.bin.%ld", cache_dir, n, (long)getpid());
+	snprintf(name, sizeof(name), "%s/twiddle_%d.bin", cache_dir, n);
+	if ((file = fopen(temp, "wb")) == NULL) {
+		return;
+	}
+	memcpy(header.magic, TWIDDLE_MAGIC, sizeof(TWIDDLE_MAGIC));
+	header.version = TWIDDLE_VERSION;
+	header.n = n;
+	if (fwrite(&header, sizeof(header), 1, file) != 1
+		|| fwrite(table, sizeof(double complex), n, file) != (size_t)n) {
+		fclose(file);
+		remove(temp);
+		return;
+	}
+	if (fclose(file) != 0 || rename(temp, name) != 0) {
+		remove(temp);
+	}
+}
+
+/* Keep large tables in files in a directory, so that later runs
+	 read them rather than building them again.  Tables are written
+	 as twiddle_<n>.bin, in the machine's own double format after a
+	 header giving TWIDDLE_MAGIC, TWIDDLE_VERSION and n.  A file whose
+	 header or spot checked roots do not match is built again and
+	 replaced.  Call before any plans are built.
+
+	 dir[]: cache directory, which must exist, or NULL to stop caching
+
+	 Returns 0, or -1 if the directory name is too long.
+	 */
+int twiddle_cache(const char dir[]) {
+	if (dir != NULL && strlen(dir) >= sizeof(cache_dir)) {
+		return -1;
+	}
+	pthread_mutex_lock(&tables_lock);
+	strcpy(cache_dir, (dir == NULL) ? "" : dir);
+	pthread_mutex_unlock(&tables_lock);
+	return 0;
+}
+
+/* Get the table of the n roots of unity exp(2 pi i k / n),
+	 k = 0 ... n-1.  Tables are shared: every caller asking for
+	 the same n gets the same table, which is built on first use.
+	 Each call must be matched by a twiddle_release().
+
+	 n: order of the roots of unity
+
+	 Returns NULL if memory could not be allocated.
+	 */
+double complex *twiddle_acquire(int n) {
+	// list entry for this size
+	struct twiddle_entry *entry;
+	// new table
+	void *table;
+
+	if (n < 1) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&tables_lock);
+	for (entry = tables; entry != NULL; entry = entry->next) {
+		if (entry->n == n) {
+			entry->users++;
+			pthread_mutex_unlock(&tables_lock);
+			return entry->table;
+		}
+	}
+
+	if ((entry = malloc(sizeof(struct twiddle_entry))) == NULL) {
+		pthread_mutex_unlock(&tables_lock);
+		return NULL;
+	}
+	if (posix_memalign(&table, TWIDDLE_ALIGN, n * sizeof(double complex)) != 0) {
+		free(entry);
+		pthread_mutex_unlock(&tables_lock);
+		return NULL;
+	}
+	if (*cache_dir == '\0' || n < TWIDDLE_CACHE_MIN) {
+		fill_table(table, n);
+	} else if (read_table(table, n) != 0) {
+		fill_table(table, n);
+		write_table(table, n);
+	}
+
+	entry->n = n;
+	entry->users = 1;
+	entry->table = table;
+	entry->next = tables;
+	tables = entry;
+	pthread_mutex_unlock(&tables_lock);
+
+	return table;
+}
+
+/* Give up a table from twiddle_acquire().  It is freed when
+	 the last user releases it.  NULL is ignored.
+
+	 *table: table to be released
+	 */
+void twiddle_release(double complex *table) {
+	// list entry, and the link pointing to it
+	struct twiddle_entry *entry, **link;
+
+	if (table == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&tables_lock);
+	for (link = &tables; (entry = *link) != NULL; link = &entry->next) {
+		if (entry->table == table) {
+			if (--entry->users == 0) {
+				*link = entry->next;
+				free(entry->table);
+				free(entry);
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock(&tables_lock);
+}
@@ -0,0 +1,68 @@
+/*
+DISCRETE FOURIER TRANSFORM
+
+Author:  Jeremy Stanger
+Date:
+
+Header file for the twiddle factor tables.
+Function prototypes and the lookup macro.
+
+*/
+
+#ifndef TWIDDLE_H
+#define TWIDDLE_H
+
+#include <complex.h>
+
+// Tables are aligned to this many bytes, ie. one cache line
+#define TWIDDLE_ALIGN 64
+// Tables of at least this many roots are kept in the cache directory,
+// if there is one.  Smaller ones are quicker to build than to read.
+#define TWIDDLE_CACHE_MIN 16384
+// First bytes of every cached table, NUL included
+#define TWIDDLE_MAGIC "DFTROOT"
+// Bumped whenever the cached tables change
+#define TWIDDLE_VERSION 1
+// Furthest a cached root may lie from the one worked out afresh
+#define TWIDDLE_CHECK_TOLERANCE 1e-15
+
+/* Look up exp(2 pi i k / n) in a table from twiddle_acquire(n).
+	 k may be any integer, including negative and products of two
+	 indices; it is reduced mod n exactly in integer arithmetic,
+	 so there is no loss of phase accuracy for large arguments.
+	 */
+#define twiddle(table, n, k) \
+	(*((table) + ((((long long)(k)) % (n) + (n)) % (n))))
+
+/* Get the table of the n roots of unity exp(2 pi i k / n),
+	 k = 0 ... n-1.  Tables are shared: every caller asking for
+	 the same n gets the same table, which is built on first use.
+	 Each call must be matched by a twiddle_release().
+
+	 n: order of the roots of unity
+
+	 Returns NULL if memory could not be allocated.
+	 */
+double complex *twiddle_acquire(int n);
+
+/* Keep large tables in files in a directory, so that later runs
+	 read them rather than building them again.  Tables are written
+	 as twiddle_<n>.bin, in the machine's own double format after a
+	 header giving TWIDDLE_MAGIC, TWIDDLE_VERSION and n.  A file whose
+	 header or spot checked roots do not match is built again and
+	 replaced.  Call before any plans are built.
+
+	 dir[]: cache directory, which must exist, or NULL to stop caching
+
+	 Returns 0, or -1 if the directory name is too long.
+	 */
+int twiddle_cache(const char dir[]);
+
+/* Give up a table from twiddle_acquire().  It is freed when
+	 the last user releases it.  NULL is ignored.
+
+	 *table: table to be released
+	 */
+void twiddle_release(double complex *table);
+
+#endif